@@ -0,0 +1,136 @@
+// Bytes on disk and scan throughput of the same rows in slotted, PAX and
+// compressed pages. Each table is bulk-loaded, reopened and scanned with a
+// TableScan; the best of several scans with a hot cache is reported, in GB/s
+// of serialized rows produced.
+//
+// Usage: compressed_scan [rows] [page size]   (defaults: 1000000 4096)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "file_storage.h"
+#include "table_scan.h"
+
+namespace
+{
+    constexpr int SCANS = 5;
+    const char *const REGIONS[] = {"north", "south", "east", "west", "central", "north-east", "south-west", "overseas"};
+
+    class NullLogger : public ILogger
+    {
+    public:
+        void log(const std::string &) override {}
+    };
+
+    const std::vector<Column> &columns()
+    {
+        static const std::vector<Column> columns = {{"id", DataType::INT}, {"status", DataType::INT}, {"day", DataType::DATE},
+                                                    {"amount", DataType::FLOAT}, {"region", DataType::TEXT}, {"qty", DataType::INT}};
+        return columns;
+    }
+
+    // Cold-table data: ascending ids and dates, a status with two values, few
+    // regions in long runs, and random amounts and quantities.
+    void writeRows(const std::string &filename, size_t rows)
+    {
+        std::ofstream out(filename);
+        out << "id\tstatus\tday\tamount\tregion\tqty\n";
+        std::mt19937 rng(1);
+        char day[16];
+        for (size_t i = 0; i < rows; i++)
+        {
+            size_t d = i / 2000;
+            std::snprintf(day, sizeof(day), "%02zu/%02zu/%04zu", d % 28 + 1, (d / 28) % 12 + 1, 2015 + d / 336);
+            int status = rng() % 5 == 0 ? 500 : 200;
+            float amount = static_cast<float>((rng() % 100000) / 100.0);
+            int qty = static_cast<int>(rng() % 100);
+            out << i << "\t" << status << "\t" << day << "\t" << amount << "\t" << REGIONS[(i / 50) % 8] << "\t" << qty << "\n";
+        }
+    }
+
+    const char *layoutName(PageLayout layout)
+    {
+        switch (layout)
+        {
+        case PageLayout::PAX:
+            return "pax";
+        case PageLayout::COMPRESSED:
+            return "compressed";
+        default:
+            return "slotted";
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t pageSize = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096;
+
+    NullLogger logger;
+    FileStorage storage(logger);
+    const std::string dir = "compressed_scan";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string data = dir + "/rows.tsv";
+    writeRows(data, rows);
+
+    std::printf("%zuK pages   pages   on disk      scan\n", pageSize / 1024);
+    for (PageLayout layout : {PageLayout::SLOTTED, PageLayout::PAX, PageLayout::COMPRESSED})
+    {
+        const std::string name = layoutName(layout);
+        {
+            Database db(dir + "/db", storage, logger);
+            db.initialize();
+            Table &table = db.createTable(name, columns(), layout, pageSize);
+            if (!table.writeDataFromFiles({data}))
+            {
+                std::fprintf(stderr, "Failed to load %s\n", name.c_str());
+                return 1;
+            }
+        }
+
+        // Reopened, so that the scan reads the pages as they are stored.
+        Database db(dir + "/db", storage, logger);
+        db.initialize();
+        PageManager &pageManager = db.getTable(name).getPageManager();
+        size_t pages = pageManager.getPageIds().size();
+
+        double best = 1e9;
+        size_t scanned = 0;
+        size_t bytes = 0;
+        for (int scan = 0; scan < SCANS; scan++)
+        {
+            TableScan tableScan(pageManager, columns());
+            RowBatch batch;
+            scanned = 0;
+            bytes = 0;
+            auto start = std::chrono::steady_clock::now();
+            tableScan.open();
+            while (tableScan.next(batch))
+            {
+                for (const auto &row : batch.rows)
+                {
+                    bytes += row.size();
+                }
+                scanned += batch.rows.size();
+            }
+            tableScan.close();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        if (scanned != rows)
+        {
+            std::fprintf(stderr, "%s: scanned %zu of %zu rows\n", name.c_str(), scanned, rows);
+            return 1;
+        }
+        std::printf("%-10s %7zu  %6.1f MB  %5.2f GB/s\n", name.c_str(), pages, pages * pageSize / 1e6, bytes / best / 1e9);
+    }
+    return 0;
+}
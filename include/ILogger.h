@@ -1,10 +1,96 @@
 // ILogger.h
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <string>
 
+enum class LogLevel : uint8_t
+{
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4,
+    OFF = 5
+};
+
+// Messages below this level are compiled out entirely by the LOG_* macros.
+// Set with -DMAKEDB_MIN_LOG_LEVEL=<0..5> (see the CMake cache variable).
+#ifndef MAKEDB_MIN_LOG_LEVEL
+#define MAKEDB_MIN_LOG_LEVEL 0
+#endif
+
+inline const char *logLevelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::TRACE:
+        return "TRACE";
+    case LogLevel::DEBUG:
+        return "DEBUG";
+    case LogLevel::INFO:
+        return "INFO";
+    case LogLevel::WARN:
+        return "WARN";
+    case LogLevel::ERROR:
+        return "ERROR";
+    default:
+        return "OFF";
+    }
+}
+
 class ILogger
 {
 public:
     virtual ~ILogger() = default;
     virtual void log(const std::string &message) = 0;
+
+    // Leveled entry point. Loggers that do not care about levels only need to
+    // implement log(message); the default drops messages below the runtime level.
+    virtual void log(LogLevel level, const std::string &message)
+    {
+        if (isEnabled(level))
+        {
+            log(message);
+        }
+    }
+
+    bool isEnabled(LogLevel level) const
+    {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+    void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel getLevel() const { return level_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<LogLevel> level_{LogLevel::INFO};
 };
+
+// The message expression is only evaluated when the level survives both the
+// compile-time and the runtime filter, so disabled messages cost one relaxed load.
+// With no compile-time minimum the level is not compared against it at all.
+#if MAKEDB_MIN_LOG_LEVEL > 0
+#define MAKEDB_LOG(logger, level, message)                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        if (static_cast<int>(level) >= MAKEDB_MIN_LOG_LEVEL && (logger).isEnabled(level))         \
+        {                                                                                         \
+            (logger).log(level, message);                                                         \
+        }                                                                                         \
+    } while (0)
+#else
+#define MAKEDB_LOG(logger, level, message)                                                        \
+    do                                                                                            \
+    {                                                                                             \
+        if ((logger).isEnabled(level))                                                            \
+        {                                                                                         \
+            (logger).log(level, message);                                                         \
+        }                                                                                         \
+    } while (0)
+#endif
+
+#define LOG_TRACE(logger, message) MAKEDB_LOG(logger, LogLevel::TRACE, message)
+#define LOG_DEBUG(logger, message) MAKEDB_LOG(logger, LogLevel::DEBUG, message)
+#define LOG_INFO(logger, message) MAKEDB_LOG(logger, LogLevel::INFO, message)
+#define LOG_WARN(logger, message) MAKEDB_LOG(logger, LogLevel::WARN, message)
+#define LOG_ERROR(logger, message) MAKEDB_LOG(logger, LogLevel::ERROR, message)
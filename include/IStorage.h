@@ -1,6 +1,7 @@
 #pragma once
 #include <cstddef>
 #include <ios>
+#include <string>
 
 class IStorage
 {
@@ -12,4 +13,19 @@ public:
     virtual bool fileExists(const std::string &filename) = 0;
     virtual bool createFile(const std::string &filename) = 0;
     virtual size_t getSize(const std::string &filename) = 0;
+    virtual bool removeFile(const std::string &filename) = 0;
+    // Forces the file's written data and metadata to stable storage (fsync).
+    virtual void syncFile(const std::string &filename) = 0;
+    // Forces the written data, and only the metadata needed to read it back,
+    // to stable storage (fdatasync).
+    virtual void syncData(const std::string &filename) = 0;
+    // Starts writing back a range of the file without waiting for it, so that
+    // a later sync has less left to do.
+    virtual void flushRange(const std::string &filename, std::size_t offset, std::size_t size) = 0;
+    // Reserves disk space for the file to grow to size bytes without changing
+    // its size. Returns false when the file system cannot do so.
+    virtual bool preallocate(const std::string &filename, std::size_t size) = 0;
+    // Starts reading a range of the file into memory without waiting for it,
+    // so that later reads of the range do not wait for the device.
+    virtual void prefetch(const std::string &filename, std::size_t offset, std::size_t size) = 0;
 };
\ No newline at end of file
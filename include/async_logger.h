@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "ILogger.h"
+
+// Logger that keeps I/O off the calling thread: enabled messages are
+// pushed into a bounded lock-free ring buffer (multi-producer, single-consumer)
+// and a background thread writes them out, flushing once per drained batch.
+// When the ring is full the message is dropped rather than blocking the caller;
+// drops are counted and reported by the writer thread.
+class AsyncLogger : public ILogger
+{
+public:
+    explicit AsyncLogger(std::ostream &out = std::cout, size_t capacity = 8192);
+    ~AsyncLogger() override;
+
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    void log(const std::string &message) override;
+    void log(LogLevel level, const std::string &message) override;
+
+    // Blocks until every message pushed before the call has been written.
+    void flush();
+
+    uint64_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        std::string message;
+    };
+
+    bool push(LogLevel level, const std::string &message);
+    bool pop(LogLevel &level, std::string &message);
+    void run();
+    size_t drain();
+
+    std::ostream &out_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+
+    // Producers claim slots at tail_; the writer thread alone advances head_.
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+    std::atomic<size_t> written_{0};
+
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reportedDrops_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread writer_;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "schema.h"
+#include "row.h"
+#include "page_size.h"
+
+struct BloomFilterHeader
+{
+    uint32_t num_pages;        // Number of page filters stored in the file.
+    uint32_t blocks_per_page;  // Filter size of one page, in BLOCK_WORDS-word blocks.
+};
+
+// Split-block Bloom filter: every key sets one bit in each of the eight 32-bit
+// words of a single 32-byte block, so a probe touches exactly one cache line.
+// The eight bit positions come from eight multiplicative hashes of the key,
+// computed together in one AVX2 register when the CPU supports it.
+namespace blocked_bloom
+{
+    constexpr size_t BLOCK_WORDS = 8;
+
+    void insert(uint32_t *filter, uint32_t numBlocks, uint64_t hash);
+    bool mayContain(const uint32_t *filter, uint32_t numBlocks, uint64_t hash);
+}
+
+// One blocked Bloom filter per page over a single column, stored in
+// <table>/<column>.bloom next to the page directory. Equality scans probe it
+// to skip pages that certainly do not contain the value.
+class PageBloomFilters
+{
+public:
+    // 8 blocks of 32 bytes per PAGE_SIZE bytes of page: 2048 bits per 4K page,
+    // about 10-20 bits per row for typical rows. Larger pages hold
+    // proportionally more rows and get proportionally more blocks.
+    static constexpr uint32_t BLOCKS_PER_PAGE = 8;
+
+    PageBloomFilters(const std::string &tableName, const std::string &columnName, IStorage &storage, size_t pageSize = PAGE_SIZE,
+                     ILogger &logger = GlobalLogger::instance())
+        : storage_(storage),
+          filename_(tableName + "/" + columnName + ".bloom"),
+          columnName_(columnName),
+          logger_(logger),
+          header_{0, blocksForPageSize(pageSize)} {};
+
+    static uint32_t blocksForPageSize(size_t pageSize)
+    {
+        return static_cast<uint32_t>(std::max<size_t>(BLOCKS_PER_PAGE * pageSize / PAGE_SIZE, 1));
+    }
+
+    // Hash of a column value; must agree between ingest and probes.
+    static uint64_t hashValue(const Row::Value &value, DataType type);
+
+    bool initialize();
+    bool exists();
+    void add(uint32_t pageId, uint64_t hash);
+    // Returns false only when the page certainly holds no row with this hash.
+    bool mayContain(uint32_t pageId, uint64_t hash) const;
+    // Writes the header and the contiguous range of filters changed since the last persist.
+    void persist();
+    // Forces the last persisted filters to stable storage.
+    void sync();
+    // Drops every filter and resizes them to blocksPerPage blocks, for a
+    // rebuild. The next persist rewrites the whole file.
+    void reset(uint32_t blocksPerPage);
+
+    uint32_t getBlocksPerPage() const { return header_.blocks_per_page; }
+
+    const std::string &getColumnName() const { return columnName_; }
+
+private:
+    size_t pageWords() const { return header_.blocks_per_page * blocked_bloom::BLOCK_WORDS; }
+
+    IStorage &storage_;
+    std::string filename_;
+    std::string columnName_;
+    ILogger &logger_;
+    BloomFilterHeader header_;
+    // Lets scans probe the filters while inserts add to them.
+    mutable std::shared_mutex latch_;
+    std::vector<uint32_t> filters_;
+    uint32_t dirtyBegin_ = UINT32_MAX;
+    uint32_t dirtyEnd_ = 0;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "location.h"
+#include "page_size.h"
+
+// Page 0 of an index file holds the metadata of the tree. Every other page is a node.
+struct BTreeMetaPage
+{
+    uint32_t root_page_id; // 0 while the tree is empty
+    uint32_t num_pages;    // Number of pages in the file, including the meta page.
+    uint32_t height;       // Number of levels, 1 when the root is a leaf.
+    uint32_t num_entries;  // Total number of (key, location) pairs stored.
+    uint32_t clean;        // BPlusTree::CLEAN_MARK while the file matches its table.
+};
+
+struct BTreeNodeHeader
+{
+    uint16_t is_leaf;
+    uint16_t num_keys;
+    uint32_t next_leaf; // Right sibling of a leaf, 0 if none (page 0 is never a node).
+};
+
+// Leaves store (key, location) pairs sorted by key.
+struct BTreeLeafEntry
+{
+    int32_t key;
+    uint32_t page_id;
+    uint16_t slot_id;
+    uint16_t reserved;
+};
+
+// Internal nodes store children[0] followed by (key, child) pairs, where every key in
+// the subtree of child i + 1 is >= key i.
+struct BTreeInternalEntry
+{
+    int32_t key;
+    uint32_t child;
+};
+
+// A disk-resident B+tree mapping INT/DATE column values to row locations.
+// Duplicate keys are allowed, and leaves are linked left to right for range scans.
+class BPlusTree
+{
+public:
+    using Entry = std::pair<int32_t, Location>;
+
+    static constexpr size_t LEAF_CAPACITY = (PAGE_SIZE - sizeof(BTreeNodeHeader)) / sizeof(BTreeLeafEntry);
+    static constexpr size_t INTERNAL_CAPACITY = (PAGE_SIZE - sizeof(BTreeNodeHeader) - sizeof(uint32_t)) / sizeof(BTreeInternalEntry);
+    static constexpr uint32_t CLEAN_MARK = 0x434c4e31;
+
+    BPlusTree(const std::string &tableName, const std::string &columnName, IStorage &storage, ILogger &logger = GlobalLogger::instance())
+        : storage_(storage),
+          filename_(tableName + "/" + columnName + ".btree"),
+          columnName_(columnName),
+          logger_(logger),
+          meta_{0, 1, 0, 0, 0} {};
+
+    bool initialize();
+    bool exists();
+    // Deletes the index file, so that initialize starts an empty tree.
+    void removeFiles();
+    // Index files are written outside the log, so the table marks an index
+    // dirty on stable storage before committing a change it has yet to apply
+    // to it, and clean again once both are on stable storage. An index found
+    // dirty when the table is opened may miss committed changes, or hold
+    // torn pages, and is rebuilt.
+    bool isClean() const { return meta_.clean == CLEAN_MARK; }
+    void markDirty();
+    void markClean();
+    // Builds the tree bottom-up from entries sorted by key. If the tree already
+    // holds data the entries are inserted one by one instead.
+    bool bulkLoad(const std::vector<Entry> &sortedEntries);
+    bool insert(int32_t key, const Location &location);
+    // Removes one (key, location) pair; false when the tree does not hold it.
+    // Leaves are not merged, so a tree that shrinks keeps its pages.
+    bool remove(int32_t key, const Location &location);
+    // Returns the locations of all entries with low <= key <= high, in key order.
+    // The leaf walk stops as soon as `limit` locations have been collected.
+    std::vector<Location> rangeScan(int32_t low, int32_t high, size_t limit = SIZE_MAX);
+
+    const std::string &getColumnName() const { return columnName_; }
+    uint32_t size() const { return meta_.num_entries; }
+
+private:
+    struct Split
+    {
+        bool happened;
+        int32_t separator;
+        uint32_t rightPageId;
+    };
+
+    void readNode(uint32_t pageId, std::vector<char> &buffer);
+    void writeNode(uint32_t pageId, std::vector<char> &buffer);
+    uint32_t allocatePage();
+    void persistMeta();
+    // Inserts without persisting the meta page, so a batch writes it once.
+    void insertEntry(int32_t key, const Location &location);
+    Split insertInto(uint32_t pageId, int32_t key, const Location &location);
+
+    IStorage &storage_;
+    std::string filename_;
+    std::string columnName_;
+    ILogger &logger_;
+    BTreeMetaPage meta_;
+};
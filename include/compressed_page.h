@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "ILogger.h"
+#include "global_logger.h"
+#include "page_size.h"
+#include "page_format.h"
+#include "schema.h"
+#include "row.h"
+
+struct CompressedPageHeader
+{
+    uint64_t lsn;      // See getPageLsn.
+    uint32_t checksum; // See setPageChecksum.
+    uint16_t numRows;
+    uint16_t numColumns;
+    uint32_t usedBytes;  // Header, column headers and encoded columns.
+    uint32_t plainBytes; // requiredSpace of every row on the page, summed.
+};
+static_assert(offsetof(CompressedPageHeader, lsn) == 0, "the page LSN must lead the header");
+static_assert(offsetof(CompressedPageHeader, checksum) == PAGE_CHECKSUM_OFFSET, "the checksum must follow the LSN");
+
+// How the values of one column of a compressed page are stored. INT, FLOAT
+// and DATE values (dates as YYYYMMDD integers) are 32-bit words, TEXT values
+// byte strings.
+enum class ColumnEncoding : uint8_t
+{
+    PLAIN,              // Every value in slot order.
+    FRAME_OF_REFERENCE, // The smallest word, then bitWidth-bit offsets from it. Words only.
+    DICTIONARY,         // count distinct values, then bitWidth-bit codes into them.
+    RUN_LENGTH          // count runs of equal values, each with the slot it ends before.
+};
+
+struct CompressedColumnHeader
+{
+    ColumnEncoding encoding;
+    uint8_t bitWidth;
+    uint16_t count;  // DICTIONARY values or RUN_LENGTH runs.
+    uint32_t offset; // Of the encoded column.
+};
+
+// Value of a column of one row while it is packed.
+struct PackedField
+{
+    uint32_t word = 0; // INT, FLOAT and DATE
+    std::string text;  // TEXT
+};
+
+// What the rows packed onto a compressed page so far look like, column by
+// column: range, runs and distinct values. The size of the cheapest encoding
+// of every column follows, so rows can be added one at a time until the
+// encoded page is full.
+class CompressedPageStatistics
+{
+public:
+    CompressedPageStatistics(const std::vector<Column> &columns, size_t pageSize);
+
+    // Adds the row unless the page would then take more than pageSize bytes
+    // encoded, or hold more rows than a slot id can address. Returns false,
+    // leaving the statistics unchanged, when the row does not fit.
+    bool add(uint32_t rowId, const std::vector<PackedField> &fields);
+    bool add(uint32_t rowId, const std::vector<char> &row);
+    void clear();
+
+    size_t numRows() const { return numRows_; }
+    // Bytes of the page holding the rows added so far.
+    size_t pageBytes() const;
+    // Cheapest encoding of a column (0 for the row ids, c + 1 for column c)
+    // and the bytes it takes.
+    ColumnEncoding encoding(size_t column, size_t &bytes, uint8_t &bitWidth) const;
+
+private:
+    struct ColumnStats
+    {
+        bool isText = false;
+        bool isSigned = false; // Words compare as int32_t, otherwise as uint32_t.
+        int64_t min = 0;
+        int64_t max = 0;
+        size_t runs = 0;
+        size_t textBytes = 0;
+        size_t runBytes = 0;
+        size_t distinctBytes = 0;
+        std::unordered_set<uint32_t> distinctWords;
+        std::unordered_set<std::string> distinctTexts;
+        bool hasLast = false;
+        PackedField last; // Of the latest row, which a new run starts after.
+
+        int64_t key(uint32_t word) const { return isSigned ? static_cast<int32_t>(word) : static_cast<int64_t>(word); }
+        // Bytes of the cheapest encoding, counting field as one more row when given.
+        size_t bytes(size_t numRows, const PackedField *field, ColumnEncoding &encoding, uint8_t &bitWidth) const;
+        void add(const PackedField &field);
+    };
+
+    size_t pageBytes(uint32_t rowId, const std::vector<PackedField> *fields) const;
+
+    std::vector<Column> columns_;
+    size_t pageSize_;
+    size_t numRows_ = 0;
+    std::vector<ColumnStats> stats_; // Row ids first, then one per column.
+};
+
+// Read-mostly column-major layout for cold data. Like PAX, every column is
+// stored contiguously, but each column is encoded with whichever of
+// ColumnEncoding takes the fewest bytes for the rows on the page, chosen from
+// CompressedPageStatistics when the page is built. The row ids form one more
+// column, ahead of the others.
+//
+// +--------+----------------+---------+----------+----------+-----+------+
+// | header | column headers | row ids | column 0 | column 1 | ... | free |
+// +--------+----------------+---------+----------+----------+-----+------+
+//
+// Inserts decode the page, append the rows and encode it again, which can
+// take more room for the old rows than before: one value outside their range
+// widens every offset. freeSpace therefore only promises what the rows would
+// need unencoded, so inserts of single batches always fit; bulk loads use
+// CompressedPageStatistics to pack pages by their encoded size instead.
+class CompressedPage : public IPageFormat
+{
+public:
+    CompressedPage(ILogger &logger = GlobalLogger::instance()) : logger_(logger) {};
+
+    void setSchema(const std::vector<Column> &columns) { columns_ = columns; }
+    // Statistics to pack rows onto pages of this format.
+    CompressedPageStatistics statistics() const { return CompressedPageStatistics(columns_, pageSize_); }
+
+    void initPage(std::vector<char> &page) override;
+    size_t emptyPageSpace() override;
+    size_t requiredSpace(const std::vector<char> &row) override;
+    size_t freeSpace(const std::vector<char> &page) override;
+    std::vector<ReturnType> insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry) override;
+    bool verifyPage(std::vector<char> &buffer) override;
+
+    std::vector<ReturnType> readRows(const std::vector<char> &page, uint32_t pageId) override;
+    Data read(const std::vector<char> &page, uint16_t slotId) override;
+
+    // Returns every value of one column, in slot order, decoding only that column.
+    std::vector<Row::Value> readColumn(const std::vector<char> &page, size_t columnIndex);
+    // Encoding of a column of the page.
+    ColumnEncoding columnEncoding(const std::vector<char> &page, size_t columnIndex) const;
+
+private:
+    // Decoded values of one column (0 for the row ids, c + 1 for column c).
+    void decodeColumn(const std::vector<char> &page, size_t column, std::vector<PackedField> &values) const;
+    PackedField decodeField(const std::vector<char> &page, size_t column, uint16_t slotId) const;
+    void appendField(std::vector<char> &row, size_t columnIndex, const PackedField &field) const;
+    void build(const std::vector<uint32_t> &ids, const std::vector<std::vector<PackedField>> &rows, size_t plainBytes,
+               std::vector<char> &page);
+
+    ILogger &logger_;
+    std::vector<Column> columns_;
+};
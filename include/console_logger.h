@@ -3,11 +3,21 @@
 #include "ILogger.h"
 #include <iostream>
 
+// Synchronous logger. Writes '\n' rather than std::endl so that stdout is not
+// flushed on every message.
 class ConsoleLogger : public ILogger
 {
 public:
     void log(const std::string &message) override
     {
-        std::cout << "[INFO] " << message << std::endl;
+        std::cout << "[INFO] " << message << '\n';
+    }
+
+    void log(LogLevel level, const std::string &message) override
+    {
+        if (isEnabled(level))
+        {
+            std::cout << '[' << logLevelName(level) << "] " << message << '\n';
+        }
     }
 };
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) of data, continuing from crc so that a buffer can be
+// checksummed in pieces. Uses the SSE4.2 or ARMv8 CRC instructions when the
+// CPU has them, several GB/s per core, and a slice-by-8 table otherwise.
+uint32_t crc32c(const char *data, size_t size, uint32_t crc = 0);
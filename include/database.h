@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "parser.h"
+#include "schema.h"
+#include "table.h"
+
+// A set of tables in one directory, each in <directory>/<name>, listed in
+// <directory>/catalog.dat. The catalog holds the schema of every table, so a
+// table's files are only read, and its log recovered, when it is first used
+// (see getTable). Processes with hundreds of tables then pay at startup for
+// the catalog alone. All tables share the database's storage, logger and
+// parser.
+//
+// The catalog is append-only, one record per created table: the uint32_t
+// length and CRC-32C of the payload, then the uint16_t length and bytes of
+// the table name and the table's serialized schema (see Schema::serialize).
+// A torn record at its end, left by a crash, is dropped when it is opened.
+class Database
+{
+public:
+    Database(const std::string &directory, IStorage &storage, ILogger &logger = GlobalLogger::instance());
+    ~Database();
+
+    // Creates the catalog when missing and loads the tables it lists. Needed
+    // before any other call.
+    bool initialize();
+
+    // Creates a table and opens it. Throws invalid_argument when the name is
+    // taken or cannot be a directory name, or the schema is invalid.
+    Table &createTable(const std::string &name, std::vector<Column> columns,
+                       PageLayout layout = PageLayout::SLOTTED, size_t pageSize = PAGE_SIZE);
+    // The table with the given name, opened on first use. Throws
+    // invalid_argument when there is none.
+    Table &getTable(const std::string &name);
+    bool hasTable(const std::string &name) const;
+    // Names of all tables, in ascending order.
+    std::vector<std::string> listTables() const;
+    // Schema of a table as listed in the catalog, without opening it.
+    std::vector<Column> getSchema(const std::string &name) const;
+    // Number of tables opened so far.
+    size_t openTableCount() const;
+
+private:
+    struct OpenTable;
+    struct Entry
+    {
+        std::vector<Column> columns;
+        PageLayout layout;
+        size_t pageSize;
+        std::mutex openMutex; // Held while the table is opened.
+        std::unique_ptr<OpenTable> table;
+    };
+
+    static void validateName(const std::string &name);
+    Entry *findEntry(const std::string &name) const;
+    std::unique_ptr<OpenTable> open(const std::string &name, const Entry &entry);
+    void appendRecord(const std::string &name, const std::vector<char> &schema);
+
+    std::string directory_;
+    std::string catalogPath_;
+    IStorage &storage_;
+    ILogger &logger_;
+    Parser parser_;
+    mutable std::mutex mutex_; // Guards tables_.
+    std::mutex createMutex_;   // Serialises createTable; guards end_.
+    std::map<std::string, std::unique_ptr<Entry>> tables_;
+    uint64_t end_ = 0; // Offset the next catalog record is written at.
+    std::atomic<bool> initialized_{false};
+};
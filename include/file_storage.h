@@ -14,6 +14,12 @@ public:
     bool fileExists(const std::string &filename) override;
     bool createFile(const std::string &filename) override;
     size_t getSize(const std::string &filename) override;
+    bool removeFile(const std::string &filename) override;
+    void syncFile(const std::string &filename) override;
+    void syncData(const std::string &filename) override;
+    void flushRange(const std::string &filename, std::size_t offset, std::size_t size) override;
+    bool preallocate(const std::string &filename, std::size_t size) override;
+    void prefetch(const std::string &filename, std::size_t offset, std::size_t size) override;
 
 private:
     ILogger &logger_;
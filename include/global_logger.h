@@ -1,12 +1,34 @@
 #pragma once 
+#include <atomic>
 #include "ILogger.h"
 #include "console_logger.h"
 // The global logger is a singleton class that provides a single point of access to the logger.
+// It defaults to a ConsoleLogger; install() swaps in another logger (e.g. an
+// AsyncLogger) for objects constructed afterwards. Objects keep the logger they
+// were constructed with, so the installed logger must outlive them.
 
 class GlobalLogger {
     public: 
         static ILogger &instance() {
+            return *current().load(std::memory_order_acquire);
+        }
+
+        static void install(ILogger &logger) {
+            current().store(&logger, std::memory_order_release);
+        }
+
+        static void reset() {
+            install(console());
+        }
+
+    private:
+        static ConsoleLogger &console() {
             static ConsoleLogger logger; 
             return logger;
         }
-};
\ No newline at end of file
+
+        static std::atomic<ILogger *> &current() {
+            static std::atomic<ILogger *> logger{&console()};
+            return logger;
+        }
+};
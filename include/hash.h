@@ -0,0 +1,57 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+// 64-bit non-cryptographic hash used by the hash index. It consumes 8 bytes per
+// round and finishes with a murmur3-style avalanche so that the low bits, which
+// select buckets, depend on every input byte.
+inline uint64_t hashMix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t hashBytes(const char *data, size_t size, uint64_t seed = 0)
+{
+    const uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = seed ^ (size * multiplier);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ hashMix(word)) * multiplier;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = (h ^ hashMix(tail)) * multiplier;
+
+    return hashMix(h);
+}
+
+// Bits of a float to hash, alike for values that compare equal: -0.0 gives
+// the bits of +0.0. NaN equals nothing, so it can never match; every NaN gives
+// the bits of the default quiet NaN, so its sign and payload never matter.
+inline uint32_t floatHashBits(float f)
+{
+    if (f == 0.0f)
+    {
+        f = 0.0f;
+    }
+    else if (std::isnan(f))
+    {
+        f = std::numeric_limits<float>::quiet_NaN();
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
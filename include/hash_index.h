@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "location.h"
+#include "page_size.h"
+
+// Page 0 of the bucket file holds the metadata of the index.
+struct HashIndexMetaPage
+{
+    uint32_t level;              // Number of completed doublings of the bucket count.
+    uint32_t next_split;         // Next bucket to split in the current round.
+    uint32_t initial_buckets;    // Bucket count at level 0, a power of two.
+    uint32_t num_overflow_pages; // Pages allocated in the overflow file, including page 0.
+    uint32_t free_overflow_head; // First overflow page released by a split, 0 if none.
+    uint32_t clean;              // HashIndex::CLEAN_MARK while the files match the table.
+    uint64_t num_entries;
+};
+
+struct HashBucketHeader
+{
+    uint16_t num_entries;
+    uint16_t reserved;
+    uint32_t overflow_page; // Next page of the bucket chain in the overflow file, 0 if none.
+};
+
+// Buckets store only the hash of the key; callers recheck candidate rows, so long
+// TEXT values never have to fit in an index page.
+struct HashBucketEntry
+{
+    uint64_t hash;
+    uint32_t page_id;
+    uint16_t slot_id;
+    uint16_t reserved;
+};
+
+// An on-disk linear hash index mapping TEXT column values to row locations.
+// Bucket b lives at page b + 1 of <table>/<column>.hash, so the bucket file only
+// ever grows at its end; chains overflow into <table>/<column>.hashovf.
+class HashIndex
+{
+public:
+    using Entry = std::pair<uint64_t, Location>;
+
+    static constexpr size_t BUCKET_CAPACITY = (PAGE_SIZE - sizeof(HashBucketHeader)) / sizeof(HashBucketEntry);
+    static constexpr uint32_t INITIAL_BUCKETS = 4;
+    // A bucket is split whenever the average bucket is more than this full.
+    static constexpr double MAX_LOAD_FACTOR = 0.75;
+    static constexpr uint32_t CLEAN_MARK = 0x434c4e31;
+
+    HashIndex(const std::string &tableName, const std::string &columnName, IStorage &storage, ILogger &logger = GlobalLogger::instance())
+        : storage_(storage),
+          filename_(tableName + "/" + columnName + ".hash"),
+          overflowFilename_(tableName + "/" + columnName + ".hashovf"),
+          columnName_(columnName),
+          logger_(logger),
+          meta_{0, 0, INITIAL_BUCKETS, 1, 0, 0, 0} {};
+
+    static uint64_t hashKey(const std::string &key);
+
+    bool initialize();
+    bool exists();
+    // Deletes both index files, so that initialize starts an empty index.
+    void removeFiles();
+    // Dirty and clean on stable storage like a BPlusTree (see
+    // BPlusTree::markDirty).
+    bool isClean() const { return meta_.clean == CLEAN_MARK; }
+    void markDirty();
+    void markClean();
+    bool insert(const std::string &key, const Location &location);
+    // Inserts many entries, reading and writing each affected bucket chain once.
+    bool insertBatch(const std::vector<Entry> &entries);
+    // Removes one (key, location) pair; false when the index does not hold it.
+    bool remove(const std::string &key, const Location &location);
+    // Returns the locations of all rows whose key hashes like `key`. Callers must
+    // compare the actual column value to discard hash collisions.
+    std::vector<Location> lookup(const std::string &key);
+
+    const std::string &getColumnName() const { return columnName_; }
+    uint64_t size() const { return meta_.num_entries; }
+    uint32_t numBuckets() const { return (meta_.initial_buckets << meta_.level) + meta_.next_split; }
+
+private:
+    uint32_t bucketFor(uint64_t hash) const;
+    std::vector<HashBucketEntry> readChain(uint32_t bucket, std::vector<uint32_t> &overflowPages);
+    void writeChain(uint32_t bucket, const std::vector<HashBucketEntry> &entries, std::vector<uint32_t> &overflowPages);
+    uint32_t allocateOverflowPage();
+    void releaseOverflowPage(uint32_t pageId);
+    void splitNextBucket();
+    void growFor(uint64_t numEntries);
+    void persistMeta();
+
+    IStorage &storage_;
+    std::string filename_;
+    std::string overflowFilename_;
+    std::string columnName_;
+    ILogger &logger_;
+    HashIndexMetaPage meta_;
+};
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "operator.h"
+#include "row.h"
+#include "spill_file.h"
+
+// One input of a join: the operator, its join column and the columns it
+// contributes to the output. An empty projection keeps every column.
+struct JoinInput
+{
+    Operator &input;
+    size_t keyColumn;
+    std::vector<size_t> projection;
+};
+
+// Equi-join of two inputs (typically TableScans). The hash table is built on
+// the side with fewer pages and probed with batches from the other side.
+// Output rows are the projected left columns followed by the projected right
+// columns, whichever side was built.
+//
+// When the build side grows beyond the memory budget the join switches to
+// Grace partitioning: both inputs are hashed on the join key into partition
+// files in spillDir and every partition pair is joined on its own. A build
+// partition that still does not fit is partitioned again with another seed,
+// up to MAX_PARTITION_LEVEL times.
+class HashJoin : public Operator
+{
+public:
+    static constexpr size_t MAX_PARTITIONS = 64;
+    static constexpr uint32_t MAX_PARTITION_LEVEL = 3;
+
+    HashJoin(JoinInput left, JoinInput right, size_t memoryBudget, IStorage &storage, const std::string &spillDir,
+             ILogger &logger = GlobalLogger::instance());
+    ~HashJoin() override;
+
+    const std::vector<Column> &getSchema() override { return outputSchema_; }
+    bool open() override;
+    bool next(RowBatch &batch) override;
+    // Removes the partition files that are still on disk.
+    void close() override;
+
+    bool isPartitioned() const { return partitioned_; }
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Row::Value &key) const;
+    };
+
+    // A row reduced to its join key and projected columns.
+    struct JoinRow
+    {
+        Row::Value key;
+        std::vector<char> projected;
+    };
+
+    struct Partition
+    {
+        std::string buildFile;
+        std::string probeFile;
+        uint32_t level;
+    };
+
+    JoinRow extract(size_t side, const std::vector<char> &bytes) const;
+    // Spill records are the key, serialized as a one-column row, followed by the projected columns.
+    std::vector<char> encode(size_t side, const JoinRow &row) const;
+    JoinRow decode(size_t side, const std::vector<char> &record) const;
+    size_t partitionOf(const Row::Value &key, uint32_t level) const;
+    size_t footprint(const JoinRow &row) const;
+
+    std::vector<std::unique_ptr<SpillWriter>> createWriters(uint32_t level);
+    // Finishes the writers and queues one partition per build/probe writer pair.
+    void queuePartitions(std::vector<std::unique_ptr<SpillWriter>> &buildWriters,
+                         std::vector<std::unique_ptr<SpillWriter>> &probeWriters, uint32_t level);
+    void partitionFile(size_t side, const std::string &filename, std::vector<std::unique_ptr<SpillWriter>> &writers,
+                       uint32_t level);
+    void removeSpillFile(const std::string &filename);
+
+    void insert(JoinRow row);
+    // Loads the next partition whose build side fits in memory. Returns false when none is left.
+    bool loadNextPartition();
+    bool nextProbeRow();
+    std::vector<char> combine(const std::vector<char> &probeProjected, const std::vector<char> &buildProjected) const;
+
+    JoinInput inputs_[2];
+    std::vector<Column> keySchema_[2];
+    std::vector<Column> outputSchema_;
+    size_t memoryBudget_;
+    IStorage &storage_;
+    std::string spillDir_;
+    ILogger &logger_;
+    uint32_t operatorId_;
+    uint32_t nextFileId_ = 0;
+
+    size_t buildSide_ = 1;
+    size_t probeSide() const { return 1 - buildSide_; }
+
+    std::unordered_multimap<Row::Value, std::vector<char>, KeyHash> table_;
+    size_t tableBytes_ = 0;
+    bool partitioned_ = false;
+    std::deque<Partition> partitions_;
+    std::vector<std::string> spillFiles_;
+
+    // Probe state: rows come from the probe input until it is partitioned,
+    // afterwards from the probe file of the current partition.
+    bool probeFromInput_ = false;
+    RowBatch probeBatch_;
+    size_t probePosition_ = 0;
+    std::unique_ptr<SpillReader> probeReader_;
+    Partition current_{};
+    JoinRow probeRow_;
+    std::unordered_multimap<Row::Value, std::vector<char>, KeyHash>::const_iterator match_, matchEnd_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "operator.h"
+#include "row.h"
+#include "sort_operator.h"
+
+// LIMIT n: passes the first n input rows through and then closes its input
+// without asking it for more.
+class LimitOperator : public Operator
+{
+public:
+    LimitOperator(Operator &input, size_t limit) : input_(input), limit_(limit) {};
+
+    const std::vector<Column> &getSchema() override { return input_.getSchema(); }
+    bool open() override;
+    bool next(RowBatch &batch) override;
+    void close() override;
+
+private:
+    Operator &input_;
+    size_t limit_;
+    size_t produced_ = 0;
+    bool inputOpen_ = false;
+};
+
+// The n best rows seen so far under an ordering, kept in a heap whose top is
+// the worst of them, so memory stays O(n) however many rows are pushed.
+// Among equal keys the rows pushed first are kept.
+class TopNBuffer
+{
+public:
+    TopNBuffer(const RowOrdering &ordering, const std::vector<Column> &columns, size_t limit)
+        : ordering_(ordering), columns_(columns), limit_(limit) {};
+
+    void push(std::vector<char> bytes);
+    bool full() const { return limit_ > 0 && heap_.size() == limit_; }
+    // Sort keys of the worst row kept; only valid when the buffer is not empty.
+    const std::vector<Row::Value> &worstKeys() const { return heap_.front().keys; }
+    // Returns the rows kept, best first, and empties the buffer.
+    std::vector<std::vector<char>> finish();
+
+private:
+    struct Entry
+    {
+        std::vector<Row::Value> keys;
+        uint64_t sequence;
+        std::vector<char> bytes;
+    };
+
+    bool better(const Entry &a, const Entry &b) const;
+
+    const RowOrdering &ordering_;
+    const std::vector<Column> &columns_;
+    size_t limit_;
+    std::vector<Entry> heap_;
+    uint64_t sequence_ = 0;
+};
+
+// ORDER BY ... LIMIT n without sorting the whole input: rows go through a
+// TopNBuffer and only the n survivors are sorted.
+class TopNOperator : public Operator
+{
+public:
+    TopNOperator(Operator &input, std::vector<SortKey> keys, size_t limit)
+        : input_(input), ordering_(std::move(keys)), limit_(limit) {};
+
+    const std::vector<Column> &getSchema() override { return input_.getSchema(); }
+    bool open() override;
+    bool next(RowBatch &batch) override;
+
+private:
+    Operator &input_;
+    RowOrdering ordering_;
+    size_t limit_;
+    std::vector<std::vector<char>> rows_;
+    size_t position_ = 0;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "schema.h"
+
+// A batch of rows in the row-serialized format produced by Row::serialize.
+struct RowBatch
+{
+    std::vector<std::vector<char>> rows;
+};
+
+// Pull-based query operator. Operators are chained by handing one operator its
+// input operator; rows flow between them in batches rather than one at a time.
+class Operator
+{
+public:
+    virtual ~Operator() = default;
+    // Schema of the rows this operator produces.
+    virtual const std::vector<Column> &getSchema() = 0;
+    virtual bool open() = 0;
+    // Replaces the content of batch with the next rows. Returns false once the
+    // operator is exhausted, in which case batch is left empty.
+    virtual bool next(RowBatch &batch) = 0;
+    virtual void close() {}
+    // Number of pages the operator will read, or 0 when it cannot tell.
+    virtual size_t estimatedPages() { return 0; }
+};
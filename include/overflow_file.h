@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IStorage.h"
+#include "schema.h"
+
+// Stands in a stored row for a TEXT value kept in the overflow file, after
+// the Row::OVERFLOW_TEXT length prefix.
+struct OverflowRef
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Reads one TEXT value in chunks, from the overflow file or from the row
+// itself for values stored inline.
+class ValueReader
+{
+public:
+    ValueReader() = default;
+    explicit ValueReader(std::string value) : value_(std::move(value)), size_(value_.size()) {}
+    ValueReader(IStorage &storage, const std::string &filename, const OverflowRef &ref)
+        : storage_(&storage), filename_(filename), offset_(ref.offset), size_(ref.length) {}
+
+    uint64_t size() const { return size_; }
+    // Copies up to size bytes from the current position; returns how many,
+    // 0 at the end of the value.
+    size_t read(char *data, size_t size);
+
+private:
+    IStorage *storage_ = nullptr; // Null for inline values.
+    std::string filename_;
+    std::string value_;
+    uint64_t offset_ = 0;
+    uint64_t size_ = 0;
+    uint64_t position_ = 0;
+};
+
+// Large TEXT values of a table, in <table>/overflow.dat. A stored row longer
+// than a quarter of the table's page gets its longest TEXT values appended to the file and
+// replaced by an OverflowRef each, so that JSON documents and the like fit on a
+// page whatever their size. Values are written once and never moved, so a
+// reference stays valid for as long as the row holding it; the space of
+// deleted or replaced values is not reused.
+//
+// Values must be on stable storage before the log record of their row, so
+// writers sync the file before committing and checkpoints sync it with the
+// other metadata. Bytes appended by a change that never committed stay behind
+// unreferenced.
+class OverflowFile
+{
+public:
+    // Shorter values stay in the row: their reference would save too little.
+    static constexpr size_t MIN_OVERFLOW_VALUE = 64;
+
+    OverflowFile(const std::string &tableName, IStorage &storage)
+        : storage_(storage), filename_(tableName + "/overflow.dat") {};
+
+    // Creates the file when missing and appends behind what it holds.
+    void initialize();
+
+    // Moves TEXT values of a serialized row to the file, longest first, until
+    // the row takes at most maxRowSize bytes. Values too long for a uint16_t
+    // length always move. Returns false when the row is unchanged.
+    bool storeLargeValues(const std::vector<Column> &columns, std::vector<char> &row, size_t maxRowSize);
+    // Puts the values back into loaded, so that it holds what Row::serialize
+    // produced. Returns false, leaving loaded alone, when the row refers to
+    // no value.
+    bool loadLargeValues(const std::vector<Column> &columns, const std::vector<char> &row, std::vector<char> &loaded);
+    // Reader for the TEXT value of a column of a stored row.
+    ValueReader openValue(const std::vector<Column> &columns, const std::vector<char> &row, size_t columnIndex);
+
+    // No value has been stored yet; rows then need no loading.
+    bool empty() const { return end_ == 0; }
+    void sync();
+
+private:
+    OverflowRef append(const char *data, size_t size);
+
+    IStorage &storage_;
+    std::string filename_;
+    std::atomic<uint64_t> end_{0}; // Offset the next value is written at.
+};
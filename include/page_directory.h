@@ -1,5 +1,12 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -15,15 +22,55 @@ struct PageDirectoryHeader
     uint32_t next_page_id; // The ID to be assigned to the next new page.
     uint32_t num_rows;     // Total number of rows stored across pages.
     uint32_t next_row_id;  // The ID to be assigned to the next new row.
+    // Write-ahead log position the directory reflects: every record before it
+    // is included in the entries and counters, no record after it is.
+    uint64_t checkpoint_lsn;
 };
 
 // Each page directory entry contains the page id and the available space in that page.
 struct PageDirectoryEntry
 {
-    uint16_t page_id;
-    uint16_t available_space;
+    uint32_t page_id;
+    uint32_t available_space; // Room for pages of MAX_PAGE_SIZE bytes.
 };
 
+// The first size() page ids of a table, in the order the pages were added.
+// Views share one buffer that is only ever written past the end of every
+// view handed out, so taking or copying a view costs O(1).
+class PageIdView
+{
+public:
+    PageIdView() = default;
+    PageIdView(std::shared_ptr<const uint32_t[]> ids, size_t size) : ids_(std::move(ids)), size_(size) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    uint32_t operator[](size_t i) const { return ids_[i]; }
+    const uint32_t *begin() const { return ids_.get(); }
+    const uint32_t *end() const { return ids_.get() + size_; }
+
+private:
+    std::shared_ptr<const uint32_t[]> ids_;
+    size_t size_ = 0;
+};
+
+// What a reader sees of a table: the pages that existed and the rows that had
+// been committed when the snapshot was taken. Rows with an id at or above
+// rowIdHighWater are filtered out, so rows appended to an existing page after
+// the snapshot stay invisible without copying the page.
+struct DirectorySnapshot
+{
+    PageIdView pageIds;
+    uint32_t rowIdHighWater;
+
+    bool isVisible(uint32_t rowId) const { return rowId < rowIdHighWater; }
+};
+
+// Safe to share between inserting threads. Page and row ids come from atomic
+// counters. Entries sit behind a reader/writer latch, and every entry carries
+// an atomic count of its space not yet claimed by an insert in flight. Free
+// space lookups therefore run concurrently and claim space with a
+// compare-and-swap, and two threads never pick the same bytes of a page.
 class PageDirectory
 {
 public:
@@ -32,25 +79,107 @@ public:
                                                                                                                  filename_(tableName + "/pagedirectory.dat"),
                                                                                                                  pagefilename_(tableName + "/pages.dat"),
                                                                                                                  logger_(logger),
-                                                                                                                 header_{0, 0, 0, 0} {
+                                                                                                                 header_{0, 0, 0, 0, 0} {
 
                                                                                                                  };
+    ~PageDirectory();
 
     bool initialize();
     uint32_t getAndIncrementNextPageId();
     uint32_t getAndIncrementNextRowId();
+    // Reserves count consecutive row ids and returns the first of them.
+    uint32_t allocateRowIds(uint32_t count);
+    void addRows(uint32_t count) { numRows_ += count; }
+    void removeRows(uint32_t count) { numRows_ -= count; }
+    // Marks a range of row ids as written. The commit high-water mark only moves
+    // past ids whose whole prefix is committed, since batches finish out of order.
+    void commitRows(uint32_t firstRowId, uint32_t count);
+    // Never blocks writers for longer than it takes to move published pages in.
+    DirectorySnapshot snapshot();
     void persistPageDirectory();
+    // Log position stored with the next persistPageDirectory.
+    void setCheckpointLsn(uint64_t lsn) { checkpointLsn_ = lsn; }
+    uint64_t getCheckpointLsn() const { return checkpointLsn_; }
+    // Forces the last persisted directory to stable storage.
+    void sync();
     void updatePageDirectoryEntry(PageDirectoryEntry &entry);
+    // Publishes a page. Callers write the page first, so that any thread that
+    // finds the entry can also read the page.
     void addPageDirectoryEntry(PageDirectoryEntry &entry);
-    PageDirectoryEntry *getPageDirectoryEntry(uint16_t pageId);
-    PageDirectoryEntry *getPageDirectoryBySize(uint16_t size);
-    std::vector<PageDirectoryEntry> &getAllEntries() { return entries_; }
+    bool getPageDirectoryEntry(uint32_t pageId, PageDirectoryEntry &entry);
+    // Finds a page with at least size unclaimed bytes and claims them. The claim
+    // is ended by releaseSpace once the rows are on the page, or by cancelClaim.
+    bool claimSpace(uint32_t size, PageDirectoryEntry &entry);
+    // Claims size unclaimed bytes of one particular page.
+    bool claimSpaceOn(uint32_t pageId, uint32_t size);
+    // Claims as much as maximum bytes of the first page at or after position
+    // cursor that has minimum bytes to spare once reserve bytes are set
+    // aside, and moves cursor past it. Returns the bytes claimed, 0 when no
+    // such page is left. Claims end like those of claimSpace.
+    uint32_t claimAvailable(uint32_t minimum, uint32_t maximum, uint32_t reserve, size_t &cursor, PageDirectoryEntry &entry);
+    // Records the free space of the page after a claimed insert.
+    void releaseSpace(uint32_t pageId, uint32_t claimed, uint32_t availableSpace);
+    void cancelClaim(uint32_t pageId, uint32_t claimed);
+    // Copy of the entries, safe to iterate while other threads insert.
+    std::vector<PageDirectoryEntry> getAllEntries();
+    // Dead bytes of a page (see IPageFormat::deadSpace), which available_space
+    // does not count. Only kept in memory, by whoever rewrites the page.
+    void setDeadSpace(uint32_t pageId, uint32_t bytes);
+    uint32_t getDeadSpace(uint32_t pageId);
+    // Up to count pages with at least minBytes dead bytes, the most first.
+    std::vector<uint32_t> mostFragmented(size_t count, uint32_t minBytes);
+    // Lock-free handoff of pages written by a bulk loader: the batch is pushed
+    // onto a stack with one compare-and-swap, and moved into the entries by the
+    // next thread that reads the directory.
+    void publishPages(std::vector<PageDirectoryEntry> entries);
+
+    // Crash recovery: reapplies a logged directory entry, adding the page when
+    // it is missing, and moves the counters past everything logged. Neither
+    // writes the directory file.
+    void restoreEntry(const PageDirectoryEntry &entry);
+    void restoreCounters(uint32_t nextPageId, uint32_t nextRowId, int64_t addedRows);
 
 private:
+    struct PublishedPages
+    {
+        std::vector<PageDirectoryEntry> entries;
+        PublishedPages *next;
+    };
+
+    // Moves published batches into entries_, oldest first.
+    void drainPublished();
+    void appendEntry(const PageDirectoryEntry &entry);
+    // Makes the ids of pages appended to entries_ visible to new snapshots;
+    // latch_ must be held.
+    void publishVersion();
+
     IStorage &storage_;
     std::string filename_;
     std::string pagefilename_;
     ILogger &logger_;
     PageDirectoryHeader header_;
+    std::atomic<uint32_t> nextPageId_{0};
+    std::atomic<uint32_t> nextRowId_{0};
+    std::atomic<uint32_t> numRows_{0};
+    std::atomic<uint64_t> checkpointLsn_{0};
+
+    std::shared_mutex latch_; // Guards entries_, positions_ and the size of claimable_.
+    std::mutex persistMutex_; // Orders concurrent writes of the directory file.
     std::vector<PageDirectoryEntry> entries_;
+    // Unclaimed space of entries_[i]; a deque so that appends never move the atomics.
+    std::deque<std::atomic<int32_t>> claimable_;
+    std::unordered_map<uint32_t, size_t> positions_; // page id -> index in entries_
+    std::atomic<PublishedPages *> published_{nullptr};
+
+    // Page ids behind every PageIdView, and the number of them published.
+    // Appends write past publishedPages_ and then raise it. A full buffer is
+    // replaced by one twice the size, and views of the old one keep it alive.
+    std::shared_ptr<uint32_t[]> pageIds_;
+    size_t pageIdCapacity_ = 0;
+    std::atomic<size_t> publishedPages_{0};
+    std::mutex commitMutex_;
+    std::map<uint32_t, uint32_t> committedRanges_; // first row id -> count, above the high-water mark
+    std::atomic<uint32_t> committedRowId_{0};
+    std::mutex deadSpaceMutex_;
+    std::unordered_map<uint32_t, uint32_t> deadSpace_; // Pages with dead bytes only.
 };
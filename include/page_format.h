@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "crc32c.h"
+#include "location.h"
+#include "page_directory.h"
+#include "page_size.h"
+
+struct Data
+{
+    uint32_t id;
+    std::vector<char> data;
+};
+
+struct ReturnType
+{
+    Data data;
+    Location location;
+};
+
+// Every layout starts its page header with the LSN of the last write-ahead log
+// record applied to the page, so recovery can read it without knowing the layout.
+inline uint64_t getPageLsn(const std::vector<char> &page)
+{
+    uint64_t lsn;
+    std::memcpy(&lsn, page.data(), sizeof(lsn));
+    return lsn;
+}
+
+inline void setPageLsn(std::vector<char> &page, uint64_t lsn)
+{
+    std::memcpy(page.data(), &lsn, sizeof(lsn));
+}
+
+// The CRC-32C of the whole page follows the LSN, computed with the field
+// itself taken as zero. It is set when the page is written to page.dat and
+// checked once when it is read back, so torn writes and bit rot are caught
+// before a layout interprets the page.
+constexpr size_t PAGE_CHECKSUM_OFFSET = sizeof(uint64_t);
+
+inline uint32_t computePageChecksum(const std::vector<char> &page)
+{
+    static const char zeros[sizeof(uint32_t)] = {};
+    uint32_t crc = crc32c(page.data(), PAGE_CHECKSUM_OFFSET);
+    crc = crc32c(zeros, sizeof(zeros), crc);
+    size_t rest = PAGE_CHECKSUM_OFFSET + sizeof(uint32_t);
+    return crc32c(page.data() + rest, page.size() - rest, crc);
+}
+
+inline void setPageChecksum(std::vector<char> &page)
+{
+    uint32_t crc = computePageChecksum(page);
+    std::memcpy(page.data() + PAGE_CHECKSUM_OFFSET, &crc, sizeof(crc));
+}
+
+inline bool hasValidChecksum(const std::vector<char> &page)
+{
+    uint32_t stored;
+    std::memcpy(&stored, page.data() + PAGE_CHECKSUM_OFFSET, sizeof(stored));
+    return stored == computePageChecksum(page);
+}
+
+// What a slot holds, for row maintenance. A FORWARDED slot is the home of a row
+// that moved to another page: the slot keeps its location, so index entries
+// stay valid, and points to the MOVED slot that holds the row now.
+enum class SlotState
+{
+    LIVE,
+    FREE,
+    FORWARDED,
+    MOVED
+};
+
+// Common interface of the on-page layouts. Rows always enter and leave a page
+// in the row-serialized format produced by Row::serialize; how they are laid out
+// inside the page is up to the implementation. Every layout shares page.dat and
+// the page directory.
+class IPageFormat
+{
+public:
+    virtual ~IPageFormat() = default;
+    // Size of every page of the table (see isValidPageSize), fixed before the
+    // first page is formatted.
+    virtual void setPageSize(size_t pageSize) { pageSize_ = pageSize; }
+    size_t getPageSize() const { return pageSize_; }
+    // Formats an empty page in the buffer.
+    virtual void initPage(std::vector<char> &page) = 0;
+    // Free bytes of a freshly initialized page.
+    virtual size_t emptyPageSpace() = 0;
+    // Bytes a serialized row will occupy in the page, including per-row metadata.
+    virtual size_t requiredSpace(const std::vector<char> &row) = 0;
+    // Bytes still available in the page.
+    virtual size_t freeSpace(const std::vector<char> &page) = 0;
+    virtual std::vector<ReturnType> insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry) = 0;
+    // Sanity checks of the header, run once on pages loaded from page.dat
+    // whose checksum matched. Throws std::runtime_error when they fail.
+    virtual bool verifyPage(std::vector<char> &buffer) = 0;
+    // Returns every row stored in the page together with its location.
+    virtual std::vector<ReturnType> readRows(const std::vector<char> &page, uint32_t pageId) = 0;
+    // Returns the row stored in the given slot.
+    virtual Data read(const std::vector<char> &page, uint16_t slotId) = 0;
+    // Ids of the rows in every used slot, including FORWARDED homes whose row
+    // readRows returns from another page. Without row maintenance these are
+    // the ids of the rows readRows returns.
+    virtual std::vector<uint32_t> rowIds(const std::vector<char> &page)
+    {
+        std::vector<uint32_t> ids;
+        for (const auto &row : readRows(page, 0))
+        {
+            ids.push_back(row.data.id);
+        }
+        return ids;
+    }
+
+    // Row maintenance behind deleteRow and updateRow. Layouts that do not
+    // support it keep these defaults, which throw.
+    //
+    // Finds the home slot of a row, never a MOVED one.
+    virtual bool findRow(const std::vector<char> &/*page*/, uint32_t /*rowId*/, uint16_t &/*slotId*/)
+    {
+        unsupported();
+        return false;
+    }
+    // Fills forward for FORWARDED slots. Without row maintenance every row is LIVE.
+    virtual SlotState slotState(const std::vector<char> &/*page*/, uint16_t /*slotId*/, Location &/*forward*/)
+    {
+        return SlotState::LIVE;
+    }
+    // Frees the slot for reuse by later inserts.
+    virtual void erase(std::vector<char> &/*page*/, uint16_t /*slotId*/) { unsupported(); }
+    // Replaces the row of a LIVE or MOVED slot, or turns a FORWARDED slot back
+    // into a LIVE one. Returns false, leaving the page unchanged, when the row
+    // does not fit into the page.
+    virtual bool update(std::vector<char> &/*page*/, uint16_t /*slotId*/, const std::vector<char> &/*row*/)
+    {
+        unsupported();
+        return false;
+    }
+    // Turns the slot into a forwarding pointer to target. Returns false when
+    // the page has no room for the pointer.
+    virtual bool forward(std::vector<char> &/*page*/, uint16_t /*slotId*/, const Location &/*target*/)
+    {
+        unsupported();
+        return false;
+    }
+    // Flags a row as moved here from its home slot.
+    virtual void setMoved(std::vector<char> &/*page*/, uint16_t /*slotId*/) { unsupported(); }
+
+    // Bytes left behind by deleted or shrunk rows that compact() would turn
+    // into free space.
+    virtual size_t deadSpace(const std::vector<char> &/*page*/) { return 0; }
+    // Packs the rows together, keeping every slot id, and returns the bytes
+    // gained.
+    virtual size_t compact(std::vector<char> &/*page*/) { return 0; }
+
+protected:
+    size_t pageSize_ = PAGE_SIZE;
+
+private:
+    [[noreturn]] static void unsupported()
+    {
+        throw std::runtime_error("This page layout does not support deleting or updating rows");
+    }
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <shared_mutex>
+
+// Reader/writer latches for the pages of a table. Page ids hash into a fixed
+// table of latches, so there is no per-page allocation and no map that itself
+// needs a lock. Two pages may share a latch, which only costs concurrency.
+// Readers hold a page latch shared while they read the page. Writers hold it
+// exclusively for the whole read-modify-write of the page.
+class PageLatchTable
+{
+public:
+    static constexpr size_t NUM_LATCHES = 1024;
+
+    std::shared_mutex &latch(uint32_t pageId) { return latches_[pageId % NUM_LATCHES]; }
+
+private:
+    std::array<std::shared_mutex, NUM_LATCHES> latches_;
+};
@@ -1,38 +1,371 @@
 #pragma once
 #include <string>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <thread>
+#include <condition_variable>
 
 #include "slotted_page.h"
+#include "pax_page.h"
+#include "compressed_page.h"
 #include "page_directory.h"
+#include "zone_map.h"
+#include "bloom_filter.h"
+#include "page_latch.h"
+#include "wal.h"
+#include "overflow_file.h"
+#include "text_dictionary.h"
+#include "read_ahead.h"
 #include "ILogger.h"
 #include "IStorage.h"
 
+// insertData may be called from several threads at once. Rows are placed either
+// on space claimed in the page directory, under that page's write latch, or on
+// fresh pages that only become visible once written. Zone map and bloom filter
+// updates are serialised by their own mutex.
+//
+// Every insertData call commits one redo record (page after-images plus their
+// directory entries) to the table's write-ahead log before any page is written,
+// so page.dat and the metadata files are written without syncing and only made
+// durable by a checkpoint. An updated page waits in pendingPages_ until its
+// record is durable; the page latch is released meanwhile, so inserts into the
+// same page share one group commit. Every page carries the LSN of the record
+// that last wrote it.
+//
+// Checkpoints are fuzzy: inserts pause only while the log switches files and
+// the directory is written, not while page.dat and the statistics are synced.
+// They run once the log a recovery would replay outgrows CHECKPOINT_LOG_BYTES,
+// after bulk loads and on destruction, which bounds restart time by the
+// checkpoint interval instead of the table size. Recovery redoes the newest
+// logged image of every page in parallel, partitioned by page id, and skips
+// pages whose LSN shows that the image already reached page.dat.
+//
+// The table's DurabilityPolicy decides when commits reach stable storage (see
+// DurabilityMode). page.dat grows into space reserved PAGE_FILE_EXTENT at a
+// time, and bulk loaded pages are written back as they are published so that
+// the checkpoint ending the load has little left to sync.
+//
+// deleteRow and updateRow rewrite rows in place on slotted pages. A row that
+// outgrows its page moves to another one and leaves a forwarding pointer in its
+// home slot, so the row's location, and every index entry pointing at it, stays
+// valid. Its own slot is marked as moved so that scans skip it when reading the
+// home slot. A scan running while a row moves may see it twice, or miss it when
+// it moved to a page the scan had already read.
+// Modifications run one at a time but alongside inserts and scans, latch every
+// page they touch, and commit one log record covering all of them.
+//
+// Deletes and shrinking updates leave dead bytes behind, which the page
+// directory counts per page in memory. vacuum() compacts the pages with the
+// most dead bytes and merges sparse neighbours: the rows of the first page move
+// into the second one, leaving their home slots behind as forwarding pointers,
+// since index entries point at them. The freed space goes back to inserts.
+// startVacuum runs it in the background.
+//
+// Rows of slotted tables that would take more than a quarter of a page keep
+// their longest TEXT values in the table's OverflowFile, and categorical
+// columns hold codes into its TextDictionary. The read paths put the values
+// back, so callers always see rows as Row::serialize produced them;
+// openValue streams a single value instead, and readRowsWithCode and
+// countCodes work on the codes themselves.
 class PageManager {
     public:
+        static constexpr uint64_t CHECKPOINT_LOG_BYTES = 64ull << 20;
+        static constexpr size_t MAX_REDO_THREADS = 8;
+        static constexpr size_t PAGE_FILE_EXTENT = 4u << 20;
+        // A vacuum pass compacts at most VACUUM_PAGES pages with at least an
+        // eighth of a page dead, and merges neighbours whose live rows each
+        // fill at most a quarter of a page.
+        static constexpr size_t VACUUM_PAGES = 64;
+        static constexpr size_t VACUUM_DEAD_SPACE_DIVISOR = 8;
+        static constexpr size_t SPARSE_PAGE_DIVISOR = 4;
+        // Stored rows of slotted tables take at most a quarter of a page.
+        static constexpr size_t INLINE_ROW_DIVISOR = 4;
+        // An insert spreads its rows over the free space of at most
+        // MAX_PLACEMENT_PAGES existing pages before it starts new ones.
+        static constexpr size_t MAX_PLACEMENT_PAGES = 32;
+        static constexpr size_t MIN_FILL_FACTOR = 10;
+
         PageManager(const std::string &tableName, ILogger &logger, IStorage &storage)
-          : pageFilePath_(tableName + "/page.dat"),
+          : tableName_(tableName),
+            pageFilePath_(tableName + "/page.dat"),
             logger_(logger),
             storage_(storage),
             slottedPage_(logger),
+            paxPage_(logger),
+            compressedPage_(logger),
+            pageFormat_(&slottedPage_),
             pageDirectory_(tableName, storage, logger),
+            zoneMap_(tableName, storage, logger),
+            wal_(tableName, storage, logger),
+            overflow_(tableName, storage),
+            dictionary_(tableName, storage),
+            readAhead_(storage, pageFilePath_),
             initialized_(false)
         {
-            // Allocate the page buffer (for one page)
-            page_ = std::vector<char>(PAGE_SIZE);
-            memset(page_.data(), 0, PAGE_SIZE);
         }
+        ~PageManager();
     
-        bool loadPage(PageDirectoryEntry &entry);
+        bool loadPage(PageDirectoryEntry &entry, std::vector<char> &buffer);
         bool persistPage(std::vector<char> buffer, PageDirectoryEntry &entry);
-        bool insertData(std::vector<std::vector<char>> &serializedData, const size_t &expectedSerializedDataSize, const size_t &expectedNumRows); 
+        // When `inserted` is provided it receives the row id and location of every
+        // inserted row, in the same order as serializedData.
+        bool insertData(std::vector<std::vector<char>> &serializedData, const size_t &expectedSerializedDataSize, const size_t &expectedNumRows,
+                        std::vector<ReturnType> *inserted = nullptr); 
         bool initialize(); 
+
+        // Delete or rewrite the row with the given id. When `previous` is
+        // provided it receives the row as it was and its home location, the one
+        // insertData returned. Return false when no row has the id. Throw when
+        // the page layout does not support it.
+        bool deleteRow(uint32_t rowId, ReturnType *previous = nullptr);
+        bool updateRow(uint32_t rowId, const std::vector<char> &row, ReturnType *previous = nullptr);
+
+        // Parallel bulk load: every loader thread takes its own BulkWriter, and
+        // finishBulkLoad persists the table metadata once all of them finished.
+        class BulkWriter;
+        BulkWriter bulkWriter();
+        void finishBulkLoad();
+
+        // Makes everything logged so far durable in page.dat and the metadata
+        // files and moves the log's redo point past it.
+        void checkpoint();
+        // Applies to commits from now on. Bulk backfills may run with NONE and
+        // rely on the checkpoint that finishBulkLoad takes.
+        void setDurability(const DurabilityPolicy &policy);
+        // Percentage of a page that inserts and bulk loads fill, from
+        // MIN_FILL_FACTOR to the default of 100. The rest is left to updates
+        // that grow rows, so that they stay on their page. Compressed tables
+        // take no updates and always fill their pages.
+        void setFillFactor(size_t percent);
+
+        // One vacuum pass; returns the number of pages rewritten. Safe to run
+        // alongside inserts, scans and row maintenance.
+        size_t vacuum();
+        // Runs vacuum() every intervalMs on a thread of its own until
+        // stopVacuum or destruction.
+        void startVacuum(uint32_t intervalMs);
+        void stopVacuum();
+
+        // Read path used by scans and index lookups.
+        bool readPage(uint32_t pageId, std::vector<char> &buffer);
+        std::vector<uint32_t> getPageIds();
+        // Locations are home locations, like those insertData returns.
+        std::vector<ReturnType> readRows(uint32_t pageId);
+        // Consistent view for scans running during ingest (see DirectorySnapshot).
+        DirectorySnapshot snapshot();
+        // Rows of the page that are visible in the snapshot.
+        std::vector<ReturnType> readRows(uint32_t pageId, const DirectorySnapshot &snapshot);
+        // Follows forwarding pointers; false when the slot holds no row.
+        bool readRow(const Location &location, Data &row);
+        // Reader for the value of a TEXT column of the row with the given id,
+        // which does not load a value kept in the overflow file at once.
+        // Returns false when no row has the id.
+        bool openValue(uint32_t rowId, size_t columnIndex, ValueReader &reader);
+
+        // Zone maps and bloom filters are maintained only once the table schema is known.
+        // The layout selects the page format used for every page of the table.
+        void setSchema(const std::vector<Column> &columns, PageLayout layout = PageLayout::SLOTTED);
+        PageLayout getLayout() const { return layout_; }
+        // Size of the table's pages, a power of two from MIN_PAGE_SIZE to
+        // MAX_PAGE_SIZE. Fixed once the table has a page: throws when it
+        // would change then.
+        void setPageSize(size_t pageSize);
+        size_t getPageSize() const { return pageSize_; }
+        // Returns the rows of a page whose column satisfies the predicate. On PAX
+        // and compressed pages only the predicate column is decoded for rows
+        // that do not match.
+        std::vector<ReturnType> readMatchingRows(uint32_t pageId, size_t columnIndex,
+                                                 const std::function<bool(const Row::Value &)> &predicate,
+                                                 const DirectorySnapshot *snapshot = nullptr);
+        // Rows of a page whose categorical column holds the given dictionary
+        // code. Only matching rows are decoded.
+        std::vector<ReturnType> readRowsWithCode(uint32_t pageId, size_t columnIndex, uint32_t code,
+                                                 const DirectorySnapshot *snapshot = nullptr);
+        // Adds the rows of a page to counts, indexed by the code their
+        // categorical column holds, without decoding them.
+        void countCodes(uint32_t pageId, size_t columnIndex, std::vector<uint64_t> &counts,
+                        const DirectorySnapshot *snapshot = nullptr);
+        // Categorical columns are those of a slotted table flagged so in its schema.
+        bool isCategorical(size_t columnIndex) const { return columnIndex < columns_.size() && columns_[columnIndex].categorical; }
+        TextDictionary &getDictionary() { return dictionary_; }
+        ZoneMap &getZoneMap() { return zoneMap_; }
+
+        // Attaches the bloom filter of a column, building it from the existing pages
+        // when it does not exist yet. It is then maintained by every insert.
+        bool enableBloomFilter(const std::string &columnName);
+        bool hasBloomFilter(size_t columnIndex);
+        // Returns false only when the page certainly holds no row with column == value.
+        bool bloomMayContain(uint32_t pageId, size_t columnIndex, const Row::Value &value);
     
     private:
+        // Feeds one row placed on pageId into the zone map and bloom filters.
+        void recordRow(uint32_t pageId, const Data &row);
+        // Same for all rows of a page, taking the statistics mutex once.
+        void recordRows(uint32_t pageId, const std::vector<Data> &rows);
+        // Turns a row about to be stored into its stored form: categorical
+        // values become dictionary codes and large values move to the
+        // overflow file. Returns true when syncStoredValues must run before
+        // the row is committed.
+        bool encodeStoredRow(std::vector<char> &row);
+        // Undoes encodeStoredRow on a row read from a page.
+        void decodeStoredRow(std::vector<char> &row);
+        // Row::deserialize for rows read from a page.
+        Row decodeRow(const std::vector<char> &row);
+        // Makes values stored by a change durable before its log record.
+        void syncStoredValues();
+        // readRow without decodeStoredRow.
+        bool readStoredRow(const Location &location, Data &row);
+        // Writes the zone map and bloom filters.
+        void persistStatistics();
+        void syncMetadata();
+        // Body of checkpoint(); the caller holds checkpointMutex_.
+        void runCheckpoint();
+        // Passes the turnstile and holds off checkpoints for one logged change.
+        std::shared_lock<std::shared_mutex> holdOffCheckpoint();
+        // Checkpoints once the log has outgrown CHECKPOINT_LOG_BYTES, unless a
+        // checkpoint is already running.
+        void checkpointIfDue();
+        // Appends the redo record of one insertData, deleteRow or updateRow call
+        // and returns its LSN.
+        uint64_t logPages(WalRecordType type, uint32_t firstRowId, uint32_t numRows, const std::vector<PageDirectoryEntry> &entries,
+                          const std::vector<std::vector<char>> &pages);
+        // Latest image of a page whose log record is not durable yet, if any.
+        // Callers hold the page latch.
+        bool readPendingPage(uint32_t pageId, std::vector<char> &buffer);
+        // Makes a logged image the one readers and writers see until its record
+        // is durable. Callers hold the page latch.
+        void stagePage(uint32_t pageId, uint64_t lsn, std::vector<char> image);
+        // Once the record at lsn is durable: writes the staged image unless a
+        // later record replaced it; that one is written when it is durable.
+        void writeStagedPage(uint32_t pageId, uint64_t lsn);
+        class PageEdit;
+        // Rows of an insert going to an existing page, and the space claimed for them.
+        struct Placement
+        {
+            PageDirectoryEntry entry;
+            uint32_t claimed;
+            std::vector<Data> rows;
+        };
+        // Bytes of every page that inserts leave free (see setFillFactor).
+        size_t fillReserve() const;
+        // Body of deleteRow (row == nullptr) and updateRow.
+        bool modifyRow(uint32_t rowId, const std::vector<char> *row, ReturnType *previous);
+        // Home slot of a row, found through the row id zones of the zone map.
+        bool locateRow(uint32_t rowId, Location &home);
+        bool compactPage(uint32_t pageId);
+        // Moves the rows of from into into; false when they do not fit.
+        bool mergePages(uint32_t into, uint32_t from);
+        void vacuumLoop(uint32_t intervalMs);
+        // Gives rows read from a slotted page the location of their home slot,
+        // which differs for rows that moved there (see updateRow).
+        void resolveMovedRows(const std::vector<char> &page, std::vector<ReturnType> &rows);
+        // Replays the write-ahead log into page.dat and the page directory.
+        void recover();
+        void addToBloomFilter(PageBloomFilters &bloom, size_t columnIndex, uint32_t pageId);
+        // Reserves page.dat space up to and including the page.
+        void reservePageFile(uint32_t pageId);
+
+        std::string tableName_;
         std::string pageFilePath_;
         ILogger &logger_;
         IStorage &storage_;
         SlottedPage slottedPage_;
+        PaxPage paxPage_;
+        CompressedPage compressedPage_;
+        IPageFormat *pageFormat_; // Format of the table's pages, one of the above.
+        PageLayout layout_ = PageLayout::SLOTTED;
+        size_t pageSize_ = PAGE_SIZE;
         PageDirectory pageDirectory_;
-        bool initialized_; 
-        std::vector<char> page_; // Reusable buffer for one page
+        ZoneMap zoneMap_;
+        std::vector<Column> columns_;
+        // (column index, filter) for every column with a bloom filter.
+        std::vector<std::pair<size_t, std::unique_ptr<PageBloomFilters>>> bloomFilters_;
+        WriteAheadLog wal_;
+        OverflowFile overflow_;
+        TextDictionary dictionary_;
+        bool hasCategorical_ = false; // Some column of the schema is categorical.
+        ReadAhead readAhead_; // Of pages read by readPage.
+        std::atomic<DurabilityMode> durability_{DurabilityMode::FSYNC};
+        std::atomic<size_t> fillFactor_{100};
+        std::atomic<size_t> pageFileReserved_{0};
+        std::mutex reserveMutex_;
+        // Held shared by insertData and briefly exclusively by a checkpoint.
+        // Inserts pass the turnstile before taking it, so a waiting checkpoint
+        // is not starved by a steady stream of inserts.
+        std::shared_mutex checkpointLatch_;
+        std::mutex checkpointTurnstile_;
+        std::mutex checkpointMutex_; // One checkpoint at a time.
+        // Pages rewritten by recovery. Their zone map and bloom filter entries may
+        // predate the replayed rows and are rebuilt once the schema is known.
+        std::vector<uint32_t> recoveredPages_;
+        struct PendingPage
+        {
+            uint64_t lsn; // Record that produced the image.
+            std::vector<char> image;
+        };
+        std::mutex pendingMutex_;
+        std::unordered_map<uint32_t, PendingPage> pendingPages_;
+        std::atomic<bool> initialized_;
+        std::mutex initMutex_;
+        std::mutex statsMutex_; // Guards zone map and bloom filter updates.
+        std::mutex modifyMutex_; // One deleteRow, updateRow or vacuum step at a time.
+        std::atomic<bool> deadSpaceKnown_{false}; // Every page's dead space is in the directory.
+        std::thread vacuumThread_;
+        std::mutex vacuumMutex_;
+        std::condition_variable vacuumWake_;
+        bool stopVacuum_ = false;
+        PageLatchTable latches_;
     };
-    
\ No newline at end of file
+
+// Loads rows onto pages owned by one thread. Pages take their ids from the
+// directory's atomic counter and are filled and written without any latch,
+// since no other thread knows about them. Completed pages are published to
+// the PageDirectory PUBLISH_BATCH at a time through its lock-free handoff.
+// Row ids are allocated per page when the page is sealed and committed when
+// the page is published, so snapshot readers never see a row whose page they
+// cannot find.
+class PageManager::BulkWriter
+{
+public:
+    static constexpr size_t PUBLISH_BATCH = 32;
+
+    explicit BulkWriter(PageManager &pageManager)
+        : pageManager_(pageManager), pageCapacity_(pageManager.pageFormat_->emptyPageSpace()),
+          fillCapacity_(pageCapacity_ - pageManager.fillReserve())
+    {
+        if (pageManager.layout_ == PageLayout::COMPRESSED)
+        {
+            packed_ = std::make_unique<CompressedPageStatistics>(pageManager.compressedPage_.statistics());
+        }
+    }
+    BulkWriter(BulkWriter &&) = default;
+    ~BulkWriter();
+
+    void add(const std::vector<char> &row);
+    // Writes the partly filled page and publishes every page not yet published.
+    void finish();
+    // Row id and location of every added row, in the order they were added.
+    const std::vector<ReturnType> &getInserted() const { return inserted_; }
+
+private:
+    void sealPage();
+    void publish();
+
+    PageManager &pageManager_;
+    size_t pageCapacity_;
+    size_t fillCapacity_; // What the fill factor lets rows take of a page.
+    std::vector<std::vector<char>> pending_; // Rows of the page being filled.
+    size_t pendingSpace_ = 0;
+    // Compressed pages take rows until they fill the page encoded, rather than
+    // by pendingSpace_.
+    std::unique_ptr<CompressedPageStatistics> packed_;
+    std::vector<PageDirectoryEntry> unpublished_;
+    std::vector<std::pair<uint32_t, uint32_t>> uncommitted_; // (first row id, count) of unpublished pages
+    std::vector<ReturnType> inserted_;
+    bool finished_ = false;
+};
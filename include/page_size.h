@@ -1,3 +1,13 @@
-#pragma once 
+#pragma once
 #include <cstddef>
-constexpr size_t PAGE_SIZE = 4096;
\ No newline at end of file
+// Default size of table pages, and the fixed size of index nodes and spill
+// file chunks. Tables may choose any power of two from MIN_PAGE_SIZE to
+// MAX_PAGE_SIZE when their schema is created (see Table::createSchema).
+constexpr size_t PAGE_SIZE = 4096;
+constexpr size_t MIN_PAGE_SIZE = 4096;
+constexpr size_t MAX_PAGE_SIZE = 65536;
+
+inline bool isValidPageSize(size_t size)
+{
+    return size >= MIN_PAGE_SIZE && size <= MAX_PAGE_SIZE && (size & (size - 1)) == 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ILogger.h"
+#include "global_logger.h"
+#include "page_size.h"
+#include "page_format.h"
+#include "schema.h"
+#include "row.h"
+
+struct PaxPageHeader
+{
+    uint64_t lsn;      // See getPageLsn.
+    uint32_t checksum; // See setPageChecksum.
+    uint16_t numRows;
+    uint16_t numColumns;
+    // Start of the TEXT heap, which grows down from the end of the page.
+    uint32_t heapOffset;
+    uint32_t unused; // Keeps the header free of padding.
+};
+static_assert(offsetof(PaxPageHeader, lsn) == 0, "the page LSN must lead the header");
+static_assert(offsetof(PaxPageHeader, checksum) == PAGE_CHECKSUM_OFFSET, "the checksum must follow the LSN");
+
+// Entry of a TEXT mini-page: where the value lives in the heap.
+struct PaxTextEntry
+{
+    uint16_t offset;
+    uint16_t length;
+};
+
+// Column-major (PAX) layout. After the header come the start offsets of every
+// mini-page, the row id array, and one mini-page per column: a fixed-width array
+// for INT, FLOAT and DATE (dates as YYYYMMDD integers) and an array of
+// PaxTextEntry for TEXT, whose bytes live in the heap at the end of the page.
+//
+// +--------+-------------+---------+----------+----------+-----+------+------+
+// | header | col offsets | row ids | column 0 | column 1 | ... | free | heap |
+// +--------+-------------+---------+----------+----------+-----+------+------+
+//
+// Mini-pages are sized exactly to the rows on the page, so inserts rebuild the
+// page; in exchange scans over a few columns read contiguous arrays.
+class PaxPage : public IPageFormat
+{
+public:
+    PaxPage(ILogger &logger = GlobalLogger::instance()) : logger_(logger) {};
+
+    void setSchema(const std::vector<Column> &columns) { columns_ = columns; }
+
+    void initPage(std::vector<char> &page) override;
+    size_t emptyPageSpace() override;
+    size_t requiredSpace(const std::vector<char> &row) override;
+    size_t freeSpace(const std::vector<char> &page) override;
+    std::vector<ReturnType> insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry) override;
+    bool verifyPage(std::vector<char> &buffer) override;
+
+    std::vector<ReturnType> readRows(const std::vector<char> &page, uint32_t pageId) override;
+    Data read(const std::vector<char> &page, uint16_t slotId) override;
+
+    // Returns every value of one column, in slot order, reading only its mini-page.
+    std::vector<Row::Value> readColumn(const std::vector<char> &page, size_t columnIndex);
+
+private:
+    size_t fixedRowWidth() const;
+    size_t columnOffset(const std::vector<char> &page, size_t columnIndex) const;
+    std::vector<char> encodeRow(const std::vector<char> &page, uint16_t slotId) const;
+    void build(const std::vector<uint32_t> &ids, const std::vector<Row> &rows, std::vector<char> &page);
+
+    ILogger &logger_;
+    std::vector<Column> columns_;
+};
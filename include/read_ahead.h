@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "IStorage.h"
+#include "page_size.h"
+
+// Detects sequential reads of a page file and asks the storage to read ahead
+// of them (see IStorage::prefetch), so that the device fetches the next pages
+// while the rows of the current ones are decoded.
+//
+// Up to MAX_STREAMS interleaved scans are followed at once, each by the page
+// it is expected to read next. A stream reads ahead once it has read two
+// pages in a row, keeping the next `window` pages requested and issuing the
+// next request when half of them have been read. The window starts at
+// MIN_WINDOW pages and doubles, up to MAX_WINDOW_BYTES, whenever a page that
+// was read ahead still took SLOW_READ_FACTOR times as long as the fastest
+// read seen, i.e. when the device did not keep up.
+class ReadAhead
+{
+public:
+    static constexpr size_t MAX_STREAMS = 8;
+    static constexpr uint32_t MIN_WINDOW = 8;
+    static constexpr size_t MAX_WINDOW_BYTES = 8u << 20;
+    static constexpr int64_t SLOW_READ_FACTOR = 4;
+
+    ReadAhead(IStorage &storage, const std::string &filename) : storage_(storage), filename_(filename) {}
+
+    void setPageSize(size_t pageSize) { pageSize_ = pageSize; }
+    // Called before page pageId is read from storage.
+    void beforeRead(uint32_t pageId);
+    // Called once the read returned, with the time it took.
+    void afterRead(uint32_t pageId, std::chrono::nanoseconds latency);
+
+private:
+    struct Stream
+    {
+        uint32_t next = 0;        // Page the stream reads next.
+        uint32_t requestedTo = 0; // Pages below were read ahead.
+        uint32_t window = MIN_WINDOW;
+        uint32_t run = 0; // Pages read in a row; 0 for an unused stream.
+        uint64_t lastUse = 0;
+    };
+
+    uint32_t maxWindow() const;
+
+    IStorage &storage_;
+    std::string filename_;
+    size_t pageSize_ = PAGE_SIZE;
+    std::mutex mutex_;
+    std::array<Stream, MAX_STREAMS> streams_;
+    uint64_t clock_ = 0;
+    std::chrono::nanoseconds fastest_ = std::chrono::nanoseconds::max();
+};
@@ -1,3 +1,4 @@
+#pragma once
 #include <string>
 #include <variant>
 #include <vector>
@@ -23,17 +24,34 @@ public:
 
     static Value convertValue(const std::string &value, DataType type);
 
+    // Rebuilds a row from the bytes produced by serialize()
+    static Row deserialize(const std::vector<Column> &schema, const char *data, size_t size);
+
+    // Maps a DD/MM/YYYY date onto an integer that sorts chronologically (YYYYMMDD)
+    static int32_t dateToKey(const std::string &date);
+    // Inverse of dateToKey
+    static std::string keyToDate(int32_t key);
+
 
     // Serializes the row into a contiguous byte buffer
     // INT: raw uint16_t bytes
     // FLOAT: raw float bytes
-    // TEXT: uint16_t length followed by the string bytes
+    // TEXT: uint16_t length followed by the string bytes. Values of LONG_TEXT
+    // bytes or more store LONG_TEXT, then their uint32_t length.
     std::vector<char> serialize() const;
 
+    static constexpr uint16_t LONG_TEXT = 0xFFFF;
+    // Length prefix of a value kept outside the row; an OverflowRef follows
+    // (see OverflowFile). Only rows stored on pages carry it, so deserialize
+    // rejects it.
+    static constexpr uint16_t OVERFLOW_TEXT = 0xFFFE;
+
     // returns the size (in bytes) that the row will occupy when serialized
 
     size_t getSerializedSize() const;
 
+    const Value &getValue(size_t colIndex) const { return values_.at(colIndex); }
+
 private:
     std::vector<Column> schema_;
     std::vector<Value> values_;
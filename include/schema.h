@@ -7,6 +7,7 @@
 #include "IStorage.h"
 #include "ILogger.h"
 #include "global_logger.h"
+#include "page_size.h"
 
 enum class DataType
 {
@@ -16,15 +17,30 @@ enum class DataType
     DATE
 };
 
+// How rows are laid out inside the pages of a table. Chosen once, when the
+// schema is created.
+enum class PageLayout : uint16_t
+{
+    SLOTTED,   // row-major slotted pages
+    PAX,       // column-major mini-pages
+    COMPRESSED // column-major, encoded per column; for cold, bulk loaded data
+};
+
 struct Column
 {
     std::string name;
     DataType type;
+    // TEXT columns repeating a few distinct values, such as status codes or
+    // country names. Slotted tables store their values as codes into the
+    // table's TextDictionary.
+    bool categorical = false;
 };
 
 struct SchemaHeader
 {
     uint16_t num_columns;
+    PageLayout layout;
+    uint32_t page_size; // Of the table's pages, see isValidPageSize.
 };
 
 class Schema
@@ -34,17 +50,27 @@ public:
                                                                                                           filepath_(tableName + "/schema.dat"),
                                                                                                           logger_(logger) {};
 
+    // Serialized form of a schema, as stored in schema.dat and in the catalog
+    // of a Database: the SchemaHeader, then for every column the uint16_t
+    // length and the bytes of its name, its type and its categorical flag.
+    static std::vector<char> serialize(const std::vector<Column> &columns, PageLayout layout, size_t pageSize);
+    // Parses what serialize wrote at the start of data. Returns false when it
+    // is truncated or holds an unknown type, layout or page size.
+    static bool deserialize(const char *data, size_t size, std::vector<Column> &columns, SchemaHeader &header);
+
     // write schema to disk
-    bool write(const std::vector<Column> &schema);
+    bool write(const std::vector<Column> &schema, PageLayout layout = PageLayout::SLOTTED, size_t pageSize = PAGE_SIZE);
     std::vector<Column> read();
     bool initialize();
     bool exists();
     const std::vector<Column> &getSchema() { return schema_; }
+    PageLayout getLayout() const { return header_.layout; }
+    size_t getPageSize() const { return header_.page_size; }
     
 private:
     IStorage &storage_;
     std::string filepath_;
     std::vector<Column> schema_;
     ILogger &logger_;
-    SchemaHeader header_;
+    SchemaHeader header_{0, PageLayout::SLOTTED, PAGE_SIZE};
 };
\ No newline at end of file
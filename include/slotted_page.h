@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -7,44 +9,108 @@
 #include "location.h"
 #include "page_size.h"
 #include "page_directory.h"
+#include "page_format.h"
+
+// The top bits of SlotEntry::length flag rows that moved. A slot with offset 0
+// is free, since the header lives there.
+constexpr uint32_t SLOT_FORWARDED = 0x80000000u; // The slot's bytes hold a ForwardPointer.
+constexpr uint32_t SLOT_MOVED = 0x40000000u;     // The row's home slot is on another page.
+constexpr uint32_t SLOT_LENGTH_MASK = 0x3fffffffu;
+
+// Where a row that no longer fits its home page lives now.
+struct ForwardPointer
+{
+    uint32_t page_id;
+    uint16_t slot_id;
+    uint16_t reserved;
+};
 
 struct SlotEntry
 {
 
     uint32_t id; // id of the row
+    uint32_t offset;
+    uint32_t length;
+
+    bool isFree() const { return offset == 0; }
+    uint32_t size() const { return length & SLOT_LENGTH_MASK; }
+};
+
+// How pages of up to NARROW_SLOT_PAGE_SIZE bytes store a SlotEntry: offset and
+// length take 16 bits, and the flags the top two bits of the length. Larger
+// pages store the SlotEntry as it is.
+struct NarrowSlotEntry
+{
+    uint32_t id;
     uint16_t offset;
     uint16_t length;
 };
+constexpr size_t NARROW_SLOT_PAGE_SIZE = 16384;
+constexpr uint16_t NARROW_SLOT_FLAGS = 0xc000;
+static_assert(NARROW_SLOT_PAGE_SIZE <= NARROW_SLOT_FLAGS, "narrow row lengths must leave the flag bits free");
 
 struct SlottedPageHeader
 {
+    uint64_t lsn;      // See getPageLsn.
+    uint32_t checksum; // See setPageChecksum.
     uint16_t numSlots;
+    uint16_t reserved;
     // freeDataOffset points to the first byte of the last row in the data area
     // for example if the last row starts at byte 100, freeDataOffset will be 100
-    uint16_t lastDataOffset;
+    uint32_t lastDataOffset;
+    uint32_t unused; // Keeps the header free of padding.
 };
+static_assert(offsetof(SlottedPageHeader, lsn) == 0, "the page LSN must lead the header");
+static_assert(offsetof(SlottedPageHeader, checksum) == PAGE_CHECKSUM_OFFSET, "the checksum must follow the LSN");
 
-struct Data
-{
-    uint32_t id;
-    std::vector<char> data;
-};
-
-struct ReturnType
-{
-    Data data;
-    Location location;
-};
-
-class SlottedPage
+// Row-major layout: a slot directory grows from the front of the page while row
+// payloads grow down from its end.
+//
+// Deleted rows leave a free slot that the next insert into the page reuses, so
+// the slot ids of the other rows never change. Their bytes stay behind as dead
+// space until the row below them goes too. An update overwrites the row when
+// the new version is not longer, takes free space of the page otherwise, and
+// moves the row to another page behind a ForwardPointer as a last resort.
+// compact() moves the rows back together at the end of the page; trailing
+// free slots are already dropped by erase.
+class SlottedPage : public IPageFormat
 {
 public:
     SlottedPage(ILogger &logger = GlobalLogger::instance()) : logger_(logger) {};
 
-    std::vector<ReturnType> insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry);
-    bool verifyPage(std::vector<char> &buffer);
+    void setPageSize(size_t pageSize) override;
+    // Bytes a slot takes in the slot directory of the table's pages.
+    size_t slotSize() const { return slotSize_; }
+    void initPage(std::vector<char> &page) override;
+    size_t emptyPageSpace() override { return pageSize_ - sizeof(SlottedPageHeader); }
+    size_t requiredSpace(const std::vector<char> &row) override { return storedSize(row.size()) + slotSize_; }
+    // Bytes a row takes in the data area. Shorter rows are padded with zeros,
+    // which Row::deserialize ignores, so that every row can be turned into a
+    // ForwardPointer in place.
+    static size_t storedSize(size_t rowSize) { return std::max(rowSize, sizeof(ForwardPointer)); }
+    size_t freeSpace(const std::vector<char> &page) override;
+    std::vector<ReturnType> insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry) override;
+    bool verifyPage(std::vector<char> &buffer) override;
+
+    std::vector<ReturnType> readRows(const std::vector<char> &page, uint32_t pageId) override;
+    Data read(const std::vector<char> &page, uint16_t slotId) override;
+    std::vector<uint32_t> rowIds(const std::vector<char> &page) override;
+
+    bool findRow(const std::vector<char> &page, uint32_t rowId, uint16_t &slotId) override;
+    SlotState slotState(const std::vector<char> &page, uint16_t slotId, Location &forward) override;
+    void erase(std::vector<char> &page, uint16_t slotId) override;
+    bool update(std::vector<char> &page, uint16_t slotId, const std::vector<char> &row) override;
+    bool forward(std::vector<char> &page, uint16_t slotId, const Location &target) override;
+    void setMoved(std::vector<char> &page, uint16_t slotId) override;
+    size_t deadSpace(const std::vector<char> &page) override;
+    size_t compact(std::vector<char> &page) override;
 
 private:
+    SlotEntry readSlot(const std::vector<char> &page, uint16_t slotId) const;
+    // The slot, checked to exist and hold a row; throws naming the action otherwise.
+    SlotEntry usedSlot(const std::vector<char> &page, const SlottedPageHeader &header, uint16_t slotId, const char *action) const;
+    void writeSlot(std::vector<char> &page, uint16_t slotId, const SlotEntry &slot) const;
+
     ILogger &logger_;
-    SlottedPageHeader header_;
+    size_t slotSize_ = sizeof(NarrowSlotEntry);
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "operator.h"
+#include "row.h"
+#include "spill_file.h"
+
+struct SortKey
+{
+    size_t column;
+    bool ascending = true;
+};
+
+// The order defined by a list of sort keys. Key values are extracted from a
+// serialized row once and then compared as often as needed; DATE keys are
+// held as their YYYYMMDD integer so they compare chronologically.
+class RowOrdering
+{
+public:
+    explicit RowOrdering(std::vector<SortKey> keys);
+
+    std::vector<Row::Value> extract(const std::vector<Column> &columns, const std::vector<char> &bytes) const;
+    bool less(const std::vector<Row::Value> &a, const std::vector<Row::Value> &b) const;
+    const std::vector<SortKey> &getKeys() const { return keys_; }
+
+private:
+    std::vector<SortKey> keys_;
+};
+
+// ORDER BY over an input operator, bounded by a memory budget. Input rows are
+// collected until the budget is reached, sorted and spilled to a run file in
+// spillDir; the runs are then merged through a loser tree. When there are more
+// runs than the budget allows readers for (one page of buffer each), they are
+// merged in several passes. Input that fits in the budget is never spilled.
+class SortOperator : public Operator
+{
+public:
+    SortOperator(Operator &input, std::vector<SortKey> keys, size_t memoryBudget, IStorage &storage,
+                 const std::string &spillDir, ILogger &logger = GlobalLogger::instance());
+    ~SortOperator() override;
+
+    const std::vector<Column> &getSchema() override { return input_.getSchema(); }
+    bool open() override;
+    bool next(RowBatch &batch) override;
+    // Removes the run files that are still on disk.
+    void close() override;
+
+    size_t getNumRuns() const { return numRuns_; }
+
+private:
+    struct SortedRow
+    {
+        std::vector<Row::Value> keys;
+        std::vector<char> bytes;
+    };
+
+    // Source of a merge: a run being read and the row at its head.
+    struct MergeSource
+    {
+        std::unique_ptr<SpillReader> reader;
+        SortedRow head;
+        bool exhausted = false;
+    };
+
+    // Loser tree over the sources: tree[0] holds the current winner, every
+    // other node the loser of the match played there, so replacing the winner
+    // replays only the matches on its path to the root.
+    struct Merge
+    {
+        std::vector<MergeSource> sources;
+        std::vector<int> tree;
+    };
+
+    SortedRow decode(std::vector<char> bytes) const;
+    bool less(const SortedRow &a, const SortedRow &b) const;
+    size_t footprint(const SortedRow &row) const;
+
+    void spillRun();
+    std::string nextRunName();
+
+    void startMerge(Merge &merge, const std::vector<std::string> &runs);
+    // True when source a wins against source b. -1 is the sentinel used while
+    // building the tree and beats every source; exhausted sources lose.
+    bool beats(const Merge &merge, int a, int b) const;
+    void adjust(Merge &merge, int source);
+    // Moves the smallest head into row and advances its source. Returns false
+    // once every source is exhausted.
+    bool pop(Merge &merge, std::vector<char> &row);
+    void advance(MergeSource &source);
+
+    Operator &input_;
+    RowOrdering ordering_;
+    size_t memoryBudget_;
+    IStorage &storage_;
+    std::string spillDir_;
+    ILogger &logger_;
+    uint32_t operatorId_;
+
+    std::vector<SortedRow> buffer_;
+    size_t bufferBytes_ = 0;
+    size_t bufferPosition_ = 0;
+    std::vector<std::string> runs_;
+    size_t numRuns_ = 0;
+    uint32_t nextRunId_ = 0;
+    Merge merge_;
+    bool merging_ = false;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IStorage.h"
+#include "page_size.h"
+
+// Temporary files used by operators that run out of memory. A spill file is a
+// sequence of records, each a uint32_t length followed by the record bytes.
+// Both sides buffer a page at a time so the file is written and read in
+// sequential PAGE_SIZE chunks.
+class SpillWriter
+{
+public:
+    // Creates (or truncates) the file.
+    SpillWriter(IStorage &storage, const std::string &filename);
+
+    void write(const std::vector<char> &record);
+    // Writes out the buffered tail; the writer must not be used afterwards.
+    void finish();
+
+    const std::string &getFilename() const { return filename_; }
+    uint64_t getNumRecords() const { return numRecords_; }
+
+private:
+    void flush();
+
+    IStorage &storage_;
+    std::string filename_;
+    std::vector<char> buffer_;
+    uint64_t numRecords_ = 0;
+};
+
+class SpillReader
+{
+public:
+    SpillReader(IStorage &storage, const std::string &filename);
+
+    // Reads the next record into record. Returns false at the end of the file.
+    bool next(std::vector<char> &record);
+
+private:
+    // Makes at least `bytes` unread bytes available, short only at the end of the file.
+    bool ensure(size_t bytes);
+
+    IStorage &storage_;
+    std::string filename_;
+    size_t fileSize_;
+    size_t fileOffset_ = 0;
+    std::vector<char> buffer_;
+    size_t position_ = 0;
+};
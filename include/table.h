@@ -2,6 +2,9 @@
 #include <string>
 #include <vector>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 #include "ILogger.h"
 #include "global_logger.h"
@@ -9,23 +12,107 @@
 #include "page_manager.h"
 #include "parser.h"
 #include "IStorage.h"
+#include "row.h"
+#include "hash_index.h"
+#ifndef DISABLE_BTREE
+#include "btree.h"
+#endif
 
 class Table
 {
 public:
     Table(const std::string &name, ILogger &logger, PageManager &pageManager, Schema &schema, Parser &parser, IStorage &storage)
-        : tableDir_(name), logger_(logger), pageManager_(pageManager), schema_(schema), parser_(parser) {}
+        : tableDir_(name), logger_(logger), pageManager_(pageManager), schema_(schema), parser_(parser), storage_(storage) {}
+    // Marks the indexes clean once the rows they hold are on stable storage.
+    ~Table();
 
     bool initialize();
-    bool createSchema(std::vector<Column> &columns);
+    // The page layout is fixed for the lifetime of the table.
+    bool createSchema(std::vector<Column> &columns, PageLayout layout = PageLayout::SLOTTED, size_t pageSize = PAGE_SIZE);
     std::vector<Column> getSchema();
+    // Source of table rows for query operators (see TableScan).
+    PageManager &getPageManager() { return pageManager_; }
+    // When commits to this table reach stable storage (see DurabilityMode).
+    void setDurability(const DurabilityPolicy &policy) { pageManager_.setDurability(policy); }
+    // How full inserts pack pages (see PageManager::setFillFactor).
+    void setFillFactor(size_t percent) { pageManager_.setFillFactor(percent); }
+    // Compacts and merges pages in the background (see PageManager::vacuum).
+    void startVacuum(uint32_t intervalMs) { pageManager_.startVacuum(intervalMs); }
     bool writeDataFromFile(const std::string &filename, char delimiter = '\t');
+    // Loads several files in parallel, one loader thread per file, each filling
+    // pages of its own (see PageManager::BulkWriter).
+    bool writeDataFromFiles(const std::vector<std::string> &filenames, char delimiter = '\t');
+    // Delete or replace the row with the given id, keeping every index in step.
+    // The row keeps its id and, for index lookups, its location. Return false
+    // when no row has the id. Only slotted tables support them.
+    bool deleteRow(uint32_t rowId);
+    bool updateRow(uint32_t rowId, const Row &row);
+    // Ids of the rows whose column equals value, for deleteRow and updateRow.
+    std::vector<uint32_t> findRowIds(const std::string &columnName, const Row::Value &value);
+    // Streams the value of a TEXT column of the row with the given id, for
+    // values too large to read whole (see OverflowFile). Returns false when no
+    // row has the id.
+    bool openValue(uint32_t rowId, const std::string &columnName, ValueReader &reader);
+
+#ifndef DISABLE_BTREE
+    // Builds a B+tree index over an INT or DATE column from the rows already in the
+    // table. The index is then maintained by every subsequent insert.
+    bool createIndex(const std::string &columnName);
+#endif
+    // Builds a hash index over a TEXT column for equality lookups. Like B+tree
+    // indexes it is maintained by every subsequent insert.
+    bool createHashIndex(const std::string &columnName);
+    // Builds per-page bloom filters over a column so that equality scans can skip
+    // pages without reading them. Worth it for high-cardinality, unordered keys.
+    bool createBloomFilter(const std::string &columnName);
+    // Returns all rows with low <= column value <= high, using an index when one exists.
+    std::vector<Row> rangeQuery(const std::string &columnName, const Row::Value &low, const Row::Value &high);
+    // Returns all rows whose column equals value, using an index when one exists.
+    std::vector<Row> lookup(const std::string &columnName, const Row::Value &value);
+    // Returns the n rows with the smallest (ascending) or largest column values,
+    // best first. Pages are visited in key order through a B+tree or the zone
+    // map, and the scan stops once no unread page can improve the result.
+    std::vector<Row> topN(const std::string &columnName, size_t n, bool ascending = true);
+    // Number of rows holding each value of a column, in ascending value order.
+    // Categorical columns are grouped by dictionary code without decoding rows.
+    std::vector<std::pair<Row::Value, uint64_t>> groupCount(const std::string &columnName);
 
 private:
+    size_t getColumnIndex(const std::string &columnName);
+    std::vector<Row> fetchRows(const std::vector<Location> &locations);
+    // Full scan for low <= column <= high that skips pages using the zone map.
+    std::vector<Row> scanRange(size_t columnIndex, const Row::Value &low, const Row::Value &high);
+    std::vector<ReturnType> scanStored(size_t columnIndex, const Row::Value &low, const Row::Value &high);
+    HashIndex *findHashIndex(const std::string &columnName);
+    // Index files built afresh from the rows on the pages, and marked clean.
+    std::unique_ptr<HashIndex> buildHashIndex(size_t columnIndex);
+    // Replaces every index by one built from the pages, for changes whose
+    // rows cannot be told apart from those that failed.
+    void rebuildIndexes();
+    // Marks every index dirty before a change to the rows they cover is
+    // committed (see BPlusTree::markDirty).
+    void beginIndexChange();
+    void updateIndexes(const std::vector<std::vector<char>> &serializedData, const std::vector<ReturnType> &inserted);
+    // Index maintenance of deleteRow (row == nullptr) and updateRow; previous
+    // is the row as it was, at its home location.
+    void updateIndexes(const ReturnType &previous, const std::vector<char> *row);
+#ifndef DISABLE_BTREE
+    BPlusTree *findIndex(const std::string &columnName);
+    std::unique_ptr<BPlusTree> buildIndex(size_t columnIndex);
+#endif
+
     const std::string &tableDir_;
     ILogger &logger_;
     PageManager &pageManager_;
     Schema &schema_;
     Parser &parser_;
+    IStorage &storage_;
+    std::vector<std::unique_ptr<HashIndex>> hashIndexes_;
+#ifndef DISABLE_BTREE
+    std::vector<std::unique_ptr<BPlusTree>> indexes_;
+#endif
+    // Index lookups share it. Index maintenance and creation hold it alone,
+    // so a lookup never walks a node or bucket chain being rewritten.
+    std::shared_mutex indexMutex_;
     bool initialized_ = false; // flag to check if the table has been initialized
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "operator.h"
+#include "page_manager.h"
+
+// Leaf operator producing the rows of a table one page at a time. The scan
+// reads the snapshot taken by open(), so it can run while rows are inserted.
+class TableScan : public Operator
+{
+public:
+    TableScan(PageManager &pageManager, const std::vector<Column> &columns)
+        : pageManager_(pageManager), columns_(columns) {};
+
+    const std::vector<Column> &getSchema() override { return columns_; }
+    bool open() override;
+    bool next(RowBatch &batch) override;
+    size_t estimatedPages() override { return pageManager_.snapshot().pageIds.size(); }
+
+private:
+    PageManager &pageManager_;
+    std::vector<Column> columns_;
+    DirectorySnapshot snapshot_;
+    size_t nextPage_ = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IStorage.h"
+#include "schema.h"
+
+// Strings of the categorical TEXT columns of a table (see Column::categorical),
+// in <table>/dictionary.dat. Stored rows hold the code of such a value instead
+// of its length and bytes: a varint of 1 to 4 bytes, 7 bits per byte, so the
+// first 128 distinct values take a single byte. Codes are assigned in order of
+// first appearance and never change, so equality filters and grouping can
+// compare codes without decoding rows.
+//
+// Like overflow values, new strings must be on stable storage before the log
+// record of a row using them; a row reports when it uses one that is not yet
+// (see encodeRow). The file is a sequence of uint16_t lengths and bytes; a
+// torn entry at its end, left by a crash, is dropped when it is opened.
+class TextDictionary
+{
+public:
+    static constexpr uint32_t MAX_CODES = 1u << 28;
+    static constexpr size_t MAX_CODE_BYTES = 4;
+
+    TextDictionary(const std::string &tableName, IStorage &storage)
+        : storage_(storage), filename_(tableName + "/dictionary.dat") {};
+
+    // Creates the file when missing and loads the strings it holds.
+    void initialize();
+
+    // Code of value, assigning the next one when it is new.
+    uint32_t encode(const std::string &value);
+    // False when value has no code, so no row holds it.
+    bool find(const std::string &value, uint32_t &code) const;
+    std::string value(uint32_t code) const;
+    size_t size() const;
+
+    // Replaces the values of categorical columns of a serialized row by their
+    // codes. Returns true when the row uses a code not yet on stable storage.
+    bool encodeRow(const std::vector<Column> &columns, std::vector<char> &row);
+    // Undoes encodeRow on a stored row, which may refer to overflow values.
+    void decodeRow(const std::vector<Column> &columns, std::vector<char> &row) const;
+    // Code held by a categorical column of a stored row, found without
+    // decoding it.
+    static uint32_t codeAt(const std::vector<Column> &columns, const std::vector<char> &row, size_t columnIndex);
+
+    static void appendCode(std::vector<char> &row, uint32_t code);
+    // Reads the code at offset and moves offset past it.
+    static uint32_t readCode(const char *data, size_t size, size_t &offset);
+
+    void sync();
+
+private:
+    IStorage &storage_;
+    std::string filename_;
+    mutable std::shared_mutex mutex_;
+    std::vector<std::string> values_;
+    std::unordered_map<std::string, uint32_t> codes_;
+    uint64_t end_ = 0;         // Offset the next string is written at.
+    uint32_t durableCodes_ = 0; // Codes below are on stable storage.
+};
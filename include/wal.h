@@ -0,0 +1,174 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+
+// Start of each log file. Log sequence numbers keep growing across files:
+// the first record of a file has LSN start_lsn, and every later record's LSN
+// is start_lsn plus its distance from the first record.
+struct WalFileHeader
+{
+    uint64_t magic;
+    uint64_t start_lsn;
+};
+
+// Content of <table>/wal.ckpt, rewritten by every completed checkpoint.
+// Recovery replays the log from redo_lsn on.
+struct WalCheckpoint
+{
+    uint64_t magic;
+    uint64_t redo_lsn;
+};
+
+// When commits reach stable storage.
+enum class DurabilityMode
+{
+    NONE,      // Never synced on commit; only checkpoints sync. Survives process
+               // crashes but may lose any commit since the last checkpoint to a
+               // power failure.
+    FSYNC,     // fsync the log on every group commit.
+    PERIODIC,  // Commits reach the OS at once and are synced every interval_ms,
+               // which bounds the loss on power failure to that interval.
+    FDATASYNC, // fdatasync the log on every group commit, and page.dat at
+               // checkpoints, skipping metadata that is not needed to read them.
+};
+
+struct DurabilityPolicy
+{
+    DurabilityMode mode = DurabilityMode::FSYNC;
+    uint32_t interval_ms = 0; // Only for PERIODIC.
+};
+
+enum class WalRecordType : uint32_t
+{
+    // Redo of one insertData call: WalInsertHeader, then num_pages times a
+    // PageDirectoryEntry followed by the after-image of that page, as many
+    // bytes as the table's pages take.
+    INSERT = 1,
+    // Redo of a deleteRow or updateRow call, laid out like INSERT. first_row_id
+    // is the row and num_rows the number of rows deleted, 0 or 1.
+    MODIFY = 2,
+};
+
+struct WalRecordHeader
+{
+    uint32_t length; // Payload bytes following this header.
+    WalRecordType type;
+    uint64_t lsn;
+    uint64_t checksum; // Hash of the payload seeded with the LSN.
+};
+
+struct WalInsertHeader
+{
+    uint32_t first_row_id;
+    uint32_t num_rows;
+    uint32_t num_pages;
+    uint32_t reserved;
+};
+
+struct WalRecord
+{
+    WalRecordType type;
+    uint64_t lsn;
+    std::vector<char> payload;
+};
+
+// Redo-only write-ahead log of a table. commit() returns once the record is
+// durable under the log's DurabilityPolicy. Records of threads that commit
+// while a flush is running are buffered and written by the next flush with a
+// single sequential write and sync (group commit), so n concurrent committers
+// pay for about two syncs instead of n. Log space is reserved WAL_EXTENT at a
+// time so that appends do not allocate blocks one by one.
+//
+// The log alternates between two files, wal.0.log and wal.1.log. A checkpoint
+// starts a new file with switchFile() and, once everything logged before the
+// switch is durable elsewhere, records the switch LSN as the redo point with
+// checkpointed(). The file before it is then free for reuse by the next
+// checkpoint, so the log never holds more than two checkpoint intervals.
+//
+// Records are written at the file's own end offset rather than appended, so
+// after recovery new records overwrite a torn tail. A record is only replayed
+// when its LSN matches its position and its checksum matches, which stops
+// replay at the first torn or stale record.
+class WriteAheadLog
+{
+public:
+    static constexpr uint64_t MAGIC = 0x314c415742444b4dULL; // "MKDBWAL1"
+
+    WriteAheadLog(const std::string &tableName, IStorage &storage, ILogger &logger = GlobalLogger::instance())
+        : storage_(storage),
+          files_{tableName + "/wal.0.log", tableName + "/wal.1.log"},
+          checkpointFile_(tableName + "/wal.ckpt"),
+          logger_(logger) {};
+    ~WriteAheadLog();
+
+    static constexpr size_t WAL_EXTENT = 16u << 20;
+
+    // Takes effect for the next flush. PERIODIC runs a thread that syncs the
+    // log every interval_ms.
+    void setDurability(const DurabilityPolicy &policy);
+
+    // Opens the log, creating it when missing, and calls visit for every intact
+    // record from the redo point on, in log order. Must run before the first commit.
+    void recover(const std::function<void(const WalRecord &)> &visit);
+
+    // Appends a record and blocks until it is durable. Returns its LSN.
+    uint64_t commit(WalRecordType type, const std::vector<char> &payload);
+    // The two halves of commit, for callers that must release latches between
+    // fixing the order of their record and waiting for it to become durable.
+    uint64_t append(WalRecordType type, const std::vector<char> &payload);
+    void waitDurable(uint64_t lsn);
+
+    // Directs later records to the other file, after syncing the records not
+    // synced yet, and returns the LSN they start at. No commit may be in flight. When the previous checkpoint never
+    // completed, the file is kept and its start returned, so that the records
+    // the recorded redo point still needs are not overwritten.
+    uint64_t switchFile();
+    // Makes redoLsn the point recovery starts from.
+    void checkpointed(uint64_t redoLsn);
+
+    // LSN the next record will get.
+    uint64_t getEndLsn();
+    // Bytes of log a recovery would replay.
+    uint64_t getSize();
+
+private:
+    void flushLocked(std::unique_lock<std::mutex> &lock);
+    void syncLoop();
+    void stopSyncer();
+    // Replays the records of one file from its start; returns the LSN after the last one.
+    uint64_t replayFile(int file, const std::function<void(const WalRecord &)> &visit, size_t &replayed);
+    bool readFileHeader(int file, WalFileHeader &header);
+    void writeFileHeader(int file, uint64_t startLsn);
+    static uint64_t checksum(const std::vector<char> &payload, uint64_t lsn);
+
+    IStorage &storage_;
+    std::string files_[2];
+    std::string checkpointFile_;
+    ILogger &logger_;
+
+    std::mutex mutex_;
+    std::condition_variable flushed_;
+    std::vector<char> buffer_; // Records waiting for the next flush.
+    int current_ = 0;          // File the records are written to.
+    uint64_t startLsn_ = 0;    // LSN of the first record of the current file.
+    uint64_t redoLsn_ = 0;     // Redo point of the last completed checkpoint.
+    uint64_t nextLsn_ = 0;     // LSN of the next record to be buffered.
+    uint64_t durableLsn_ = 0;  // Everything below is written and durable per the policy.
+    uint64_t syncedLsn_ = 0;   // Everything below is on stable storage.
+    size_t reserved_ = 0;      // Bytes preallocated for the current file.
+    bool flushing_ = false;    // A flush or periodic sync is running.
+    bool failed_ = false; // A flush failed; the buffered records are lost.
+    DurabilityPolicy policy_;
+    std::thread syncer_;
+    std::condition_variable syncerWake_;
+    bool stopSyncer_ = false;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <shared_mutex>
+
+#include "IStorage.h"
+#include "ILogger.h"
+#include "global_logger.h"
+#include "schema.h"
+#include "row.h"
+
+struct ZoneMapHeader
+{
+    uint32_t num_pages;
+    uint16_t num_columns;
+    uint16_t reserved;
+};
+
+// Min/max of one column within one page. Values are stored as order-preserving
+// 64-bit keys (see ZoneMap::toZoneKey), so a single layout covers every type.
+struct ColumnZone
+{
+    int64_t min;
+    int64_t max;
+    uint32_t null_count; // No column is nullable yet, so this stays 0 for now.
+    uint32_t has_values; // 0 until the first row of the page has been recorded.
+};
+
+// Per-page, per-column min/max kept next to the page directory in
+// <table>/zonemap.dat. Scans consult it to skip pages that cannot match a
+// range predicate without reading them from page.dat. After the column zones
+// every page has one more zone over the ids of its rows, which lets row
+// lookups by id skip pages the same way.
+class ZoneMap
+{
+public:
+    ZoneMap(const std::string &tableName, IStorage &storage, ILogger &logger = GlobalLogger::instance())
+        : storage_(storage),
+          filename_(tableName + "/zonemap.dat"),
+          logger_(logger) {};
+
+    // Maps a value onto an int64 such that a < b implies key(a) <= key(b).
+    // TEXT values are reduced to their first 7 bytes, which keeps the order
+    // but not strictness, so pruning comparisons must be strict.
+    static int64_t toZoneKey(const Row::Value &value, DataType type);
+
+    bool initialize();
+    void setSchema(const std::vector<Column> &columns);
+    // Widens the zone of a page with one row. Pages that already have a zone keep
+    // it, so appending rows to a partially full page stays correct.
+    void extend(uint32_t pageId, uint32_t rowId, const Row &row);
+    // Widens only the row id zone of a page, for rows whose home slot stays
+    // on the page while their values moved to another one.
+    void extendRowId(uint32_t pageId, uint32_t rowId);
+    // Returns false only when no row of the page can have lowKey <= column <= highKey.
+    bool mayContain(uint32_t pageId, size_t columnIndex, int64_t lowKey, int64_t highKey) const;
+    // Returns false only when the page certainly holds no row with this id.
+    bool mayContainRowId(uint32_t pageId, uint32_t rowId) const;
+    // Zones of every column of the page, or an empty vector when the page has none.
+    std::vector<ColumnZone> getZones(uint32_t pageId) const;
+    void persist();
+    // Forces the last persisted zone map to stable storage.
+    void sync();
+
+private:
+    // Zones of the page, created when missing. Needs latch_ held exclusively.
+    std::vector<ColumnZone> &zonesOf(uint32_t pageId);
+
+    IStorage &storage_;
+    std::string filename_;
+    ILogger &logger_;
+    std::vector<Column> columns_;
+    // Lets scans consult zones while inserts extend them.
+    mutable std::shared_mutex latch_;
+    // Indexed by page id; an empty vector means the page has no zone yet.
+    std::vector<std::vector<ColumnZone>> zones_;
+};
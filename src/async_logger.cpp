@@ -0,0 +1,164 @@
+#include "async_logger.h"
+
+#include <chrono>
+
+namespace
+{
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t capacity = 2;
+        while (capacity < value)
+        {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+}
+
+AsyncLogger::AsyncLogger(std::ostream &out, size_t capacity) : out_(out)
+{
+    capacity = roundUpToPowerOfTwo(capacity);
+    slots_ = std::make_unique<Slot[]>(capacity);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer_ = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stopping_.store(true, std::memory_order_release);
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+}
+
+void AsyncLogger::log(const std::string &message)
+{
+    log(LogLevel::INFO, message);
+}
+
+void AsyncLogger::log(LogLevel level, const std::string &message)
+{
+    if (!isEnabled(level))
+    {
+        return;
+    }
+    if (!push(level, message))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool AsyncLogger::push(LogLevel level, const std::string &message)
+{
+    // Bounded MPMC queue after Vyukov: a slot is free for position pos when its
+    // sequence equals pos, and holds a message for the reader when it is pos + 1.
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;)
+    {
+        slot = &slots_[pos & mask_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The writer has not freed this slot yet: the ring is full.
+            return false;
+        }
+        else
+        {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->message = message;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::pop(LogLevel &level, std::string &message)
+{
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[pos & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+    {
+        return false;
+    }
+    level = slot.level;
+    message.swap(slot.message);
+    slot.message.clear();
+    slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t AsyncLogger::drain()
+{
+    LogLevel level;
+    std::string message;
+    size_t count = 0;
+    while (pop(level, message))
+    {
+        out_ << '[' << logLevelName(level) << "] " << message << '\n';
+        count++;
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reportedDrops_)
+    {
+        out_ << "[WARN] Log buffer full, dropped " << (dropped - reportedDrops_) << " messages\n";
+        reportedDrops_ = dropped;
+        count++;
+    }
+
+    if (count > 0)
+    {
+        out_.flush();
+        written_.store(head_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+    return count;
+}
+
+void AsyncLogger::run()
+{
+    unsigned idle = 0;
+    while (!stopping_.load(std::memory_order_acquire))
+    {
+        if (drain() > 0)
+        {
+            idle = 0;
+            continue;
+        }
+        // Back off from spinning to sleeping while the ring stays empty.
+        if (++idle < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    drain();
+}
+
+void AsyncLogger::flush()
+{
+    size_t target = tail_.load(std::memory_order_acquire);
+    while (written_.load(std::memory_order_acquire) < target)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
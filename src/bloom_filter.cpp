@@ -0,0 +1,222 @@
+#include "bloom_filter.h"
+#include "hash.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MAKEDB_BLOOM_AVX2 1
+#endif
+
+namespace
+{
+    // Odd constants from the Parquet split-block Bloom filter specification.
+    alignas(32) const uint32_t SALTS[blocked_bloom::BLOCK_WORDS] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    uint32_t blockIndex(uint64_t hash, uint32_t numBlocks)
+    {
+        // Upper 32 bits pick the block, lower 32 bits pick the bits inside it.
+        return static_cast<uint32_t>(((hash >> 32) * numBlocks) >> 32);
+    }
+
+    void insertScalar(uint32_t *block, uint32_t key)
+    {
+        for (size_t i = 0; i < blocked_bloom::BLOCK_WORDS; i++)
+        {
+            block[i] |= 1U << ((key * SALTS[i]) >> 27);
+        }
+    }
+
+    bool containsScalar(const uint32_t *block, uint32_t key)
+    {
+        for (size_t i = 0; i < blocked_bloom::BLOCK_WORDS; i++)
+        {
+            if ((block[i] & (1U << ((key * SALTS[i]) >> 27))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#ifdef MAKEDB_BLOOM_AVX2
+    __attribute__((target("avx2"))) __m256i makeMask(uint32_t key)
+    {
+        __m256i salts = _mm256_load_si256(reinterpret_cast<const __m256i *>(SALTS));
+        __m256i products = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)), salts);
+        __m256i shifts = _mm256_srli_epi32(products, 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+    }
+
+    __attribute__((target("avx2"))) void insertAvx2(uint32_t *block, uint32_t key)
+    {
+        __m256i *target = reinterpret_cast<__m256i *>(block);
+        _mm256_storeu_si256(target, _mm256_or_si256(_mm256_loadu_si256(target), makeMask(key)));
+    }
+
+    __attribute__((target("avx2"))) bool containsAvx2(const uint32_t *block, uint32_t key)
+    {
+        __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+        // testc returns 1 when every bit of the mask is also set in the block.
+        return _mm256_testc_si256(bits, makeMask(key)) != 0;
+    }
+
+    const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+void blocked_bloom::insert(uint32_t *filter, uint32_t numBlocks, uint64_t hash)
+{
+    uint32_t *block = filter + blockIndex(hash, numBlocks) * BLOCK_WORDS;
+    uint32_t key = static_cast<uint32_t>(hash);
+#ifdef MAKEDB_BLOOM_AVX2
+    if (hasAvx2)
+    {
+        insertAvx2(block, key);
+        return;
+    }
+#endif
+    insertScalar(block, key);
+}
+
+bool blocked_bloom::mayContain(const uint32_t *filter, uint32_t numBlocks, uint64_t hash)
+{
+    const uint32_t *block = filter + blockIndex(hash, numBlocks) * BLOCK_WORDS;
+    uint32_t key = static_cast<uint32_t>(hash);
+#ifdef MAKEDB_BLOOM_AVX2
+    if (hasAvx2)
+    {
+        return containsAvx2(block, key);
+    }
+#endif
+    return containsScalar(block, key);
+}
+
+uint64_t PageBloomFilters::hashValue(const Row::Value &value, DataType type)
+{
+    switch (type)
+    {
+    case DataType::INT:
+        return hashMix(static_cast<uint32_t>(std::get<int32_t>(value)));
+    case DataType::FLOAT:
+        return hashMix(floatHashBits(std::get<float>(value)));
+    case DataType::TEXT:
+    case DataType::DATE:
+    {
+        const auto &text = std::get<std::string>(value);
+        return hashBytes(text.data(), text.size());
+    }
+    default:
+        throw std::runtime_error("Unsupported data type in bloom filter");
+    }
+}
+
+bool PageBloomFilters::exists()
+{
+    return storage_.fileExists(filename_);
+}
+
+bool PageBloomFilters::initialize()
+{
+    try
+    {
+        if (!storage_.fileExists(filename_) || storage_.getSize(filename_) < sizeof(BloomFilterHeader))
+        {
+            LOG_DEBUG(logger_, "Creating bloom filter file: " + filename_);
+            storage_.writeFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_));
+            return true;
+        }
+
+        storage_.readFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_), 0);
+        filters_.assign(header_.num_pages * pageWords(), 0);
+        if (!filters_.empty())
+        {
+            storage_.readFile(filename_, reinterpret_cast<char *>(filters_.data()), filters_.size() * sizeof(uint32_t), sizeof(header_));
+        }
+        LOG_DEBUG(logger_, "Loaded bloom filters for " + std::to_string(header_.num_pages) + " pages on column " + columnName_);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to initialize bloom filter " + filename_ + ": " + e.what());
+    }
+}
+
+void PageBloomFilters::add(uint32_t pageId, uint64_t hash)
+{
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (pageId >= header_.num_pages)
+    {
+        header_.num_pages = pageId + 1;
+        filters_.resize(header_.num_pages * pageWords(), 0);
+    }
+    blocked_bloom::insert(filters_.data() + pageId * pageWords(), header_.blocks_per_page, hash);
+    if (pageId < dirtyBegin_)
+    {
+        dirtyBegin_ = pageId;
+    }
+    if (pageId + 1 > dirtyEnd_)
+    {
+        dirtyEnd_ = pageId + 1;
+    }
+}
+
+bool PageBloomFilters::mayContain(uint32_t pageId, uint64_t hash) const
+{
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (pageId >= header_.num_pages)
+    {
+        // No filter was built for this page: it has to be read.
+        return true;
+    }
+    return blocked_bloom::mayContain(filters_.data() + pageId * pageWords(), header_.blocks_per_page, hash);
+}
+
+void PageBloomFilters::persist()
+{
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    if (dirtyBegin_ >= dirtyEnd_)
+    {
+        return;
+    }
+
+    try
+    {
+        size_t wordOffset = dirtyBegin_ * pageWords();
+        size_t numWords = (dirtyEnd_ - dirtyBegin_) * pageWords();
+        storage_.writeFile(filename_, reinterpret_cast<char *>(filters_.data() + wordOffset), numWords * sizeof(uint32_t),
+                           sizeof(header_) + wordOffset * sizeof(uint32_t));
+        storage_.writeFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_));
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(logger_, "Failed to persist bloom filter to file: " + filename_ + ", error: " + e.what());
+        return;
+    }
+    dirtyBegin_ = UINT32_MAX;
+    dirtyEnd_ = 0;
+}
+
+void PageBloomFilters::reset(uint32_t blocksPerPage)
+{
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    header_ = {0, blocksPerPage};
+    filters_.clear();
+    // Bytes of the old filters stay in the file until overwritten, so even
+    // pages never added to must be written.
+    dirtyBegin_ = 0;
+    dirtyEnd_ = 0;
+    storage_.writeFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_));
+}
+
+void PageBloomFilters::sync()
+{
+    if (storage_.fileExists(filename_))
+    {
+        storage_.syncFile(filename_);
+    }
+}
@@ -0,0 +1,476 @@
+#include "btree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    BTreeNodeHeader readHeader(const std::vector<char> &node)
+    {
+        BTreeNodeHeader header;
+        std::memcpy(&header, node.data(), sizeof(BTreeNodeHeader));
+        return header;
+    }
+
+    void writeHeader(std::vector<char> &node, const BTreeNodeHeader &header)
+    {
+        std::memcpy(node.data(), &header, sizeof(BTreeNodeHeader));
+    }
+
+    // Leaf layout: header, then num_keys BTreeLeafEntry.
+    std::vector<BTreeLeafEntry> readLeafEntries(const std::vector<char> &node, uint16_t numKeys)
+    {
+        std::vector<BTreeLeafEntry> entries(numKeys);
+        std::memcpy(entries.data(), node.data() + sizeof(BTreeNodeHeader), numKeys * sizeof(BTreeLeafEntry));
+        return entries;
+    }
+
+    void writeLeaf(std::vector<char> &node, const std::vector<BTreeLeafEntry> &entries, uint32_t nextLeaf)
+    {
+        std::fill(node.begin(), node.end(), 0);
+        BTreeNodeHeader header{1, static_cast<uint16_t>(entries.size()), nextLeaf};
+        writeHeader(node, header);
+        std::memcpy(node.data() + sizeof(BTreeNodeHeader), entries.data(), entries.size() * sizeof(BTreeLeafEntry));
+    }
+
+    // Internal layout: header, children[0], then num_keys BTreeInternalEntry.
+    void readInternal(const std::vector<char> &node, uint16_t numKeys, std::vector<int32_t> &keys, std::vector<uint32_t> &children)
+    {
+        keys.resize(numKeys);
+        children.resize(numKeys + 1);
+        const char *cursor = node.data() + sizeof(BTreeNodeHeader);
+        std::memcpy(&children[0], cursor, sizeof(uint32_t));
+        cursor += sizeof(uint32_t);
+        for (uint16_t i = 0; i < numKeys; i++)
+        {
+            BTreeInternalEntry entry;
+            std::memcpy(&entry, cursor + i * sizeof(BTreeInternalEntry), sizeof(BTreeInternalEntry));
+            keys[i] = entry.key;
+            children[i + 1] = entry.child;
+        }
+    }
+
+    void writeInternal(std::vector<char> &node, const std::vector<int32_t> &keys, const std::vector<uint32_t> &children)
+    {
+        std::fill(node.begin(), node.end(), 0);
+        BTreeNodeHeader header{0, static_cast<uint16_t>(keys.size()), 0};
+        writeHeader(node, header);
+        char *cursor = node.data() + sizeof(BTreeNodeHeader);
+        std::memcpy(cursor, &children[0], sizeof(uint32_t));
+        cursor += sizeof(uint32_t);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            BTreeInternalEntry entry{keys[i], children[i + 1]};
+            std::memcpy(cursor + i * sizeof(BTreeInternalEntry), &entry, sizeof(BTreeInternalEntry));
+        }
+    }
+
+    // Splits `total` items into `groups` nearly equal consecutive runs.
+    size_t groupStart(size_t total, size_t groups, size_t index)
+    {
+        return total * index / groups;
+    }
+}
+
+bool BPlusTree::exists()
+{
+    return storage_.fileExists(filename_);
+}
+
+bool BPlusTree::initialize()
+{
+    try
+    {
+        LOG_DEBUG(logger_, "Checking if index file exists: " + filename_);
+        if (storage_.fileExists(filename_) && storage_.getSize(filename_) >= PAGE_SIZE)
+        {
+            std::vector<char> metaPage(PAGE_SIZE, 0);
+            if (!storage_.readFile(filename_, metaPage.data(), PAGE_SIZE, 0))
+            {
+                throw std::runtime_error("Failed to read meta page");
+            }
+            std::memcpy(&meta_, metaPage.data(), sizeof(BTreeMetaPage));
+        }
+        else
+        {
+            LOG_DEBUG(logger_, "Creating index file: " + filename_);
+            meta_ = {0, 1, 0, 0, 0};
+            persistMeta();
+        }
+        LOG_DEBUG(logger_, "Index " + columnName_ + ": root=" + std::to_string(meta_.root_page_id) +
+                           ", pages=" + std::to_string(meta_.num_pages) + ", height=" + std::to_string(meta_.height) +
+                           ", entries=" + std::to_string(meta_.num_entries));
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to initialize index " + filename_ + ": " + e.what());
+    }
+}
+
+void BPlusTree::removeFiles()
+{
+    if (storage_.fileExists(filename_))
+    {
+        storage_.removeFile(filename_);
+    }
+    meta_ = {0, 1, 0, 0, 0};
+}
+
+void BPlusTree::markDirty()
+{
+    if (meta_.clean != CLEAN_MARK)
+    {
+        return;
+    }
+    meta_.clean = 0;
+    persistMeta();
+    storage_.syncData(filename_);
+}
+
+void BPlusTree::markClean()
+{
+    if (meta_.clean == CLEAN_MARK)
+    {
+        return;
+    }
+    // The nodes must be durable before the mark that vouches for them.
+    storage_.syncData(filename_);
+    meta_.clean = CLEAN_MARK;
+    persistMeta();
+    storage_.syncData(filename_);
+}
+
+void BPlusTree::readNode(uint32_t pageId, std::vector<char> &buffer)
+{
+    buffer.assign(PAGE_SIZE, 0);
+    if (!storage_.readFile(filename_, buffer.data(), PAGE_SIZE, static_cast<std::streamoff>(pageId) * PAGE_SIZE))
+    {
+        throw std::runtime_error("Failed to read node " + std::to_string(pageId) + " of index " + filename_);
+    }
+}
+
+void BPlusTree::writeNode(uint32_t pageId, std::vector<char> &buffer)
+{
+    if (!storage_.writeFile(filename_, buffer.data(), PAGE_SIZE, static_cast<std::streamoff>(pageId) * PAGE_SIZE))
+    {
+        throw std::runtime_error("Failed to write node " + std::to_string(pageId) + " of index " + filename_);
+    }
+}
+
+uint32_t BPlusTree::allocatePage()
+{
+    return meta_.num_pages++;
+}
+
+void BPlusTree::persistMeta()
+{
+    std::vector<char> metaPage(PAGE_SIZE, 0);
+    std::memcpy(metaPage.data(), &meta_, sizeof(BTreeMetaPage));
+    if (!storage_.writeFile(filename_, metaPage.data(), PAGE_SIZE, 0))
+    {
+        throw std::runtime_error("Failed to write meta page of index " + filename_);
+    }
+}
+
+bool BPlusTree::bulkLoad(const std::vector<Entry> &sortedEntries)
+{
+    if (sortedEntries.empty())
+    {
+        return true;
+    }
+    if (meta_.root_page_id != 0)
+    {
+        LOG_INFO(logger_, "Index " + columnName_ + " is not empty, inserting " + std::to_string(sortedEntries.size()) + " entries");
+        for (const auto &entry : sortedEntries)
+        {
+            insertEntry(entry.first, entry.second);
+        }
+        persistMeta();
+        return true;
+    }
+
+    LOG_INFO(logger_, "Bulk loading " + std::to_string(sortedEntries.size()) + " entries into index " + columnName_);
+
+    // All nodes are laid out contiguously after the meta page and written in one go.
+    std::vector<char> pages;
+    uint32_t firstPageId = meta_.num_pages;
+    auto appendNode = [&](const std::vector<char> &node)
+    {
+        pages.insert(pages.end(), node.begin(), node.end());
+        return meta_.num_pages++;
+    };
+
+    // 1) Leaves, evenly filled so that no leaf ends up nearly empty.
+    size_t numLeaves = (sortedEntries.size() + LEAF_CAPACITY - 1) / LEAF_CAPACITY;
+    std::vector<uint32_t> levelPages;
+    std::vector<int32_t> levelMinKeys;
+    std::vector<char> node(PAGE_SIZE, 0);
+    for (size_t leaf = 0; leaf < numLeaves; leaf++)
+    {
+        size_t begin = groupStart(sortedEntries.size(), numLeaves, leaf);
+        size_t end = groupStart(sortedEntries.size(), numLeaves, leaf + 1);
+        std::vector<BTreeLeafEntry> entries;
+        entries.reserve(end - begin);
+        for (size_t i = begin; i < end; i++)
+        {
+            const auto &entry = sortedEntries[i];
+            entries.push_back({entry.first, entry.second.page_id, entry.second.slot_id, 0});
+        }
+        uint32_t pageId = firstPageId + static_cast<uint32_t>(leaf);
+        uint32_t nextLeaf = (leaf + 1 < numLeaves) ? pageId + 1 : 0;
+        writeLeaf(node, entries, nextLeaf);
+        levelPages.push_back(appendNode(node));
+        levelMinKeys.push_back(entries.front().key);
+    }
+    uint32_t height = 1;
+
+    // 2) Internal levels until a single root remains.
+    while (levelPages.size() > 1)
+    {
+        size_t numNodes = (levelPages.size() + INTERNAL_CAPACITY) / (INTERNAL_CAPACITY + 1);
+        std::vector<uint32_t> parentPages;
+        std::vector<int32_t> parentMinKeys;
+        for (size_t n = 0; n < numNodes; n++)
+        {
+            size_t begin = groupStart(levelPages.size(), numNodes, n);
+            size_t end = groupStart(levelPages.size(), numNodes, n + 1);
+            std::vector<uint32_t> children(levelPages.begin() + begin, levelPages.begin() + end);
+            std::vector<int32_t> keys(levelMinKeys.begin() + begin + 1, levelMinKeys.begin() + end);
+            writeInternal(node, keys, children);
+            parentPages.push_back(appendNode(node));
+            parentMinKeys.push_back(levelMinKeys[begin]);
+        }
+        levelPages.swap(parentPages);
+        levelMinKeys.swap(parentMinKeys);
+        height++;
+    }
+
+    if (!storage_.writeFile(filename_, pages.data(), pages.size(), static_cast<std::streamoff>(firstPageId) * PAGE_SIZE))
+    {
+        throw std::runtime_error("Failed to write bulk loaded nodes of index " + filename_);
+    }
+
+    meta_.root_page_id = levelPages.front();
+    meta_.height = height;
+    meta_.num_entries += static_cast<uint32_t>(sortedEntries.size());
+    persistMeta();
+    LOG_INFO(logger_, "Bulk load complete: pages=" + std::to_string(meta_.num_pages) + ", height=" + std::to_string(meta_.height));
+    return true;
+}
+
+bool BPlusTree::insert(int32_t key, const Location &location)
+{
+    insertEntry(key, location);
+    persistMeta();
+    return true;
+}
+
+void BPlusTree::insertEntry(int32_t key, const Location &location)
+{
+    if (meta_.root_page_id == 0)
+    {
+        std::vector<char> node(PAGE_SIZE, 0);
+        writeLeaf(node, {{key, location.page_id, location.slot_id, 0}}, 0);
+        uint32_t pageId = allocatePage();
+        writeNode(pageId, node);
+        meta_.root_page_id = pageId;
+        meta_.height = 1;
+        meta_.num_entries = 1;
+        return;
+    }
+
+    Split split = insertInto(meta_.root_page_id, key, location);
+    if (split.happened)
+    {
+        // Grow the tree by one level.
+        std::vector<char> node(PAGE_SIZE, 0);
+        writeInternal(node, {split.separator}, {meta_.root_page_id, split.rightPageId});
+        uint32_t newRoot = allocatePage();
+        writeNode(newRoot, node);
+        meta_.root_page_id = newRoot;
+        meta_.height++;
+    }
+    meta_.num_entries++;
+}
+
+BPlusTree::Split BPlusTree::insertInto(uint32_t pageId, int32_t key, const Location &location)
+{
+    std::vector<char> node;
+    readNode(pageId, node);
+    BTreeNodeHeader header = readHeader(node);
+
+    if (header.is_leaf)
+    {
+        std::vector<BTreeLeafEntry> entries = readLeafEntries(node, header.num_keys);
+        auto pos = std::upper_bound(entries.begin(), entries.end(), key,
+                                    [](int32_t k, const BTreeLeafEntry &e)
+                                    { return k < e.key; });
+        entries.insert(pos, {key, location.page_id, location.slot_id, 0});
+
+        if (entries.size() <= LEAF_CAPACITY)
+        {
+            writeLeaf(node, entries, header.next_leaf);
+            writeNode(pageId, node);
+            return {false, 0, 0};
+        }
+
+        // Split the leaf in half and link the new right sibling.
+        size_t mid = entries.size() / 2;
+        std::vector<BTreeLeafEntry> left(entries.begin(), entries.begin() + mid);
+        std::vector<BTreeLeafEntry> right(entries.begin() + mid, entries.end());
+        uint32_t rightPageId = allocatePage();
+
+        std::vector<char> rightNode(PAGE_SIZE, 0);
+        writeLeaf(rightNode, right, header.next_leaf);
+        writeNode(rightPageId, rightNode);
+        writeLeaf(node, left, rightPageId);
+        writeNode(pageId, node);
+        return {true, right.front().key, rightPageId};
+    }
+
+    std::vector<int32_t> keys;
+    std::vector<uint32_t> children;
+    readInternal(node, header.num_keys, keys, children);
+    size_t childIndex = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+
+    Split childSplit = insertInto(children[childIndex], key, location);
+    if (!childSplit.happened)
+    {
+        return {false, 0, 0};
+    }
+
+    keys.insert(keys.begin() + childIndex, childSplit.separator);
+    children.insert(children.begin() + childIndex + 1, childSplit.rightPageId);
+    if (keys.size() <= INTERNAL_CAPACITY)
+    {
+        writeInternal(node, keys, children);
+        writeNode(pageId, node);
+        return {false, 0, 0};
+    }
+
+    // Split the internal node; the middle key moves up to the parent.
+    size_t mid = keys.size() / 2;
+    int32_t separator = keys[mid];
+    std::vector<int32_t> leftKeys(keys.begin(), keys.begin() + mid);
+    std::vector<uint32_t> leftChildren(children.begin(), children.begin() + mid + 1);
+    std::vector<int32_t> rightKeys(keys.begin() + mid + 1, keys.end());
+    std::vector<uint32_t> rightChildren(children.begin() + mid + 1, children.end());
+    uint32_t rightPageId = allocatePage();
+
+    std::vector<char> rightNode(PAGE_SIZE, 0);
+    writeInternal(rightNode, rightKeys, rightChildren);
+    writeNode(rightPageId, rightNode);
+    writeInternal(node, leftKeys, leftChildren);
+    writeNode(pageId, node);
+    return {true, separator, rightPageId};
+}
+
+bool BPlusTree::remove(int32_t key, const Location &location)
+{
+    if (meta_.root_page_id == 0)
+    {
+        return false;
+    }
+
+    // Duplicates of the key may start left of where a lookup lands, so descend
+    // like rangeScan and walk right from there.
+    std::vector<char> node;
+    uint32_t pageId = meta_.root_page_id;
+    readNode(pageId, node);
+    BTreeNodeHeader header = readHeader(node);
+    while (!header.is_leaf)
+    {
+        std::vector<int32_t> keys;
+        std::vector<uint32_t> children;
+        readInternal(node, header.num_keys, keys, children);
+        size_t childIndex = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        pageId = children[childIndex];
+        readNode(pageId, node);
+        header = readHeader(node);
+    }
+
+    while (true)
+    {
+        std::vector<BTreeLeafEntry> entries = readLeafEntries(node, header.num_keys);
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->key > key)
+            {
+                return false;
+            }
+            if (it->key == key && it->page_id == location.page_id && it->slot_id == location.slot_id)
+            {
+                entries.erase(it);
+                writeLeaf(node, entries, header.next_leaf);
+                writeNode(pageId, node);
+                meta_.num_entries--;
+                persistMeta();
+                return true;
+            }
+        }
+        if (header.next_leaf == 0)
+        {
+            return false;
+        }
+        pageId = header.next_leaf;
+        readNode(pageId, node);
+        header = readHeader(node);
+    }
+}
+
+std::vector<Location> BPlusTree::rangeScan(int32_t low, int32_t high, size_t limit)
+{
+    std::vector<Location> results;
+    if (meta_.root_page_id == 0 || low > high || limit == 0)
+    {
+        return results;
+    }
+
+    // 1) Descend to the leftmost leaf that may contain `low`. Separators equal to
+    //    `low` send us left because duplicates can straddle a split.
+    std::vector<char> node;
+    uint32_t pageId = meta_.root_page_id;
+    readNode(pageId, node);
+    BTreeNodeHeader header = readHeader(node);
+    while (!header.is_leaf)
+    {
+        std::vector<int32_t> keys;
+        std::vector<uint32_t> children;
+        readInternal(node, header.num_keys, keys, children);
+        size_t childIndex = std::lower_bound(keys.begin(), keys.end(), low) - keys.begin();
+        pageId = children[childIndex];
+        readNode(pageId, node);
+        header = readHeader(node);
+    }
+
+    // 2) Walk the linked leaves until a key exceeds `high`.
+    while (true)
+    {
+        std::vector<BTreeLeafEntry> entries = readLeafEntries(node, header.num_keys);
+        for (const auto &entry : entries)
+        {
+            if (entry.key > high)
+            {
+                return results;
+            }
+            if (entry.key >= low)
+            {
+                results.push_back({entry.page_id, entry.slot_id});
+                if (results.size() == limit)
+                {
+                    return results;
+                }
+            }
+        }
+        if (header.next_leaf == 0)
+        {
+            break;
+        }
+        pageId = header.next_leaf;
+        readNode(pageId, node);
+        header = readHeader(node);
+    }
+    return results;
+}
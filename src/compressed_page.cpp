@@ -0,0 +1,908 @@
+#include "compressed_page.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    constexpr size_t WORD_WIDTH = sizeof(uint32_t);
+    // Every row takes a slot id, so a page holds at most this many.
+    constexpr size_t MAX_ROWS = UINT16_MAX;
+
+    CompressedPageHeader readHeader(const std::vector<char> &page)
+    {
+        CompressedPageHeader header;
+        std::memcpy(&header, page.data(), sizeof(CompressedPageHeader));
+        return header;
+    }
+
+    CompressedColumnHeader readColumnHeader(const std::vector<char> &page, size_t column)
+    {
+        CompressedColumnHeader header;
+        std::memcpy(&header, page.data() + sizeof(CompressedPageHeader) + column * sizeof(CompressedColumnHeader),
+                    sizeof(CompressedColumnHeader));
+        return header;
+    }
+
+    size_t columnsOffset(size_t numColumns)
+    {
+        // One column header per column plus one for the row ids.
+        return sizeof(CompressedPageHeader) + (numColumns + 1) * sizeof(CompressedColumnHeader);
+    }
+
+    // Bits a code of at most maxCode takes.
+    uint8_t bitsFor(uint64_t maxCode)
+    {
+        uint8_t bits = 0;
+        while (maxCode >> bits)
+        {
+            bits++;
+        }
+        return bits;
+    }
+
+    size_t packedBytes(size_t count, uint8_t bitWidth)
+    {
+        return (count * bitWidth + 7) / 8;
+    }
+
+    // Codes are packed least significant bit first; out must be zeroed.
+    void packBits(const std::vector<uint32_t> &codes, uint8_t bitWidth, char *out)
+    {
+        for (size_t i = 0; i < codes.size() && bitWidth > 0; i++)
+        {
+            size_t bit = i * bitWidth;
+            uint64_t value = static_cast<uint64_t>(codes[i]) << (bit & 7);
+            for (size_t byte = bit >> 3; value != 0; byte++, value >>= 8)
+            {
+                out[byte] = static_cast<char>(static_cast<uint8_t>(out[byte]) | static_cast<uint8_t>(value & 0xff));
+            }
+        }
+    }
+
+    // Reads code index of codes packed at in, with available bytes from in to
+    // the end of the page.
+    uint32_t unpackBits(const char *in, size_t available, size_t index, uint8_t bitWidth)
+    {
+        if (bitWidth == 0)
+        {
+            return 0;
+        }
+        size_t bit = index * bitWidth;
+        size_t first = bit >> 3;
+        uint64_t word = 0;
+        std::memcpy(&word, in + first, std::min(sizeof(word), available - first));
+        return static_cast<uint32_t>((word >> (bit & 7)) & ((uint64_t(1) << bitWidth) - 1));
+    }
+
+    uint16_t readUint16(const char *data, size_t index)
+    {
+        uint16_t value;
+        std::memcpy(&value, data + index * sizeof(uint16_t), sizeof(uint16_t));
+        return value;
+    }
+
+    uint32_t readWord(const char *data, size_t index)
+    {
+        uint32_t value;
+        std::memcpy(&value, data + index * WORD_WIDTH, WORD_WIDTH);
+        return value;
+    }
+
+    // Splits a serialized row into its fields; DATE values become words.
+    std::vector<PackedField> parseRow(const std::vector<Column> &columns, const std::vector<char> &row)
+    {
+        std::vector<PackedField> fields(columns.size());
+        size_t offset = 0;
+        auto need = [&](size_t bytes)
+        {
+            if (offset + bytes > row.size())
+            {
+                throw std::runtime_error("Serialized row is truncated");
+            }
+        };
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            if (columns[c].type == DataType::INT || columns[c].type == DataType::FLOAT)
+            {
+                need(WORD_WIDTH);
+                std::memcpy(&fields[c].word, row.data() + offset, WORD_WIDTH);
+                offset += WORD_WIDTH;
+                continue;
+            }
+            need(sizeof(uint16_t));
+            uint16_t prefix;
+            std::memcpy(&prefix, row.data() + offset, sizeof(uint16_t));
+            offset += sizeof(uint16_t);
+            size_t length = prefix;
+            if (prefix == Row::LONG_TEXT)
+            {
+                uint32_t longLength;
+                need(sizeof(uint32_t));
+                std::memcpy(&longLength, row.data() + offset, sizeof(uint32_t));
+                offset += sizeof(uint32_t);
+                length = longLength;
+            }
+            else if (prefix == Row::OVERFLOW_TEXT)
+            {
+                throw std::runtime_error("Compressed pages do not store overflow values");
+            }
+            need(length);
+            std::string text(row.data() + offset, length);
+            offset += length;
+            if (columns[c].type == DataType::DATE)
+            {
+                fields[c].word = static_cast<uint32_t>(Row::dateToKey(text));
+            }
+            else
+            {
+                fields[c].text = std::move(text);
+            }
+        }
+        return fields;
+    }
+
+    // Bytes the fields take stored plainly, the row id included.
+    size_t plainSize(const std::vector<Column> &columns, const std::vector<PackedField> &fields)
+    {
+        size_t size = WORD_WIDTH;
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            size += columns[c].type == DataType::TEXT ? sizeof(uint16_t) + fields[c].text.size() : WORD_WIDTH;
+        }
+        return size;
+    }
+}
+
+size_t CompressedPageStatistics::ColumnStats::bytes(size_t numRows, const PackedField *field, ColumnEncoding &encoding,
+                                                     uint8_t &bitWidth) const
+{
+    size_t rows = numRows;
+    size_t runCount = runs;
+    size_t distinct = isText ? distinctTexts.size() : distinctWords.size();
+    size_t plainText = textBytes;
+    size_t runText = runBytes;
+    size_t distinctText = distinctBytes;
+    int64_t lo = min;
+    int64_t hi = max;
+    if (field != nullptr)
+    {
+        bool newRun = !hasLast || (isText ? field->text != last.text : field->word != last.word);
+        rows++;
+        runCount += newRun ? 1 : 0;
+        if (isText)
+        {
+            plainText += field->text.size();
+            runText += newRun ? field->text.size() : 0;
+            if (distinctTexts.count(field->text) == 0)
+            {
+                distinct++;
+                distinctText += field->text.size();
+            }
+        }
+        else
+        {
+            int64_t k = key(field->word);
+            lo = hasLast ? std::min(lo, k) : k;
+            hi = hasLast ? std::max(hi, k) : k;
+            distinct += distinctWords.count(field->word) == 0 ? 1 : 0;
+        }
+    }
+
+    // Candidates in order of preference; a later one has to be strictly smaller.
+    uint8_t codeWidth = distinct > 1 ? bitsFor(distinct - 1) : 0;
+    encoding = ColumnEncoding::PLAIN;
+    bitWidth = 0;
+    size_t best = isText ? rows * sizeof(uint16_t) + plainText : rows * WORD_WIDTH;
+    auto consider = [&](ColumnEncoding candidate, size_t size, uint8_t width)
+    {
+        if (size < best)
+        {
+            encoding = candidate;
+            best = size;
+            bitWidth = width;
+        }
+    };
+    if (!isText && rows > 0)
+    {
+        uint8_t offsetWidth = bitsFor(static_cast<uint64_t>(hi - lo));
+        consider(ColumnEncoding::FRAME_OF_REFERENCE, sizeof(int64_t) + packedBytes(rows, offsetWidth), offsetWidth);
+    }
+    size_t dictionaryBytes = isText ? distinct * sizeof(uint16_t) + distinctText : distinct * WORD_WIDTH;
+    consider(ColumnEncoding::DICTIONARY, dictionaryBytes + packedBytes(rows, codeWidth), codeWidth);
+    size_t runLengthBytes = isText ? runCount * 2 * sizeof(uint16_t) + runText : runCount * (WORD_WIDTH + sizeof(uint16_t));
+    consider(ColumnEncoding::RUN_LENGTH, runLengthBytes, 0);
+    return best;
+}
+
+void CompressedPageStatistics::ColumnStats::add(const PackedField &field)
+{
+    bool newRun = !hasLast || (isText ? field.text != last.text : field.word != last.word);
+    runs += newRun ? 1 : 0;
+    if (isText)
+    {
+        textBytes += field.text.size();
+        runBytes += newRun ? field.text.size() : 0;
+        if (distinctTexts.insert(field.text).second)
+        {
+            distinctBytes += field.text.size();
+        }
+    }
+    else
+    {
+        int64_t k = key(field.word);
+        min = hasLast ? std::min(min, k) : k;
+        max = hasLast ? std::max(max, k) : k;
+        distinctWords.insert(field.word);
+    }
+    if (newRun)
+    {
+        last = field;
+    }
+    hasLast = true;
+}
+
+CompressedPageStatistics::CompressedPageStatistics(const std::vector<Column> &columns, size_t pageSize)
+    : columns_(columns), pageSize_(pageSize)
+{
+    clear();
+}
+
+void CompressedPageStatistics::clear()
+{
+    numRows_ = 0;
+    stats_.assign(columns_.size() + 1, ColumnStats{});
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        stats_[c + 1].isText = columns_[c].type == DataType::TEXT;
+        stats_[c + 1].isSigned = columns_[c].type != DataType::FLOAT;
+    }
+}
+
+size_t CompressedPageStatistics::pageBytes(uint32_t rowId, const std::vector<PackedField> *fields) const
+{
+    ColumnEncoding encoding;
+    uint8_t bitWidth;
+    PackedField id;
+    id.word = rowId;
+    size_t bytes = columnsOffset(columns_.size());
+    bytes += stats_[0].bytes(numRows_, fields != nullptr ? &id : nullptr, encoding, bitWidth);
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        bytes += stats_[c + 1].bytes(numRows_, fields != nullptr ? &(*fields)[c] : nullptr, encoding, bitWidth);
+    }
+    return bytes;
+}
+
+size_t CompressedPageStatistics::pageBytes() const
+{
+    return pageBytes(0, nullptr);
+}
+
+bool CompressedPageStatistics::add(uint32_t rowId, const std::vector<PackedField> &fields)
+{
+    if (numRows_ >= MAX_ROWS || pageBytes(rowId, &fields) > pageSize_)
+    {
+        return false;
+    }
+    PackedField id;
+    id.word = rowId;
+    stats_[0].add(id);
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        stats_[c + 1].add(fields[c]);
+    }
+    numRows_++;
+    return true;
+}
+
+bool CompressedPageStatistics::add(uint32_t rowId, const std::vector<char> &row)
+{
+    return add(rowId, parseRow(columns_, row));
+}
+
+ColumnEncoding CompressedPageStatistics::encoding(size_t column, size_t &bytes, uint8_t &bitWidth) const
+{
+    ColumnEncoding encoding;
+    bytes = stats_.at(column).bytes(numRows_, nullptr, encoding, bitWidth);
+    return encoding;
+}
+
+void CompressedPage::initPage(std::vector<char> &page)
+{
+    page.assign(pageSize_, 0);
+    uint32_t used = static_cast<uint32_t>(columnsOffset(columns_.size()));
+    CompressedPageHeader header{0, 0, 0, static_cast<uint16_t>(columns_.size()), used, 0};
+    std::memcpy(page.data(), &header, sizeof(CompressedPageHeader));
+    for (size_t c = 0; c <= columns_.size(); c++)
+    {
+        CompressedColumnHeader column{ColumnEncoding::PLAIN, 0, 0, used};
+        std::memcpy(page.data() + sizeof(CompressedPageHeader) + c * sizeof(CompressedColumnHeader), &column,
+                    sizeof(CompressedColumnHeader));
+    }
+}
+
+size_t CompressedPage::emptyPageSpace()
+{
+    return pageSize_ - columnsOffset(columns_.size());
+}
+
+size_t CompressedPage::requiredSpace(const std::vector<char> &row)
+{
+    return plainSize(columns_, parseRow(columns_, row));
+}
+
+size_t CompressedPage::freeSpace(const std::vector<char> &page)
+{
+    // Rows stored plainly never take more room than encoded, so a batch
+    // within this fits whatever encodings the rebuilt page ends up with.
+    CompressedPageHeader header = readHeader(page);
+    size_t capacity = emptyPageSpace();
+    return header.plainBytes < capacity ? capacity - header.plainBytes : 0;
+}
+
+void CompressedPage::build(const std::vector<uint32_t> &ids, const std::vector<std::vector<PackedField>> &rows, size_t plainBytes,
+                           std::vector<char> &page)
+{
+    const size_t numColumns = columns_.size();
+    const size_t numRows = rows.size();
+    CompressedPageStatistics statistics(columns_, pageSize_);
+    for (size_t r = 0; r < numRows; r++)
+    {
+        if (!statistics.add(ids[r], rows[r]))
+        {
+            throw std::runtime_error("Not enough space for new row in compressed page.");
+        }
+    }
+
+    std::vector<PackedField> idFields(numRows);
+    for (size_t r = 0; r < numRows; r++)
+    {
+        idFields[r].word = ids[r];
+    }
+
+    std::vector<char> out(pageSize_, 0);
+    size_t cursor = columnsOffset(numColumns);
+    for (size_t c = 0; c <= numColumns; c++)
+    {
+        bool isText = c > 0 && columns_[c - 1].type == DataType::TEXT;
+        auto field = [&](size_t r) -> const PackedField &
+        { return c == 0 ? idFields[r] : rows[r][c - 1]; };
+        auto same = [&](size_t a, size_t b)
+        {
+            return isText ? field(a).text == field(b).text : field(a).word == field(b).word;
+        };
+
+        size_t bytes;
+        CompressedColumnHeader header{};
+        header.encoding = statistics.encoding(c, bytes, header.bitWidth);
+        header.offset = static_cast<uint32_t>(cursor);
+        char *data = out.data() + cursor;
+        switch (header.encoding)
+        {
+        case ColumnEncoding::PLAIN:
+        {
+            if (!isText)
+            {
+                for (size_t r = 0; r < numRows; r++)
+                {
+                    std::memcpy(data + r * WORD_WIDTH, &field(r).word, WORD_WIDTH);
+                }
+                break;
+            }
+            char *bytesStart = data + numRows * sizeof(uint16_t);
+            uint16_t end = 0;
+            for (size_t r = 0; r < numRows; r++)
+            {
+                const std::string &text = field(r).text;
+                std::memcpy(bytesStart + end, text.data(), text.size());
+                end = static_cast<uint16_t>(end + text.size());
+                std::memcpy(data + r * sizeof(uint16_t), &end, sizeof(uint16_t));
+            }
+            break;
+        }
+        case ColumnEncoding::FRAME_OF_REFERENCE:
+        {
+            bool isSigned = c > 0 && columns_[c - 1].type != DataType::FLOAT;
+            auto key = [&](uint32_t word)
+            { return isSigned ? static_cast<int64_t>(static_cast<int32_t>(word)) : static_cast<int64_t>(word); };
+            int64_t base = key(field(0).word);
+            for (size_t r = 1; r < numRows; r++)
+            {
+                base = std::min(base, key(field(r).word));
+            }
+            std::vector<uint32_t> codes(numRows);
+            for (size_t r = 0; r < numRows; r++)
+            {
+                codes[r] = static_cast<uint32_t>(key(field(r).word) - base);
+            }
+            std::memcpy(data, &base, sizeof(int64_t));
+            packBits(codes, header.bitWidth, data + sizeof(int64_t));
+            break;
+        }
+        case ColumnEncoding::DICTIONARY:
+        {
+            // Values in order of first appearance; codes index them.
+            std::vector<uint32_t> codes(numRows);
+            std::vector<size_t> firsts;
+            if (isText)
+            {
+                std::unordered_map<std::string, uint32_t> dictionary;
+                for (size_t r = 0; r < numRows; r++)
+                {
+                    auto inserted = dictionary.emplace(field(r).text, static_cast<uint32_t>(firsts.size()));
+                    if (inserted.second)
+                    {
+                        firsts.push_back(r);
+                    }
+                    codes[r] = inserted.first->second;
+                }
+                char *bytesStart = data + firsts.size() * sizeof(uint16_t);
+                uint16_t end = 0;
+                for (size_t i = 0; i < firsts.size(); i++)
+                {
+                    const std::string &text = field(firsts[i]).text;
+                    std::memcpy(bytesStart + end, text.data(), text.size());
+                    end = static_cast<uint16_t>(end + text.size());
+                    std::memcpy(data + i * sizeof(uint16_t), &end, sizeof(uint16_t));
+                }
+                packBits(codes, header.bitWidth, bytesStart + end);
+            }
+            else
+            {
+                std::unordered_map<uint32_t, uint32_t> dictionary;
+                for (size_t r = 0; r < numRows; r++)
+                {
+                    auto inserted = dictionary.emplace(field(r).word, static_cast<uint32_t>(firsts.size()));
+                    if (inserted.second)
+                    {
+                        firsts.push_back(r);
+                    }
+                    codes[r] = inserted.first->second;
+                }
+                for (size_t i = 0; i < firsts.size(); i++)
+                {
+                    std::memcpy(data + i * WORD_WIDTH, &field(firsts[i]).word, WORD_WIDTH);
+                }
+                packBits(codes, header.bitWidth, data + firsts.size() * WORD_WIDTH);
+            }
+            header.count = static_cast<uint16_t>(firsts.size());
+            break;
+        }
+        case ColumnEncoding::RUN_LENGTH:
+        {
+            // Slots every run ends before, then its value.
+            std::vector<size_t> starts;
+            for (size_t r = 0; r < numRows; r++)
+            {
+                if (r == 0 || !same(r, r - 1))
+                {
+                    starts.push_back(r);
+                }
+            }
+            for (size_t i = 0; i < starts.size(); i++)
+            {
+                uint16_t runEnd = static_cast<uint16_t>(i + 1 < starts.size() ? starts[i + 1] : numRows);
+                std::memcpy(data + i * sizeof(uint16_t), &runEnd, sizeof(uint16_t));
+            }
+            char *values = data + starts.size() * sizeof(uint16_t);
+            if (isText)
+            {
+                char *bytesStart = values + starts.size() * sizeof(uint16_t);
+                uint16_t end = 0;
+                for (size_t i = 0; i < starts.size(); i++)
+                {
+                    const std::string &text = field(starts[i]).text;
+                    std::memcpy(bytesStart + end, text.data(), text.size());
+                    end = static_cast<uint16_t>(end + text.size());
+                    std::memcpy(values + i * sizeof(uint16_t), &end, sizeof(uint16_t));
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < starts.size(); i++)
+                {
+                    std::memcpy(values + i * WORD_WIDTH, &field(starts[i]).word, WORD_WIDTH);
+                }
+            }
+            header.count = static_cast<uint16_t>(starts.size());
+            break;
+        }
+        }
+        std::memcpy(out.data() + sizeof(CompressedPageHeader) + c * sizeof(CompressedColumnHeader), &header,
+                    sizeof(CompressedColumnHeader));
+        cursor += bytes;
+    }
+
+    CompressedPageHeader header{getPageLsn(page), 0, static_cast<uint16_t>(numRows), static_cast<uint16_t>(numColumns),
+                                static_cast<uint32_t>(cursor), static_cast<uint32_t>(plainBytes)};
+    std::memcpy(out.data(), &header, sizeof(CompressedPageHeader));
+    page.swap(out);
+}
+
+std::vector<ReturnType> CompressedPage::insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry)
+{
+    // Decode what is already on the page, append the new rows and encode again.
+    CompressedPageHeader header = readHeader(page);
+    std::vector<PackedField> values;
+    decodeColumn(page, 0, values);
+    std::vector<uint32_t> ids(header.numRows);
+    for (size_t r = 0; r < header.numRows; r++)
+    {
+        ids[r] = values[r].word;
+    }
+    std::vector<std::vector<PackedField>> rows(header.numRows, std::vector<PackedField>(columns_.size()));
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        decodeColumn(page, c + 1, values);
+        for (size_t r = 0; r < header.numRows; r++)
+        {
+            rows[r][c] = std::move(values[r]);
+        }
+    }
+
+    size_t plainBytes = header.plainBytes;
+    std::vector<ReturnType> results;
+    results.reserve(serializedData.size());
+    for (auto &d : serializedData)
+    {
+        rows.push_back(parseRow(columns_, d.data));
+        ids.push_back(d.id);
+        plainBytes += plainSize(columns_, rows.back());
+
+        ReturnType ret;
+        ret.data.id = d.id;
+        ret.location.page_id = entry.page_id;
+        ret.location.slot_id = static_cast<uint16_t>(rows.size() - 1);
+        results.push_back(ret);
+    }
+
+    build(ids, rows, plainBytes, page);
+    return results;
+}
+
+bool CompressedPage::verifyPage(std::vector<char> &buffer)
+{
+    if (buffer.size() != pageSize_)
+    {
+        throw std::runtime_error("Invalid page buffer: must be " + std::to_string(pageSize_) + " bytes.");
+    }
+
+    CompressedPageHeader header = readHeader(buffer);
+    if (header.numColumns != columns_.size())
+    {
+        throw std::runtime_error("Corrupt compressed page header: numColumns " + std::to_string(header.numColumns) +
+                                 " does not match schema (" + std::to_string(columns_.size()) + ").");
+    }
+    if (header.usedBytes < columnsOffset(header.numColumns) || header.usedBytes > pageSize_)
+    {
+        throw std::runtime_error("Corrupt compressed page header: usedBytes " + std::to_string(header.usedBytes) +
+                                 " is outside the page.");
+    }
+    for (size_t c = 0; c <= header.numColumns; c++)
+    {
+        CompressedColumnHeader column = readColumnHeader(buffer, c);
+        if (column.offset > header.usedBytes || column.encoding > ColumnEncoding::RUN_LENGTH)
+        {
+            throw std::runtime_error("Corrupt compressed page: bad header of column " + std::to_string(c) + ".");
+        }
+    }
+    return true;
+}
+
+void CompressedPage::decodeColumn(const std::vector<char> &page, size_t column, std::vector<PackedField> &values) const
+{
+    const size_t numRows = readHeader(page).numRows;
+    const CompressedColumnHeader header = readColumnHeader(page, column);
+    const bool isText = column > 0 && columns_[column - 1].type == DataType::TEXT;
+    const char *data = page.data() + header.offset;
+    const size_t available = page.size() - header.offset;
+    values.assign(numRows, PackedField{});
+
+    switch (header.encoding)
+    {
+    case ColumnEncoding::PLAIN:
+        if (!isText)
+        {
+            for (size_t r = 0; r < numRows; r++)
+            {
+                values[r].word = readWord(data, r);
+            }
+            break;
+        }
+        for (size_t r = 0, start = 0; r < numRows; r++)
+        {
+            size_t end = readUint16(data, r);
+            values[r].text.assign(data + numRows * sizeof(uint16_t) + start, end - start);
+            start = end;
+        }
+        break;
+    case ColumnEncoding::FRAME_OF_REFERENCE:
+    {
+        int64_t base;
+        std::memcpy(&base, data, sizeof(int64_t));
+        for (size_t r = 0; r < numRows; r++)
+        {
+            values[r].word = static_cast<uint32_t>(base + unpackBits(data + sizeof(int64_t), available - sizeof(int64_t), r, header.bitWidth));
+        }
+        break;
+    }
+    case ColumnEncoding::DICTIONARY:
+    {
+        std::vector<PackedField> dictionary(header.count);
+        const char *codes;
+        if (isText)
+        {
+            const char *bytesStart = data + header.count * sizeof(uint16_t);
+            size_t start = 0;
+            for (size_t i = 0; i < header.count; i++)
+            {
+                size_t end = readUint16(data, i);
+                dictionary[i].text.assign(bytesStart + start, end - start);
+                start = end;
+            }
+            codes = bytesStart + start;
+        }
+        else
+        {
+            for (size_t i = 0; i < header.count; i++)
+            {
+                dictionary[i].word = readWord(data, i);
+            }
+            codes = data + header.count * WORD_WIDTH;
+        }
+        size_t codesAvailable = page.size() - static_cast<size_t>(codes - page.data());
+        for (size_t r = 0; r < numRows; r++)
+        {
+            values[r] = dictionary.at(unpackBits(codes, codesAvailable, r, header.bitWidth));
+        }
+        break;
+    }
+    case ColumnEncoding::RUN_LENGTH:
+    {
+        const char *runValues = data + header.count * sizeof(uint16_t);
+        size_t slot = 0;
+        size_t start = 0;
+        for (size_t i = 0; i < header.count; i++)
+        {
+            PackedField value;
+            if (isText)
+            {
+                size_t end = readUint16(runValues, i);
+                value.text.assign(runValues + header.count * sizeof(uint16_t) + start, end - start);
+                start = end;
+            }
+            else
+            {
+                value.word = readWord(runValues, i);
+            }
+            for (size_t runEnd = std::min<size_t>(readUint16(data, i), numRows); slot < runEnd; slot++)
+            {
+                values[slot] = value;
+            }
+        }
+        break;
+    }
+    }
+}
+
+PackedField CompressedPage::decodeField(const std::vector<char> &page, size_t column, uint16_t slotId) const
+{
+    const size_t numRows = readHeader(page).numRows;
+    const CompressedColumnHeader header = readColumnHeader(page, column);
+    const bool isText = column > 0 && columns_[column - 1].type == DataType::TEXT;
+    const char *data = page.data() + header.offset;
+    const size_t available = page.size() - header.offset;
+
+    // Text entry i of an array of end offsets followed by the bytes.
+    auto text = [](const char *ends, size_t count, size_t i)
+    {
+        size_t start = i == 0 ? 0 : readUint16(ends, i - 1);
+        return std::string(ends + count * sizeof(uint16_t) + start, readUint16(ends, i) - start);
+    };
+    PackedField field;
+    switch (header.encoding)
+    {
+    case ColumnEncoding::PLAIN:
+        if (isText)
+        {
+            field.text = text(data, numRows, slotId);
+        }
+        else
+        {
+            field.word = readWord(data, slotId);
+        }
+        break;
+    case ColumnEncoding::FRAME_OF_REFERENCE:
+    {
+        int64_t base;
+        std::memcpy(&base, data, sizeof(int64_t));
+        field.word = static_cast<uint32_t>(base + unpackBits(data + sizeof(int64_t), available - sizeof(int64_t), slotId, header.bitWidth));
+        break;
+    }
+    case ColumnEncoding::DICTIONARY:
+    {
+        const char *codes = isText ? data + header.count * sizeof(uint16_t) + (header.count > 0 ? readUint16(data, header.count - 1) : 0)
+                                   : data + header.count * WORD_WIDTH;
+        uint32_t code = unpackBits(codes, page.size() - static_cast<size_t>(codes - page.data()), slotId, header.bitWidth);
+        if (code >= header.count)
+        {
+            throw std::runtime_error("Corrupt compressed page: dictionary code out of range");
+        }
+        if (isText)
+        {
+            field.text = text(data, header.count, code);
+        }
+        else
+        {
+            field.word = readWord(data, code);
+        }
+        break;
+    }
+    case ColumnEncoding::RUN_LENGTH:
+    {
+        // The first run ending after the slot holds it.
+        size_t lo = 0;
+        size_t hi = header.count;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (readUint16(data, mid) <= slotId)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        if (lo >= header.count)
+        {
+            throw std::runtime_error("Corrupt compressed page: slot beyond the last run");
+        }
+        const char *runValues = data + header.count * sizeof(uint16_t);
+        if (isText)
+        {
+            field.text = text(runValues, header.count, lo);
+        }
+        else
+        {
+            field.word = readWord(runValues, lo);
+        }
+        break;
+    }
+    }
+    return field;
+}
+
+void CompressedPage::appendField(std::vector<char> &row, size_t columnIndex, const PackedField &field) const
+{
+    auto appendText = [&row](const std::string &text)
+    {
+        uint16_t length = static_cast<uint16_t>(text.size());
+        const char *lenPtr = reinterpret_cast<const char *>(&length);
+        row.insert(row.end(), lenPtr, lenPtr + sizeof(uint16_t));
+        row.insert(row.end(), text.begin(), text.end());
+    };
+    switch (columns_[columnIndex].type)
+    {
+    case DataType::INT:
+    case DataType::FLOAT:
+    {
+        const char *word = reinterpret_cast<const char *>(&field.word);
+        row.insert(row.end(), word, word + WORD_WIDTH);
+        break;
+    }
+    case DataType::DATE:
+        // readRows formats dates ahead; an empty text is one it did not.
+        appendText(field.text.empty() ? Row::keyToDate(static_cast<int32_t>(field.word)) : field.text);
+        break;
+    case DataType::TEXT:
+        appendText(field.text);
+        break;
+    default:
+        throw std::runtime_error("Unsupported data type in schema");
+    }
+}
+
+std::vector<ReturnType> CompressedPage::readRows(const std::vector<char> &page, uint32_t pageId)
+{
+    CompressedPageHeader header = readHeader(page);
+    std::vector<std::vector<PackedField>> columns(columns_.size() + 1);
+    for (size_t c = 0; c <= columns_.size(); c++)
+    {
+        decodeColumn(page, c, columns[c]);
+        if (c == 0 || columns_[c - 1].type != DataType::DATE)
+        {
+            continue;
+        }
+        // Dates repeat on cold pages: format every run of them once.
+        for (size_t r = 0; r < columns[c].size(); r++)
+        {
+            bool repeated = r > 0 && columns[c][r].word == columns[c][r - 1].word;
+            columns[c][r].text = repeated ? columns[c][r - 1].text : Row::keyToDate(static_cast<int32_t>(columns[c][r].word));
+        }
+    }
+
+    std::vector<ReturnType> results(header.numRows);
+    for (uint16_t r = 0; r < header.numRows; r++)
+    {
+        ReturnType &ret = results[r];
+        ret.data.id = columns[0][r].word;
+        ret.data.data.reserve(header.plainBytes / header.numRows);
+        for (size_t c = 0; c < columns_.size(); c++)
+        {
+            appendField(ret.data.data, c, columns[c + 1][r]);
+        }
+        ret.location.page_id = pageId;
+        ret.location.slot_id = r;
+    }
+    return results;
+}
+
+Data CompressedPage::read(const std::vector<char> &page, uint16_t slotId)
+{
+    CompressedPageHeader header = readHeader(page);
+    if (slotId >= header.numRows)
+    {
+        throw std::runtime_error("Slot id " + std::to_string(slotId) + " out of range (numRows=" +
+                                 std::to_string(header.numRows) + ")");
+    }
+
+    Data result;
+    result.id = decodeField(page, 0, slotId).word;
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        appendField(result.data, c, decodeField(page, c + 1, slotId));
+    }
+    return result;
+}
+
+std::vector<Row::Value> CompressedPage::readColumn(const std::vector<char> &page, size_t columnIndex)
+{
+    if (columnIndex >= columns_.size())
+    {
+        throw std::out_of_range("Column index out of range in compressed page");
+    }
+
+    std::vector<PackedField> fields;
+    decodeColumn(page, columnIndex + 1, fields);
+    std::vector<Row::Value> values;
+    values.reserve(fields.size());
+    for (auto &field : fields)
+    {
+        switch (columns_[columnIndex].type)
+        {
+        case DataType::INT:
+            values.emplace_back(static_cast<int32_t>(field.word));
+            break;
+        case DataType::FLOAT:
+        {
+            float v;
+            std::memcpy(&v, &field.word, sizeof(float));
+            values.emplace_back(v);
+            break;
+        }
+        case DataType::DATE:
+            values.emplace_back(Row::keyToDate(static_cast<int32_t>(field.word)));
+            break;
+        case DataType::TEXT:
+            values.emplace_back(std::move(field.text));
+            break;
+        default:
+            throw std::runtime_error("Unsupported data type in schema");
+        }
+    }
+    return values;
+}
+
+ColumnEncoding CompressedPage::columnEncoding(const std::vector<char> &page, size_t columnIndex) const
+{
+    if (columnIndex >= columns_.size())
+    {
+        throw std::out_of_range("Column index out of range in compressed page");
+    }
+    return readColumnHeader(page, columnIndex + 1).encoding;
+}
@@ -0,0 +1,129 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARMV8
+#endif
+
+namespace
+{
+    constexpr uint32_t POLYNOMIAL = 0x82f63b78; // Castagnoli, bit-reversed.
+
+    // tables[k][b] is the CRC of byte b followed by k zero bytes.
+    struct Tables
+    {
+        uint32_t tables[8][256];
+
+        Tables()
+        {
+            for (uint32_t b = 0; b < 256; b++)
+            {
+                uint32_t crc = b;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+                }
+                tables[0][b] = crc;
+            }
+            for (uint32_t b = 0; b < 256; b++)
+            {
+                for (int k = 1; k < 8; k++)
+                {
+                    tables[k][b] = (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xff];
+                }
+            }
+        }
+    };
+
+    uint32_t crc32cTable(const char *data, size_t size, uint32_t crc)
+    {
+        static const Tables t;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        for (; size >= 8; p += 8, size -= 8)
+        {
+            uint32_t low;
+            uint32_t high;
+            std::memcpy(&low, p, sizeof(low));
+            std::memcpy(&high, p + 4, sizeof(high));
+            low ^= crc;
+            crc = t.tables[7][low & 0xff] ^ t.tables[6][(low >> 8) & 0xff] ^ t.tables[5][(low >> 16) & 0xff] ^
+                  t.tables[4][low >> 24] ^ t.tables[3][high & 0xff] ^ t.tables[2][(high >> 8) & 0xff] ^
+                  t.tables[1][(high >> 16) & 0xff] ^ t.tables[0][high >> 24];
+        }
+        for (; size > 0; p++, size--)
+        {
+            crc = (crc >> 8) ^ t.tables[0][(crc ^ *p) & 0xff];
+        }
+        return crc;
+    }
+
+#ifdef CRC32C_SSE42
+    __attribute__((target("sse4.2"))) uint32_t crc32cHardware(const char *data, size_t size, uint32_t crc)
+    {
+#ifdef __x86_64__
+        uint64_t crc64 = crc;
+        for (; size >= 8; data += 8, size -= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+        }
+        crc = static_cast<uint32_t>(crc64);
+#endif
+        for (; size > 0; data++, size--)
+        {
+            crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data));
+        }
+        return crc;
+    }
+
+    bool hasHardware()
+    {
+        return __builtin_cpu_supports("sse4.2");
+    }
+#elif defined(CRC32C_ARMV8)
+    uint32_t crc32cHardware(const char *data, size_t size, uint32_t crc)
+    {
+        for (; size >= 8; data += 8, size -= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            crc = __crc32cd(crc, word);
+        }
+        for (; size > 0; data++, size--)
+        {
+            crc = __crc32cb(crc, static_cast<uint8_t>(*data));
+        }
+        return crc;
+    }
+
+    bool hasHardware()
+    {
+        return true;
+    }
+#endif
+
+    using Crc32cFunction = uint32_t (*)(const char *, size_t, uint32_t);
+
+    Crc32cFunction select()
+    {
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARMV8)
+        if (hasHardware())
+        {
+            return crc32cHardware;
+        }
+#endif
+        return crc32cTable;
+    }
+}
+
+uint32_t crc32c(const char *data, size_t size, uint32_t crc)
+{
+    static const Crc32cFunction implementation = select();
+    return ~implementation(data, size, ~crc);
+}
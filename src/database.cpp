@@ -0,0 +1,256 @@
+#include "database.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "crc32c.h"
+
+namespace
+{
+    // Payload length and CRC-32C in front of every catalog record.
+    constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+}
+
+// The objects making up an open table. Table keeps references to all of them.
+struct Database::OpenTable
+{
+    OpenTable(const std::string &tableDir, IStorage &storage, ILogger &logger, Parser &parser)
+        : directory(tableDir),
+          pageManager(directory, logger, storage),
+          schema(directory, storage, logger),
+          table(directory, logger, pageManager, schema, parser, storage) {}
+
+    std::string directory;
+    PageManager pageManager;
+    Schema schema;
+    Table table;
+};
+
+Database::Database(const std::string &directory, IStorage &storage, ILogger &logger)
+    : directory_(directory),
+      catalogPath_(directory + "/catalog.dat"),
+      storage_(storage),
+      logger_(logger),
+      parser_(logger)
+{
+}
+
+Database::~Database() = default;
+
+bool Database::initialize()
+{
+    if (initialized_)
+    {
+        return true;
+    }
+    std::lock_guard<std::mutex> createLock(createMutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (initialized_)
+    {
+        return true;
+    }
+    LOG_INFO(logger_, "Opening database: " + directory_);
+    if (!storage_.fileExists(catalogPath_))
+    {
+        storage_.createFile(catalogPath_);
+    }
+    size_t fileSize = storage_.getSize(catalogPath_);
+    std::vector<char> buffer(fileSize);
+    if (fileSize > 0 && !storage_.readFile(catalogPath_, buffer.data(), fileSize))
+    {
+        LOG_ERROR(logger_, "Failed to read catalog: " + catalogPath_);
+        return false;
+    }
+
+    size_t offset = 0;
+    while (offset + RECORD_HEADER_SIZE <= fileSize)
+    {
+        uint32_t length;
+        uint32_t checksum;
+        std::memcpy(&length, buffer.data() + offset, sizeof(uint32_t));
+        std::memcpy(&checksum, buffer.data() + offset + sizeof(uint32_t), sizeof(uint32_t));
+        const char *payload = buffer.data() + offset + RECORD_HEADER_SIZE;
+        if (length > fileSize - offset - RECORD_HEADER_SIZE || crc32c(payload, length) != checksum)
+        {
+            break;
+        }
+
+        uint16_t nameLength = 0;
+        if (length >= sizeof(uint16_t))
+        {
+            std::memcpy(&nameLength, payload, sizeof(uint16_t));
+        }
+        auto entry = std::make_unique<Entry>();
+        SchemaHeader header;
+        if (length < sizeof(uint16_t) + nameLength ||
+            !Schema::deserialize(payload + sizeof(uint16_t) + nameLength, length - sizeof(uint16_t) - nameLength,
+                                 entry->columns, header))
+        {
+            throw std::runtime_error("Catalog is corrupted at offset " + std::to_string(offset) + ": " + catalogPath_);
+        }
+        entry->layout = header.layout;
+        entry->pageSize = header.page_size;
+        tables_[std::string(payload + sizeof(uint16_t), nameLength)] = std::move(entry);
+        offset += RECORD_HEADER_SIZE + length;
+    }
+    if (offset < fileSize)
+    {
+        LOG_WARN(logger_, "Dropping torn record at the end of catalog: " + catalogPath_);
+    }
+    end_ = offset;
+    LOG_DEBUG(logger_, "Catalog lists " + std::to_string(tables_.size()) + " tables: " + catalogPath_);
+    initialized_ = true;
+    return true;
+}
+
+Table &Database::createTable(const std::string &name, std::vector<Column> columns, PageLayout layout, size_t pageSize)
+{
+    validateName(name);
+    if (!isValidPageSize(pageSize))
+    {
+        throw std::invalid_argument("Invalid page size: " + std::to_string(pageSize));
+    }
+    if (!initialized_)
+    {
+        throw std::runtime_error("Database is not initialized: " + directory_);
+    }
+    std::lock_guard<std::mutex> createLock(createMutex_);
+    if (findEntry(name) != nullptr)
+    {
+        throw std::invalid_argument("Table already exists: " + name);
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->columns = columns;
+    entry->layout = layout;
+    entry->pageSize = pageSize;
+    std::vector<char> schema = Schema::serialize(columns, layout, pageSize);
+
+    // The table's own schema file is durable before the catalog lists it, so
+    // a listed table always opens with its schema.
+    LOG_INFO(logger_, "Creating table: " + name);
+    auto table = std::make_unique<OpenTable>(directory_ + "/" + name, storage_, logger_, parser_);
+    if (!table->table.initialize() || !table->table.createSchema(columns, layout, pageSize))
+    {
+        throw std::runtime_error("Failed to create table: " + name);
+    }
+    appendRecord(name, schema);
+
+    entry->table = std::move(table);
+    Table &result = entry->table->table;
+    std::lock_guard<std::mutex> lock(mutex_);
+    tables_.emplace(name, std::move(entry));
+    return result;
+}
+
+Table &Database::getTable(const std::string &name)
+{
+    if (!initialized_)
+    {
+        throw std::runtime_error("Database is not initialized: " + directory_);
+    }
+    Entry *entry = findEntry(name);
+    if (entry == nullptr)
+    {
+        throw std::invalid_argument("No such table: " + name);
+    }
+    std::lock_guard<std::mutex> lock(entry->openMutex);
+    if (!entry->table)
+    {
+        entry->table = open(name, *entry);
+    }
+    return entry->table->table;
+}
+
+bool Database::hasTable(const std::string &name) const
+{
+    return findEntry(name) != nullptr;
+}
+
+std::vector<std::string> Database::listTables() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    names.reserve(tables_.size());
+    for (const auto &table : tables_)
+    {
+        names.push_back(table.first);
+    }
+    return names;
+}
+
+std::vector<Column> Database::getSchema(const std::string &name) const
+{
+    Entry *entry = findEntry(name);
+    if (entry == nullptr)
+    {
+        throw std::invalid_argument("No such table: " + name);
+    }
+    return entry->columns;
+}
+
+size_t Database::openTableCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto &table : tables_)
+    {
+        std::lock_guard<std::mutex> openLock(table.second->openMutex);
+        count += table.second->table ? 1 : 0;
+    }
+    return count;
+}
+
+void Database::validateName(const std::string &name)
+{
+    // Every table is a directory next to the catalog.
+    if (name.empty() || name == "." || name == ".." || name == "catalog.dat" || name.size() > UINT16_MAX ||
+        name.find_first_of(std::string("/\\\0", 3)) != std::string::npos)
+    {
+        throw std::invalid_argument("Invalid table name: " + name.substr(0, 64));
+    }
+}
+
+Database::Entry *Database::findEntry(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tables_.find(name);
+    return it == tables_.end() ? nullptr : it->second.get();
+}
+
+std::unique_ptr<Database::OpenTable> Database::open(const std::string &name, const Entry &entry)
+{
+    LOG_INFO(logger_, "Opening table: " + name);
+    auto table = std::make_unique<OpenTable>(directory_ + "/" + name, storage_, logger_, parser_);
+    if (!table->table.initialize())
+    {
+        throw std::runtime_error("Failed to open table: " + name);
+    }
+    if (table->schema.getLayout() != entry.layout || table->schema.getPageSize() != entry.pageSize ||
+        table->schema.getSchema().size() != entry.columns.size())
+    {
+        throw std::runtime_error("Schema file of table " + name + " does not match the catalog");
+    }
+    return table;
+}
+
+void Database::appendRecord(const std::string &name, const std::vector<char> &schema)
+{
+    std::vector<char> record(RECORD_HEADER_SIZE);
+    uint16_t nameLength = static_cast<uint16_t>(name.size());
+    const char *lenPtr = reinterpret_cast<const char *>(&nameLength);
+    record.insert(record.end(), lenPtr, lenPtr + sizeof(uint16_t));
+    record.insert(record.end(), name.begin(), name.end());
+    record.insert(record.end(), schema.begin(), schema.end());
+
+    uint32_t length = static_cast<uint32_t>(record.size() - RECORD_HEADER_SIZE);
+    uint32_t checksum = crc32c(record.data() + RECORD_HEADER_SIZE, length);
+    std::memcpy(record.data(), &length, sizeof(uint32_t));
+    std::memcpy(record.data() + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+    if (!storage_.writeFile(catalogPath_, record.data(), record.size(), static_cast<std::streamoff>(end_)))
+    {
+        throw std::runtime_error("Failed to write catalog: " + catalogPath_);
+    }
+    storage_.syncData(catalogPath_);
+    end_ += record.size();
+}
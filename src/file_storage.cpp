@@ -2,6 +2,10 @@
 #include <iostream>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include <filesystem>
 #include <sstream>
 
@@ -14,7 +18,8 @@ void ensureDirectoryExists(const std::string &filepath)
     fs::path directory = p.parent_path();
     if (!directory.empty() && !fs::exists(directory))
     {
-        if (!fs::create_directories(directory))
+        // Another thread may create the directory between the two calls.
+        if (!fs::create_directories(directory) && !fs::is_directory(directory))
         {
             throw std::runtime_error("Failed to create directory: " + directory.string());
         }
@@ -24,11 +29,16 @@ void ensureDirectoryExists(const std::string &filepath)
 bool FileStorage::writeFile(const std::string &filename, char *data, std::size_t size, std::streampos offset)
 {
     ensureDirectoryExists(filename);
-    std::ostringstream message;
-    message << "Writing " << size << " bytes to file: " << filename;
-    logger_.log(message.str());
+    LOG_TRACE(logger_, "Writing " + std::to_string(size) + " bytes to file: " + filename);
 
-    std::ofstream outFile(filename, std::ios::binary | std::ios::out);
+    // Open in read/write mode when the file already exists so that writing a page
+    // at an offset does not truncate the rest of the file.
+    std::ios::openmode mode = std::ios::binary | std::ios::out;
+    if (fileExists(filename))
+    {
+        mode |= std::ios::in;
+    }
+    std::ofstream outFile(filename, mode);
     if (!outFile)
     {
         throw std::runtime_error("Failed to open file for writing: " + filename);
@@ -36,6 +46,11 @@ bool FileStorage::writeFile(const std::string &filename, char *data, std::size_t
     outFile.seekp(offset);
     outFile.write(data, size);
     outFile.close();
+    if (!outFile)
+    {
+        throw std::runtime_error("Failed to write " + std::to_string(size) + " bytes at offset " +
+                                 std::to_string(offset) + " to file: " + filename);
+    }
 
     return true;
 }
@@ -43,10 +58,8 @@ bool FileStorage::writeFile(const std::string &filename, char *data, std::size_t
 bool FileStorage::readFile(const std::string &filename, char *buffer, std::size_t size, std::streampos offset)
 {
     ensureDirectoryExists(filename);
-    std::ostringstream message;
-    message << "Attempting to open file: " << filename << " of size: " << size << " bytes";
-    logger_.log(message.str());
-    message.str("");
+    LOG_TRACE(logger_, "Reading " + std::to_string(size) + " bytes at offset " + std::to_string(offset) +
+                       " from file: " + filename);
 
     std::ifstream inFile(filename, std::ios::binary | std::ios::in);
     if (!inFile)
@@ -56,19 +69,11 @@ bool FileStorage::readFile(const std::string &filename, char *buffer, std::size_
     inFile.seekg(0, std::ios::end);
     std::streampos fileSize = inFile.tellg();
 
-    message << "File size: " << fileSize << " bytes";
-    logger_.log(message.str());
-    message.str("");
-
     if (offset >= fileSize)
     {
         throw std::runtime_error("Offset is greater than file size: " + filename);
     }
 
-    message << "Seeking to offset: " << offset << "in file: " << filename;
-    logger_.log(message.str());
-    message.str("");
-
     inFile.seekg(offset, std::ios::beg);
     if (!inFile)
     {
@@ -77,28 +82,20 @@ bool FileStorage::readFile(const std::string &filename, char *buffer, std::size_
 
     // pre-zero the buffer
     std::fill(buffer, buffer + size, 0);
-    message << "Reading " << size << " bytes from file: " << filename;
-    logger_.log(message.str());
-    message.str("");
 
     inFile.read(buffer, size);
     std::streamsize bytesRead = inFile.gcount();
 
     if (bytesRead < static_cast<std::streamsize>(size))
     {
+        std::ostringstream message;
         message << "Partial Read " << bytesRead << " bytes from file: " << filename << ". Expected " << size << " bytes.";
         throw std::runtime_error(message.str());
     }
-    else if (bytesRead == static_cast<std::streamsize>(size))
+    else if (bytesRead != static_cast<std::streamsize>(size))
     {
-        message << "Successfully read " << bytesRead << " bytes from file: " << filename;
+        throw std::runtime_error("Error reading file: " + filename);
     }
-    else
-    {
-        message << "Error reading file: " << filename;
-        throw std::runtime_error(message.str());
-    }
-    logger_.log(message.str());
     inFile.close();
     return true;
 }
@@ -106,9 +103,7 @@ bool FileStorage::readFile(const std::string &filename, char *buffer, std::size_
 void FileStorage::appendFile(const std::string &filename, const char *data, std::size_t size)
 {
     ensureDirectoryExists(filename);
-    std::ostringstream message;
-    message << "Appending " << size << " bytes to file: " << filename;
-    logger_.log(message.str());
+    LOG_TRACE(logger_, "Appending " + std::to_string(size) + " bytes to file: " + filename);
 
     std::ofstream outFile(filename, std::ios::binary | std::ios::app);
     if (!outFile)
@@ -117,6 +112,10 @@ void FileStorage::appendFile(const std::string &filename, const char *data, std:
     }
     outFile.write(data, size);
     outFile.close();
+    if (!outFile)
+    {
+        throw std::runtime_error("Failed to append " + std::to_string(size) + " bytes to file: " + filename);
+    }
 }
 
 bool FileStorage::fileExists(const std::string &filename)
@@ -127,6 +126,7 @@ bool FileStorage::fileExists(const std::string &filename)
 
 bool FileStorage::createFile(const std::string &filename)
 {
+    ensureDirectoryExists(filename);
     std::ofstream file(filename);
     if (!file)
     {
@@ -137,12 +137,12 @@ bool FileStorage::createFile(const std::string &filename)
 
 size_t FileStorage::getSize(const std::string &filename)
 {
-    logger_.log("Checking file size for: " + filename);
+    LOG_TRACE(logger_, "Checking file size for: " + filename);
 
     // If the file doesn't exist, either return 0 or throw an error.
     if (!fileExists(filename))
     {
-        logger_.log("File does not exist: " + filename);
+        LOG_TRACE(logger_, "File does not exist: " + filename);
         return 0; 
         // or throw std::runtime_error("File not found: " + filename);
     }
@@ -164,6 +164,127 @@ size_t FileStorage::getSize(const std::string &filename)
     }
 
     // Log and return the size as a size_t.
-    logger_.log("File size is " + std::to_string(fileSize) + " bytes for: " + filename);
+    LOG_TRACE(logger_, "File size is " + std::to_string(fileSize) + " bytes for: " + filename);
     return static_cast<size_t>(fileSize);
 }
+
+bool FileStorage::removeFile(const std::string &filename)
+{
+    LOG_DEBUG(logger_, "Removing file: " + filename);
+    std::error_code error;
+    bool removed = fs::remove(filename, error);
+    if (error)
+    {
+        throw std::runtime_error("Failed to remove file: " + filename + ", error: " + error.message());
+    }
+    return removed;
+}
+
+void FileStorage::syncFile(const std::string &filename)
+{
+    LOG_TRACE(logger_, "Syncing file: " + filename);
+    // fsync flushes every dirty page of the file, whichever descriptor wrote it.
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for sync: " + filename + ", error: " + std::strerror(errno));
+    }
+    int result = ::fsync(fd);
+    int error = errno;
+    ::close(fd);
+    if (result != 0)
+    {
+        throw std::runtime_error("Failed to sync file: " + filename + ", error: " + std::strerror(error));
+    }
+}
+
+void FileStorage::syncData(const std::string &filename)
+{
+    LOG_TRACE(logger_, "Syncing data of file: " + filename);
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for sync: " + filename + ", error: " + std::strerror(errno));
+    }
+#ifdef __linux__
+    int result = ::fdatasync(fd);
+#else
+    int result = ::fsync(fd);
+#endif
+    int error = errno;
+    ::close(fd);
+    if (result != 0)
+    {
+        throw std::runtime_error("Failed to sync file data: " + filename + ", error: " + std::strerror(error));
+    }
+}
+
+void FileStorage::flushRange(const std::string &filename, std::size_t offset, std::size_t size)
+{
+#ifdef __linux__
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for writeback: " + filename + ", error: " + std::strerror(errno));
+    }
+    // Only a hint: durability still comes from a later syncFile or syncData.
+    if (::sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(size), SYNC_FILE_RANGE_WRITE) != 0)
+    {
+        LOG_DEBUG(logger_, "sync_file_range failed for file: " + filename + ", error: " + std::strerror(errno));
+    }
+    ::close(fd);
+#else
+    (void)filename;
+    (void)offset;
+    (void)size;
+#endif
+}
+
+bool FileStorage::preallocate(const std::string &filename, std::size_t size)
+{
+#ifdef __linux__
+    ensureDirectoryExists(filename);
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for preallocation: " + filename + ", error: " + std::strerror(errno));
+    }
+    int result = ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+    int error = errno;
+    ::close(fd);
+    if (result != 0)
+    {
+        LOG_DEBUG(logger_, "fallocate failed for file: " + filename + ", error: " + std::strerror(error));
+        return false;
+    }
+    LOG_TRACE(logger_, "Preallocated " + std::to_string(size) + " bytes for file: " + filename);
+    return true;
+#else
+    (void)filename;
+    (void)size;
+    return false;
+#endif
+}
+
+void FileStorage::prefetch(const std::string &filename, std::size_t offset, std::size_t size)
+{
+#ifdef __linux__
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for read-ahead: " + filename + ", error: " + std::strerror(errno));
+    }
+    // The page cache is shared by every descriptor of the file, so the pages
+    // stay read ahead for the readers that open it afterwards.
+    int result = ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+    if (result != 0)
+    {
+        LOG_DEBUG(logger_, "posix_fadvise failed for file: " + filename + ", error: " + std::strerror(result));
+    }
+    ::close(fd);
+#else
+    (void)filename;
+    (void)offset;
+    (void)size;
+#endif
+}
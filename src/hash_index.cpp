@@ -0,0 +1,323 @@
+#include "hash_index.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+uint64_t HashIndex::hashKey(const std::string &key)
+{
+    return hashBytes(key.data(), key.size());
+}
+
+bool HashIndex::exists()
+{
+    return storage_.fileExists(filename_);
+}
+
+bool HashIndex::initialize()
+{
+    try
+    {
+        LOG_DEBUG(logger_, "Checking if hash index file exists: " + filename_);
+        if (storage_.fileExists(filename_) && storage_.getSize(filename_) >= PAGE_SIZE)
+        {
+            std::vector<char> metaPage(PAGE_SIZE, 0);
+            storage_.readFile(filename_, metaPage.data(), PAGE_SIZE, 0);
+            std::memcpy(&meta_, metaPage.data(), sizeof(HashIndexMetaPage));
+        }
+        else
+        {
+            // Meta page followed by the initial empty buckets, written in one go.
+            LOG_DEBUG(logger_, "Creating hash index file: " + filename_);
+            meta_ = {0, 0, INITIAL_BUCKETS, 1, 0, 0, 0};
+            std::vector<char> pages((INITIAL_BUCKETS + 1) * PAGE_SIZE, 0);
+            std::memcpy(pages.data(), &meta_, sizeof(HashIndexMetaPage));
+            storage_.writeFile(filename_, pages.data(), pages.size(), 0);
+
+            // Overflow page 0 is reserved so that 0 can mean "no overflow page".
+            std::vector<char> emptyPage(PAGE_SIZE, 0);
+            storage_.writeFile(overflowFilename_, emptyPage.data(), PAGE_SIZE, 0);
+        }
+        LOG_DEBUG(logger_, "Hash index " + columnName_ + ": buckets=" + std::to_string(numBuckets()) +
+                           ", overflow_pages=" + std::to_string(meta_.num_overflow_pages) +
+                           ", entries=" + std::to_string(meta_.num_entries));
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to initialize hash index " + filename_ + ": " + e.what());
+    }
+}
+
+void HashIndex::removeFiles()
+{
+    for (const std::string &filename : {filename_, overflowFilename_})
+    {
+        if (storage_.fileExists(filename))
+        {
+            storage_.removeFile(filename);
+        }
+    }
+    meta_ = {0, 0, INITIAL_BUCKETS, 1, 0, 0, 0};
+}
+
+void HashIndex::markDirty()
+{
+    if (meta_.clean != CLEAN_MARK)
+    {
+        return;
+    }
+    meta_.clean = 0;
+    persistMeta();
+    storage_.syncData(filename_);
+}
+
+void HashIndex::markClean()
+{
+    if (meta_.clean == CLEAN_MARK)
+    {
+        return;
+    }
+    // The buckets must be durable before the mark that vouches for them.
+    storage_.syncData(filename_);
+    storage_.syncData(overflowFilename_);
+    meta_.clean = CLEAN_MARK;
+    persistMeta();
+    storage_.syncData(filename_);
+}
+
+uint32_t HashIndex::bucketFor(uint64_t hash) const
+{
+    uint64_t roundBuckets = static_cast<uint64_t>(meta_.initial_buckets) << meta_.level;
+    uint64_t bucket = hash & (roundBuckets - 1);
+    if (bucket < meta_.next_split)
+    {
+        // Already split in this round: use one more bit of the hash.
+        bucket = hash & (2 * roundBuckets - 1);
+    }
+    return static_cast<uint32_t>(bucket);
+}
+
+std::vector<HashBucketEntry> HashIndex::readChain(uint32_t bucket, std::vector<uint32_t> &overflowPages)
+{
+    std::vector<HashBucketEntry> entries;
+    std::vector<char> page(PAGE_SIZE, 0);
+
+    storage_.readFile(filename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(bucket + 1) * PAGE_SIZE);
+    while (true)
+    {
+        HashBucketHeader header;
+        std::memcpy(&header, page.data(), sizeof(HashBucketHeader));
+        const char *cursor = page.data() + sizeof(HashBucketHeader);
+        for (uint16_t i = 0; i < header.num_entries; i++)
+        {
+            HashBucketEntry entry;
+            std::memcpy(&entry, cursor + i * sizeof(HashBucketEntry), sizeof(HashBucketEntry));
+            entries.push_back(entry);
+        }
+
+        if (header.overflow_page == 0)
+        {
+            break;
+        }
+        overflowPages.push_back(header.overflow_page);
+        storage_.readFile(overflowFilename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(header.overflow_page) * PAGE_SIZE);
+    }
+    return entries;
+}
+
+void HashIndex::writeChain(uint32_t bucket, const std::vector<HashBucketEntry> &entries, std::vector<uint32_t> &overflowPages)
+{
+    size_t numPages = std::max<size_t>(1, (entries.size() + BUCKET_CAPACITY - 1) / BUCKET_CAPACITY);
+
+    // Reuse the chain's existing overflow pages, then allocate or release the difference.
+    while (overflowPages.size() < numPages - 1)
+    {
+        overflowPages.push_back(allocateOverflowPage());
+    }
+    while (overflowPages.size() > numPages - 1)
+    {
+        releaseOverflowPage(overflowPages.back());
+        overflowPages.pop_back();
+    }
+
+    std::vector<char> page(PAGE_SIZE, 0);
+    for (size_t i = 0; i < numPages; i++)
+    {
+        size_t begin = i * BUCKET_CAPACITY;
+        size_t count = std::min(BUCKET_CAPACITY, entries.size() - std::min(begin, entries.size()));
+
+        std::fill(page.begin(), page.end(), 0);
+        HashBucketHeader header{static_cast<uint16_t>(count), 0, (i + 1 < numPages) ? overflowPages[i] : 0};
+        std::memcpy(page.data(), &header, sizeof(HashBucketHeader));
+        if (count > 0)
+        {
+            std::memcpy(page.data() + sizeof(HashBucketHeader), entries.data() + begin, count * sizeof(HashBucketEntry));
+        }
+
+        if (i == 0)
+        {
+            storage_.writeFile(filename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(bucket + 1) * PAGE_SIZE);
+        }
+        else
+        {
+            storage_.writeFile(overflowFilename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(overflowPages[i - 1]) * PAGE_SIZE);
+        }
+    }
+}
+
+uint32_t HashIndex::allocateOverflowPage()
+{
+    if (meta_.free_overflow_head != 0)
+    {
+        uint32_t pageId = meta_.free_overflow_head;
+        std::vector<char> page(PAGE_SIZE, 0);
+        storage_.readFile(overflowFilename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(pageId) * PAGE_SIZE);
+        HashBucketHeader header;
+        std::memcpy(&header, page.data(), sizeof(HashBucketHeader));
+        meta_.free_overflow_head = header.overflow_page;
+        return pageId;
+    }
+    return meta_.num_overflow_pages++;
+}
+
+void HashIndex::releaseOverflowPage(uint32_t pageId)
+{
+    // Freed pages form a list threaded through their overflow_page field.
+    std::vector<char> page(PAGE_SIZE, 0);
+    HashBucketHeader header{0, 0, meta_.free_overflow_head};
+    std::memcpy(page.data(), &header, sizeof(HashBucketHeader));
+    storage_.writeFile(overflowFilename_, page.data(), PAGE_SIZE, static_cast<std::streamoff>(pageId) * PAGE_SIZE);
+    meta_.free_overflow_head = pageId;
+}
+
+void HashIndex::splitNextBucket()
+{
+    uint64_t roundBuckets = static_cast<uint64_t>(meta_.initial_buckets) << meta_.level;
+    uint32_t oldBucket = meta_.next_split;
+    uint32_t newBucket = static_cast<uint32_t>(oldBucket + roundBuckets);
+
+    std::vector<uint32_t> oldOverflow;
+    std::vector<HashBucketEntry> entries = readChain(oldBucket, oldOverflow);
+
+    std::vector<HashBucketEntry> stay;
+    std::vector<HashBucketEntry> move;
+    for (const auto &entry : entries)
+    {
+        if ((entry.hash & (2 * roundBuckets - 1)) == oldBucket)
+        {
+            stay.push_back(entry);
+        }
+        else
+        {
+            move.push_back(entry);
+        }
+    }
+
+    std::vector<uint32_t> newOverflow;
+    writeChain(oldBucket, stay, oldOverflow);
+    writeChain(newBucket, move, newOverflow);
+
+    meta_.next_split++;
+    if (meta_.next_split == roundBuckets)
+    {
+        meta_.level++;
+        meta_.next_split = 0;
+    }
+}
+
+void HashIndex::growFor(uint64_t numEntries)
+{
+    while (numEntries > numBuckets() * BUCKET_CAPACITY * MAX_LOAD_FACTOR)
+    {
+        splitNextBucket();
+    }
+}
+
+void HashIndex::persistMeta()
+{
+    std::vector<char> metaPage(PAGE_SIZE, 0);
+    std::memcpy(metaPage.data(), &meta_, sizeof(HashIndexMetaPage));
+    storage_.writeFile(filename_, metaPage.data(), PAGE_SIZE, 0);
+}
+
+bool HashIndex::insert(const std::string &key, const Location &location)
+{
+    return insertBatch({{hashKey(key), location}});
+}
+
+bool HashIndex::insertBatch(const std::vector<Entry> &entries)
+{
+    if (entries.empty())
+    {
+        return true;
+    }
+
+    // 1) Split buckets up front so the whole batch lands at the target load factor.
+    growFor(meta_.num_entries + entries.size());
+
+    // 2) Group the batch by bucket and rewrite every affected chain once.
+    std::vector<std::pair<uint32_t, HashBucketEntry>> byBucket;
+    byBucket.reserve(entries.size());
+    for (const auto &entry : entries)
+    {
+        byBucket.push_back({bucketFor(entry.first), {entry.first, entry.second.page_id, entry.second.slot_id, 0}});
+    }
+    std::stable_sort(byBucket.begin(), byBucket.end(),
+                     [](const auto &a, const auto &b)
+                     { return a.first < b.first; });
+
+    size_t i = 0;
+    while (i < byBucket.size())
+    {
+        uint32_t bucket = byBucket[i].first;
+        std::vector<uint32_t> overflowPages;
+        std::vector<HashBucketEntry> chain = readChain(bucket, overflowPages);
+        for (; i < byBucket.size() && byBucket[i].first == bucket; i++)
+        {
+            chain.push_back(byBucket[i].second);
+        }
+        writeChain(bucket, chain, overflowPages);
+    }
+
+    meta_.num_entries += entries.size();
+    persistMeta();
+    LOG_DEBUG(logger_, "Inserted " + std::to_string(entries.size()) + " entries into hash index " + columnName_ +
+                       " (buckets=" + std::to_string(numBuckets()) + ")");
+    return true;
+}
+
+std::vector<Location> HashIndex::lookup(const std::string &key)
+{
+    uint64_t hash = hashKey(key);
+    std::vector<uint32_t> overflowPages;
+    std::vector<Location> results;
+    for (const auto &entry : readChain(bucketFor(hash), overflowPages))
+    {
+        if (entry.hash == hash)
+        {
+            results.push_back({entry.page_id, entry.slot_id});
+        }
+    }
+    return results;
+}
+
+bool HashIndex::remove(const std::string &key, const Location &location)
+{
+    uint64_t hash = hashKey(key);
+    uint32_t bucket = bucketFor(hash);
+    std::vector<uint32_t> overflowPages;
+    std::vector<HashBucketEntry> chain = readChain(bucket, overflowPages);
+    auto match = std::find_if(chain.begin(), chain.end(), [&](const HashBucketEntry &entry)
+                              { return entry.hash == hash && entry.page_id == location.page_id && entry.slot_id == location.slot_id; });
+    if (match == chain.end())
+    {
+        return false;
+    }
+    chain.erase(match);
+    writeChain(bucket, chain, overflowPages);
+    meta_.num_entries--;
+    persistMeta();
+    return true;
+}
@@ -0,0 +1,424 @@
+#include "hash_join.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    // Distinguishes the partition files of joins sharing a spill directory.
+    std::atomic<uint32_t> nextOperatorId{0};
+
+    // Approximate per-entry cost of a node in the hash table.
+    constexpr size_t ENTRY_OVERHEAD = 64;
+
+    uint64_t hashKey(const Row::Value &key, uint64_t seed)
+    {
+        if (const auto *text = std::get_if<std::string>(&key))
+        {
+            return hashBytes(text->data(), text->size(), seed);
+        }
+        uint32_t bits;
+        if (const auto *i = std::get_if<int32_t>(&key))
+        {
+            std::memcpy(&bits, i, sizeof(bits));
+        }
+        else
+        {
+            // Keys are matched with ==, so -0.0 and +0.0 must hash alike.
+            bits = floatHashBits(std::get<float>(key));
+        }
+        return hashBytes(reinterpret_cast<const char *>(&bits), sizeof(bits), seed);
+    }
+
+    size_t keyWidth(const std::vector<char> &record, DataType type)
+    {
+        if (type == DataType::TEXT || type == DataType::DATE)
+        {
+            uint16_t length;
+            std::memcpy(&length, record.data(), sizeof(uint16_t));
+            return sizeof(uint16_t) + length;
+        }
+        return sizeof(int32_t);
+    }
+}
+
+size_t HashJoin::KeyHash::operator()(const Row::Value &key) const
+{
+    return static_cast<size_t>(hashKey(key, 0));
+}
+
+HashJoin::HashJoin(JoinInput left, JoinInput right, size_t memoryBudget, IStorage &storage, const std::string &spillDir,
+                   ILogger &logger)
+    : inputs_{std::move(left), std::move(right)},
+      memoryBudget_(memoryBudget),
+      storage_(storage),
+      spillDir_(spillDir),
+      logger_(logger),
+      operatorId_(nextOperatorId++)
+{
+    for (size_t side = 0; side < 2; side++)
+    {
+        JoinInput &in = inputs_[side];
+        const auto &columns = in.input.getSchema();
+        if (in.keyColumn >= columns.size())
+        {
+            throw std::out_of_range("Join column index out of range");
+        }
+        if (in.projection.empty())
+        {
+            in.projection.resize(columns.size());
+            std::iota(in.projection.begin(), in.projection.end(), 0);
+        }
+        for (size_t column : in.projection)
+        {
+            if (column >= columns.size())
+            {
+                throw std::out_of_range("Projected column index out of range");
+            }
+            outputSchema_.push_back(columns[column]);
+        }
+        keySchema_[side] = {columns[in.keyColumn]};
+    }
+    match_ = matchEnd_ = table_.cend();
+    if (keySchema_[0][0].type != keySchema_[1][0].type)
+    {
+        throw std::invalid_argument("Join columns " + keySchema_[0][0].name + " and " + keySchema_[1][0].name +
+                                    " have different types");
+    }
+}
+
+HashJoin::~HashJoin()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_WARN(logger_, std::string("Failed to remove join partitions: ") + e.what());
+    }
+}
+
+HashJoin::JoinRow HashJoin::extract(size_t side, const std::vector<char> &bytes) const
+{
+    const JoinInput &in = inputs_[side];
+    const auto &columns = in.input.getSchema();
+    Row row = Row::deserialize(columns, bytes.data(), bytes.size());
+
+    std::vector<Column> projectedColumns;
+    std::vector<Row::Value> projectedValues;
+    projectedColumns.reserve(in.projection.size());
+    projectedValues.reserve(in.projection.size());
+    for (size_t column : in.projection)
+    {
+        projectedColumns.push_back(columns[column]);
+        projectedValues.push_back(row.getValue(column));
+    }
+    return JoinRow{row.getValue(in.keyColumn), Row(projectedColumns, projectedValues).serialize()};
+}
+
+std::vector<char> HashJoin::encode(size_t side, const JoinRow &row) const
+{
+    std::vector<char> record = Row(keySchema_[side], {row.key}).serialize();
+    record.insert(record.end(), row.projected.begin(), row.projected.end());
+    return record;
+}
+
+HashJoin::JoinRow HashJoin::decode(size_t side, const std::vector<char> &record) const
+{
+    size_t width = keyWidth(record, keySchema_[side][0].type);
+    Row key = Row::deserialize(keySchema_[side], record.data(), width);
+    return JoinRow{key.getValue(0), std::vector<char>(record.begin() + width, record.end())};
+}
+
+size_t HashJoin::partitionOf(const Row::Value &key, uint32_t level) const
+{
+    // Every level uses its own seed so a partition splits again when it is re-partitioned.
+    size_t fanOut = std::clamp<size_t>(memoryBudget_ / PAGE_SIZE, 2, MAX_PARTITIONS);
+    return static_cast<size_t>(hashKey(key, level + 1) % fanOut);
+}
+
+size_t HashJoin::footprint(const JoinRow &row) const
+{
+    size_t bytes = ENTRY_OVERHEAD + sizeof(Row::Value) + row.projected.size();
+    if (const auto *text = std::get_if<std::string>(&row.key))
+    {
+        bytes += text->size();
+    }
+    return bytes;
+}
+
+std::vector<std::unique_ptr<SpillWriter>> HashJoin::createWriters(uint32_t level)
+{
+    size_t fanOut = std::clamp<size_t>(memoryBudget_ / PAGE_SIZE, 2, MAX_PARTITIONS);
+    std::vector<std::unique_ptr<SpillWriter>> writers;
+    for (size_t i = 0; i < fanOut; i++)
+    {
+        std::string filename = spillDir_ + "/join_" + std::to_string(operatorId_) + "_l" + std::to_string(level) +
+                               "_" + std::to_string(nextFileId_++) + ".tmp";
+        writers.push_back(std::make_unique<SpillWriter>(storage_, filename));
+        spillFiles_.push_back(filename);
+    }
+    return writers;
+}
+
+void HashJoin::queuePartitions(std::vector<std::unique_ptr<SpillWriter>> &buildWriters,
+                               std::vector<std::unique_ptr<SpillWriter>> &probeWriters, uint32_t level)
+{
+    for (size_t i = 0; i < buildWriters.size(); i++)
+    {
+        buildWriters[i]->finish();
+        probeWriters[i]->finish();
+        if (buildWriters[i]->getNumRecords() == 0 || probeWriters[i]->getNumRecords() == 0)
+        {
+            // One side is empty: the partition cannot produce any output.
+            removeSpillFile(buildWriters[i]->getFilename());
+            removeSpillFile(probeWriters[i]->getFilename());
+            continue;
+        }
+        partitions_.push_back(Partition{buildWriters[i]->getFilename(), probeWriters[i]->getFilename(), level});
+    }
+}
+
+void HashJoin::partitionFile(size_t side, const std::string &filename, std::vector<std::unique_ptr<SpillWriter>> &writers,
+                             uint32_t level)
+{
+    SpillReader reader(storage_, filename);
+    std::vector<char> record;
+    while (reader.next(record))
+    {
+        JoinRow row = decode(side, record);
+        writers[partitionOf(row.key, level)]->write(record);
+    }
+}
+
+void HashJoin::removeSpillFile(const std::string &filename)
+{
+    storage_.removeFile(filename);
+    spillFiles_.erase(std::remove(spillFiles_.begin(), spillFiles_.end(), filename), spillFiles_.end());
+}
+
+void HashJoin::insert(JoinRow row)
+{
+    tableBytes_ += footprint(row);
+    table_.emplace(std::move(row.key), std::move(row.projected));
+}
+
+bool HashJoin::open()
+{
+    close();
+    partitioned_ = false;
+
+    // Build on the smaller input; without estimates the right input is built.
+    size_t leftPages = inputs_[0].input.estimatedPages();
+    size_t rightPages = inputs_[1].input.estimatedPages();
+    buildSide_ = (leftPages != 0 && rightPages != 0 && leftPages < rightPages) ? 0 : 1;
+    Operator &build = inputs_[buildSide_].input;
+    Operator &probe = inputs_[probeSide()].input;
+
+    // 1) Build, switching to partitioning once the table outgrows the budget.
+    if (!build.open())
+    {
+        return false;
+    }
+    std::vector<std::unique_ptr<SpillWriter>> buildWriters;
+    RowBatch batch;
+    while (build.next(batch))
+    {
+        for (const auto &bytes : batch.rows)
+        {
+            JoinRow row = extract(buildSide_, bytes);
+            if (partitioned_)
+            {
+                buildWriters[partitionOf(row.key, 0)]->write(encode(buildSide_, row));
+                continue;
+            }
+            insert(std::move(row));
+            if (tableBytes_ > memoryBudget_)
+            {
+                LOG_INFO(logger_, "Hash join build side exceeds " + std::to_string(memoryBudget_) +
+                                  " bytes, partitioning both inputs");
+                partitioned_ = true;
+                buildWriters = createWriters(0);
+                for (const auto &entry : table_)
+                {
+                    JoinRow spilled{entry.first, entry.second};
+                    buildWriters[partitionOf(spilled.key, 0)]->write(encode(buildSide_, spilled));
+                }
+                table_.clear();
+                tableBytes_ = 0;
+            }
+        }
+    }
+    build.close();
+
+    if (!probe.open())
+    {
+        return false;
+    }
+    if (!partitioned_)
+    {
+        // 2a) Everything fit: stream the probe input through the table.
+        probeFromInput_ = true;
+        return true;
+    }
+
+    // 2b) Partition the probe input the same way, then join partition by partition.
+    std::vector<std::unique_ptr<SpillWriter>> probeWriters = createWriters(0);
+    while (probe.next(batch))
+    {
+        for (const auto &bytes : batch.rows)
+        {
+            JoinRow row = extract(probeSide(), bytes);
+            probeWriters[partitionOf(row.key, 0)]->write(encode(probeSide(), row));
+        }
+    }
+    probe.close();
+    queuePartitions(buildWriters, probeWriters, 0);
+    return true;
+}
+
+bool HashJoin::loadNextPartition()
+{
+    while (!partitions_.empty())
+    {
+        Partition partition = partitions_.front();
+        partitions_.pop_front();
+
+        table_.clear();
+        tableBytes_ = 0;
+        match_ = matchEnd_ = table_.cend();
+        bool fits = true;
+        {
+            SpillReader reader(storage_, partition.buildFile);
+            std::vector<char> record;
+            while (reader.next(record))
+            {
+                insert(decode(buildSide_, record));
+                if (tableBytes_ > memoryBudget_ && partition.level < MAX_PARTITION_LEVEL)
+                {
+                    fits = false;
+                    break;
+                }
+            }
+        }
+
+        if (!fits)
+        {
+            // Too big even after partitioning: split it again with the next seed.
+            table_.clear();
+            tableBytes_ = 0;
+            uint32_t level = partition.level + 1;
+            auto buildWriters = createWriters(level);
+            auto probeWriters = createWriters(level);
+            partitionFile(buildSide_, partition.buildFile, buildWriters, level);
+            partitionFile(probeSide(), partition.probeFile, probeWriters, level);
+            removeSpillFile(partition.buildFile);
+            removeSpillFile(partition.probeFile);
+            queuePartitions(buildWriters, probeWriters, level);
+            continue;
+        }
+
+        current_ = partition;
+        probeReader_ = std::make_unique<SpillReader>(storage_, partition.probeFile);
+        return true;
+    }
+    return false;
+}
+
+bool HashJoin::nextProbeRow()
+{
+    if (probeFromInput_)
+    {
+        while (probePosition_ >= probeBatch_.rows.size())
+        {
+            probePosition_ = 0;
+            if (!inputs_[probeSide()].input.next(probeBatch_))
+            {
+                inputs_[probeSide()].input.close();
+                probeFromInput_ = false;
+                return false;
+            }
+        }
+        probeRow_ = extract(probeSide(), probeBatch_.rows[probePosition_++]);
+        return true;
+    }
+
+    if (probeReader_)
+    {
+        std::vector<char> record;
+        if (probeReader_->next(record))
+        {
+            probeRow_ = decode(probeSide(), record);
+            return true;
+        }
+        probeReader_.reset();
+        removeSpillFile(current_.buildFile);
+        removeSpillFile(current_.probeFile);
+    }
+    return false;
+}
+
+std::vector<char> HashJoin::combine(const std::vector<char> &probeProjected, const std::vector<char> &buildProjected) const
+{
+    const std::vector<char> &left = buildSide_ == 0 ? buildProjected : probeProjected;
+    const std::vector<char> &right = buildSide_ == 0 ? probeProjected : buildProjected;
+    std::vector<char> out;
+    out.reserve(left.size() + right.size());
+    out.insert(out.end(), left.begin(), left.end());
+    out.insert(out.end(), right.begin(), right.end());
+    return out;
+}
+
+bool HashJoin::next(RowBatch &batch)
+{
+    batch.rows.clear();
+    size_t batchBytes = 0;
+    while (batchBytes < PAGE_SIZE)
+    {
+        if (match_ != matchEnd_)
+        {
+            batch.rows.push_back(combine(probeRow_.projected, match_->second));
+            batchBytes += batch.rows.back().size();
+            ++match_;
+            continue;
+        }
+        if (!nextProbeRow())
+        {
+            if (!partitioned_ || !loadNextPartition())
+            {
+                break;
+            }
+            continue;
+        }
+        auto range = table_.equal_range(probeRow_.key);
+        match_ = range.first;
+        matchEnd_ = range.second;
+    }
+    return !batch.rows.empty();
+}
+
+void HashJoin::close()
+{
+    if (probeFromInput_)
+    {
+        inputs_[probeSide()].input.close();
+        probeFromInput_ = false;
+    }
+    probeBatch_.rows.clear();
+    probePosition_ = 0;
+    probeReader_.reset();
+    table_.clear();
+    tableBytes_ = 0;
+    match_ = matchEnd_ = table_.cend();
+    partitions_.clear();
+    for (const auto &file : spillFiles_)
+    {
+        storage_.removeFile(file);
+    }
+    spillFiles_.clear();
+}
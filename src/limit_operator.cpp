@@ -0,0 +1,137 @@
+#include "limit_operator.h"
+
+#include <algorithm>
+
+bool LimitOperator::open()
+{
+    produced_ = 0;
+    inputOpen_ = false;
+    if (limit_ == 0)
+    {
+        return true;
+    }
+    inputOpen_ = input_.open();
+    return inputOpen_;
+}
+
+bool LimitOperator::next(RowBatch &batch)
+{
+    batch.rows.clear();
+    if (!inputOpen_)
+    {
+        return false;
+    }
+    if (!input_.next(batch))
+    {
+        close();
+        return false;
+    }
+
+    size_t remaining = limit_ - produced_;
+    if (batch.rows.size() >= remaining)
+    {
+        // Early termination: the input is not asked for another batch.
+        batch.rows.resize(remaining);
+        close();
+    }
+    produced_ += batch.rows.size();
+    return !batch.rows.empty();
+}
+
+void LimitOperator::close()
+{
+    if (inputOpen_)
+    {
+        input_.close();
+        inputOpen_ = false;
+    }
+}
+
+bool TopNBuffer::better(const Entry &a, const Entry &b) const
+{
+    if (ordering_.less(a.keys, b.keys))
+    {
+        return true;
+    }
+    if (ordering_.less(b.keys, a.keys))
+    {
+        return false;
+    }
+    return a.sequence < b.sequence;
+}
+
+void TopNBuffer::push(std::vector<char> bytes)
+{
+    if (limit_ == 0)
+    {
+        return;
+    }
+
+    Entry entry{ordering_.extract(columns_, bytes), sequence_++, {}};
+    // std heap functions keep the maximum on top, so "better" plays the role of "less".
+    auto cmp = [this](const Entry &a, const Entry &b) { return better(a, b); };
+    if (heap_.size() < limit_)
+    {
+        entry.bytes = std::move(bytes);
+        heap_.push_back(std::move(entry));
+        std::push_heap(heap_.begin(), heap_.end(), cmp);
+        return;
+    }
+    if (!better(entry, heap_.front()))
+    {
+        return;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), cmp);
+    entry.bytes = std::move(bytes);
+    heap_.back() = std::move(entry);
+    std::push_heap(heap_.begin(), heap_.end(), cmp);
+}
+
+std::vector<std::vector<char>> TopNBuffer::finish()
+{
+    std::sort_heap(heap_.begin(), heap_.end(), [this](const Entry &a, const Entry &b) { return better(a, b); });
+    std::vector<std::vector<char>> rows;
+    rows.reserve(heap_.size());
+    for (auto &entry : heap_)
+    {
+        rows.push_back(std::move(entry.bytes));
+    }
+    heap_.clear();
+    return rows;
+}
+
+bool TopNOperator::open()
+{
+    rows_.clear();
+    position_ = 0;
+    if (!input_.open())
+    {
+        return false;
+    }
+
+    TopNBuffer buffer(ordering_, input_.getSchema(), limit_);
+    RowBatch batch;
+    while (input_.next(batch))
+    {
+        for (auto &bytes : batch.rows)
+        {
+            buffer.push(std::move(bytes));
+        }
+    }
+    input_.close();
+    rows_ = buffer.finish();
+    return true;
+}
+
+bool TopNOperator::next(RowBatch &batch)
+{
+    batch.rows.clear();
+    size_t batchBytes = 0;
+    while (position_ < rows_.size() && batchBytes < PAGE_SIZE)
+    {
+        batchBytes += rows_[position_].size();
+        batch.rows.push_back(std::move(rows_[position_]));
+        position_++;
+    }
+    return !batch.rows.empty();
+}
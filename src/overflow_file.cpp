@@ -0,0 +1,255 @@
+#include "overflow_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "row.h"
+#include "text_dictionary.h"
+
+namespace
+{
+    // A TEXT value of a serialized row.
+    struct TextField
+    {
+        size_t column;
+        size_t offset;   // Of the length prefix.
+        size_t size;     // Bytes of the prefix and the value or reference.
+        uint16_t prefix; // Length, Row::LONG_TEXT or Row::OVERFLOW_TEXT.
+        uint64_t length; // Of the value itself.
+
+        size_t valueOffset() const { return offset + sizeof(uint16_t) + (prefix == Row::LONG_TEXT ? sizeof(uint32_t) : 0); }
+    };
+
+    std::vector<TextField> textFields(const std::vector<Column> &columns, const std::vector<char> &row)
+    {
+        std::vector<TextField> fields;
+        size_t offset = 0;
+        auto need = [&](size_t bytes, size_t column)
+        {
+            if (offset + bytes > row.size())
+            {
+                throw std::runtime_error("Serialized row truncated at column " + std::to_string(column));
+            }
+        };
+        for (size_t i = 0; i < columns.size(); i++)
+        {
+            if (columns[i].type == DataType::INT || columns[i].type == DataType::FLOAT)
+            {
+                need(sizeof(int32_t), i);
+                offset += sizeof(int32_t);
+                continue;
+            }
+            if (columns[i].categorical && columns[i].type == DataType::TEXT)
+            {
+                // A code into the table's TextDictionary, never moved out.
+                TextDictionary::readCode(row.data(), row.size(), offset);
+                continue;
+            }
+
+            need(sizeof(uint16_t), i);
+            TextField field{i, offset, sizeof(uint16_t), 0, 0};
+            std::memcpy(&field.prefix, row.data() + offset, sizeof(uint16_t));
+            if (field.prefix == Row::OVERFLOW_TEXT)
+            {
+                need(field.size + sizeof(OverflowRef), i);
+                OverflowRef ref;
+                std::memcpy(&ref, row.data() + offset + field.size, sizeof(OverflowRef));
+                field.size += sizeof(OverflowRef);
+                field.length = ref.length;
+            }
+            else if (field.prefix == Row::LONG_TEXT)
+            {
+                need(field.size + sizeof(uint32_t), i);
+                uint32_t length;
+                std::memcpy(&length, row.data() + offset + field.size, sizeof(uint32_t));
+                field.size += sizeof(uint32_t) + length;
+                field.length = length;
+            }
+            else
+            {
+                field.size += field.prefix;
+                field.length = field.prefix;
+            }
+            need(field.size, i);
+            offset += field.size;
+            if (columns[i].type == DataType::TEXT)
+            {
+                fields.push_back(field);
+            }
+        }
+        return fields;
+    }
+
+    void appendLength(std::vector<char> &row, uint64_t length)
+    {
+        if (length >= Row::OVERFLOW_TEXT)
+        {
+            uint16_t escape = Row::LONG_TEXT;
+            uint32_t longLength = static_cast<uint32_t>(length);
+            row.insert(row.end(), reinterpret_cast<char *>(&escape), reinterpret_cast<char *>(&escape) + sizeof(uint16_t));
+            row.insert(row.end(), reinterpret_cast<char *>(&longLength), reinterpret_cast<char *>(&longLength) + sizeof(uint32_t));
+            return;
+        }
+        uint16_t shortLength = static_cast<uint16_t>(length);
+        row.insert(row.end(), reinterpret_cast<char *>(&shortLength), reinterpret_cast<char *>(&shortLength) + sizeof(uint16_t));
+    }
+}
+
+size_t ValueReader::read(char *data, size_t size)
+{
+    size_t count = static_cast<size_t>(std::min<uint64_t>(size, size_ - position_));
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (storage_ == nullptr)
+    {
+        std::memcpy(data, value_.data() + position_, count);
+    }
+    else if (!storage_->readFile(filename_, data, count, static_cast<std::streamoff>(offset_ + position_)))
+    {
+        throw std::runtime_error("Failed to read overflow value from: " + filename_);
+    }
+    position_ += count;
+    return count;
+}
+
+void OverflowFile::initialize()
+{
+    if (!storage_.fileExists(filename_))
+    {
+        storage_.createFile(filename_);
+    }
+    end_ = storage_.getSize(filename_);
+}
+
+OverflowRef OverflowFile::append(const char *data, size_t size)
+{
+    // Writers take disjoint ranges, so they write concurrently without a lock.
+    OverflowRef ref{end_.fetch_add(size), size};
+    storage_.writeFile(filename_, const_cast<char *>(data), size, static_cast<std::streamoff>(ref.offset));
+    return ref;
+}
+
+bool OverflowFile::storeLargeValues(const std::vector<Column> &columns, std::vector<char> &row, size_t maxRowSize)
+{
+    if (row.size() <= maxRowSize)
+    {
+        return false;
+    }
+    std::vector<TextField> fields = textFields(columns, row);
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        if (fields[i].prefix != Row::OVERFLOW_TEXT && fields[i].length >= MIN_OVERFLOW_VALUE)
+        {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&fields](size_t a, size_t b)
+              { return fields[a].length > fields[b].length; });
+
+    std::vector<bool> moving(fields.size(), false);
+    size_t size = row.size();
+    bool any = false;
+    for (size_t i : candidates)
+    {
+        if (size <= maxRowSize && fields[i].prefix != Row::LONG_TEXT)
+        {
+            break;
+        }
+        moving[i] = true;
+        any = true;
+        size -= fields[i].size - sizeof(uint16_t) - sizeof(OverflowRef);
+    }
+    if (!any)
+    {
+        return false;
+    }
+
+    std::vector<char> stored;
+    stored.reserve(size);
+    size_t copied = 0;
+    for (size_t i = 0; i < fields.size(); i++)
+    {
+        if (!moving[i])
+        {
+            continue;
+        }
+        const TextField &field = fields[i];
+        stored.insert(stored.end(), row.begin() + copied, row.begin() + field.offset);
+        OverflowRef ref = append(row.data() + field.valueOffset(), field.length);
+        uint16_t prefix = Row::OVERFLOW_TEXT;
+        stored.insert(stored.end(), reinterpret_cast<char *>(&prefix), reinterpret_cast<char *>(&prefix) + sizeof(uint16_t));
+        stored.insert(stored.end(), reinterpret_cast<char *>(&ref), reinterpret_cast<char *>(&ref) + sizeof(OverflowRef));
+        copied = field.offset + field.size;
+    }
+    stored.insert(stored.end(), row.begin() + copied, row.end());
+    row.swap(stored);
+    return true;
+}
+
+bool OverflowFile::loadLargeValues(const std::vector<Column> &columns, const std::vector<char> &row, std::vector<char> &loaded)
+{
+    if (empty())
+    {
+        return false;
+    }
+    std::vector<TextField> fields = textFields(columns, row);
+    if (std::none_of(fields.begin(), fields.end(), [](const TextField &field)
+                     { return field.prefix == Row::OVERFLOW_TEXT; }))
+    {
+        return false;
+    }
+
+    loaded.clear();
+    size_t copied = 0;
+    for (const TextField &field : fields)
+    {
+        if (field.prefix != Row::OVERFLOW_TEXT)
+        {
+            continue;
+        }
+        OverflowRef ref;
+        std::memcpy(&ref, row.data() + field.offset + sizeof(uint16_t), sizeof(OverflowRef));
+        loaded.insert(loaded.end(), row.begin() + copied, row.begin() + field.offset);
+        appendLength(loaded, ref.length);
+        size_t start = loaded.size();
+        loaded.resize(start + ref.length);
+        if (!storage_.readFile(filename_, loaded.data() + start, ref.length, static_cast<std::streamoff>(ref.offset)))
+        {
+            throw std::runtime_error("Failed to read overflow value from: " + filename_);
+        }
+        copied = field.offset + field.size;
+    }
+    loaded.insert(loaded.end(), row.begin() + copied, row.end());
+    return true;
+}
+
+ValueReader OverflowFile::openValue(const std::vector<Column> &columns, const std::vector<char> &row, size_t columnIndex)
+{
+    for (const TextField &field : textFields(columns, row))
+    {
+        if (field.column != columnIndex)
+        {
+            continue;
+        }
+        if (field.prefix == Row::OVERFLOW_TEXT)
+        {
+            OverflowRef ref;
+            std::memcpy(&ref, row.data() + field.offset + sizeof(uint16_t), sizeof(OverflowRef));
+            return ValueReader(storage_, filename_, ref);
+        }
+        return ValueReader(std::string(row.data() + field.valueOffset(), field.length));
+    }
+    throw std::invalid_argument("Column " + std::to_string(columnIndex) + " is not a TEXT column");
+}
+
+void OverflowFile::sync()
+{
+    if (!empty())
+    {
+        storage_.syncData(filename_);
+    }
+}
@@ -1,35 +1,57 @@
 #include "page_directory.h"
 
+#include <algorithm>
+#include <functional>
+
+PageDirectory::~PageDirectory()
+{
+    PublishedPages *node = published_.exchange(nullptr);
+    while (node != nullptr)
+    {
+        PublishedPages *next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
 bool PageDirectory::initialize()
 {
     try
     {
 
         // check if file exists
-        logger_.log("Checking if page directory file exists: " + filename_);
+        LOG_DEBUG(logger_, "Checking if page directory file exists: " + filename_);
         if (storage_.fileExists(filename_))
         {
-            logger_.log("Page directory file exists: " + filename_);
-            logger_.log("Reading page directory file: " + filename_);
+            LOG_DEBUG(logger_, "Page directory file exists: " + filename_);
+            LOG_DEBUG(logger_, "Reading page directory file: " + filename_);
             storage_.readFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_));
         }
         else
         {
-            logger_.log("Page directory file does not exist: " + filename_);
-            logger_.log("Creating page directory file: " + filename_);
+            LOG_DEBUG(logger_, "Page directory file does not exist: " + filename_);
+            LOG_DEBUG(logger_, "Creating page directory file: " + filename_);
             storage_.writeFile(filename_, reinterpret_cast<char *>(&header_), sizeof(header_));
         }
 
-        logger_.log("Page directory header: num_pages=" + std::to_string(header_.num_pages) + ", next_page_id=" + std::to_string(header_.next_page_id) + ", num_rows=" + std::to_string(header_.num_rows) + ", next_row_id=" + std::to_string(header_.next_row_id));
+        LOG_DEBUG(logger_, "Page directory header: num_pages=" + std::to_string(header_.num_pages) + ", next_page_id=" + std::to_string(header_.next_page_id) + ", num_rows=" + std::to_string(header_.num_rows) + ", next_row_id=" + std::to_string(header_.next_row_id));
+        nextPageId_ = header_.next_page_id;
+        nextRowId_ = header_.next_row_id;
+        numRows_ = header_.num_rows;
+        checkpointLsn_ = header_.checkpoint_lsn;
+        committedRowId_ = header_.next_row_id;
+
         // load the page directory entries into memory
+        std::unique_lock<std::shared_mutex> lock(latch_);
         for (size_t i = 0; i < header_.num_pages; i++)
         {
             PageDirectoryEntry entry;
             // Calculate the offset for the i-th entry.
             std::streampos offset = sizeof(header_) + i * sizeof(entry);
             storage_.readFile(filename_, reinterpret_cast<char *>(&entry), sizeof(entry), offset);
-            entries_.push_back(entry);
+            appendEntry(entry);
         }
+        publishVersion();
         return true;
     }
     catch (const std::exception &e)
@@ -41,90 +63,357 @@ bool PageDirectory::initialize()
 
 uint32_t PageDirectory::getAndIncrementNextPageId()
 {
-    uint32_t nextPageId = header_.next_page_id;
-    header_.next_page_id++;
-    return nextPageId;
+    return nextPageId_.fetch_add(1);
 }
 
 uint32_t PageDirectory::getAndIncrementNextRowId()
 {
-    uint32_t nextRowId = header_.next_row_id;
-    header_.next_row_id++;
-    return nextRowId;
+    return nextRowId_.fetch_add(1);
+}
+
+uint32_t PageDirectory::allocateRowIds(uint32_t count)
+{
+    return nextRowId_.fetch_add(count);
 }
 
 void PageDirectory::persistPageDirectory()
 {
-    logger_.log("Persisting page directory to file: " + filename_);
-    // Compute total size: header + all entries.
-    size_t totalSize = sizeof(header_) + entries_.size() * sizeof(PageDirectoryEntry);
+    LOG_TRACE(logger_, "Persisting page directory to file: " + filename_);
+    // Snapshot and write under one mutex so that a newer directory is never
+    // overwritten by an older one.
+    drainPublished();
+    std::lock_guard<std::mutex> persistLock(persistMutex_);
+    std::vector<char> buffer;
+    {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        header_.num_pages = static_cast<uint32_t>(entries_.size());
+        header_.next_page_id = nextPageId_;
+        header_.next_row_id = nextRowId_;
+        header_.num_rows = numRows_;
+        header_.checkpoint_lsn = checkpointLsn_;
 
-    std::vector<char> buffer(totalSize);
-    std::memcpy(buffer.data(), &header_, sizeof(header_));
+        // Compute total size: header + all entries.
+        size_t totalSize = sizeof(header_) + entries_.size() * sizeof(PageDirectoryEntry);
+        buffer.resize(totalSize);
+        std::memcpy(buffer.data(), &header_, sizeof(header_));
 
-    // Copy each entry.
-    for (size_t i = 0; i < entries_.size(); i++)
-    {
-        std::memcpy(buffer.data() + sizeof(header_) + i * sizeof(PageDirectoryEntry),
-                    &entries_[i],
-                    sizeof(PageDirectoryEntry));
+        // Copy each entry.
+        for (size_t i = 0; i < entries_.size(); i++)
+        {
+            std::memcpy(buffer.data() + sizeof(header_) + i * sizeof(PageDirectoryEntry),
+                        &entries_[i],
+                        sizeof(PageDirectoryEntry));
+        }
     }
     try
     {
-        storage_.writeFile(filename_, buffer.data(), totalSize);
+        storage_.writeFile(filename_, buffer.data(), buffer.size());
     }
     catch (const std::exception &e)
     {
-        logger_.log("Failed to persist page directory to file: " + filename_ + ", error: " + e.what());
+        LOG_ERROR(logger_, "Failed to persist page directory to file: " + filename_ + ", error: " + e.what());
     }
 }
 
+void PageDirectory::sync()
+{
+    std::lock_guard<std::mutex> persistLock(persistMutex_);
+    storage_.syncFile(filename_);
+}
+
 void PageDirectory::updatePageDirectoryEntry(PageDirectoryEntry &entry)
 {
-    logger_.log("Updating page directory entry: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
-    for (size_t i = 0; i < entries_.size(); i++)
+    LOG_TRACE(logger_, "Updating page directory entry: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    drainPublished();
     {
-        if (entries_[i].page_id == entry.page_id)
+        std::unique_lock<std::shared_mutex> lock(latch_);
+        auto it = positions_.find(entry.page_id);
+        if (it != positions_.end())
         {
-            entries_[i] = entry;
+            PageDirectoryEntry &current = entries_[it->second];
+            claimable_[it->second] += static_cast<int32_t>(entry.available_space) - static_cast<int32_t>(current.available_space);
+            current = entry;
             return;
         }
+        appendEntry(entry);
+        publishVersion();
     }
-    entries_.push_back(entry);
     persistPageDirectory();
 }
 
 void PageDirectory::addPageDirectoryEntry(PageDirectoryEntry &entry)
 {
-    logger_.log("Adding page directory entry: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    LOG_TRACE(logger_, "Adding page directory entry: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    appendEntry(entry);
+    publishVersion();
+}
+
+void PageDirectory::appendEntry(const PageDirectoryEntry &entry)
+{
+    positions_[entry.page_id] = entries_.size();
     entries_.push_back(entry);
-    persistPageDirectory();
+    claimable_.emplace_back(entry.available_space);
 }
 
-PageDirectoryEntry *PageDirectory::getPageDirectoryEntry(uint16_t pageId)
+void PageDirectory::publishPages(std::vector<PageDirectoryEntry> entries)
 {
-    for (size_t i = 0; i < entries_.size(); i++)
+    if (entries.empty())
+    {
+        return;
+    }
+    auto *node = new PublishedPages{std::move(entries), published_.load(std::memory_order_relaxed)};
+    while (!published_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+void PageDirectory::restoreEntry(const PageDirectoryEntry &entry)
+{
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    auto it = positions_.find(entry.page_id);
+    if (it != positions_.end())
     {
-        if (entries_[i].page_id == pageId)
+        claimable_[it->second] = entry.available_space;
+        entries_[it->second] = entry;
+        return;
+    }
+    appendEntry(entry);
+    publishVersion();
+}
+
+void PageDirectory::restoreCounters(uint32_t nextPageId, uint32_t nextRowId, int64_t addedRows)
+{
+    nextPageId_ = std::max(nextPageId_.load(), nextPageId);
+    nextRowId_ = std::max(nextRowId_.load(), nextRowId);
+    committedRowId_ = nextRowId_.load();
+    numRows_ = static_cast<uint32_t>(numRows_ + addedRows);
+}
+
+void PageDirectory::drainPublished()
+{
+    if (published_.load(std::memory_order_relaxed) == nullptr)
+    {
+        return;
+    }
+    // Taking the batches under the latch keeps concurrent drains in publish order.
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    PublishedPages *node = published_.exchange(nullptr, std::memory_order_acquire);
+
+    // The stack holds the newest batch first.
+    std::vector<PublishedPages *> batches;
+    for (; node != nullptr; node = node->next)
+    {
+        batches.push_back(node);
+    }
+    std::reverse(batches.begin(), batches.end());
+
+    for (PublishedPages *batch : batches)
+    {
+        for (const auto &entry : batch->entries)
         {
-            logger_.log("Page directory entry: page_id=" + std::to_string(entries_[i].page_id) + ", available_space=" + std::to_string(entries_[i].available_space));
-            return &entries_[i];
+            appendEntry(entry);
         }
+        delete batch;
+    }
+    publishVersion();
+}
+
+void PageDirectory::publishVersion()
+{
+    size_t published = publishedPages_.load(std::memory_order_relaxed);
+    if (entries_.size() > pageIdCapacity_)
+    {
+        size_t capacity = std::max<size_t>({entries_.size(), pageIdCapacity_ * 2, 64});
+        std::shared_ptr<uint32_t[]> grown(new uint32_t[capacity]);
+        std::copy(pageIds_.get(), pageIds_.get() + published, grown.get());
+        std::atomic_store(&pageIds_, std::move(grown));
+        pageIdCapacity_ = capacity;
+    }
+    for (size_t i = published; i < entries_.size(); i++)
+    {
+        pageIds_[i] = entries_[i].page_id;
+    }
+    publishedPages_.store(entries_.size(), std::memory_order_release);
+}
+
+void PageDirectory::commitRows(uint32_t firstRowId, uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
     }
-    logger_.log("Page directory entry not found: page_id=" + std::to_string(pageId));
-    return nullptr;
+    std::lock_guard<std::mutex> lock(commitMutex_);
+    committedRanges_[firstRowId] = count;
+    uint32_t highWater = committedRowId_.load();
+    for (auto it = committedRanges_.begin(); it != committedRanges_.end() && it->first == highWater;)
+    {
+        highWater += it->second;
+        it = committedRanges_.erase(it);
+    }
+    committedRowId_.store(highWater);
+}
+
+DirectorySnapshot PageDirectory::snapshot()
+{
+    // Read the high-water mark first: every row below it sits on a page that was
+    // published before its commit, so the page list read afterwards contains it.
+    uint32_t highWater = committedRowId_.load();
+    drainPublished();
+    // The count before the buffer: a buffer installed after the count was
+    // published holds a copy of every id below it.
+    size_t count = publishedPages_.load(std::memory_order_acquire);
+    std::shared_ptr<const uint32_t[]> ids = std::atomic_load(&pageIds_);
+    return DirectorySnapshot{PageIdView(std::move(ids), count), highWater};
 }
 
-PageDirectoryEntry *PageDirectory::getPageDirectoryBySize(uint16_t size)
+bool PageDirectory::getPageDirectoryEntry(uint32_t pageId, PageDirectoryEntry &entry)
 {
+    drainPublished();
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto it = positions_.find(pageId);
+    if (it == positions_.end())
+    {
+        LOG_DEBUG(logger_, "Page directory entry not found: page_id=" + std::to_string(pageId));
+        return false;
+    }
+    entry = entries_[it->second];
+    LOG_TRACE(logger_, "Page directory entry: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    return true;
+}
+
+bool PageDirectory::claimSpace(uint32_t size, PageDirectoryEntry &entry)
+{
+    drainPublished();
+    std::shared_lock<std::shared_mutex> lock(latch_);
     for (size_t i = 0; i < entries_.size(); i++)
     {
-        if (entries_[i].available_space >= size)
+        int32_t unclaimed = claimable_[i].load(std::memory_order_relaxed);
+        while (unclaimed >= static_cast<int32_t>(size))
+        {
+            if (claimable_[i].compare_exchange_weak(unclaimed, unclaimed - static_cast<int32_t>(size)))
+            {
+                entry = entries_[i];
+                LOG_TRACE(logger_, "Claimed " + std::to_string(size) + " bytes on page_id=" + std::to_string(entry.page_id));
+                return true;
+            }
+        }
+    }
+    LOG_TRACE(logger_, "Page directory entry not found for size: " + std::to_string(size));
+    return false;
+}
+
+bool PageDirectory::claimSpaceOn(uint32_t pageId, uint32_t size)
+{
+    drainPublished();
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto it = positions_.find(pageId);
+    if (it == positions_.end())
+    {
+        return false;
+    }
+    int32_t unclaimed = claimable_[it->second].load(std::memory_order_relaxed);
+    while (unclaimed >= static_cast<int32_t>(size))
+    {
+        if (claimable_[it->second].compare_exchange_weak(unclaimed, unclaimed - static_cast<int32_t>(size)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PageDirectory::claimAvailable(uint32_t minimum, uint32_t maximum, uint32_t reserve, size_t &cursor,
+                                       PageDirectoryEntry &entry)
+{
+    drainPublished();
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    int64_t needed = static_cast<int64_t>(minimum) + reserve;
+    for (; cursor < entries_.size(); cursor++)
+    {
+        int32_t unclaimed = claimable_[cursor].load(std::memory_order_relaxed);
+        while (unclaimed >= needed)
+        {
+            uint32_t size = static_cast<uint32_t>(std::min<int64_t>(unclaimed - static_cast<int64_t>(reserve), maximum));
+            if (claimable_[cursor].compare_exchange_weak(unclaimed, unclaimed - static_cast<int32_t>(size)))
+            {
+                entry = entries_[cursor++];
+                LOG_TRACE(logger_, "Claimed " + std::to_string(size) + " bytes on page_id=" + std::to_string(entry.page_id));
+                return size;
+            }
+        }
+    }
+    return 0;
+}
+
+void PageDirectory::releaseSpace(uint32_t pageId, uint32_t claimed, uint32_t availableSpace)
+{
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    auto it = positions_.find(pageId);
+    if (it == positions_.end())
+    {
+        throw std::runtime_error("Releasing space on unknown page: page_id=" + std::to_string(pageId));
+    }
+    PageDirectoryEntry &current = entries_[it->second];
+    // The claim is over, and whatever the insert did not use becomes claimable again.
+    claimable_[it->second] += static_cast<int32_t>(claimed + availableSpace) - static_cast<int32_t>(current.available_space);
+    current.available_space = availableSpace;
+}
+
+void PageDirectory::cancelClaim(uint32_t pageId, uint32_t claimed)
+{
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto it = positions_.find(pageId);
+    if (it != positions_.end())
+    {
+        claimable_[it->second] += static_cast<int32_t>(claimed);
+    }
+}
+
+std::vector<PageDirectoryEntry> PageDirectory::getAllEntries()
+{
+    drainPublished();
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    return entries_;
+}
+
+void PageDirectory::setDeadSpace(uint32_t pageId, uint32_t bytes)
+{
+    std::lock_guard<std::mutex> lock(deadSpaceMutex_);
+    if (bytes == 0)
+    {
+        deadSpace_.erase(pageId);
+        return;
+    }
+    deadSpace_[pageId] = bytes;
+}
+
+uint32_t PageDirectory::getDeadSpace(uint32_t pageId)
+{
+    std::lock_guard<std::mutex> lock(deadSpaceMutex_);
+    auto it = deadSpace_.find(pageId);
+    return it == deadSpace_.end() ? 0 : it->second;
+}
+
+std::vector<uint32_t> PageDirectory::mostFragmented(size_t count, uint32_t minBytes)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> candidates; // (dead bytes, page id)
+    {
+        std::lock_guard<std::mutex> lock(deadSpaceMutex_);
+        for (const auto &page : deadSpace_)
         {
-            logger_.log("Page directory entry: page_id=" + std::to_string(entries_[i].page_id) + ", available_space=" + std::to_string(entries_[i].available_space));
-            return &entries_[i];
+            if (page.second >= minBytes)
+            {
+                candidates.emplace_back(page.second, page.first);
+            }
         }
     }
-    logger_.log("Page directory entry not found for size: " + std::to_string(size));
-    return nullptr;
+    count = std::min(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), std::greater<>());
+    std::vector<uint32_t> pageIds;
+    for (size_t i = 0; i < count; i++)
+    {
+        pageIds.push_back(candidates[i].second);
+    }
+    return pageIds;
 }
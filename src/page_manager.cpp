@@ -1,241 +1,1894 @@
 #include "page_manager.h"
 
-bool PageManager::loadPage(PageDirectoryEntry &entry)
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <thread>
+
+namespace
+{
+    // Commits the row ids of an insert however it ends, so that a failed batch
+    // cannot hold back the snapshot high-water mark forever.
+    struct RowCommit
+    {
+        PageDirectory &directory;
+        uint32_t firstRowId;
+        uint32_t count;
+        ~RowCommit() { directory.commitRows(firstRowId, count); }
+    };
+
+    // Write latches of several pages, each taken once. Only the first is
+    // waited for with nothing held; when one of the others is busy all are
+    // released and the wait starts over at that one. A thread taking them
+    // therefore never blocks while holding a latch, and cannot deadlock with
+    // one that takes latches one after another.
+    std::vector<std::unique_lock<std::shared_mutex>> lockLatches(std::vector<std::shared_mutex *> latches)
+    {
+        std::sort(latches.begin(), latches.end());
+        latches.erase(std::unique(latches.begin(), latches.end()), latches.end());
+        std::vector<std::unique_lock<std::shared_mutex>> held;
+        size_t first = 0;
+        while (!latches.empty())
+        {
+            held.clear();
+            held.emplace_back(*latches[first]);
+            size_t busy = first;
+            for (size_t i = 0; i < latches.size(); i++)
+            {
+                if (i == first)
+                {
+                    continue;
+                }
+                std::unique_lock<std::shared_mutex> lock(*latches[i], std::try_to_lock);
+                if (!lock.owns_lock())
+                {
+                    busy = i;
+                    break;
+                }
+                held.push_back(std::move(lock));
+            }
+            if (busy == first)
+            {
+                break;
+            }
+            first = busy;
+        }
+        return held;
+    }
+}
+
+bool PageManager::loadPage(PageDirectoryEntry &entry, std::vector<char> &buffer)
 {
     initialize();
 
-    logger_.log("Loading page: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    LOG_TRACE(logger_, "Loading page: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
     // Calculate the offset for the i-th entry.
-    std::streampos offset = entry.page_id * PAGE_SIZE;
+    std::streampos offset = static_cast<std::streamoff>(entry.page_id) * pageSize_;
 
     // temp page buffer
-    std::vector<char> tempBuffer(PAGE_SIZE, 0);
+    std::vector<char> tempBuffer(pageSize_, 0);
 
-    bool success = storage_.readFile(pageFilePath_, tempBuffer.data(), PAGE_SIZE, offset);
+    bool success = storage_.readFile(pageFilePath_, tempBuffer.data(), pageSize_, offset);
     if (!success)
     {
-        logger_.log("Failed to load page: page_id=" + std::to_string(entry.page_id));
+        LOG_ERROR(logger_, "Failed to load page: page_id=" + std::to_string(entry.page_id));
         return false;
     }
 
+    if (!hasValidChecksum(tempBuffer))
+    {
+        LOG_ERROR(logger_, "Page checksum mismatch: page_id=" + std::to_string(entry.page_id));
+        return false;
+    }
     try
     {
-        slottedPage_.verifyPage(tempBuffer);
+        pageFormat_->verifyPage(tempBuffer);
     }
     catch (const std::runtime_error &e)
     {
-        logger_.log("Failed to verify page: page_id=" + std::to_string(entry.page_id) + ", error=" + e.what());
+        LOG_ERROR(logger_, "Failed to verify page: page_id=" + std::to_string(entry.page_id) + ", error=" + e.what());
         return false;
     }
 
-    page_ = tempBuffer;
-    logger_.log("Page loaded: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
+    buffer.swap(tempBuffer);
+    LOG_TRACE(logger_, "Page loaded: page_id=" + std::to_string(entry.page_id) + ", available_space=" + std::to_string(entry.available_space));
 
     return true;
 }
 
 bool PageManager::persistPage(std::vector<char> buffer, PageDirectoryEntry &entry)
 {
+    reservePageFile(entry.page_id);
+    setPageChecksum(buffer);
     // Write the buffer to the storage.
-    bool success = storage_.writeFile(pageFilePath_, buffer.data(), PAGE_SIZE, entry.page_id * PAGE_SIZE);
+    bool success = storage_.writeFile(pageFilePath_, buffer.data(), pageSize_, static_cast<std::streamoff>(entry.page_id) * pageSize_);
     if (!success)
     {
-        logger_.log("Failed to persist page");
+        LOG_ERROR(logger_, "Failed to persist page");
         return false;
     }
 
     return true;
 }
 
+void PageManager::reservePageFile(uint32_t pageId)
+{
+    size_t end = (static_cast<size_t>(pageId) + 1) * pageSize_;
+    if (end <= pageFileReserved_)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(reserveMutex_);
+    if (end <= pageFileReserved_)
+    {
+        return;
+    }
+    size_t reserve = (end / PAGE_FILE_EXTENT + 1) * PAGE_FILE_EXTENT;
+    storage_.preallocate(pageFilePath_, reserve);
+    // Also when unsupported, so that every page does not try again.
+    pageFileReserved_ = reserve;
+}
+
 bool PageManager::insertData(std::vector<std::vector<char>> &serializedData,
                              const size_t &expectedSerializedDataSize,
-                             const size_t &expectedNumRows)
+                             const size_t &expectedNumRows,
+                             std::vector<ReturnType> *inserted)
 {
     // 1) Initialize the system.
     if (!initialize())
     {
-        logger_.log("Initialization failed in insertData.");
+        LOG_ERROR(logger_, "Initialization failed in insertData.");
         return false;
     }
-    logger_.log("Starting insertion of " + std::to_string(expectedNumRows) + " rows.");
+    LOG_DEBUG(logger_, "Starting insertion of " + std::to_string(expectedNumRows) + " rows.");
+    if (serializedData.empty())
+    {
+        return expectedNumRows == 0;
+    }
+    std::shared_lock<std::shared_mutex> checkpointGuard = holdOffCheckpoint();
 
     // 2) Convert each serialized row into a Data struct with a unique row ID.
+    //    The batch takes a contiguous range of ids in one atomic step. The
+    //    serialized size (row bytes + SlotEntry overhead) the caller validates
+    //    against is that of the rows as given, before they are encoded.
+    uint32_t firstRowId = pageDirectory_.allocateRowIds(static_cast<uint32_t>(serializedData.size()));
+    RowCommit commit{pageDirectory_, firstRowId, static_cast<uint32_t>(serializedData.size())};
     std::vector<Data> formattedData;
     formattedData.reserve(serializedData.size());
+    size_t serializedSize = 0;
+    bool unsynced = false;
     for (const auto &vec : serializedData)
     {
         Data tempData;
-        tempData.id = pageDirectory_.getAndIncrementNextRowId(); // Unique row ID
+        tempData.id = firstRowId + static_cast<uint32_t>(formattedData.size()); // Unique row ID
         tempData.data = vec;
+        serializedSize += vec.size() + sizeof(SlotEntry);
+        unsynced = encodeStoredRow(tempData.data) || unsynced;
         formattedData.push_back(tempData);
     }
-    logger_.log("Assigned row IDs from " + std::to_string(formattedData.front().id) +
-                " to " + std::to_string(formattedData.back().id));
+    if (unsynced)
+    {
+        syncStoredValues();
+    }
+    LOG_DEBUG(logger_, "Assigned row IDs from " + std::to_string(formattedData.front().id) +
+                       " to " + std::to_string(formattedData.back().id));
 
-    // 3) Calculate total required space.
+    // 3) Calculate total required space in the table's page layout.
     size_t requiredSpace = 0;
+    std::vector<size_t> rowRequirements;
+    rowRequirements.reserve(formattedData.size());
     for (const auto &d : formattedData)
     {
-        // Each row is its data + SlotEntry overhead
-        requiredSpace += d.data.size() + sizeof(SlotEntry);
+        rowRequirements.push_back(pageFormat_->requiredSpace(d.data));
+        if (rowRequirements.back() > pageFormat_->emptyPageSpace())
+        {
+            throw std::runtime_error("Row of " + std::to_string(d.data.size()) + " bytes does not fit in a page");
+        }
+        requiredSpace += rowRequirements.back();
     }
-    logger_.log("Total required space for insertion: " + std::to_string(requiredSpace) + " bytes.");
+    LOG_DEBUG(logger_, "Total required space for insertion: " + std::to_string(requiredSpace) + " bytes.");
 
-    // 4) Check if an existing page can hold the entire batch in one go.
-    PageDirectoryEntry *entry = pageDirectory_.getPageDirectoryBySize(requiredSpace);
-    if (entry != nullptr)
+    // 4) Place the rows: first into the free space of existing pages, then onto
+    //    new pages. Space on existing pages is claimed so that concurrent
+    //    inserts look elsewhere, and inserts only fill pages up to the fill
+    //    factor. New pages are private to this thread until written and added
+    //    to the directory.
+    size_t reserve = fillReserve();
+    std::vector<Placement> placements;
+    std::vector<bool> placed(formattedData.size(), false);
+    size_t unplacedSpace = requiredSpace;
+    size_t cursor = 0;
+    while (unplacedSpace > 0 && placements.size() < MAX_PLACEMENT_PAGES)
     {
-        logger_.log("Found existing page with enough space: page_id=" + std::to_string(entry->page_id) +
-                    " (avail=" + std::to_string(entry->available_space) + " bytes)");
+        size_t smallest = SIZE_MAX;
+        for (size_t i = 0; i < formattedData.size(); i++)
+        {
+            if (!placed[i])
+            {
+                smallest = std::min(smallest, rowRequirements[i]);
+            }
+        }
+        Placement placement{};
+        placement.claimed = pageDirectory_.claimAvailable(static_cast<uint32_t>(smallest),
+                                                          static_cast<uint32_t>(std::min<size_t>(unplacedSpace, UINT32_MAX)),
+                                                          static_cast<uint32_t>(reserve), cursor, placement.entry);
+        if (placement.claimed == 0)
+        {
+            break;
+        }
+        // First fit, so that a large row does not keep smaller ones behind it
+        // from the page.
+        size_t used = 0;
+        for (size_t i = 0; i < formattedData.size(); i++)
+        {
+            if (!placed[i] && used + rowRequirements[i] <= placement.claimed)
+            {
+                placement.rows.push_back(formattedData[i]);
+                placed[i] = true;
+                used += rowRequirements[i];
+            }
+        }
+        unplacedSpace -= used;
+        placements.push_back(std::move(placement));
+    }
+    LOG_DEBUG(logger_, "Placing " + std::to_string(requiredSpace - unplacedSpace) + " of " + std::to_string(requiredSpace) +
+                       " bytes on " + std::to_string(placements.size()) + " existing pages");
 
-        // Load the page into our member buffer (page_).
-        if (!loadPage(*entry))
+    std::vector<ReturnType> results;
+    results.reserve(formattedData.size());
+    std::vector<PageDirectoryEntry> entries;
+    std::vector<std::vector<char>> pages;
+    size_t numExisting = placements.size();
+    uint64_t lsn = 0;
+    try
+    {
+        // Hold the write latches of the existing pages across read, modify,
+        // logging and the directory update so that updates of a page are
+        // logged in order.
+        std::vector<std::shared_mutex *> pageLatches;
+        for (const auto &placement : placements)
         {
-            throw std::runtime_error("Failed to load existing page: page_id=" + std::to_string(entry->page_id));
+            pageLatches.push_back(&latches_.latch(placement.entry.page_id));
         }
+        std::vector<std::unique_lock<std::shared_mutex>> held = lockLatches(pageLatches);
+        for (auto &placement : placements)
+        {
+            std::vector<char> page;
+            if (!readPendingPage(placement.entry.page_id, page) && !loadPage(placement.entry, page))
+            {
+                throw std::runtime_error("Failed to load existing page: page_id=" + std::to_string(placement.entry.page_id));
+            }
+            auto placedRows = pageFormat_->insert(placement.rows, page, placement.entry);
+            results.insert(results.end(), placedRows.begin(), placedRows.end());
+            for (const auto &d : placement.rows)
+            {
+                recordRow(placement.entry.page_id, d);
+            }
+            entries.push_back({placement.entry.page_id, static_cast<uint32_t>(pageFormat_->freeSpace(page))});
+            pages.push_back(std::move(page));
+        }
+
+        // Whatever is left goes onto new pages, filled in order.
+        size_t capacity = pageFormat_->emptyPageSpace() - reserve;
+        size_t currentRow = 0;
+        while (unplacedSpace > 0)
+        {
+            PageDirectoryEntry newEntry{pageDirectory_.getAndIncrementNextPageId(), static_cast<uint32_t>(pageSize_)};
+            LOG_DEBUG(logger_, "Created new page: page_id=" + std::to_string(newEntry.page_id));
+            std::vector<char> localPage;
+            pageFormat_->initPage(localPage);
+
+            // A row larger than the fill factor allows still gets a page of its own.
+            std::vector<Data> batch;
+            size_t pageUsed = 0;
+            for (; currentRow < formattedData.size(); currentRow++)
+            {
+                if (placed[currentRow])
+                {
+                    continue;
+                }
+                size_t rowReq = rowRequirements[currentRow];
+                if (!batch.empty() && pageUsed + rowReq > capacity)
+                {
+                    break;
+                }
+                batch.push_back(formattedData[currentRow]);
+                pageUsed += rowReq;
+                unplacedSpace -= rowReq;
+            }
 
-        // Insert all rows into the loaded page_ buffer.
-        auto results = slottedPage_.insert(formattedData, page_, *entry);
+            auto placedRows = pageFormat_->insert(batch, localPage, newEntry);
+            results.insert(results.end(), placedRows.begin(), placedRows.end());
+            for (const auto &d : batch)
+            {
+                recordRow(newEntry.page_id, d);
+            }
+            newEntry.available_space = static_cast<uint32_t>(pageFormat_->freeSpace(localPage));
+            entries.push_back(newEntry);
+            pages.push_back(std::move(localPage));
+        }
 
-        // Re-read the final header from page_ to compute leftover space accurately.
-        SlottedPageHeader finalHeader;
-        std::memcpy(&finalHeader, page_.data(), sizeof(SlottedPageHeader));
+        // Log every page the batch touched as one record. Existing pages may only
+        // reach page.dat once the record is durable; until then later inserts
+        // and readers take them from pendingPages_.
+        lsn = logPages(WalRecordType::INSERT, firstRowId, static_cast<uint32_t>(formattedData.size()), entries, pages);
+        for (size_t i = 0; i < numExisting; i++)
+        {
+            setPageLsn(pages[i], lsn);
+            stagePage(entries[i].page_id, lsn, std::move(pages[i]));
+            // End the claim with the page's precise free space.
+            pageDirectory_.releaseSpace(entries[i].page_id, placements[i].claimed, entries[i].available_space);
+            placements[i].claimed = 0;
+        }
+    }
+    catch (...)
+    {
+        for (const auto &placement : placements)
+        {
+            if (placement.claimed > 0)
+            {
+                pageDirectory_.cancelClaim(placement.entry.page_id, placement.claimed);
+            }
+        }
+        throw;
+    }
 
-        // Calculate the final slot directory end and free space.
-        size_t slotDirEnd = sizeof(SlottedPageHeader) + finalHeader.numSlots * sizeof(SlotEntry);
-        size_t freeSpace = 0;
-        if (slotDirEnd < finalHeader.lastDataOffset)
+    wal_.waitDurable(lsn);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (i < numExisting)
         {
-            freeSpace = finalHeader.lastDataOffset - slotDirEnd;
+            writeStagedPage(entries[i].page_id, lsn);
+            continue;
         }
-        logger_.log("After insertion: numSlots=" + std::to_string(finalHeader.numSlots) +
-                    ", lastDataOffset=" + std::to_string(finalHeader.lastDataOffset) +
-                    ", freeSpace=" + std::to_string(freeSpace));
+        setPageLsn(pages[i], lsn);
+        if (!persistPage(pages[i], entries[i]))
+        {
+            throw std::runtime_error("Failed to persist new page: page_id=" + std::to_string(entries[i].page_id));
+        }
+        pageDirectory_.addPageDirectoryEntry(entries[i]);
+    }
+
+    // 5) Report the rows in batch order and confirm that all of them went in.
+    std::sort(results.begin(), results.end(), [](const ReturnType &a, const ReturnType &b)
+              { return a.data.id < b.data.id; });
+    if (inserted != nullptr)
+    {
+        inserted->insert(inserted->end(), results.begin(), results.end());
+    }
+    if (results.size() != expectedNumRows || expectedSerializedDataSize != serializedSize)
+    {
+        LOG_ERROR(logger_, "Insertion mismatch. Inserted " + std::to_string(results.size()) + " rows; expected " +
+                           std::to_string(expectedNumRows));
+        return false;
+    }
+
+    // 6) The log holds the directory changes; the metadata files catch up at
+    //    the next checkpoint.
+    pageDirectory_.addRows(static_cast<uint32_t>(formattedData.size()));
+    checkpointGuard.unlock();
+    LOG_DEBUG(logger_, "Insertion completed successfully.");
+    checkpointIfDue();
+    return true;
+}
 
-        // Update entry->available_space to the precise freeSpace.
-        entry->available_space = static_cast<uint16_t>(freeSpace);
+bool PageManager::deleteRow(uint32_t rowId, ReturnType *previous)
+{
+    return modifyRow(rowId, nullptr, previous);
+}
+
+bool PageManager::updateRow(uint32_t rowId, const std::vector<char> &row, ReturnType *previous)
+{
+    return modifyRow(rowId, &row, previous);
+}
 
-        // Persist the updated page back to disk.
-        if (!persistPage(page_, *entry))
+bool PageManager::locateRow(uint32_t rowId, Location &home)
+{
+    std::vector<char> buffer;
+    // Held for the whole loop: an insert growing the page id buffer frees
+    // the old one once no snapshot refers to it.
+    DirectorySnapshot snapshot = pageDirectory_.snapshot();
+    for (uint32_t pageId : snapshot.pageIds)
+    {
+        if (!zoneMap_.mayContainRowId(pageId, rowId))
+        {
+            continue;
+        }
+        if (!readPage(pageId, buffer))
+        {
+            throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+        }
+        uint16_t slotId;
+        if (pageFormat_->findRow(buffer, rowId, slotId))
         {
-            throw std::runtime_error("Failed to persist updated page: page_id=" + std::to_string(entry->page_id));
+            home = {pageId, slotId};
+            return true;
         }
+    }
+    return false;
+}
 
-        // Update the page directory entry with the new free space.
-        pageDirectory_.updatePageDirectoryEntry(*entry);
+// Pages rewritten together by one logged change. Every page is write latched
+// when first touched and stays latched until the change is staged. Readers
+// hold one page latch at a time, inserts never wait for one while holding
+// another (see lockLatches) and changes run one at a time under
+// modifyMutex_, so holding several cannot deadlock; pages that share a latch
+// stripe take it once. Space claimed for the change goes back to the
+// directory if the edit is abandoned.
+class PageManager::PageEdit
+{
+public:
+    struct Page
+    {
+        PageDirectoryEntry entry;
+        std::vector<char> image;
+        uint32_t claimed; // Directory space claimed for the change.
+        bool isNew;
+    };
 
-        // Validate insertion
-        if (results.size() != expectedNumRows || expectedSerializedDataSize != requiredSpace)
+    explicit PageEdit(PageManager &pageManager) : pageManager_(pageManager) {}
+    ~PageEdit()
+    {
+        if (staged_)
         {
-            logger_.log("Insertion size mismatch (existing page)!");
-            return false;
+            return;
+        }
+        for (const auto &page : pages_)
+        {
+            if (page.claimed > 0)
+            {
+                pageManager_.pageDirectory_.cancelClaim(page.entry.page_id, page.claimed);
+            }
         }
     }
-    else
+
+    bool touched(uint32_t pageId) const
     {
-        // 5) No single page can hold all rows at once. We'll create new pages as needed.
-        logger_.log("No existing page has enough space. Creating new pages...");
+        return std::any_of(pages_.begin(), pages_.end(), [pageId](const Page &page)
+                           { return page.entry.page_id == pageId; });
+    }
 
-        size_t currentRow = 0;
-        size_t totalInserted = 0;
+    Page &touch(uint32_t pageId)
+    {
+        for (auto &page : pages_)
+        {
+            if (page.entry.page_id == pageId)
+            {
+                return page;
+            }
+        }
+        latch(pageId);
+        Page page{{pageId, 0}, {}, 0, false};
+        if (!pageManager_.readPendingPage(pageId, page.image) && !pageManager_.loadPage(page.entry, page.image))
+        {
+            throw std::runtime_error("Failed to load page: page_id=" + std::to_string(pageId));
+        }
+        pages_.push_back(std::move(page));
+        return pages_.back();
+    }
 
-        while (currentRow < formattedData.size())
+    // A page with room for a row of required bytes, claimed in the directory,
+    // or a new one. Pages already touched are passed over: the change could
+    // not use their space a moment ago.
+    Page &placeRow(size_t required)
+    {
+        PageDirectory &directory = pageManager_.pageDirectory_;
+        PageDirectoryEntry claimed{};
+        if (required <= UINT32_MAX && directory.claimSpace(static_cast<uint32_t>(required), claimed))
         {
-            // Create a new page directory entry with a fresh page_id and full PAGE_SIZE free.
-            uint16_t newPageId = pageDirectory_.getAndIncrementNextPageId();
-            PageDirectoryEntry newEntry{newPageId, PAGE_SIZE};
-            pageDirectory_.addPageDirectoryEntry(newEntry);
+            if (!touched(claimed.page_id))
+            {
+                Page &page = touch(claimed.page_id);
+                page.claimed += static_cast<uint32_t>(required);
+                return page;
+            }
+            directory.cancelClaim(claimed.page_id, static_cast<uint32_t>(required));
+        }
+        uint32_t pageId = directory.getAndIncrementNextPageId();
+        latch(pageId);
+        Page page{{pageId, static_cast<uint32_t>(pageManager_.pageSize_)}, {}, 0, true};
+        pageManager_.pageFormat_->initPage(page.image);
+        pages_.push_back(std::move(page));
+        return pages_.back();
+    }
 
-            logger_.log("Created new page: page_id=" + std::to_string(newPageId));
+    // Applies change to a copy of the page and keeps it if it succeeds. Space
+    // the change takes from the page is claimed first, so that it never uses
+    // space a concurrent insert has claimed.
+    bool apply(Page &page, const std::function<bool(std::vector<char> &)> &change)
+    {
+        IPageFormat &format = *pageManager_.pageFormat_;
+        std::vector<char> copy = page.image;
+        size_t before = format.freeSpace(copy);
+        if (!change(copy))
+        {
+            return false;
+        }
+        size_t after = format.freeSpace(copy);
+        if (after < before && !page.isNew)
+        {
+            uint32_t used = static_cast<uint32_t>(before - after);
+            if (!pageManager_.pageDirectory_.claimSpaceOn(page.entry.page_id, used))
+            {
+                return false;
+            }
+            page.claimed += used;
+        }
+        page.image.swap(copy);
+        return true;
+    }
 
-            // Allocate a local buffer for this new page.
-            std::vector<char> localPage(PAGE_SIZE, 0);
-            SlottedPageHeader emptyHeader = {0, PAGE_SIZE};
-            std::memcpy(localPage.data(), &emptyHeader, sizeof(SlottedPageHeader));
+    // Logs the change, makes the new images visible, hands their space to the
+    // directory and releases the latches. Returns the LSN to wait for.
+    uint64_t stage(uint32_t rowId, uint32_t numDeleted)
+    {
+        IPageFormat &format = *pageManager_.pageFormat_;
+        PageDirectory &directory = pageManager_.pageDirectory_;
+        std::vector<std::vector<char>> images;
+        for (auto &page : pages_)
+        {
+            page.entry.available_space = static_cast<uint32_t>(format.freeSpace(page.image));
+            entries_.push_back(page.entry);
+            images.push_back(page.image);
+        }
+        uint64_t lsn = pageManager_.logPages(WalRecordType::MODIFY, rowId, numDeleted, entries_, images);
+        staged_ = true;
+        for (auto &page : pages_)
+        {
+            setPageLsn(page.image, lsn);
+            directory.setDeadSpace(page.entry.page_id, static_cast<uint32_t>(format.deadSpace(page.image)));
+            pageManager_.stagePage(page.entry.page_id, lsn, std::move(page.image));
+            if (page.isNew)
+            {
+                directory.addPageDirectoryEntry(page.entry);
+            }
+            else
+            {
+                directory.releaseSpace(page.entry.page_id, page.claimed, page.entry.available_space);
+            }
+        }
+        latches_.clear();
+        return lsn;
+    }
 
-            // We'll fill this page with as many rows as fit.
-            size_t availableSpace = PAGE_SIZE - sizeof(SlottedPageHeader);
-            std::vector<Data> batch;
-            size_t pageUsed = 0;
+    // Writes the staged images once the record at lsn is durable.
+    void finish(uint64_t lsn)
+    {
+        pageManager_.wal_.waitDurable(lsn);
+        for (const auto &entry : entries_)
+        {
+            pageManager_.writeStagedPage(entry.page_id, lsn);
+        }
+    }
 
-            while (currentRow < formattedData.size())
+private:
+    void latch(uint32_t pageId)
+    {
+        std::shared_mutex &latch = pageManager_.latches_.latch(pageId);
+        for (const auto &held : latches_)
+        {
+            if (held.mutex() == &latch)
             {
-                size_t rowReq = formattedData[currentRow].data.size() + sizeof(SlotEntry);
-                if (pageUsed + rowReq <= availableSpace)
-                {
-                    batch.push_back(formattedData[currentRow]);
-                    pageUsed += rowReq;
-                    currentRow++;
-                }
-                else
-                {
-                    break;
-                }
+                return;
             }
+        }
+        latches_.emplace_back(latch);
+    }
+
+    PageManager &pageManager_;
+    std::deque<Page> pages_; // A deque so that references stay valid as pages are added.
+    std::vector<std::unique_lock<std::shared_mutex>> latches_;
+    std::vector<PageDirectoryEntry> entries_;
+    bool staged_ = false;
+};
 
-            logger_.log("Inserting " + std::to_string(batch.size()) +
-                        " rows into new page_id=" + std::to_string(newPageId));
+bool PageManager::modifyRow(uint32_t rowId, const std::vector<char> *row, ReturnType *previous)
+{
+    if (!initialize())
+    {
+        LOG_ERROR(logger_, "Initialization failed in modifyRow.");
+        return false;
+    }
+    std::vector<char> stored;
+    if (row != nullptr)
+    {
+        stored = *row;
+        if (encodeStoredRow(stored))
+        {
+            syncStoredValues();
+        }
+        row = &stored;
+    }
+    std::unique_lock<std::mutex> modifying(modifyMutex_);
+    std::shared_lock<std::shared_mutex> checkpointGuard = holdOffCheckpoint();
+    Location home{};
+    if (!locateRow(rowId, home))
+    {
+        return false;
+    }
 
-            // Insert batch into localPage
-            auto results = slottedPage_.insert(batch, localPage, newEntry);
-            totalInserted += results.size();
+    PageEdit edit(*this);
+    PageEdit::Page *homePage = &edit.touch(home.page_id);
+    Location where = home; // Where the row's bytes are.
+    SlotState state = pageFormat_->slotState(homePage->image, home.slot_id, where);
+    PageEdit::Page *current = state == SlotState::FORWARDED ? &edit.touch(where.page_id) : homePage;
+    if (previous != nullptr)
+    {
+        previous->data = pageFormat_->read(current->image, where.slot_id);
+        previous->location = home;
+    }
 
-            // Re-read the final header from localPage to compute leftover space
-            SlottedPageHeader finalHeader;
-            std::memcpy(&finalHeader, localPage.data(), sizeof(SlottedPageHeader));
-            size_t slotDirEnd = sizeof(SlottedPageHeader) + finalHeader.numSlots * sizeof(SlotEntry);
+    auto erase = [&](PageEdit::Page &page, uint16_t slotId)
+    {
+        edit.apply(page, [&](std::vector<char> &image)
+                   { pageFormat_->erase(image, slotId); return true; });
+    };
+    // Compacting first turns dead bytes of the page into room for the row.
+    auto update = [&](PageEdit::Page &page, uint16_t slotId)
+    {
+        return edit.apply(page, [&](std::vector<char> &image)
+                          { return pageFormat_->update(image, slotId, *row) ||
+                                   (pageFormat_->compact(image) > 0 && pageFormat_->update(image, slotId, *row)); });
+    };
 
-            size_t freeSpace = 0;
-            if (slotDirEnd < finalHeader.lastDataOffset)
+    uint32_t placedOn = home.page_id; // Page that ends up with the row's bytes.
+    if (row == nullptr)
+    {
+        if (state == SlotState::FORWARDED)
+        {
+            erase(*current, where.slot_id);
+        }
+        erase(*homePage, home.slot_id);
+    }
+    else if (update(*current, where.slot_id))
+    {
+        placedOn = where.page_id;
+    }
+    else
+    {
+        // Moving back home frees the old target; anywhere else the row takes
+        // a new target and the home slot points at it.
+        if (state == SlotState::FORWARDED)
+        {
+            erase(*current, where.slot_id);
+        }
+        if (state != SlotState::FORWARDED || !update(*homePage, home.slot_id))
+        {
+            PageEdit::Page &target = edit.placeRow(pageFormat_->requiredSpace(*row));
+            auto results = pageFormat_->insert({Data{rowId, *row}}, target.image, target.entry);
+            Location moved = results.front().location;
+            pageFormat_->setMoved(target.image, moved.slot_id);
+            if (!edit.apply(*homePage, [&](std::vector<char> &image)
+                            { return pageFormat_->forward(image, home.slot_id, moved) ||
+                                     (pageFormat_->compact(image) > 0 && pageFormat_->forward(image, home.slot_id, moved)); }))
             {
-                freeSpace = finalHeader.lastDataOffset - slotDirEnd;
+                throw std::runtime_error("No room for a forwarding pointer on page_id=" + std::to_string(home.page_id));
             }
-            logger_.log("After insertion (new page): numSlots=" + std::to_string(finalHeader.numSlots) +
-                        ", lastDataOffset=" + std::to_string(finalHeader.lastDataOffset) +
-                        ", freeSpace=" + std::to_string(freeSpace));
+            placedOn = moved.page_id;
+        }
+    }
 
-            // Update newEntry.available_space precisely
-            newEntry.available_space = static_cast<uint16_t>(freeSpace);
-            pageDirectory_.updatePageDirectoryEntry(newEntry);
+    uint64_t lsn = edit.stage(rowId, row == nullptr ? 1 : 0);
+    if (row == nullptr)
+    {
+        pageDirectory_.removeRows(1);
+    }
+    else
+    {
+        recordRow(placedOn, Data{rowId, *row});
+    }
+    edit.finish(lsn);
+    checkpointGuard.unlock();
+    modifying.unlock();
+    if (previous != nullptr)
+    {
+        decodeStoredRow(previous->data.data);
+    }
+    checkpointIfDue();
+    return true;
+}
 
-            // Persist this new page to disk
-            if (!persistPage(localPage, newEntry))
+size_t PageManager::vacuum()
+{
+    if (!initialize() || layout_ != PageLayout::SLOTTED)
+    {
+        return 0;
+    }
+    if (!deadSpaceKnown_)
+    {
+        // Dead space is only tracked in memory, so the first pass after
+        // opening the table measures it.
+        std::vector<char> buffer;
+        for (const auto &entry : pageDirectory_.getAllEntries())
+        {
+            if (readPage(entry.page_id, buffer))
             {
-                throw std::runtime_error("Failed to persist new page: page_id=" + std::to_string(newPageId));
+                pageDirectory_.setDeadSpace(entry.page_id, static_cast<uint32_t>(pageFormat_->deadSpace(buffer)));
             }
         }
+        deadSpaceKnown_ = true;
+    }
+
+    size_t rewritten = 0;
+    for (uint32_t pageId : pageDirectory_.mostFragmented(VACUUM_PAGES, static_cast<uint32_t>(pageSize_ / VACUUM_DEAD_SPACE_DIVISOR)))
+    {
+        rewritten += compactPage(pageId) ? 1 : 0;
+    }
 
-        // Confirm that we inserted as many rows as expected.
-        if (totalInserted != expectedNumRows || expectedSerializedDataSize != requiredSpace)
+    // Merge pairs of neighbouring sparse pages. Rows move forward in
+    // directory order, the order scans visit pages in, so that a scan running
+    // meanwhile may read a row twice but never misses one.
+    std::vector<PageDirectoryEntry> entries = pageDirectory_.getAllEntries();
+    size_t sparse = pageFormat_->emptyPageSpace() / SPARSE_PAGE_DIVISOR;
+    size_t merged = 0;
+    const PageDirectoryEntry *from = nullptr;
+    for (const auto &entry : entries)
+    {
+        size_t used = pageFormat_->emptyPageSpace() - entry.available_space - pageDirectory_.getDeadSpace(entry.page_id);
+        if (used > sparse)
         {
-            logger_.log("Insertion mismatch in new-page branch. Inserted " +
-                        std::to_string(totalInserted) + " rows; expected " +
-                        std::to_string(expectedNumRows));
-            return false;
+            from = nullptr;
+            continue;
+        }
+        if (from != nullptr && merged < VACUUM_PAGES && mergePages(entry.page_id, from->page_id))
+        {
+            merged++;
+            from = nullptr;
+            continue;
         }
+        from = &entry;
     }
+    rewritten += 2 * merged;
 
-    // 6) Persist the updated page directory overall
-    pageDirectory_.persistPageDirectory();
-    logger_.log("Insertion completed successfully. Directory persisted.");
+    if (rewritten > 0)
+    {
+        LOG_DEBUG(logger_, "Vacuum of table " + tableName_ + " rewrote " + std::to_string(rewritten) + " pages, merging " +
+                               std::to_string(merged) + " pairs");
+    }
+    checkpointIfDue();
+    return rewritten;
+}
 
+bool PageManager::compactPage(uint32_t pageId)
+{
+    std::lock_guard<std::mutex> modifying(modifyMutex_);
+    std::shared_lock<std::shared_mutex> checkpointGuard = holdOffCheckpoint();
+    PageEdit edit(*this);
+    PageEdit::Page &page = edit.touch(pageId);
+    if (!edit.apply(page, [&](std::vector<char> &image)
+                    { return pageFormat_->compact(image) > 0; }))
+    {
+        pageDirectory_.setDeadSpace(pageId, 0);
+        return false;
+    }
+    edit.finish(edit.stage(0, 0));
     return true;
 }
 
-bool PageManager::initialize()
+bool PageManager::mergePages(uint32_t into, uint32_t from)
 {
-    if (initialized_)
+    std::lock_guard<std::mutex> modifying(modifyMutex_);
+    std::shared_lock<std::shared_mutex> checkpointGuard = holdOffCheckpoint();
+
+    // Rows that moved to from get a new forwarding pointer in their home
+    // slot. Homes are looked up before any latch is taken, since locateRow
+    // reads pages; holding modifyMutex_ keeps them in place.
+    std::vector<char> buffer;
+    if (!readPage(from, buffer))
     {
-        return true;
+        throw std::runtime_error("Failed to read page: page_id=" + std::to_string(from));
     }
-    // Load the page directory.
-    bool success = pageDirectory_.initialize();
-    if (!success)
+    std::unordered_map<uint32_t, Location> homes;
+    Location forward{};
+    for (const auto &stored : pageFormat_->readRows(buffer, from))
+    {
+        Location home{};
+        if (pageFormat_->slotState(buffer, stored.location.slot_id, forward) == SlotState::MOVED)
+        {
+            if (!locateRow(stored.data.id, home))
+            {
+                throw std::runtime_error("Moved row without a home slot: row_id=" + std::to_string(stored.data.id));
+            }
+            homes[stored.data.id] = home;
+        }
+    }
+
+    PageEdit edit(*this);
+    PageEdit::Page &source = edit.touch(from);
+    PageEdit::Page &target = edit.touch(into);
+    // A row that stays home is replaced by a forwarding pointer, so it only
+    // pays to move rows larger than one.
+    std::vector<ReturnType> rows;
+    for (auto &stored : pageFormat_->readRows(source.image, from))
+    {
+        SlotState state = pageFormat_->slotState(source.image, stored.location.slot_id, forward);
+        if (state == SlotState::MOVED || stored.data.data.size() > sizeof(ForwardPointer))
+        {
+            rows.push_back(std::move(stored));
+        }
+    }
+    if (rows.empty())
     {
-        logger_.log("Failed to initialize page directory.");
         return false;
     }
-    initialized_ = true;
+
+    std::vector<Data> moving;
+    size_t required = 0;
+    for (const auto &stored : rows)
+    {
+        moving.push_back(stored.data);
+        required += pageFormat_->requiredSpace(stored.data.data);
+    }
+    std::vector<ReturnType> placed;
+    if (!edit.apply(target, [&](std::vector<char> &image)
+                    {
+                        pageFormat_->compact(image);
+                        if (required > pageFormat_->freeSpace(image))
+                        {
+                            return false;
+                        }
+                        placed = pageFormat_->insert(moving, image, target.entry);
+                        for (const auto &row : placed)
+                        {
+                            pageFormat_->setMoved(image, row.location.slot_id);
+                        }
+                        return true; }))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        uint16_t slotId = rows[i].location.slot_id;
+        Location moved = placed[i].location;
+        auto it = homes.find(rows[i].data.id);
+        bool pointed;
+        if (it == homes.end())
+        {
+            pointed = edit.apply(source, [&](std::vector<char> &image)
+                                 { return pageFormat_->forward(image, slotId, moved); });
+        }
+        else
+        {
+            const Location &home = it->second;
+            pointed = edit.apply(edit.touch(home.page_id), [&](std::vector<char> &image)
+                                 { return pageFormat_->forward(image, home.slot_id, moved); });
+            edit.apply(source, [&](std::vector<char> &image)
+                       { pageFormat_->erase(image, slotId); return true; });
+        }
+        if (!pointed)
+        {
+            return false;
+        }
+    }
+    edit.apply(source, [&](std::vector<char> &image)
+               { pageFormat_->compact(image); return true; });
+
+    uint64_t lsn = edit.stage(0, 0);
+    recordRows(into, moving);
+    edit.finish(lsn);
+    return true;
+}
+
+void PageManager::startVacuum(uint32_t intervalMs)
+{
+    if (intervalMs == 0)
+    {
+        throw std::invalid_argument("Vacuum needs an interval");
+    }
+    stopVacuum();
+    {
+        std::lock_guard<std::mutex> lock(vacuumMutex_);
+        stopVacuum_ = false;
+    }
+    vacuumThread_ = std::thread(&PageManager::vacuumLoop, this, intervalMs);
+}
+
+void PageManager::stopVacuum()
+{
+    {
+        std::lock_guard<std::mutex> lock(vacuumMutex_);
+        stopVacuum_ = true;
+    }
+    vacuumWake_.notify_all();
+    if (vacuumThread_.joinable())
+    {
+        vacuumThread_.join();
+    }
+}
+
+void PageManager::vacuumLoop(uint32_t intervalMs)
+{
+    std::unique_lock<std::mutex> lock(vacuumMutex_);
+    std::chrono::milliseconds interval(intervalMs);
+    while (!vacuumWake_.wait_for(lock, interval, [this]
+                                 { return stopVacuum_; }))
+    {
+        lock.unlock();
+        try
+        {
+            vacuum();
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(logger_, "Vacuum of table " + tableName_ + " failed: " + e.what());
+        }
+        lock.lock();
+    }
+}
+
+std::shared_lock<std::shared_mutex> PageManager::holdOffCheckpoint()
+{
+    std::lock_guard<std::mutex> turnstile(checkpointTurnstile_);
+    return std::shared_lock<std::shared_mutex>(checkpointLatch_);
+}
+
+void PageManager::checkpointIfDue()
+{
+    if (wal_.getSize() >= CHECKPOINT_LOG_BYTES)
+    {
+        // The first writer to notice checkpoints; the others carry on.
+        std::unique_lock<std::mutex> checkpointing(checkpointMutex_, std::try_to_lock);
+        if (checkpointing.owns_lock())
+        {
+            runCheckpoint();
+        }
+    }
+}
+
+uint64_t PageManager::logPages(WalRecordType type, uint32_t firstRowId, uint32_t numRows, const std::vector<PageDirectoryEntry> &entries,
+                               const std::vector<std::vector<char>> &pages)
+{
+    WalInsertHeader header{firstRowId, numRows, static_cast<uint32_t>(entries.size()), 0};
+    std::vector<char> payload(sizeof(header) + entries.size() * (sizeof(PageDirectoryEntry) + pageSize_));
+    char *cursor = payload.data();
+    std::memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        std::memcpy(cursor, &entries[i], sizeof(PageDirectoryEntry));
+        cursor += sizeof(PageDirectoryEntry);
+        std::memcpy(cursor, pages[i].data(), pageSize_);
+        cursor += pageSize_;
+    }
+    return wal_.append(type, payload);
+}
+
+bool PageManager::readPendingPage(uint32_t pageId, std::vector<char> &buffer)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    auto it = pendingPages_.find(pageId);
+    if (it == pendingPages_.end())
+    {
+        return false;
+    }
+    buffer = it->second.image;
+    return true;
+}
+
+void PageManager::stagePage(uint32_t pageId, uint64_t lsn, std::vector<char> image)
+{
+    std::lock_guard<std::mutex> lock(pendingMutex_);
+    pendingPages_[pageId] = PendingPage{lsn, std::move(image)};
+}
+
+void PageManager::writeStagedPage(uint32_t pageId, uint64_t lsn)
+{
+    std::unique_lock<std::shared_mutex> pageLatch(latches_.latch(pageId));
+    std::vector<char> image;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        auto pending = pendingPages_.find(pageId);
+        if (pending != pendingPages_.end() && pending->second.lsn == lsn)
+        {
+            image = std::move(pending->second.image);
+            pendingPages_.erase(pending);
+        }
+    }
+    PageDirectoryEntry entry{pageId, 0};
+    if (!image.empty() && !persistPage(image, entry))
+    {
+        throw std::runtime_error("Failed to persist updated page: page_id=" + std::to_string(pageId));
+    }
+}
+
+void PageManager::recover()
+{
+    // Records carry full page images, so only the newest image of every page
+    // needs to be redone.
+    struct PageRedo
+    {
+        uint64_t lsn;
+        PageDirectoryEntry entry;
+        std::vector<char> image;
+    };
+    std::unordered_map<uint32_t, PageRedo> redo;
+    uint32_t nextPageId = 0;
+    uint32_t nextRowId = 0;
+    int64_t addedRows = 0;
+    uint64_t directoryLsn = pageDirectory_.getCheckpointLsn();
+    wal_.recover([&](const WalRecord &record)
+                 {
+                     if (record.type != WalRecordType::INSERT && record.type != WalRecordType::MODIFY)
+                     {
+                         throw std::runtime_error("Unknown write-ahead log record type: " + std::to_string(static_cast<uint32_t>(record.type)));
+                     }
+                     WalInsertHeader header;
+                     std::memcpy(&header, record.payload.data(), sizeof(header));
+                     if (record.payload.size() != sizeof(header) + header.num_pages * (sizeof(PageDirectoryEntry) + pageSize_))
+                     {
+                         throw std::runtime_error("Malformed write-ahead log record at lsn " + std::to_string(record.lsn));
+                     }
+
+                     const char *cursor = record.payload.data() + sizeof(header);
+                     for (uint32_t i = 0; i < header.num_pages; i++)
+                     {
+                         PageRedo page;
+                         page.lsn = record.lsn;
+                         std::memcpy(&page.entry, cursor, sizeof(PageDirectoryEntry));
+                         cursor += sizeof(PageDirectoryEntry);
+                         page.image.assign(cursor, cursor + pageSize_);
+                         cursor += pageSize_;
+                         nextPageId = std::max<uint32_t>(nextPageId, page.entry.page_id + 1u);
+                         redo[page.entry.page_id] = std::move(page);
+                     }
+                     // The directory already counts the rows logged before it was written.
+                     if (record.type == WalRecordType::MODIFY)
+                     {
+                         if (record.lsn >= directoryLsn)
+                         {
+                             addedRows -= header.num_rows;
+                         }
+                         return;
+                     }
+                     nextRowId = std::max(nextRowId, header.first_row_id + header.num_rows);
+                     if (record.lsn >= directoryLsn)
+                     {
+                         addedRows += header.num_rows;
+                     } });
+
+    // Every page belongs to one thread, so the threads never touch the same page.
+    size_t numThreads = std::min<size_t>({std::max(1u, std::thread::hardware_concurrency()), MAX_REDO_THREADS, redo.size()});
+    std::vector<std::vector<PageRedo *>> partitions(numThreads);
+    for (auto &page : redo)
+    {
+        partitions[page.first % numThreads].push_back(&page.second);
+    }
+    size_t pageFileSize = storage_.fileExists(pageFilePath_) ? storage_.getSize(pageFilePath_) : 0;
+    std::atomic<size_t> skipped{0};
+    std::vector<std::exception_ptr> errors(numThreads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        workers.emplace_back([&, t]
+                             {
+                                 try
+                                 {
+                                     std::vector<char> current(pageSize_);
+                                     for (PageRedo *page : partitions[t])
+                                     {
+                                         size_t offset = static_cast<size_t>(page->entry.page_id) * pageSize_;
+                                         if (offset + pageSize_ <= pageFileSize)
+                                         {
+                                             storage_.readFile(pageFilePath_, current.data(), pageSize_, static_cast<std::streamoff>(offset));
+                                             // The LSN of a torn page cannot be trusted.
+                                             if (hasValidChecksum(current) && getPageLsn(current) >= page->lsn)
+                                             {
+                                                 skipped++;
+                                                 continue;
+                                             }
+                                         }
+                                         setPageLsn(page->image, page->lsn);
+                                         if (!persistPage(page->image, page->entry))
+                                         {
+                                             throw std::runtime_error("Failed to redo page: page_id=" + std::to_string(page->entry.page_id));
+                                         }
+                                     }
+                                 }
+                                 catch (...)
+                                 {
+                                     errors[t] = std::current_exception();
+                                 } });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    for (const auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    for (const auto &page : redo)
+    {
+        pageDirectory_.restoreEntry(page.second.entry);
+        recoveredPages_.push_back(page.first);
+    }
+    pageDirectory_.restoreCounters(nextPageId, nextRowId, addedRows);
+    std::sort(recoveredPages_.begin(), recoveredPages_.end());
+    if (!recoveredPages_.empty())
+    {
+        LOG_INFO(logger_, "Recovered " + std::to_string(recoveredPages_.size()) + " pages from the write-ahead log using " +
+                              std::to_string(numThreads) + " threads, " + std::to_string(skipped.load()) + " already up to date");
+    }
+}
+
+void PageManager::checkpoint()
+{
+    std::lock_guard<std::mutex> checkpointing(checkpointMutex_);
+    runCheckpoint();
+}
+
+void PageManager::runCheckpoint()
+{
+    if (!initialized_)
+    {
+        return;
+    }
+    if (!recoveredPages_.empty() && columns_.empty())
+    {
+        // The statistics of recovered pages cannot be rebuilt without the
+        // schema, so keep the log and replay it again on the next open.
+        return;
+    }
+
+    uint64_t redoLsn;
+    {
+        // With no insert in flight every logged page has been written to
+        // page.dat, if only to the OS cache, and the directory matches the log end.
+        std::lock_guard<std::mutex> turnstile(checkpointTurnstile_);
+        std::unique_lock<std::shared_mutex> guard(checkpointLatch_);
+        redoLsn = wal_.switchFile();
+        pageDirectory_.setCheckpointLsn(wal_.getEndLsn());
+        pageDirectory_.persistPageDirectory();
+    }
+
+    // Inserts go on into the new log file meanwhile. Statistics written now
+    // may already include some of their rows, which only makes them wider.
+    if (durability_ == DurabilityMode::FDATASYNC)
+    {
+        storage_.syncData(pageFilePath_);
+    }
+    else
+    {
+        storage_.syncFile(pageFilePath_);
+    }
+    persistStatistics();
+    syncMetadata();
+    wal_.checkpointed(redoLsn);
+    LOG_DEBUG(logger_, "Checkpoint completed for table: " + tableName_ + ", redo from lsn " + std::to_string(redoLsn));
+}
+
+void PageManager::setDurability(const DurabilityPolicy &policy)
+{
+    wal_.setDurability(policy);
+    durability_ = policy.mode;
+}
+
+void PageManager::setFillFactor(size_t percent)
+{
+    if (percent < MIN_FILL_FACTOR || percent > 100)
+    {
+        throw std::invalid_argument("Fill factor must be between " + std::to_string(MIN_FILL_FACTOR) +
+                                    " and 100 percent: " + std::to_string(percent));
+    }
+    fillFactor_ = percent;
+}
+
+size_t PageManager::fillReserve() const
+{
+    if (layout_ == PageLayout::COMPRESSED)
+    {
+        return 0;
+    }
+    return pageFormat_->emptyPageSpace() * (100 - fillFactor_) / 100;
+}
+
+PageManager::~PageManager()
+{
+    stopVacuum();
+    try
+    {
+        checkpoint();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(logger_, std::string("Checkpoint on close failed: ") + e.what());
+    }
+}
+
+void PageManager::persistStatistics()
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    zoneMap_.persist();
+    for (auto &bloom : bloomFilters_)
+    {
+        bloom.second->persist();
+    }
+}
+
+void PageManager::syncMetadata()
+{
+    pageDirectory_.sync();
+    overflow_.sync();
+    dictionary_.sync();
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    zoneMap_.sync();
+    for (auto &bloom : bloomFilters_)
+    {
+        bloom.second->sync();
+    }
+}
+
+PageManager::BulkWriter PageManager::bulkWriter()
+{
+    if (!initialize())
+    {
+        throw std::runtime_error("Failed to initialize table for bulk load: " + tableName_);
+    }
+    return BulkWriter(*this);
+}
+
+void PageManager::finishBulkLoad()
+{
+    // Bulk loaded pages bypass the log, so they only become durable here.
+    checkpoint();
+    LOG_INFO(logger_, "Bulk load completed. Directory persisted.");
+}
+
+PageManager::BulkWriter::~BulkWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(pageManager_.logger_, std::string("Bulk writer failed to finish: ") + e.what());
+    }
+}
+
+void PageManager::BulkWriter::add(const std::vector<char> &row)
+{
+    // Bulk loaded values become durable with the checkpoint ending the load.
+    std::vector<char> stored = row;
+    pageManager_.encodeStoredRow(stored);
+    size_t required = pageManager_.pageFormat_->requiredSpace(stored);
+    if (required > pageCapacity_)
+    {
+        throw std::runtime_error("Row of " + std::to_string(stored.size()) + " bytes does not fit in a page");
+    }
+    if (packed_ != nullptr)
+    {
+        // Row ids are only allocated when the page is sealed; their offsets
+        // within the page are what the encodings depend on.
+        if (!packed_->add(static_cast<uint32_t>(pending_.size()), stored))
+        {
+            sealPage();
+            packed_->add(0, stored);
+        }
+    }
+    else if (pendingSpace_ + required > fillCapacity_)
+    {
+        sealPage();
+    }
+    pending_.push_back(std::move(stored));
+    pendingSpace_ += required;
+}
+
+void PageManager::BulkWriter::sealPage()
+{
+    if (pending_.empty())
+    {
+        return;
+    }
+
+    IPageFormat &format = *pageManager_.pageFormat_;
+    PageDirectory &directory = pageManager_.pageDirectory_;
+    uint32_t firstRowId = directory.allocateRowIds(static_cast<uint32_t>(pending_.size()));
+    std::vector<Data> rows;
+    rows.reserve(pending_.size());
+    for (auto &bytes : pending_)
+    {
+        rows.push_back(Data{firstRowId + static_cast<uint32_t>(rows.size()), std::move(bytes)});
+    }
+    pending_.clear();
+    pendingSpace_ = 0;
+    if (packed_ != nullptr)
+    {
+        packed_->clear();
+    }
+
+    PageDirectoryEntry entry{directory.getAndIncrementNextPageId(), static_cast<uint32_t>(pageManager_.pageSize_)};
+    std::vector<char> page;
+    format.initPage(page);
+    auto results = format.insert(rows, page, entry);
+    entry.available_space = static_cast<uint32_t>(format.freeSpace(page));
+    if (!pageManager_.persistPage(page, entry))
+    {
+        throw std::runtime_error("Failed to persist bulk loaded page: page_id=" + std::to_string(entry.page_id));
+    }
+    pageManager_.recordRows(entry.page_id, rows);
+    directory.addRows(static_cast<uint32_t>(rows.size()));
+    inserted_.insert(inserted_.end(), results.begin(), results.end());
+
+    unpublished_.push_back(entry);
+    uncommitted_.emplace_back(firstRowId, static_cast<uint32_t>(rows.size()));
+    if (unpublished_.size() >= PUBLISH_BATCH)
+    {
+        publish();
+    }
+}
+
+void PageManager::BulkWriter::publish()
+{
+    PageDirectory &directory = pageManager_.pageDirectory_;
+    for (const auto &entry : unpublished_)
+    {
+        pageManager_.storage_.flushRange(pageManager_.pageFilePath_, static_cast<size_t>(entry.page_id) * pageManager_.pageSize_, pageManager_.pageSize_);
+    }
+    directory.publishPages(std::move(unpublished_));
+    unpublished_.clear();
+    for (const auto &range : uncommitted_)
+    {
+        directory.commitRows(range.first, range.second);
+    }
+    uncommitted_.clear();
+}
+
+void PageManager::BulkWriter::finish()
+{
+    if (finished_)
+    {
+        return;
+    }
+    finished_ = true;
+    sealPage();
+    publish();
+}
+
+bool PageManager::initialize()
+{
+    if (initialized_)
+    {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(initMutex_);
+    if (initialized_)
+    {
+        return true;
+    }
+    // Load the page directory.
+    bool success = pageDirectory_.initialize();
+    if (!success)
+    {
+        LOG_ERROR(logger_, "Failed to initialize page directory.");
+        return false;
+    }
+    if (!zoneMap_.initialize())
+    {
+        LOG_ERROR(logger_, "Failed to initialize zone map.");
+        return false;
+    }
+    // Create the page file up front so that concurrent first writes at different
+    // offsets all open an existing file instead of truncating each other.
+    if (!storage_.fileExists(pageFilePath_))
+    {
+        storage_.createFile(pageFilePath_);
+    }
+    overflow_.initialize();
+    dictionary_.initialize();
+    recover();
+    initialized_ = true;
+    return true;
+}
+
+bool PageManager::readPage(uint32_t pageId, std::vector<char> &buffer)
+{
+    if (!initialize())
+    {
+        return false;
+    }
+
+    buffer.assign(pageSize_, 0);
+    std::streampos offset = static_cast<std::streamoff>(pageId) * pageSize_;
+    std::shared_lock<std::shared_mutex> pageLatch(latches_.latch(pageId));
+    if (readPendingPage(pageId, buffer))
+    {
+        return true;
+    }
+    readAhead_.beforeRead(pageId);
+    auto start = std::chrono::steady_clock::now();
+    if (!storage_.readFile(pageFilePath_, buffer.data(), pageSize_, offset))
+    {
+        LOG_ERROR(logger_, "Failed to read page: page_id=" + std::to_string(pageId));
+        return false;
+    }
+    readAhead_.afterRead(pageId, std::chrono::steady_clock::now() - start);
+    if (!hasValidChecksum(buffer))
+    {
+        LOG_ERROR(logger_, "Page checksum mismatch: page_id=" + std::to_string(pageId));
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint32_t> PageManager::getPageIds()
+{
+    std::vector<uint32_t> pageIds;
+    if (!initialize())
+    {
+        return pageIds;
+    }
+    PageIdView ids = pageDirectory_.snapshot().pageIds;
+    return std::vector<uint32_t>(ids.begin(), ids.end());
+}
+
+DirectorySnapshot PageManager::snapshot()
+{
+    initialize();
+    return pageDirectory_.snapshot();
+}
+
+std::vector<ReturnType> PageManager::readRows(uint32_t pageId, const DirectorySnapshot &snapshot)
+{
+    std::vector<ReturnType> rows = readRows(pageId);
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [&snapshot](const ReturnType &row)
+                              { return !snapshot.isVisible(row.data.id); }),
+               rows.end());
+    return rows;
+}
+
+std::vector<ReturnType> PageManager::readRows(uint32_t pageId)
+{
+    std::vector<char> buffer;
+    if (!readPage(pageId, buffer))
+    {
+        throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+    }
+    std::vector<ReturnType> rows = pageFormat_->readRows(buffer, pageId);
+    resolveMovedRows(buffer, rows);
+    for (auto &row : rows)
+    {
+        decodeStoredRow(row.data.data);
+    }
+    return rows;
+}
+
+void PageManager::resolveMovedRows(const std::vector<char> &page, std::vector<ReturnType> &rows)
+{
+    if (layout_ != PageLayout::SLOTTED)
+    {
+        return;
+    }
+    Location forward{};
+    for (auto &stored : rows)
+    {
+        if (pageFormat_->slotState(page, stored.location.slot_id, forward) == SlotState::MOVED &&
+            !locateRow(stored.data.id, stored.location))
+        {
+            throw std::runtime_error("Moved row without a home slot: row_id=" + std::to_string(stored.data.id));
+        }
+    }
+}
+
+bool PageManager::readRow(const Location &location, Data &row)
+{
+    if (!readStoredRow(location, row))
+    {
+        return false;
+    }
+    decodeStoredRow(row.data);
+    return true;
+}
+
+bool PageManager::readStoredRow(const Location &location, Data &row)
+{
+    std::vector<char> buffer;
+    if (!readPage(location.page_id, buffer))
+    {
+        return false;
+    }
+    Location forward{};
+    switch (pageFormat_->slotState(buffer, location.slot_id, forward))
+    {
+    case SlotState::FREE:
+        return false;
+    case SlotState::FORWARDED:
+        // Moved rows are never forwarded again, so this is a single hop.
+        return readStoredRow(forward, row);
+    default:
+        row = pageFormat_->read(buffer, location.slot_id);
+        return true;
+    }
+}
+
+void PageManager::setPageSize(size_t pageSize)
+{
+    if (!isValidPageSize(pageSize))
+    {
+        throw std::invalid_argument("Invalid page size: " + std::to_string(pageSize));
+    }
+    if (pageSize == pageSize_)
+    {
+        return;
+    }
+    if (initialized_ && !pageDirectory_.getAllEntries().empty())
+    {
+        throw std::runtime_error("Cannot change the page size of a table with pages: " + tableName_);
+    }
+    pageSize_ = pageSize;
+    slottedPage_.setPageSize(pageSize);
+    paxPage_.setPageSize(pageSize);
+    compressedPage_.setPageSize(pageSize);
+    readAhead_.setPageSize(pageSize);
+}
+
+void PageManager::setSchema(const std::vector<Column> &columns, PageLayout layout)
+{
+    columns_ = columns;
+    hasCategorical_ = false;
+    for (Column &column : columns_)
+    {
+        // PAX and compressed pages keep every value inline.
+        column.categorical = column.categorical && column.type == DataType::TEXT && layout == PageLayout::SLOTTED;
+        hasCategorical_ = hasCategorical_ || column.categorical;
+    }
+    zoneMap_.setSchema(columns);
+    paxPage_.setSchema(columns);
+    compressedPage_.setSchema(columns);
+    switch (layout)
+    {
+    case PageLayout::PAX:
+        pageFormat_ = &paxPage_;
+        break;
+    case PageLayout::COMPRESSED:
+        pageFormat_ = &compressedPage_;
+        break;
+    default:
+        pageFormat_ = &slottedPage_;
+        break;
+    }
+    layout_ = layout;
+
+    // Zone extents only grow, so re-extending with every row of a recovered
+    // page makes it cover the replayed rows whatever the zone map file held.
+    if (!columns_.empty())
+    {
+        for (uint32_t pageId : recoveredPages_)
+        {
+            std::vector<char> buffer;
+            if (!readPage(pageId, buffer))
+            {
+                throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+            }
+            // recordRows takes rows as they are stored.
+            std::vector<Data> rows;
+            for (auto &stored : pageFormat_->readRows(buffer, pageId))
+            {
+                rows.push_back(std::move(stored.data));
+            }
+            recordRows(pageId, rows);
+            // The home slot of a moved row stays here, and locateRow finds
+            // it through the row id zone.
+            for (uint32_t rowId : pageFormat_->rowIds(buffer))
+            {
+                zoneMap_.extendRowId(pageId, rowId);
+            }
+        }
+    }
+}
+
+std::vector<ReturnType> PageManager::readMatchingRows(uint32_t pageId, size_t columnIndex,
+                                                      const std::function<bool(const Row::Value &)> &predicate,
+                                                      const DirectorySnapshot *snapshot)
+{
+    std::vector<char> buffer;
+    if (!readPage(pageId, buffer))
+    {
+        throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+    }
+
+    std::vector<ReturnType> results;
+    if (layout_ != PageLayout::SLOTTED)
+    {
+        // Evaluate the predicate on the column alone and only rebuild matching rows.
+        std::vector<Row::Value> values = layout_ == PageLayout::PAX ? paxPage_.readColumn(buffer, columnIndex)
+                                                                    : compressedPage_.readColumn(buffer, columnIndex);
+        for (size_t slot = 0; slot < values.size(); slot++)
+        {
+            if (predicate(values[slot]))
+            {
+                ReturnType ret;
+                ret.data = pageFormat_->read(buffer, static_cast<uint16_t>(slot));
+                ret.location = {pageId, static_cast<uint16_t>(slot)};
+                if (snapshot == nullptr || snapshot->isVisible(ret.data.id))
+                {
+                    results.push_back(std::move(ret));
+                }
+            }
+        }
+        return results;
+    }
+
+    for (auto &stored : slottedPage_.readRows(buffer, pageId))
+    {
+        if (snapshot != nullptr && !snapshot->isVisible(stored.data.id))
+        {
+            continue;
+        }
+        decodeStoredRow(stored.data.data);
+        Row row = Row::deserialize(columns_, stored.data.data.data(), stored.data.data.size());
+        if (predicate(row.getValue(columnIndex)))
+        {
+            results.push_back(std::move(stored));
+        }
+    }
+    resolveMovedRows(buffer, results);
+    return results;
+}
+
+std::vector<ReturnType> PageManager::readRowsWithCode(uint32_t pageId, size_t columnIndex, uint32_t code,
+                                                      const DirectorySnapshot *snapshot)
+{
+    std::vector<char> buffer;
+    if (!readPage(pageId, buffer))
+    {
+        throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+    }
+
+    std::vector<ReturnType> results;
+    for (auto &stored : slottedPage_.readRows(buffer, pageId))
+    {
+        if ((snapshot != nullptr && !snapshot->isVisible(stored.data.id)) ||
+            TextDictionary::codeAt(columns_, stored.data.data, columnIndex) != code)
+        {
+            continue;
+        }
+        decodeStoredRow(stored.data.data);
+        results.push_back(std::move(stored));
+    }
+    resolveMovedRows(buffer, results);
+    return results;
+}
+
+void PageManager::countCodes(uint32_t pageId, size_t columnIndex, std::vector<uint64_t> &counts,
+                             const DirectorySnapshot *snapshot)
+{
+    std::vector<char> buffer;
+    if (!readPage(pageId, buffer))
+    {
+        throw std::runtime_error("Failed to read page: page_id=" + std::to_string(pageId));
+    }
+
+    for (const auto &stored : slottedPage_.readRows(buffer, pageId))
+    {
+        if (snapshot != nullptr && !snapshot->isVisible(stored.data.id))
+        {
+            continue;
+        }
+        uint32_t code = TextDictionary::codeAt(columns_, stored.data.data, columnIndex);
+        if (code >= counts.size())
+        {
+            counts.resize(code + 1);
+        }
+        counts[code]++;
+    }
+}
+
+bool PageManager::encodeStoredRow(std::vector<char> &row)
+{
+    // PAX and compressed pages rebuild rows from their columns and have no
+    // room for references.
+    if (layout_ != PageLayout::SLOTTED || columns_.empty())
+    {
+        return false;
+    }
+    bool unsynced = hasCategorical_ && dictionary_.encodeRow(columns_, row);
+    return overflow_.storeLargeValues(columns_, row, pageSize_ / INLINE_ROW_DIVISOR) || unsynced;
+}
+
+void PageManager::decodeStoredRow(std::vector<char> &row)
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+    std::vector<char> loaded;
+    if (overflow_.loadLargeValues(columns_, row, loaded))
+    {
+        row.swap(loaded);
+    }
+    if (hasCategorical_)
+    {
+        dictionary_.decodeRow(columns_, row);
+    }
+}
+
+Row PageManager::decodeRow(const std::vector<char> &row)
+{
+    if (hasCategorical_)
+    {
+        std::vector<char> decoded = row;
+        decodeStoredRow(decoded);
+        return Row::deserialize(columns_, decoded.data(), decoded.size());
+    }
+    std::vector<char> loaded;
+    if (!columns_.empty() && overflow_.loadLargeValues(columns_, row, loaded))
+    {
+        return Row::deserialize(columns_, loaded.data(), loaded.size());
+    }
+    return Row::deserialize(columns_, row.data(), row.size());
+}
+
+void PageManager::syncStoredValues()
+{
+    // Without syncs on commit the next checkpoint takes care of them.
+    if (durability_ != DurabilityMode::NONE)
+    {
+        overflow_.sync();
+        dictionary_.sync();
+    }
+}
+
+bool PageManager::openValue(uint32_t rowId, size_t columnIndex, ValueReader &reader)
+{
+    if (!initialize())
+    {
+        return false;
+    }
+    if (columnIndex >= columns_.size())
+    {
+        throw std::out_of_range("Column index out of range: " + std::to_string(columnIndex));
+    }
+    Location home{};
+    Data row;
+    if (!locateRow(rowId, home) || !readStoredRow(home, row))
+    {
+        return false;
+    }
+    if (columns_[columnIndex].categorical)
+    {
+        reader = ValueReader(dictionary_.value(TextDictionary::codeAt(columns_, row.data, columnIndex)));
+        return true;
+    }
+    reader = overflow_.openValue(columns_, row.data, columnIndex);
+    return true;
+}
+
+void PageManager::recordRow(uint32_t pageId, const Data &row)
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+    Row decoded = decodeRow(row.data);
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    zoneMap_.extend(pageId, row.id, decoded);
+    for (auto &bloom : bloomFilters_)
+    {
+        size_t columnIndex = bloom.first;
+        bloom.second->add(pageId, PageBloomFilters::hashValue(decoded.getValue(columnIndex), columns_[columnIndex].type));
+    }
+}
+
+void PageManager::recordRows(uint32_t pageId, const std::vector<Data> &rows)
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+    std::vector<Row> decoded;
+    decoded.reserve(rows.size());
+    for (const auto &row : rows)
+    {
+        decoded.push_back(decodeRow(row.data));
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    for (size_t i = 0; i < decoded.size(); i++)
+    {
+        const Row &row = decoded[i];
+        zoneMap_.extend(pageId, rows[i].id, row);
+        for (auto &bloom : bloomFilters_)
+        {
+            size_t columnIndex = bloom.first;
+            bloom.second->add(pageId, PageBloomFilters::hashValue(row.getValue(columnIndex), columns_[columnIndex].type));
+        }
+    }
+}
+
+bool PageManager::enableBloomFilter(const std::string &columnName)
+{
+    if (!initialize())
+    {
+        return false;
+    }
+
+    size_t columnIndex = columns_.size();
+    for (size_t i = 0; i < columns_.size(); i++)
+    {
+        if (columns_[i].name == columnName)
+        {
+            columnIndex = i;
+        }
+    }
+    if (columnIndex == columns_.size())
+    {
+        LOG_WARN(logger_, "Cannot create bloom filter on unknown column: " + columnName);
+        return false;
+    }
+    if (hasBloomFilter(columnIndex))
+    {
+        return true;
+    }
+
+    auto bloom = std::make_unique<PageBloomFilters>(tableName_, columnName, storage_, pageSize_, logger_);
+    bool existed = bloom->exists();
+    bloom->initialize();
+    uint32_t blocksPerPage = PageBloomFilters::blocksForPageSize(pageSize_);
+    if (existed && bloom->getBlocksPerPage() != blocksPerPage)
+    {
+        LOG_INFO(logger_, "Resizing bloom filter on column " + columnName + " to " + std::to_string(blocksPerPage) + " blocks per page");
+        bloom->reset(blocksPerPage);
+        existed = false;
+    }
+    if (!existed)
+    {
+        // Build the filter for the pages written before it existed.
+        LOG_INFO(logger_, "Building bloom filter on column: " + columnName);
+        for (const auto &entry : pageDirectory_.getAllEntries())
+        {
+            addToBloomFilter(*bloom, columnIndex, entry.page_id);
+        }
+        bloom->persist();
+    }
+    else
+    {
+        for (uint32_t pageId : recoveredPages_)
+        {
+            addToBloomFilter(*bloom, columnIndex, pageId);
+        }
+    }
+    bloomFilters_.emplace_back(columnIndex, std::move(bloom));
+    return true;
+}
+
+void PageManager::addToBloomFilter(PageBloomFilters &bloom, size_t columnIndex, uint32_t pageId)
+{
+    for (const auto &stored : readRows(pageId))
+    {
+        Row decoded = Row::deserialize(columns_, stored.data.data.data(), stored.data.data.size());
+        bloom.add(pageId, PageBloomFilters::hashValue(decoded.getValue(columnIndex), columns_[columnIndex].type));
+    }
+}
+
+bool PageManager::hasBloomFilter(size_t columnIndex)
+{
+    for (const auto &bloom : bloomFilters_)
+    {
+        if (bloom.first == columnIndex)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PageManager::bloomMayContain(uint32_t pageId, size_t columnIndex, const Row::Value &value)
+{
+    for (const auto &bloom : bloomFilters_)
+    {
+        if (bloom.first == columnIndex)
+        {
+            return bloom.second->mayContain(pageId, PageBloomFilters::hashValue(value, columns_[columnIndex].type));
+        }
+    }
     return true;
 }
 
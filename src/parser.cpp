@@ -47,7 +47,7 @@ DataObject Parser::parseFile(const std::string &filename, char delimiter, const
         std::vector<std::string> fields = split(line, delimiter);
         if (fields.size() != columns.size())
         {
-            logger_.log("Data row has unexpected number of columns: " + line);
+            LOG_WARN(logger_, "Data row has unexpected number of columns: " + line);
             continue;
         }
 
@@ -62,7 +62,7 @@ DataObject Parser::parseFile(const std::string &filename, char delimiter, const
             }
             catch (const std::exception &e)
             {
-                logger_.log("Failed to convert value at row " + std::to_string(allRows.size()) + ", column " + std::to_string(i) + ": " + e.what());
+                LOG_WARN(logger_, "Failed to convert value at row " + std::to_string(allRows.size()) + ", column " + std::to_string(i) + ": " + e.what());
                 continue;
             }
         }
@@ -77,7 +77,7 @@ DataObject Parser::parseFile(const std::string &filename, char delimiter, const
         }
         catch (const std::exception &e)
         {
-            logger_.log("Failed to serialize row " + std::to_string(allRows.size()) + ": " + e.what());
+            LOG_WARN(logger_, "Failed to serialize row " + std::to_string(allRows.size()) + ": " + e.what());
             continue;
         }
     }
@@ -88,3 +88,20 @@ DataObject Parser::parseFile(const std::string &filename, char delimiter, const
     data.numRows = numRows;
     return data;
 };
+
+std::vector<std::string> Parser::split(const std::string &s, char delimiter)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream tokenStream(s);
+    while (std::getline(tokenStream, token, delimiter))
+    {
+        // strip a trailing carriage return from files with CRLF line endings
+        if (!token.empty() && token.back() == '\r')
+        {
+            token.pop_back();
+        }
+        tokens.push_back(token);
+    }
+    return tokens;
+}
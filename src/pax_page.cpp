@@ -0,0 +1,343 @@
+#include "pax_page.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // Every mini-page entry is 4 bytes wide: int32, float, YYYYMMDD date or PaxTextEntry.
+    constexpr size_t ENTRY_WIDTH = 4;
+
+    PaxPageHeader readHeader(const std::vector<char> &page)
+    {
+        PaxPageHeader header;
+        std::memcpy(&header, page.data(), sizeof(PaxPageHeader));
+        return header;
+    }
+
+    size_t rowIdsOffset(uint16_t numColumns)
+    {
+        return sizeof(PaxPageHeader) + numColumns * sizeof(uint16_t);
+    }
+}
+
+size_t PaxPage::fixedRowWidth() const
+{
+    // Row id plus one entry per column.
+    return sizeof(uint32_t) + columns_.size() * ENTRY_WIDTH;
+}
+
+size_t PaxPage::columnOffset(const std::vector<char> &page, size_t columnIndex) const
+{
+    uint16_t offset;
+    std::memcpy(&offset, page.data() + sizeof(PaxPageHeader) + columnIndex * sizeof(uint16_t), sizeof(uint16_t));
+    return offset;
+}
+
+void PaxPage::initPage(std::vector<char> &page)
+{
+    page.assign(pageSize_, 0);
+    PaxPageHeader header{0, 0, 0, static_cast<uint16_t>(columns_.size()), static_cast<uint32_t>(pageSize_), 0};
+    std::memcpy(page.data(), &header, sizeof(PaxPageHeader));
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        uint16_t offset = static_cast<uint16_t>(rowIdsOffset(header.numColumns));
+        std::memcpy(page.data() + sizeof(PaxPageHeader) + c * sizeof(uint16_t), &offset, sizeof(uint16_t));
+    }
+}
+
+size_t PaxPage::emptyPageSpace()
+{
+    return pageSize_ - rowIdsOffset(static_cast<uint16_t>(columns_.size()));
+}
+
+size_t PaxPage::requiredSpace(const std::vector<char> &row)
+{
+    size_t required = fixedRowWidth();
+    Row decoded = Row::deserialize(columns_, row.data(), row.size());
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        if (columns_[c].type == DataType::TEXT)
+        {
+            required += decoded.getText(c).size();
+        }
+    }
+    return required;
+}
+
+size_t PaxPage::freeSpace(const std::vector<char> &page)
+{
+    PaxPageHeader header = readHeader(page);
+    size_t fixedEnd = rowIdsOffset(header.numColumns) + header.numRows * fixedRowWidth();
+    if (fixedEnd < header.heapOffset)
+    {
+        return header.heapOffset - fixedEnd;
+    }
+    return 0;
+}
+
+void PaxPage::build(const std::vector<uint32_t> &ids, const std::vector<Row> &rows, std::vector<char> &page)
+{
+    const uint16_t numColumns = static_cast<uint16_t>(columns_.size());
+    const size_t numRows = rows.size();
+    std::vector<char> out(pageSize_, 0);
+
+    // 1) Row ids, then one mini-page per column.
+    size_t cursor = rowIdsOffset(numColumns);
+    if (numRows > 0)
+    {
+        std::memcpy(out.data() + cursor, ids.data(), numRows * sizeof(uint32_t));
+    }
+    cursor += numRows * sizeof(uint32_t);
+
+    std::vector<uint16_t> offsets(numColumns);
+    for (uint16_t c = 0; c < numColumns; c++)
+    {
+        offsets[c] = static_cast<uint16_t>(cursor);
+        cursor += numRows * ENTRY_WIDTH;
+    }
+    for (uint16_t c = 0; c < numColumns; c++)
+    {
+        std::memcpy(out.data() + sizeof(PaxPageHeader) + c * sizeof(uint16_t), &offsets[c], sizeof(uint16_t));
+    }
+
+    // 2) Fill the mini-pages; TEXT bytes go to the heap at the end of the page.
+    size_t heapOffset = pageSize_;
+    for (uint16_t c = 0; c < numColumns; c++)
+    {
+        char *miniPage = out.data() + offsets[c];
+        for (size_t r = 0; r < numRows; r++)
+        {
+            const Row::Value &value = rows[r].getValue(c);
+            switch (columns_[c].type)
+            {
+            case DataType::INT:
+            {
+                int32_t v = std::get<int32_t>(value);
+                std::memcpy(miniPage + r * ENTRY_WIDTH, &v, ENTRY_WIDTH);
+                break;
+            }
+            case DataType::FLOAT:
+            {
+                float v = std::get<float>(value);
+                std::memcpy(miniPage + r * ENTRY_WIDTH, &v, ENTRY_WIDTH);
+                break;
+            }
+            case DataType::DATE:
+            {
+                int32_t v = Row::dateToKey(std::get<std::string>(value));
+                std::memcpy(miniPage + r * ENTRY_WIDTH, &v, ENTRY_WIDTH);
+                break;
+            }
+            case DataType::TEXT:
+            {
+                const auto &text = std::get<std::string>(value);
+                if (text.size() > heapOffset || heapOffset - text.size() < cursor)
+                {
+                    throw std::runtime_error("Not enough space for new row in PAX page.");
+                }
+                heapOffset -= text.size();
+                std::memcpy(out.data() + heapOffset, text.data(), text.size());
+                PaxTextEntry entry{static_cast<uint16_t>(heapOffset), static_cast<uint16_t>(text.size())};
+                std::memcpy(miniPage + r * ENTRY_WIDTH, &entry, ENTRY_WIDTH);
+                break;
+            }
+            default:
+                throw std::runtime_error("Unsupported data type in schema");
+            }
+        }
+    }
+
+    if (cursor > heapOffset)
+    {
+        throw std::runtime_error("Not enough space for new row in PAX page.");
+    }
+
+    PaxPageHeader header{getPageLsn(page), 0, static_cast<uint16_t>(numRows), numColumns, static_cast<uint32_t>(heapOffset), 0};
+    std::memcpy(out.data(), &header, sizeof(PaxPageHeader));
+    page.swap(out);
+}
+
+std::vector<ReturnType> PaxPage::insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry)
+{
+    // Decode what is already on the page, append the new rows and rebuild.
+    PaxPageHeader header = readHeader(page);
+    std::vector<uint32_t> ids(header.numRows);
+    for (uint16_t r = 0; r < header.numRows; r++)
+    {
+        std::memcpy(&ids[r], page.data() + rowIdsOffset(header.numColumns) + r * sizeof(uint32_t), sizeof(uint32_t));
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(header.numRows + serializedData.size());
+    for (uint16_t r = 0; r < header.numRows; r++)
+    {
+        std::vector<char> bytes = encodeRow(page, r);
+        rows.push_back(Row::deserialize(columns_, bytes.data(), bytes.size()));
+    }
+
+    std::vector<ReturnType> results;
+    results.reserve(serializedData.size());
+    for (auto &d : serializedData)
+    {
+        rows.push_back(Row::deserialize(columns_, d.data.data(), d.data.size()));
+        ids.push_back(d.id);
+
+        ReturnType ret;
+        ret.data.id = d.id;
+        ret.location.page_id = entry.page_id;
+        ret.location.slot_id = static_cast<uint16_t>(rows.size() - 1);
+        results.push_back(ret);
+    }
+
+    build(ids, rows, page);
+    return results;
+}
+
+bool PaxPage::verifyPage(std::vector<char> &buffer)
+{
+    if (buffer.size() != pageSize_)
+    {
+        throw std::runtime_error("Invalid page buffer: must be " + std::to_string(pageSize_) + " bytes.");
+    }
+
+    PaxPageHeader header = readHeader(buffer);
+    if (header.numColumns != columns_.size())
+    {
+        throw std::runtime_error("Corrupt PAX page header: numColumns " + std::to_string(header.numColumns) +
+                                 " does not match schema (" + std::to_string(columns_.size()) + ").");
+    }
+    if (header.heapOffset > pageSize_)
+    {
+        throw std::runtime_error("Corrupt PAX page header: heapOffset is beyond the page size.");
+    }
+    size_t fixedEnd = rowIdsOffset(header.numColumns) + header.numRows * fixedRowWidth();
+    if (fixedEnd > header.heapOffset)
+    {
+        throw std::runtime_error("Invalid PAX header: mini-pages (end at " + std::to_string(fixedEnd) +
+                                 ") overlap the heap (heapOffset " + std::to_string(header.heapOffset) + ").");
+    }
+    return true;
+}
+
+std::vector<char> PaxPage::encodeRow(const std::vector<char> &page, uint16_t slotId) const
+{
+    // Gather one entry from every mini-page back into the row-serialized format.
+    std::vector<char> bytes;
+    for (size_t c = 0; c < columns_.size(); c++)
+    {
+        const char *entry = page.data() + columnOffset(page, c) + slotId * ENTRY_WIDTH;
+        switch (columns_[c].type)
+        {
+        case DataType::INT:
+        case DataType::FLOAT:
+            bytes.insert(bytes.end(), entry, entry + ENTRY_WIDTH);
+            break;
+        case DataType::DATE:
+        {
+            int32_t key;
+            std::memcpy(&key, entry, sizeof(int32_t));
+            std::string date = Row::keyToDate(key);
+            uint16_t length = static_cast<uint16_t>(date.size());
+            const char *lenPtr = reinterpret_cast<const char *>(&length);
+            bytes.insert(bytes.end(), lenPtr, lenPtr + sizeof(uint16_t));
+            bytes.insert(bytes.end(), date.begin(), date.end());
+            break;
+        }
+        case DataType::TEXT:
+        {
+            PaxTextEntry text;
+            std::memcpy(&text, entry, sizeof(PaxTextEntry));
+            const char *lenPtr = reinterpret_cast<const char *>(&text.length);
+            bytes.insert(bytes.end(), lenPtr, lenPtr + sizeof(uint16_t));
+            bytes.insert(bytes.end(), page.data() + text.offset, page.data() + text.offset + text.length);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported data type in schema");
+        }
+    }
+    return bytes;
+}
+
+std::vector<ReturnType> PaxPage::readRows(const std::vector<char> &page, uint32_t pageId)
+{
+    PaxPageHeader header = readHeader(page);
+    std::vector<ReturnType> results;
+    results.reserve(header.numRows);
+    for (uint16_t r = 0; r < header.numRows; r++)
+    {
+        ReturnType ret;
+        ret.data = read(page, r);
+        ret.location.page_id = pageId;
+        ret.location.slot_id = r;
+        results.push_back(std::move(ret));
+    }
+    return results;
+}
+
+Data PaxPage::read(const std::vector<char> &page, uint16_t slotId)
+{
+    PaxPageHeader header = readHeader(page);
+    if (slotId >= header.numRows)
+    {
+        throw std::runtime_error("Slot id " + std::to_string(slotId) + " out of range (numRows=" +
+                                 std::to_string(header.numRows) + ")");
+    }
+
+    Data result;
+    std::memcpy(&result.id, page.data() + rowIdsOffset(header.numColumns) + slotId * sizeof(uint32_t), sizeof(uint32_t));
+    result.data = encodeRow(page, slotId);
+    return result;
+}
+
+std::vector<Row::Value> PaxPage::readColumn(const std::vector<char> &page, size_t columnIndex)
+{
+    PaxPageHeader header = readHeader(page);
+    if (columnIndex >= header.numColumns)
+    {
+        throw std::out_of_range("Column index out of range in PAX page");
+    }
+
+    std::vector<Row::Value> values;
+    values.reserve(header.numRows);
+    const char *miniPage = page.data() + columnOffset(page, columnIndex);
+    for (uint16_t r = 0; r < header.numRows; r++)
+    {
+        const char *entry = miniPage + r * ENTRY_WIDTH;
+        switch (columns_[columnIndex].type)
+        {
+        case DataType::INT:
+        {
+            int32_t v;
+            std::memcpy(&v, entry, sizeof(int32_t));
+            values.emplace_back(v);
+            break;
+        }
+        case DataType::FLOAT:
+        {
+            float v;
+            std::memcpy(&v, entry, sizeof(float));
+            values.emplace_back(v);
+            break;
+        }
+        case DataType::DATE:
+        {
+            int32_t key;
+            std::memcpy(&key, entry, sizeof(int32_t));
+            values.emplace_back(Row::keyToDate(key));
+            break;
+        }
+        case DataType::TEXT:
+        {
+            PaxTextEntry text;
+            std::memcpy(&text, entry, sizeof(PaxTextEntry));
+            values.emplace_back(std::string(page.data() + text.offset, text.length));
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported data type in schema");
+        }
+    }
+    return values;
+}
@@ -0,0 +1,63 @@
+#include "read_ahead.h"
+
+#include <algorithm>
+
+uint32_t ReadAhead::maxWindow() const
+{
+    return static_cast<uint32_t>(std::max<size_t>(MAX_WINDOW_BYTES / pageSize_, MIN_WINDOW));
+}
+
+void ReadAhead::beforeRead(uint32_t pageId)
+{
+    uint32_t from;
+    uint32_t to;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        clock_++;
+        auto stream = std::find_if(streams_.begin(), streams_.end(), [pageId](const Stream &s)
+                                   { return s.run > 0 && s.next == pageId; });
+        if (stream == streams_.end())
+        {
+            // A new stream replaces the one used longest ago.
+            stream = std::min_element(streams_.begin(), streams_.end(), [](const Stream &a, const Stream &b)
+                                      { return a.lastUse < b.lastUse; });
+            *stream = Stream{};
+            stream->next = pageId + 1;
+            stream->requestedTo = pageId + 1;
+            stream->run = 1;
+            stream->lastUse = clock_;
+            return;
+        }
+
+        stream->next = pageId + 1;
+        stream->run++;
+        stream->lastUse = clock_;
+        stream->requestedTo = std::max(stream->requestedTo, pageId + 1);
+        if (stream->requestedTo - pageId > stream->window / 2)
+        {
+            return;
+        }
+        from = stream->requestedTo;
+        to = pageId + 1 + stream->window;
+        stream->requestedTo = to;
+    }
+    storage_.prefetch(filename_, static_cast<size_t>(from) * pageSize_, static_cast<size_t>(to - from) * pageSize_);
+}
+
+void ReadAhead::afterRead(uint32_t pageId, std::chrono::nanoseconds latency)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    fastest_ = std::min(fastest_, latency);
+    for (auto &stream : streams_)
+    {
+        // Only pages the stream read ahead tell whether the window is too small.
+        if (stream.run > 2 && stream.next == pageId + 1 && pageId < stream.requestedTo)
+        {
+            if (latency > fastest_ * SLOW_READ_FACTOR)
+            {
+                stream.window = std::min(stream.window * 2, maxWindow());
+            }
+            return;
+        }
+    }
+}
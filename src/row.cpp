@@ -1,4 +1,7 @@
 #include "row.h"
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
 
 Row::Row(const std::vector<Column> &row, const std::vector<Value> &typedData) : schema_(row), values_(typedData)
 {
@@ -161,8 +164,18 @@ std::vector<char> Row::serialize() const
         {
             // Using const auto &value just gives a constant reference to the string, so we don’t create a new copy.
             const auto &value = std::get<std::string>(values_[i]);
-            uint16_t length = value.size();
-            buffer.insert(buffer.end(), reinterpret_cast<char *>(&length), reinterpret_cast<char *>(&length) + sizeof(uint16_t));
+            if (value.size() >= OVERFLOW_TEXT)
+            {
+                uint16_t escape = LONG_TEXT;
+                uint32_t length = static_cast<uint32_t>(value.size());
+                buffer.insert(buffer.end(), reinterpret_cast<char *>(&escape), reinterpret_cast<char *>(&escape) + sizeof(uint16_t));
+                buffer.insert(buffer.end(), reinterpret_cast<char *>(&length), reinterpret_cast<char *>(&length) + sizeof(uint32_t));
+            }
+            else
+            {
+                uint16_t length = static_cast<uint16_t>(value.size());
+                buffer.insert(buffer.end(), reinterpret_cast<char *>(&length), reinterpret_cast<char *>(&length) + sizeof(uint16_t));
+            }
             buffer.insert(buffer.end(), value.begin(), value.end());
             break;
         }
@@ -203,8 +216,16 @@ size_t Row::getSerializedSize() const
         }
         case DataType::TEXT:
         {
-            std::string value = std::get<std::string>(values_[i]);
+            const auto &value = std::get<std::string>(values_[i]);
+            if (value.size() > UINT32_MAX)
+            {
+                throw std::runtime_error("TEXT value of " + std::to_string(value.size()) + " bytes at index " + std::to_string(i) + " is too long");
+            }
             size += sizeof(uint16_t) + value.size();
+            if (value.size() >= OVERFLOW_TEXT)
+            {
+                size += sizeof(uint32_t);
+            }
             break;
         }
         case DataType::DATE:
@@ -251,18 +272,16 @@ bool Row::isValidDateFormat(const std::string &date) const
     // (Optional) Range check:
     int day = std::stoi(date.substr(0, 2));
     int month = std::stoi(date.substr(3, 2));
-    int year = std::stoi(date.substr(6, 4));
     if (day < 1 || day > 31)
         return false;
     if (month < 1 || month > 12)
         return false;
-    // Year range check not strictly necessary, but you could do:
-    // if (year < 1900 || year > 2100) return false;
+    // Any four-digit year is accepted.
 
     return true;
 }
 
-static Row::Value convertValue(const std::string &str, DataType type)
+Row::Value Row::convertValue(const std::string &str, DataType type)
 {
     switch (type)
     {
@@ -290,4 +309,97 @@ static Row::Value convertValue(const std::string &str, DataType type)
     default:
         throw std::runtime_error("Unsupported DataType encountered");
     }
-}
\ No newline at end of file
+}
+Row Row::deserialize(const std::vector<Column> &schema, const char *data, size_t size)
+{
+    std::vector<Value> values;
+    values.reserve(schema.size());
+    size_t offset = 0;
+
+    for (size_t i = 0; i < schema.size(); i++)
+    {
+        switch (schema[i].type)
+        {
+        case DataType::INT:
+        {
+            if (offset + sizeof(int32_t) > size)
+            {
+                throw std::runtime_error("Serialized row truncated at column " + std::to_string(i));
+            }
+            int32_t value;
+            std::memcpy(&value, data + offset, sizeof(int32_t));
+            offset += sizeof(int32_t);
+            values.emplace_back(value);
+            break;
+        }
+        case DataType::FLOAT:
+        {
+            if (offset + sizeof(float) > size)
+            {
+                throw std::runtime_error("Serialized row truncated at column " + std::to_string(i));
+            }
+            float value;
+            std::memcpy(&value, data + offset, sizeof(float));
+            offset += sizeof(float);
+            values.emplace_back(value);
+            break;
+        }
+        case DataType::TEXT:
+        case DataType::DATE:
+        {
+            if (offset + sizeof(uint16_t) > size)
+            {
+                throw std::runtime_error("Serialized row truncated at column " + std::to_string(i));
+            }
+            uint16_t prefix;
+            std::memcpy(&prefix, data + offset, sizeof(uint16_t));
+            offset += sizeof(uint16_t);
+            size_t length = prefix;
+            if (prefix == OVERFLOW_TEXT)
+            {
+                throw std::runtime_error("Column " + std::to_string(i) + " refers to the overflow file and must be loaded first");
+            }
+            if (prefix == LONG_TEXT)
+            {
+                if (offset + sizeof(uint32_t) > size)
+                {
+                    throw std::runtime_error("Serialized row truncated at column " + std::to_string(i));
+                }
+                uint32_t longLength;
+                std::memcpy(&longLength, data + offset, sizeof(uint32_t));
+                offset += sizeof(uint32_t);
+                length = longLength;
+            }
+            if (offset + length > size)
+            {
+                throw std::runtime_error("Serialized row truncated at column " + std::to_string(i));
+            }
+            values.emplace_back(std::string(data + offset, length));
+            offset += length;
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported data type in schema");
+        }
+    }
+    return Row(schema, values);
+}
+
+int32_t Row::dateToKey(const std::string &date)
+{
+    if (date.size() != 10 || date[2] != '/' || date[5] != '/')
+    {
+        throw std::invalid_argument("Date string does not match DD/MM/YYYY: " + date);
+    }
+    int day = std::stoi(date.substr(0, 2));
+    int month = std::stoi(date.substr(3, 2));
+    int year = std::stoi(date.substr(6, 4));
+    return year * 10000 + month * 100 + day;
+}
+
+std::string Row::keyToDate(int32_t key)
+{
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%02d/%02d/%04d", key % 100, (key / 100) % 100, key / 10000);
+    return std::string(buffer);
+}
@@ -1,13 +1,14 @@
 #include "schema.h"
 #include <cstring>
+#include <stdexcept>
 
 bool Schema::initialize()
 {
     // check if file exists
-    logger_.log("Checking if schema file exists: " + filepath_);
+    LOG_DEBUG(logger_, "Checking if schema file exists: " + filepath_);
     if (storage_.fileExists(filepath_))
     {
-        logger_.log("Schema file exists: " + filepath_ + ". Reading schema file.");
+        LOG_DEBUG(logger_, "Schema file exists: " + filepath_ + ". Reading schema file.");
         try
         {
             read();
@@ -20,7 +21,7 @@ bool Schema::initialize()
     else
     {
         // create schema file
-        logger_.log("Schema file does not exist: " + filepath_ + ". Creating schema file.");
+        LOG_DEBUG(logger_, "Schema file does not exist: " + filepath_ + ". Creating schema file.");
         try
         {
             storage_.createFile(filepath_);
@@ -34,24 +35,83 @@ bool Schema::initialize()
     return true;
 }
 
-bool Schema::write(const std::vector<Column> &schema)
+std::vector<char> Schema::serialize(const std::vector<Column> &columns, PageLayout layout, size_t pageSize)
 {
-    SchemaHeader tmpHeader;
-    tmpHeader.num_columns = static_cast<uint16_t>(schema.size());
+    if (columns.size() > UINT16_MAX)
+    {
+        throw std::invalid_argument("Too many columns: " + std::to_string(columns.size()));
+    }
+    SchemaHeader header;
+    header.num_columns = static_cast<uint16_t>(columns.size());
+    header.layout = layout;
+    header.page_size = static_cast<uint32_t>(pageSize);
 
-    // Create a buffer large enough for header + columns.
-    std::vector<char> buffer(sizeof(SchemaHeader) + schema.size() * sizeof(Column));
+    std::vector<char> buffer(sizeof(SchemaHeader));
+    std::memcpy(buffer.data(), &header, sizeof(SchemaHeader));
+    for (const Column &column : columns)
+    {
+        if (column.name.size() > UINT16_MAX)
+        {
+            throw std::invalid_argument("Column name is too long: " + column.name.substr(0, 64));
+        }
+        uint16_t length = static_cast<uint16_t>(column.name.size());
+        const char *lenPtr = reinterpret_cast<const char *>(&length);
+        buffer.insert(buffer.end(), lenPtr, lenPtr + sizeof(uint16_t));
+        buffer.insert(buffer.end(), column.name.begin(), column.name.end());
+        buffer.push_back(static_cast<char>(column.type));
+        buffer.push_back(column.categorical ? 1 : 0);
+    }
+    return buffer;
+}
 
-    // Copy header
-    std::memcpy(buffer.data(), &tmpHeader, sizeof(SchemaHeader));
-    // Copy columns
-    if (!schema.empty())
+bool Schema::deserialize(const char *data, size_t size, std::vector<Column> &columns, SchemaHeader &header)
+{
+    if (size < sizeof(SchemaHeader))
     {
-        std::memcpy(buffer.data() + sizeof(SchemaHeader),
-                    schema.data(),
-                    schema.size() * sizeof(Column));
+        return false;
+    }
+    SchemaHeader parsed;
+    std::memcpy(&parsed, data, sizeof(SchemaHeader));
+    if (!isValidPageSize(parsed.page_size) || parsed.layout > PageLayout::COMPRESSED)
+    {
+        return false;
+    }
+
+    std::vector<Column> parsedColumns(parsed.num_columns);
+    size_t offset = sizeof(SchemaHeader);
+    for (Column &column : parsedColumns)
+    {
+        uint16_t length;
+        if (offset + sizeof(uint16_t) > size)
+        {
+            return false;
+        }
+        std::memcpy(&length, data + offset, sizeof(uint16_t));
+        offset += sizeof(uint16_t);
+        if (offset + length + 2 > size)
+        {
+            return false;
+        }
+        column.name.assign(data + offset, length);
+        offset += length;
+        uint8_t type = static_cast<uint8_t>(data[offset++]);
+        if (type > static_cast<uint8_t>(DataType::DATE))
+        {
+            return false;
+        }
+        column.type = static_cast<DataType>(type);
+        column.categorical = data[offset++] != 0;
     }
+    columns.swap(parsedColumns);
+    header = parsed;
+    return true;
+}
 
+bool Schema::write(const std::vector<Column> &schema, PageLayout layout, size_t pageSize)
+{
+    std::vector<char> buffer = serialize(schema, layout, pageSize);
+    // The columns end where the last one does, so a longer schema written
+    // before does not need to be truncated away.
     bool success = storage_.writeFile(
         filepath_,
         buffer.data(),
@@ -60,65 +120,41 @@ bool Schema::write(const std::vector<Column> &schema)
     if (!success)
     {
         // Either throw or return false, but not both
-        logger_.log("Failed to write schema to file: " + filepath_);
+        LOG_ERROR(logger_, "Failed to write schema to file: " + filepath_);
         return false;
     }
+    // Written once per table, and a Database lists the table only after this.
+    storage_.syncData(filepath_);
 
     // If everything succeeded, update your in-memory state.
-    header_ = tmpHeader;
+    std::memcpy(&header_, buffer.data(), sizeof(SchemaHeader));
     schema_ = schema;
     return true;
 }
 
 std::vector<Column> Schema::read()
 {
-    // First read the header
     size_t fileSize = storage_.getSize(filepath_);
     if (fileSize < sizeof(SchemaHeader))
     {
-        logger_.log("Schema file is too small or empty: " + filepath_);
+        LOG_WARN(logger_, "Schema file is too small or empty: " + filepath_);
         throw std::runtime_error("Schema file is empty or too small to contain a header: " + filepath_);
     }
 
-    if (!storage_.readFile(filepath_, reinterpret_cast<char *>(&header_), sizeof(SchemaHeader)))
+    std::vector<char> buffer(fileSize);
+    if (!storage_.readFile(filepath_, buffer.data(), fileSize))
     {
-        logger_.log("Failed to read schema header from file: " + filepath_);
-        throw std::runtime_error("Failed to read schema header from file: " + filepath_);
+        LOG_ERROR(logger_, "Failed to read schema from file: " + filepath_);
+        throw std::runtime_error("Failed to read schema from file: " + filepath_);
     }
-    // If num_columns == 0, we consider it an empty schema
-    if (header_.num_columns == 0)
+    if (!deserialize(buffer.data(), buffer.size(), schema_, header_))
     {
-        logger_.log("Schema indicates 0 columns. Treating as empty schema.");
-        schema_.clear();
-        return schema_;
-    }
-
-    // 3) Check if there's enough file size for columns
-    size_t neededSize = sizeof(SchemaHeader) + header_.num_columns * sizeof(Column);
-    if (fileSize < neededSize)
-    {
-        logger_.log("Schema file size (" + std::to_string(fileSize) +
-                    ") is smaller than required (" + std::to_string(neededSize) +
-                    ") to hold " + std::to_string(header_.num_columns) + " columns.");
+        LOG_ERROR(logger_, "Schema file is truncated or holds an invalid header or column: " + filepath_);
         throw std::runtime_error("Schema file is corrupted or incomplete: " + filepath_);
     }
-
-    // Now read the columns
-    schema_.resize(header_.num_columns);
-    if (header_.num_columns > 0)
+    if (header_.num_columns == 0)
     {
-        bool success = storage_.readFile(
-            filepath_,
-            reinterpret_cast<char *>(schema_.data()),
-            header_.num_columns * sizeof(Column),
-            sizeof(SchemaHeader));
-
-        if (!success)
-        {
-            logger_.log("Failed to read schema columns from file: " + filepath_);
-            throw std::runtime_error("Failed to read schema columns from file: " + filepath_);
-        }
+        LOG_WARN(logger_, "Schema indicates 0 columns. Treating as empty schema.");
     }
-
     return schema_;
 }
@@ -1,56 +1,86 @@
 #include "slotted_page.h"
 
-std::vector<ReturnType> SlottedPage::insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry)
+#include <algorithm>
+#include <functional>
+
+void SlottedPage::setPageSize(size_t pageSize)
+{
+    pageSize_ = pageSize;
+    slotSize_ = pageSize <= NARROW_SLOT_PAGE_SIZE ? sizeof(NarrowSlotEntry) : sizeof(SlotEntry);
+}
+
+void SlottedPage::initPage(std::vector<char> &page)
 {
+    page.assign(pageSize_, 0);
+    SlottedPageHeader emptyHeader = {0, 0, 0, 0, static_cast<uint32_t>(pageSize_), 0};
+    std::memcpy(page.data(), &emptyHeader, sizeof(SlottedPageHeader));
+}
 
-    if (!verifyPage(page))
+size_t SlottedPage::freeSpace(const std::vector<char> &page)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+
+    // Free space lies between the end of the slot directory and the last row.
+    size_t slotDirEnd = sizeof(SlottedPageHeader) + localHeader.numSlots * slotSize_;
+    if (slotDirEnd < localHeader.lastDataOffset)
     {
-        throw std::runtime_error("Page is corrupted");
+        return localHeader.lastDataOffset - slotDirEnd;
     }
+    return 0;
+}
 
+std::vector<ReturnType> SlottedPage::insert(std::vector<Data> serializedData, std::vector<char> &page, PageDirectoryEntry &entry)
+{
     SlottedPageHeader localHeader;
     std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
 
     std::vector<ReturnType> results;
     results.reserve(serializedData.size());
 
+    uint16_t freeSlot = 0; // Free slots below it have been taken already.
     for (auto &d : serializedData)
     {
-        size_t rowSize = d.data.size();
-
-        // offset for the next slot entry
-        size_t slotDirOffset = sizeof(SlottedPageHeader) + localHeader.numSlots * sizeof(SlotEntry);
+        size_t rowSize = storedSize(d.data.size());
 
-        // location for the row’s payload
-        size_t dataOffset = localHeader.lastDataOffset - rowSize;
+        // Reuse a slot freed by a delete before growing the slot directory.
+        while (freeSlot < localHeader.numSlots && !readSlot(page, freeSlot).isFree())
+        {
+            freeSlot++;
+        }
+        bool reuse = freeSlot < localHeader.numSlots;
+        uint16_t slotId = reuse ? freeSlot : localHeader.numSlots;
+        size_t slotDirEnd = sizeof(SlottedPageHeader) + (localHeader.numSlots + (reuse ? 0 : 1)) * slotSize_;
 
         // Check if there is enough space
-        if (dataOffset < slotDirOffset)
+        if (rowSize > localHeader.lastDataOffset || localHeader.lastDataOffset - rowSize < slotDirEnd)
         {
             throw std::runtime_error("Not enough space for new row in slotted page.");
         }
+        size_t dataOffset = localHeader.lastDataOffset - rowSize;
 
         // Copy row data into page
-        std::memcpy(page.data() + dataOffset, d.data.data(), rowSize);
+        std::memcpy(page.data() + dataOffset, d.data.data(), d.data.size());
+        std::memset(page.data() + dataOffset + d.data.size(), 0, rowSize - d.data.size());
 
-        // Create a new slot entry
         SlotEntry newSlot;
-        newSlot.offset = static_cast<uint16_t>(dataOffset);
-        newSlot.length = static_cast<uint16_t>(rowSize);
+        newSlot.offset = static_cast<uint32_t>(dataOffset);
+        newSlot.length = static_cast<uint32_t>(rowSize);
         newSlot.id = static_cast<uint32_t>(d.id);
-
-        // Write slot entry to slot directory area
-        std::memcpy(page.data() + slotDirOffset, &newSlot, sizeof(SlotEntry));
+        writeSlot(page, slotId, newSlot);
 
         // Update the header
-        localHeader.numSlots++;
-        localHeader.lastDataOffset = static_cast<uint16_t>(dataOffset);
+        if (!reuse)
+        {
+            localHeader.numSlots++;
+        }
+        localHeader.lastDataOffset = static_cast<uint32_t>(dataOffset);
 
         // Create return info
         ReturnType ret;
         ret.data.id = d.id;
         ret.location.page_id = entry.page_id; // or real page_id
-        ret.location.slot_id = static_cast<uint16_t>(localHeader.numSlots - 1);
+        ret.location.slot_id = slotId;
 
         results.push_back(ret);
     }
@@ -63,57 +93,43 @@ std::vector<ReturnType> SlottedPage::insert(std::vector<Data> serializedData, st
 
 bool SlottedPage::verifyPage(std::vector<char> &buffer)
 {
-    logger_.log("Checking overall page validity");
-    if (buffer.size() != PAGE_SIZE)
+    LOG_TRACE(logger_, "Checking overall page validity");
+    if (buffer.size() != pageSize_)
     {
-        throw std::runtime_error("Invalid page buffer: must be PAGE_SIZE bytes.");
+        throw std::runtime_error("Invalid page buffer: must be " + std::to_string(pageSize_) + " bytes.");
     }
 
-    logger_.log("Reading the header");
+    LOG_TRACE(logger_, "Reading the header");
     SlottedPageHeader localHeader;
     std::memcpy(&localHeader, buffer.data(), sizeof(SlottedPageHeader));
 
-    logger_.log("Sanity checks on header");
-    const uint16_t maxSlots = (PAGE_SIZE - sizeof(SlottedPageHeader)) / sizeof(SlotEntry);
+    LOG_TRACE(logger_, "Sanity checks on header");
+    const size_t maxSlots = (pageSize_ - sizeof(SlottedPageHeader)) / slotSize_;
     if (localHeader.numSlots > maxSlots)
     {
         throw std::runtime_error("Corrupt page header: numSlots exceeds possible slot directory capacity.");
     }
 
-    if (localHeader.lastDataOffset > PAGE_SIZE)
+    if (localHeader.lastDataOffset > pageSize_)
     {
-        logger_.log("Corrupt page header: freeDataOffset is beyond the page size");
+        LOG_ERROR(logger_, "Corrupt page header: freeDataOffset is beyond the page size");
         throw std::runtime_error("Corrupt page header: freeDataOffset is beyond the page size.");
     }
 
-    // For an empty page, we expect no slots and the data area (after the header) to be zero.
+    // For an empty page, we expect no slots and no data. The page checksum
+    // already vouches for the bytes of the data area.
     if (localHeader.numSlots == 0)
     {
-        if (localHeader.lastDataOffset != PAGE_SIZE)
+        if (localHeader.lastDataOffset != pageSize_)
         {
-            throw std::runtime_error("Invalid header for an empty page: lastDataOffset must be PAGE_SIZE. "
+            throw std::runtime_error("Invalid header for an empty page: lastDataOffset must be the page size. "
                                      "Please ensure the page buffer is properly memset to 0.");
         }
-        
-        // Check that the data area (after the header) is zeroed.
-        bool isDataZeroed = true;
-        for (size_t i = sizeof(SlottedPageHeader); i < buffer.size(); ++i)
-        {
-            if (buffer[i] != 0)
-            {
-                isDataZeroed = false;
-                break;
-            }
-        }
-        if (!isDataZeroed)
-        {
-            throw std::runtime_error("Empty page data area not properly initialized: please memset the data area to 0 with PAGE_SIZE bytes.");
-        }
     }
     else
     {
         // For non-empty pages, check that the slot directory does not overlap the free data region.
-        size_t slotDirectoryEnd = sizeof(SlottedPageHeader) + localHeader.numSlots * sizeof(SlotEntry);
+        size_t slotDirectoryEnd = sizeof(SlottedPageHeader) + localHeader.numSlots * slotSize_;
         if (slotDirectoryEnd > localHeader.lastDataOffset)
         {
             throw std::runtime_error("Invalid header: slot directory (ends at " + std::to_string(slotDirectoryEnd) +
@@ -123,6 +139,301 @@ bool SlottedPage::verifyPage(std::vector<char> &buffer)
     return true;
 }
 
+std::vector<ReturnType> SlottedPage::readRows(const std::vector<char> &page, uint32_t pageId)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+
+    std::vector<ReturnType> results;
+    results.reserve(localHeader.numSlots);
+    for (uint16_t i = 0; i < localHeader.numSlots; i++)
+    {
+        // A moved row is returned from the page it moved to, not from its home.
+        SlotEntry slot = readSlot(page, i);
+        if (slot.isFree() || (slot.length & SLOT_FORWARDED))
+        {
+            continue;
+        }
+
+        ReturnType ret;
+        ret.data.id = slot.id;
+        ret.data.data.assign(page.data() + slot.offset, page.data() + slot.offset + slot.size());
+        ret.location.page_id = pageId;
+        ret.location.slot_id = i;
+        results.push_back(std::move(ret));
+    }
+    return results;
+}
+
+Data SlottedPage::read(const std::vector<char> &page, uint16_t slotId)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    if (slotId >= localHeader.numSlots)
+    {
+        throw std::runtime_error("Slot id " + std::to_string(slotId) + " out of range (numSlots=" +
+                                 std::to_string(localHeader.numSlots) + ")");
+    }
+
+    SlotEntry slot = readSlot(page, slotId);
+    if (slot.isFree() || (slot.length & SLOT_FORWARDED))
+    {
+        throw std::runtime_error("Slot id " + std::to_string(slotId) + " holds no row");
+    }
+
+    Data result;
+    result.id = slot.id;
+    result.data.assign(page.data() + slot.offset, page.data() + slot.offset + slot.size());
+    return result;
+}
+
+SlotEntry SlottedPage::readSlot(const std::vector<char> &page, uint16_t slotId) const
+{
+    const char *position = page.data() + sizeof(SlottedPageHeader) + slotId * slotSize_;
+    SlotEntry slot;
+    if (slotSize_ == sizeof(SlotEntry))
+    {
+        std::memcpy(&slot, position, sizeof(SlotEntry));
+        return slot;
+    }
+    NarrowSlotEntry narrow;
+    std::memcpy(&narrow, position, sizeof(NarrowSlotEntry));
+    slot.id = narrow.id;
+    slot.offset = narrow.offset;
+    slot.length = (narrow.length & ~NARROW_SLOT_FLAGS) | (static_cast<uint32_t>(narrow.length & NARROW_SLOT_FLAGS) << 16);
+    return slot;
+}
+
+SlotEntry SlottedPage::usedSlot(const std::vector<char> &page, const SlottedPageHeader &header, uint16_t slotId,
+                                const char *action) const
+{
+    // Slots past numSlots lie outside the slot directory, so they are not read.
+    SlotEntry slot{};
+    if (slotId < header.numSlots)
+    {
+        slot = readSlot(page, slotId);
+    }
+    if (slot.isFree())
+    {
+        throw std::runtime_error(std::string("Cannot ") + action + " empty slot " + std::to_string(slotId));
+    }
+    return slot;
+}
+
+void SlottedPage::writeSlot(std::vector<char> &page, uint16_t slotId, const SlotEntry &slot) const
+{
+    char *position = page.data() + sizeof(SlottedPageHeader) + slotId * slotSize_;
+    if (slotSize_ == sizeof(SlotEntry))
+    {
+        std::memcpy(position, &slot, sizeof(SlotEntry));
+        return;
+    }
+    NarrowSlotEntry narrow{slot.id, static_cast<uint16_t>(slot.offset),
+                           static_cast<uint16_t>(slot.size() | ((slot.length & ~SLOT_LENGTH_MASK) >> 16))};
+    std::memcpy(position, &narrow, sizeof(NarrowSlotEntry));
+}
+
+std::vector<uint32_t> SlottedPage::rowIds(const std::vector<char> &page)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+
+    std::vector<uint32_t> ids;
+    ids.reserve(localHeader.numSlots);
+    for (uint16_t i = 0; i < localHeader.numSlots; i++)
+    {
+        SlotEntry slot = readSlot(page, i);
+        if (!slot.isFree())
+        {
+            ids.push_back(slot.id);
+        }
+    }
+    return ids;
+}
+
+bool SlottedPage::findRow(const std::vector<char> &page, uint32_t rowId, uint16_t &slotId)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    for (uint16_t i = 0; i < localHeader.numSlots; i++)
+    {
+        SlotEntry slot = readSlot(page, i);
+        if (slot.id == rowId && !slot.isFree() && !(slot.length & SLOT_MOVED))
+        {
+            slotId = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+SlotState SlottedPage::slotState(const std::vector<char> &page, uint16_t slotId, Location &forward)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    if (slotId >= localHeader.numSlots)
+    {
+        return SlotState::FREE;
+    }
+    SlotEntry slot = readSlot(page, slotId);
+    if (slot.isFree())
+    {
+        return SlotState::FREE;
+    }
+    if (slot.length & SLOT_FORWARDED)
+    {
+        ForwardPointer pointer;
+        std::memcpy(&pointer, page.data() + slot.offset, sizeof(ForwardPointer));
+        forward = {pointer.page_id, pointer.slot_id};
+        return SlotState::FORWARDED;
+    }
+    return (slot.length & SLOT_MOVED) ? SlotState::MOVED : SlotState::LIVE;
+}
+
+void SlottedPage::erase(std::vector<char> &page, uint16_t slotId)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    SlotEntry slot = usedSlot(page, localHeader, slotId, "erase");
+
+    // The lowest row borders the free space and is reclaimed at once; the bytes
+    // of any other row stay dead until the rows below them are gone as well.
+    std::memset(page.data() + slot.offset, 0, slot.size());
+    if (slot.offset == localHeader.lastDataOffset)
+    {
+        localHeader.lastDataOffset = localHeader.lastDataOffset + slot.size();
+    }
+    writeSlot(page, slotId, SlotEntry{0, 0, 0});
+    while (localHeader.numSlots > 0 && readSlot(page, localHeader.numSlots - 1).isFree())
+    {
+        localHeader.numSlots--;
+    }
+
+    if (localHeader.numSlots == 0)
+    {
+        uint64_t lsn = getPageLsn(page);
+        initPage(page);
+        setPageLsn(page, lsn);
+        return;
+    }
+    std::memcpy(page.data(), &localHeader, sizeof(SlottedPageHeader));
+}
+
+bool SlottedPage::update(std::vector<char> &page, uint16_t slotId, const std::vector<char> &row)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    SlotEntry slot = usedSlot(page, localHeader, slotId, "update");
+    uint32_t flags = slot.length & SLOT_MOVED;
+    size_t rowSize = storedSize(row.size());
+
+    if (rowSize <= slot.size())
+    {
+        // Overwrite in place; the bytes the row no longer needs stay dead.
+        std::memset(page.data() + slot.offset, 0, slot.size());
+        std::memcpy(page.data() + slot.offset, row.data(), row.size());
+    }
+    else
+    {
+        if (rowSize > freeSpace(page))
+        {
+            return false;
+        }
+        std::memset(page.data() + slot.offset, 0, slot.size());
+        localHeader.lastDataOffset = static_cast<uint32_t>(localHeader.lastDataOffset - rowSize);
+        slot.offset = localHeader.lastDataOffset;
+        std::memcpy(page.data() + slot.offset, row.data(), row.size());
+        std::memcpy(page.data(), &localHeader, sizeof(SlottedPageHeader));
+    }
+    slot.length = static_cast<uint32_t>(rowSize | flags);
+    writeSlot(page, slotId, slot);
+    return true;
+}
+
+bool SlottedPage::forward(std::vector<char> &page, uint16_t slotId, const Location &target)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    SlotEntry slot = usedSlot(page, localHeader, slotId, "forward");
+
+    ForwardPointer pointer{target.page_id, target.slot_id, 0};
+    if (slot.size() >= sizeof(ForwardPointer))
+    {
+        std::memset(page.data() + slot.offset, 0, slot.size());
+    }
+    else
+    {
+        if (freeSpace(page) < sizeof(ForwardPointer))
+        {
+            return false;
+        }
+        std::memset(page.data() + slot.offset, 0, slot.size());
+        localHeader.lastDataOffset = static_cast<uint32_t>(localHeader.lastDataOffset - sizeof(ForwardPointer));
+        slot.offset = localHeader.lastDataOffset;
+        std::memcpy(page.data(), &localHeader, sizeof(SlottedPageHeader));
+    }
+    std::memcpy(page.data() + slot.offset, &pointer, sizeof(ForwardPointer));
+    slot.length = static_cast<uint32_t>(sizeof(ForwardPointer) | SLOT_FORWARDED);
+    writeSlot(page, slotId, slot);
+    return true;
+}
+
+void SlottedPage::setMoved(std::vector<char> &page, uint16_t slotId)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    SlotEntry slot = usedSlot(page, localHeader, slotId, "flag");
+    slot.length |= SLOT_MOVED;
+    writeSlot(page, slotId, slot);
+}
+
+size_t SlottedPage::deadSpace(const std::vector<char> &page)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    size_t used = 0;
+    for (uint16_t i = 0; i < localHeader.numSlots; i++)
+    {
+        used += readSlot(page, i).size();
+    }
+    // Everything between the last row and the page end that no row uses.
+    return pageSize_ - localHeader.lastDataOffset - used;
+}
+
+size_t SlottedPage::compact(std::vector<char> &page)
+{
+    SlottedPageHeader localHeader;
+    std::memcpy(&localHeader, page.data(), sizeof(SlottedPageHeader));
+    size_t before = freeSpace(page);
+
+    // Rows keep their slots and their order in the data area, so the copy
+    // only ever moves a row towards the page end, past bytes already copied.
+    std::vector<std::pair<uint32_t, uint16_t>> rows; // (offset, slot id)
+    for (uint16_t i = 0; i < localHeader.numSlots; i++)
+    {
+        SlotEntry slot = readSlot(page, i);
+        if (!slot.isFree())
+        {
+            rows.emplace_back(slot.offset, i);
+        }
+    }
+    std::sort(rows.begin(), rows.end(), std::greater<>());
+
+    uint32_t end = static_cast<uint32_t>(pageSize_);
+    for (const auto &row : rows)
+    {
+        SlotEntry slot = readSlot(page, row.second);
+        end -= slot.size();
+        std::memmove(page.data() + end, page.data() + slot.offset, slot.size());
+        slot.offset = end;
+        writeSlot(page, row.second, slot);
+    }
+    std::memset(page.data() + localHeader.lastDataOffset, 0, end - localHeader.lastDataOffset);
+    localHeader.lastDataOffset = end;
+    std::memcpy(page.data(), &localHeader, sizeof(SlottedPageHeader));
+    return freeSpace(page) - before;
+}
+
 
 // int main() {
 //     std::cout << "Test 1: Insertion on an empty page\n";
@@ -166,9 +477,9 @@ bool SlottedPage::verifyPage(std::vector<char> &buffer)
 
 //     // Debug print: iterate over slot entries.
 //     for (size_t i = 0; i < newHeader.numSlots; ++i) {
-//         size_t slotDirOffset = sizeof(SlottedPageHeader) + i * sizeof(SlotEntry);
+//         size_t slotDirOffset = sizeof(SlottedPageHeader) + i * slotSize_;
 //         SlotEntry slot;
-//         memcpy(&slot, page.data() + slotDirOffset, sizeof(SlotEntry));
+//         memcpy(&slot, page.data() + slotDirOffset, slotSize_);
 //         std::cout << "Slot " << i << ": id = " << slot.id 
 //                   << ", offset = " << slot.offset 
 //                   << ", length = " << slot.length << "\n";
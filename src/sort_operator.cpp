@@ -0,0 +1,338 @@
+#include "sort_operator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace
+{
+    // Distinguishes the run files of sort operators sharing a spill directory.
+    std::atomic<uint32_t> nextOperatorId{0};
+}
+
+RowOrdering::RowOrdering(std::vector<SortKey> keys) : keys_(std::move(keys))
+{
+    if (keys_.empty())
+    {
+        throw std::invalid_argument("Sort needs at least one key");
+    }
+}
+
+std::vector<Row::Value> RowOrdering::extract(const std::vector<Column> &columns, const std::vector<char> &bytes) const
+{
+    Row row = Row::deserialize(columns, bytes.data(), bytes.size());
+    std::vector<Row::Value> values;
+    values.reserve(keys_.size());
+    for (const auto &key : keys_)
+    {
+        if (columns[key.column].type == DataType::DATE)
+        {
+            values.emplace_back(Row::dateToKey(row.getDate(key.column)));
+        }
+        else
+        {
+            values.push_back(row.getValue(key.column));
+        }
+    }
+    return values;
+}
+
+bool RowOrdering::less(const std::vector<Row::Value> &a, const std::vector<Row::Value> &b) const
+{
+    for (size_t i = 0; i < keys_.size(); i++)
+    {
+        if (a[i] == b[i])
+        {
+            continue;
+        }
+        bool smaller = a[i] < b[i];
+        return keys_[i].ascending ? smaller : !smaller;
+    }
+    return false;
+}
+
+SortOperator::SortOperator(Operator &input, std::vector<SortKey> keys, size_t memoryBudget, IStorage &storage,
+                           const std::string &spillDir, ILogger &logger)
+    : input_(input),
+      ordering_(std::move(keys)),
+      memoryBudget_(memoryBudget),
+      storage_(storage),
+      spillDir_(spillDir),
+      logger_(logger),
+      operatorId_(nextOperatorId++)
+{
+}
+
+SortOperator::~SortOperator()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::exception &e)
+    {
+        LOG_WARN(logger_, std::string("Failed to remove sort runs: ") + e.what());
+    }
+}
+
+SortOperator::SortedRow SortOperator::decode(std::vector<char> bytes) const
+{
+    SortedRow sorted;
+    sorted.keys = ordering_.extract(input_.getSchema(), bytes);
+    sorted.bytes = std::move(bytes);
+    return sorted;
+}
+
+bool SortOperator::less(const SortedRow &a, const SortedRow &b) const
+{
+    return ordering_.less(a.keys, b.keys);
+}
+
+size_t SortOperator::footprint(const SortedRow &row) const
+{
+    size_t bytes = sizeof(SortedRow) + row.bytes.size() + row.keys.size() * sizeof(Row::Value);
+    for (const auto &key : row.keys)
+    {
+        if (const auto *text = std::get_if<std::string>(&key))
+        {
+            bytes += text->size();
+        }
+    }
+    return bytes;
+}
+
+std::string SortOperator::nextRunName()
+{
+    return spillDir_ + "/sort_" + std::to_string(operatorId_) + "_run_" + std::to_string(nextRunId_++) + ".tmp";
+}
+
+void SortOperator::spillRun()
+{
+    std::stable_sort(buffer_.begin(), buffer_.end(),
+                     [this](const SortedRow &a, const SortedRow &b) { return less(a, b); });
+
+    SpillWriter writer(storage_, nextRunName());
+    for (const auto &row : buffer_)
+    {
+        writer.write(row.bytes);
+    }
+    writer.finish();
+    runs_.push_back(writer.getFilename());
+    numRuns_++;
+    LOG_DEBUG(logger_, "Spilled sort run " + writer.getFilename() + " with " + std::to_string(buffer_.size()) + " rows");
+
+    buffer_.clear();
+    bufferBytes_ = 0;
+}
+
+bool SortOperator::open()
+{
+    close();
+    buffer_.clear();
+    bufferBytes_ = 0;
+    bufferPosition_ = 0;
+    numRuns_ = 0;
+    merging_ = false;
+
+    if (!input_.open())
+    {
+        return false;
+    }
+
+    // 1) Run generation.
+    RowBatch batch;
+    while (input_.next(batch))
+    {
+        for (auto &bytes : batch.rows)
+        {
+            SortedRow row = decode(std::move(bytes));
+            bufferBytes_ += footprint(row);
+            buffer_.push_back(std::move(row));
+            if (bufferBytes_ >= memoryBudget_)
+            {
+                spillRun();
+            }
+        }
+    }
+    input_.close();
+
+    if (runs_.empty())
+    {
+        // Everything fit in memory.
+        std::stable_sort(buffer_.begin(), buffer_.end(),
+                         [this](const SortedRow &a, const SortedRow &b) { return less(a, b); });
+        return true;
+    }
+    if (!buffer_.empty())
+    {
+        spillRun();
+    }
+
+    // 2) Intermediate passes until every run gets its own read buffer.
+    const size_t fanIn = std::max<size_t>(2, memoryBudget_ / PAGE_SIZE);
+    while (runs_.size() > fanIn)
+    {
+        std::vector<std::string> next;
+        for (size_t begin = 0; begin < runs_.size(); begin += fanIn)
+        {
+            size_t end = std::min(runs_.size(), begin + fanIn);
+            std::vector<std::string> group(runs_.begin() + begin, runs_.begin() + end);
+            if (group.size() == 1)
+            {
+                next.push_back(group.front());
+                continue;
+            }
+
+            Merge merge;
+            startMerge(merge, group);
+            SpillWriter writer(storage_, nextRunName());
+            std::vector<char> row;
+            while (pop(merge, row))
+            {
+                writer.write(row);
+            }
+            writer.finish();
+            for (const auto &run : group)
+            {
+                storage_.removeFile(run);
+            }
+            next.push_back(writer.getFilename());
+        }
+        LOG_DEBUG(logger_, "Merged " + std::to_string(runs_.size()) + " sort runs into " + std::to_string(next.size()));
+        runs_ = std::move(next);
+    }
+
+    // 3) The final merge is consumed by next().
+    startMerge(merge_, runs_);
+    merging_ = true;
+    return true;
+}
+
+bool SortOperator::next(RowBatch &batch)
+{
+    batch.rows.clear();
+    size_t batchBytes = 0;
+    if (!merging_)
+    {
+        while (bufferPosition_ < buffer_.size() && batchBytes < PAGE_SIZE)
+        {
+            batchBytes += buffer_[bufferPosition_].bytes.size();
+            batch.rows.push_back(std::move(buffer_[bufferPosition_].bytes));
+            bufferPosition_++;
+        }
+        return !batch.rows.empty();
+    }
+
+    std::vector<char> row;
+    while (batchBytes < PAGE_SIZE && pop(merge_, row))
+    {
+        batchBytes += row.size();
+        batch.rows.push_back(std::move(row));
+    }
+    return !batch.rows.empty();
+}
+
+void SortOperator::close()
+{
+    merge_.sources.clear();
+    merge_.tree.clear();
+    merging_ = false;
+    for (const auto &run : runs_)
+    {
+        storage_.removeFile(run);
+    }
+    runs_.clear();
+}
+
+void SortOperator::advance(MergeSource &source)
+{
+    std::vector<char> bytes;
+    if (source.reader->next(bytes))
+    {
+        source.head = decode(std::move(bytes));
+    }
+    else
+    {
+        source.head = SortedRow{};
+        source.exhausted = true;
+    }
+}
+
+void SortOperator::startMerge(Merge &merge, const std::vector<std::string> &runs)
+{
+    merge.sources.clear();
+    merge.sources.resize(runs.size());
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        merge.sources[i].reader = std::make_unique<SpillReader>(storage_, runs[i]);
+        advance(merge.sources[i]);
+    }
+
+    // Every node starts out holding the sentinel; inserting the sources from
+    // the last leaf backwards leaves the real losers in the nodes and the
+    // overall winner in tree[0].
+    merge.tree.assign(runs.size(), -1);
+    for (int i = static_cast<int>(runs.size()) - 1; i >= 0; i--)
+    {
+        adjust(merge, i);
+    }
+}
+
+bool SortOperator::beats(const Merge &merge, int a, int b) const
+{
+    if (a == -1)
+    {
+        return true;
+    }
+    if (b == -1)
+    {
+        return false;
+    }
+    const MergeSource &sa = merge.sources[a];
+    const MergeSource &sb = merge.sources[b];
+    if (sa.exhausted || sb.exhausted)
+    {
+        return sb.exhausted && (!sa.exhausted || a < b);
+    }
+    if (less(sa.head, sb.head))
+    {
+        return true;
+    }
+    if (less(sb.head, sa.head))
+    {
+        return false;
+    }
+    // Equal keys: the earlier run wins, which keeps the sort stable.
+    return a < b;
+}
+
+void SortOperator::adjust(Merge &merge, int source)
+{
+    const int k = static_cast<int>(merge.sources.size());
+    for (int node = (source + k) / 2; node > 0; node /= 2)
+    {
+        if (beats(merge, merge.tree[node], source))
+        {
+            std::swap(source, merge.tree[node]);
+        }
+    }
+    merge.tree[0] = source;
+}
+
+bool SortOperator::pop(Merge &merge, std::vector<char> &row)
+{
+    if (merge.sources.empty())
+    {
+        return false;
+    }
+    int winner = merge.tree[0];
+    MergeSource &source = merge.sources[winner];
+    if (source.exhausted)
+    {
+        return false;
+    }
+    row = std::move(source.head.bytes);
+    advance(source);
+    adjust(merge, winner);
+    return true;
+}
@@ -0,0 +1,88 @@
+#include "spill_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+SpillWriter::SpillWriter(IStorage &storage, const std::string &filename)
+    : storage_(storage), filename_(filename)
+{
+    storage_.createFile(filename_);
+    buffer_.reserve(PAGE_SIZE);
+}
+
+void SpillWriter::write(const std::vector<char> &record)
+{
+    uint32_t length = static_cast<uint32_t>(record.size());
+    const char *lenPtr = reinterpret_cast<const char *>(&length);
+    buffer_.insert(buffer_.end(), lenPtr, lenPtr + sizeof(uint32_t));
+    buffer_.insert(buffer_.end(), record.begin(), record.end());
+    numRecords_++;
+    if (buffer_.size() >= PAGE_SIZE)
+    {
+        flush();
+    }
+}
+
+void SpillWriter::flush()
+{
+    if (!buffer_.empty())
+    {
+        storage_.appendFile(filename_, buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+}
+
+void SpillWriter::finish()
+{
+    flush();
+}
+
+SpillReader::SpillReader(IStorage &storage, const std::string &filename)
+    : storage_(storage), filename_(filename), fileSize_(storage.getSize(filename))
+{
+}
+
+bool SpillReader::ensure(size_t bytes)
+{
+    if (buffer_.size() - position_ >= bytes)
+    {
+        return true;
+    }
+
+    // Drop what was consumed, then read the next chunk behind the unread tail.
+    buffer_.erase(buffer_.begin(), buffer_.begin() + position_);
+    position_ = 0;
+    while (buffer_.size() < bytes && fileOffset_ < fileSize_)
+    {
+        size_t chunk = std::min(std::max(PAGE_SIZE, bytes - buffer_.size()), fileSize_ - fileOffset_);
+        size_t oldSize = buffer_.size();
+        buffer_.resize(oldSize + chunk);
+        storage_.readFile(filename_, buffer_.data() + oldSize, chunk, fileOffset_);
+        fileOffset_ += chunk;
+    }
+    return buffer_.size() >= bytes;
+}
+
+bool SpillReader::next(std::vector<char> &record)
+{
+    if (!ensure(sizeof(uint32_t)))
+    {
+        if (buffer_.size() - position_ > 0)
+        {
+            throw std::runtime_error("Truncated record at the end of spill file: " + filename_);
+        }
+        return false;
+    }
+
+    uint32_t length;
+    std::memcpy(&length, buffer_.data() + position_, sizeof(uint32_t));
+    position_ += sizeof(uint32_t);
+    if (!ensure(length))
+    {
+        throw std::runtime_error("Truncated record at the end of spill file: " + filename_);
+    }
+    record.assign(buffer_.data() + position_, buffer_.data() + position_ + length);
+    position_ += length;
+    return true;
+}
@@ -1,33 +1,169 @@
 #include "table.h"
+#include "limit_operator.h"
+
+#include <algorithm>
+#include <climits>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <thread>
+
+namespace
+{
+    // Index key of an INT or DATE value; dates sort as YYYYMMDD.
+    int32_t toIndexKey(const Row::Value &value, DataType type)
+    {
+        if (type == DataType::DATE)
+        {
+            return Row::dateToKey(std::get<std::string>(value));
+        }
+        return std::get<int32_t>(value);
+    }
+
+    bool inRange(const Row::Value &value, const Row::Value &low, const Row::Value &high, DataType type)
+    {
+        if (type == DataType::DATE)
+        {
+            int32_t key = toIndexKey(value, type);
+            return toIndexKey(low, type) <= key && key <= toIndexKey(high, type);
+        }
+        return !(value < low) && !(high < value);
+    }
+
+    // Zone key of a value extracted by RowOrdering, where DATE is already YYYYMMDD.
+    int64_t orderingZoneKey(const Row::Value &value, DataType type)
+    {
+        if (type == DataType::DATE)
+        {
+            return std::get<int32_t>(value);
+        }
+        return ZoneMap::toZoneKey(value, type);
+    }
+}
 
 bool Table::initialize()
 {
-    logger_.log("Initializing table: " + tableDir_);
+    LOG_INFO(logger_, "Initializing table: " + tableDir_);
 
     // Initialize schema
-    bool schemaInitialization = schema_.initialize();
-    bool pageManagerInitialization = pageManager_.initialize();
-
-    if (!schemaInitialization || !pageManagerInitialization)
+    if (!schema_.initialize())
     {
         return false;
     }
+    // Recovery replays whole pages, so their size must be known first.
+    pageManager_.setPageSize(schema_.getPageSize());
+    if (!pageManager_.initialize())
+    {
+        return false;
+    }
+    pageManager_.setSchema(schema_.getSchema(), schema_.getLayout());
+
+    // Reattach indexes and bloom filters created in a previous session. The
+    // pages are recovered by now, so indexes left dirty by a crash are rebuilt
+    // from them.
+    const auto &columns = schema_.getSchema();
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const Column &column = columns[i];
+        if (storage_.fileExists(tableDir_ + "/" + column.name + ".bloom"))
+        {
+            pageManager_.enableBloomFilter(column.name);
+        }
+        if (column.type == DataType::TEXT)
+        {
+            auto hashIndex = std::make_unique<HashIndex>(tableDir_, column.name, storage_, logger_);
+            if (hashIndex->exists())
+            {
+                LOG_DEBUG(logger_, "Attaching hash index on column: " + column.name);
+                hashIndex->initialize();
+                if (!hashIndex->isClean())
+                {
+                    LOG_WARN(logger_, "Rebuilding hash index left dirty on column: " + column.name);
+                    hashIndex = buildHashIndex(i);
+                }
+                hashIndexes_.push_back(std::move(hashIndex));
+            }
+            continue;
+        }
+#ifndef DISABLE_BTREE
+        if (column.type != DataType::INT && column.type != DataType::DATE)
+        {
+            continue;
+        }
+        auto index = std::make_unique<BPlusTree>(tableDir_, column.name, storage_, logger_);
+        if (index->exists())
+        {
+            LOG_DEBUG(logger_, "Attaching index on column: " + column.name);
+            index->initialize();
+            if (!index->isClean())
+            {
+                LOG_WARN(logger_, "Rebuilding index left dirty on column: " + column.name);
+                index = buildIndex(i);
+            }
+            indexes_.push_back(std::move(index));
+        }
+#endif
+    }
+
     initialized_ = true;
     return true;
 }
 
-bool Table::createSchema(std::vector<Column> &columns)
+Table::~Table()
+{
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    bool dirty = std::any_of(hashIndexes_.begin(), hashIndexes_.end(), [](const auto &hashIndex)
+                             { return !hashIndex->isClean(); });
+#ifndef DISABLE_BTREE
+    dirty = dirty || std::any_of(indexes_.begin(), indexes_.end(), [](const auto &index)
+                                 { return !index->isClean(); });
+#endif
+    if (!dirty)
+    {
+        return;
+    }
+    try
+    {
+        pageManager_.checkpoint();
+        for (auto &hashIndex : hashIndexes_)
+        {
+            hashIndex->markClean();
+        }
+#ifndef DISABLE_BTREE
+        for (auto &index : indexes_)
+        {
+            index->markClean();
+        }
+#endif
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(logger_, "Failed to mark the indexes of table " + tableDir_ + " clean: " + e.what());
+    }
+}
+
+bool Table::createSchema(std::vector<Column> &columns, PageLayout layout, size_t pageSize)
 {
     if (!initialized_)
     {
         return false;
     }
 
-    logger_.log("Creating schema for table: " + tableDir_);
-    if (!schema_.write(columns))
+    for (const Column &column : columns)
+    {
+        if (column.categorical && column.type != DataType::TEXT)
+        {
+            throw std::invalid_argument("Only TEXT columns can be categorical: " + column.name);
+        }
+    }
+
+    LOG_INFO(logger_, "Creating schema for table: " + tableDir_);
+    pageManager_.setPageSize(pageSize);
+    if (!schema_.write(columns, layout, pageSize))
     {
         return false;
     }
+    pageManager_.setSchema(columns, layout);
     return true;
 }
 
@@ -53,6 +189,763 @@ bool Table::writeDataFromFile(const std::string &filename, char delimiter)
     {
         return false;
     }
-    pageManager_.insertData(data.serializedData, data.serializedDataSize, data.numRows);
+    // PageManager validates the batch size including the slot overhead of every row.
+    size_t expectedSize = data.serializedDataSize + data.numRows * sizeof(SlotEntry);
+    std::vector<ReturnType> inserted;
+    beginIndexChange();
+    if (!pageManager_.insertData(data.serializedData, expectedSize, data.numRows, &inserted))
+    {
+        return false;
+    }
+    updateIndexes(data.serializedData, inserted);
     return true;
 }
+
+bool Table::writeDataFromFiles(const std::vector<std::string> &filenames, char delimiter)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+
+    std::vector<DataObject> data(filenames.size());
+    std::vector<std::vector<ReturnType>> inserted(filenames.size());
+    std::vector<std::exception_ptr> errors(filenames.size());
+    std::vector<std::thread> loaders;
+    beginIndexChange();
+    for (size_t i = 0; i < filenames.size(); i++)
+    {
+        loaders.emplace_back([&, i]
+                             {
+                                 try
+                                 {
+                                     data[i] = parser_.parseFile(filenames[i], delimiter, schema_.getSchema());
+                                     PageManager::BulkWriter writer = pageManager_.bulkWriter();
+                                     for (const auto &row : data[i].serializedData)
+                                     {
+                                         writer.add(row);
+                                     }
+                                     writer.finish();
+                                     inserted[i] = writer.getInserted();
+                                 }
+                                 catch (...)
+                                 {
+                                     errors[i] = std::current_exception();
+                                 } });
+    }
+    for (auto &loader : loaders)
+    {
+        loader.join();
+    }
+    pageManager_.finishBulkLoad();
+
+    // Rows of the loaders that succeeded are published, and a loader that
+    // failed while adding rows published those added before, so the indexes
+    // are rebuilt from the pages before the error is passed on.
+    auto failed = std::find_if(errors.begin(), errors.end(), [](const std::exception_ptr &error)
+                               { return error != nullptr; });
+    if (failed != errors.end())
+    {
+        rebuildIndexes();
+        std::rethrow_exception(*failed);
+    }
+
+    // Maintain the indexes with one batch so that an empty B+tree is bulk loaded once.
+    std::vector<std::vector<char>> allRows;
+    std::vector<ReturnType> allInserted;
+    for (size_t i = 0; i < filenames.size(); i++)
+    {
+        std::move(data[i].serializedData.begin(), data[i].serializedData.end(), std::back_inserter(allRows));
+        allInserted.insert(allInserted.end(), inserted[i].begin(), inserted[i].end());
+    }
+    updateIndexes(allRows, allInserted);
+    LOG_INFO(logger_, "Bulk loaded " + std::to_string(filenames.size()) + " files into table: " + tableDir_);
+    return true;
+}
+
+bool Table::deleteRow(uint32_t rowId)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+    ReturnType previous;
+    beginIndexChange();
+    if (!pageManager_.deleteRow(rowId, &previous))
+    {
+        return false;
+    }
+    updateIndexes(previous, nullptr);
+    return true;
+}
+
+bool Table::updateRow(uint32_t rowId, const Row &row)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+    std::vector<char> bytes = row.serialize();
+    ReturnType previous;
+    beginIndexChange();
+    if (!pageManager_.updateRow(rowId, bytes, &previous))
+    {
+        return false;
+    }
+    updateIndexes(previous, &bytes);
+    return true;
+}
+
+std::vector<uint32_t> Table::findRowIds(const std::string &columnName, const Row::Value &value)
+{
+    std::vector<uint32_t> rowIds;
+    if (!initialized_)
+    {
+        return rowIds;
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    const auto &columns = schema_.getSchema();
+    std::vector<Location> locations;
+    bool indexed = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex_);
+        if (HashIndex *hashIndex = findHashIndex(columnName))
+        {
+            locations = hashIndex->lookup(std::get<std::string>(value));
+            indexed = true;
+        }
+#ifndef DISABLE_BTREE
+        else if (BPlusTree *index = findIndex(columnName))
+        {
+            int32_t key = toIndexKey(value, columns[columnIndex].type);
+            locations = index->rangeScan(key, key);
+            indexed = true;
+        }
+#endif
+    }
+    if (!indexed)
+    {
+        for (const auto &stored : scanStored(columnIndex, value, value))
+        {
+            rowIds.push_back(stored.data.id);
+        }
+        return rowIds;
+    }
+
+    // Recheck candidates: hash indexes only store key hashes.
+    for (const auto &location : locations)
+    {
+        Data data;
+        if (pageManager_.readRow(location, data) &&
+            Row::deserialize(columns, data.data.data(), data.data.size()).getValue(columnIndex) == value)
+        {
+            rowIds.push_back(data.id);
+        }
+    }
+    return rowIds;
+}
+
+bool Table::openValue(uint32_t rowId, const std::string &columnName, ValueReader &reader)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+    size_t columnIndex = getColumnIndex(columnName);
+    if (schema_.getSchema()[columnIndex].type != DataType::TEXT)
+    {
+        throw std::invalid_argument("Values can only be streamed from TEXT columns: " + columnName);
+    }
+    return pageManager_.openValue(rowId, columnIndex, reader);
+}
+
+size_t Table::getColumnIndex(const std::string &columnName)
+{
+    const auto &columns = schema_.getSchema();
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        if (columns[i].name == columnName)
+        {
+            return i;
+        }
+    }
+    throw std::runtime_error("Unknown column: " + columnName + " in table: " + tableDir_);
+}
+
+std::vector<Row> Table::fetchRows(const std::vector<Location> &locations)
+{
+    std::vector<Row> rows;
+    rows.reserve(locations.size());
+    const auto &columns = schema_.getSchema();
+    for (const auto &location : locations)
+    {
+        Data data;
+        if (!pageManager_.readRow(location, data))
+        {
+            throw std::runtime_error("Failed to read row at page_id=" + std::to_string(location.page_id) +
+                                     ", slot_id=" + std::to_string(location.slot_id));
+        }
+        rows.push_back(Row::deserialize(columns, data.data.data(), data.data.size()));
+    }
+    return rows;
+}
+
+std::vector<Row> Table::rangeQuery(const std::string &columnName, const Row::Value &low, const Row::Value &high)
+{
+    if (!initialized_)
+    {
+        return {};
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    DataType type = schema_.getSchema()[columnIndex].type;
+
+#ifndef DISABLE_BTREE
+    std::vector<Location> locations;
+    bool indexed = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex_);
+        if (BPlusTree *index = findIndex(columnName))
+        {
+            locations = index->rangeScan(toIndexKey(low, type), toIndexKey(high, type));
+            indexed = true;
+        }
+    }
+    if (indexed)
+    {
+        LOG_DEBUG(logger_, "Range query on " + columnName + " using index");
+        return fetchRows(locations);
+    }
+#endif
+
+    LOG_DEBUG(logger_, "Range query on " + columnName + " using full table scan");
+    return scanRange(columnIndex, low, high);
+}
+
+std::vector<Row> Table::scanRange(size_t columnIndex, const Row::Value &low, const Row::Value &high)
+{
+    const auto &columns = schema_.getSchema();
+    std::vector<Row> rows;
+    for (const auto &stored : scanStored(columnIndex, low, high))
+    {
+        rows.push_back(Row::deserialize(columns, stored.data.data.data(), stored.data.data.size()));
+    }
+    return rows;
+}
+
+std::vector<ReturnType> Table::scanStored(size_t columnIndex, const Row::Value &low, const Row::Value &high)
+{
+    const auto &columns = schema_.getSchema();
+    DataType type = columns[columnIndex].type;
+    int64_t lowKey = ZoneMap::toZoneKey(low, type);
+    int64_t highKey = ZoneMap::toZoneKey(high, type);
+    ZoneMap &zoneMap = pageManager_.getZoneMap();
+    bool probeBloom = low == high && pageManager_.hasBloomFilter(columnIndex);
+    // Equality on a categorical column compares dictionary codes, and a value
+    // without a code is in no row at all.
+    bool byCode = low == high && pageManager_.isCategorical(columnIndex);
+    uint32_t code = 0;
+    if (byCode && !pageManager_.getDictionary().find(std::get<std::string>(low), code))
+    {
+        return {};
+    }
+
+    std::vector<ReturnType> rows;
+    size_t skippedPages = 0;
+    DirectorySnapshot snapshot = pageManager_.snapshot();
+    for (uint32_t pageId : snapshot.pageIds)
+    {
+        // Skip pages whose zone or bloom filter proves that no row can match.
+        if (!zoneMap.mayContain(pageId, columnIndex, lowKey, highKey) ||
+            (probeBloom && !pageManager_.bloomMayContain(pageId, columnIndex, low)))
+        {
+            skippedPages++;
+            continue;
+        }
+        auto matches = byCode ? pageManager_.readRowsWithCode(pageId, columnIndex, code, &snapshot)
+                              : pageManager_.readMatchingRows(pageId, columnIndex, [&](const Row::Value &value)
+                                                              { return inRange(value, low, high, type); }, &snapshot);
+        std::move(matches.begin(), matches.end(), std::back_inserter(rows));
+    }
+    LOG_DEBUG(logger_, "Zone maps and bloom filters skipped " + std::to_string(skippedPages) + " pages");
+    return rows;
+}
+
+std::vector<Row> Table::lookup(const std::string &columnName, const Row::Value &value)
+{
+    if (!initialized_)
+    {
+        return {};
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    DataType type = schema_.getSchema()[columnIndex].type;
+
+    std::vector<Location> candidates;
+    bool hashed = false;
+    bool indexed = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex_);
+        if (HashIndex *hashIndex = findHashIndex(columnName))
+        {
+            candidates = hashIndex->lookup(std::get<std::string>(value));
+            hashed = true;
+        }
+#ifndef DISABLE_BTREE
+        indexed = (type == DataType::INT || type == DataType::DATE) && findIndex(columnName) != nullptr;
+#endif
+    }
+    if (hashed)
+    {
+        // The hash index only stores key hashes, so recheck every candidate.
+        LOG_DEBUG(logger_, "Lookup on " + columnName + " using hash index");
+        std::vector<Row> rows;
+        for (auto &row : fetchRows(candidates))
+        {
+            if (row.getValue(columnIndex) == value)
+            {
+                rows.push_back(std::move(row));
+            }
+        }
+        return rows;
+    }
+    if (indexed)
+    {
+        return rangeQuery(columnName, value, value);
+    }
+
+    LOG_DEBUG(logger_, "Lookup on " + columnName + " using full table scan");
+    return scanRange(columnIndex, value, value);
+}
+
+std::vector<std::pair<Row::Value, uint64_t>> Table::groupCount(const std::string &columnName)
+{
+    if (!initialized_)
+    {
+        return {};
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    DirectorySnapshot snapshot = pageManager_.snapshot();
+    std::map<Row::Value, uint64_t> groups;
+    if (pageManager_.isCategorical(columnIndex))
+    {
+        // Count codes and only look up the string of each distinct one.
+        std::vector<uint64_t> counts;
+        for (uint32_t pageId : snapshot.pageIds)
+        {
+            pageManager_.countCodes(pageId, columnIndex, counts, &snapshot);
+        }
+        TextDictionary &dictionary = pageManager_.getDictionary();
+        for (uint32_t code = 0; code < counts.size(); code++)
+        {
+            if (counts[code] > 0)
+            {
+                groups.emplace(dictionary.value(code), counts[code]);
+            }
+        }
+    }
+    else
+    {
+        const auto &columns = schema_.getSchema();
+        for (uint32_t pageId : snapshot.pageIds)
+        {
+            for (const auto &stored : pageManager_.readRows(pageId, snapshot))
+            {
+                Row row = Row::deserialize(columns, stored.data.data.data(), stored.data.data.size());
+                groups[row.getValue(columnIndex)]++;
+            }
+        }
+    }
+    return {groups.begin(), groups.end()};
+}
+
+std::vector<Row> Table::topN(const std::string &columnName, size_t n, bool ascending)
+{
+    if (!initialized_ || n == 0)
+    {
+        return {};
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    const auto &columns = schema_.getSchema();
+    DataType type = columns[columnIndex].type;
+
+#ifndef DISABLE_BTREE
+    // Leaves are only linked left to right, so the index serves ascending order.
+    std::vector<Location> locations;
+    bool indexed = false;
+    if (ascending)
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex_);
+        if (BPlusTree *index = findIndex(columnName))
+        {
+            locations = index->rangeScan(INT32_MIN, INT32_MAX, n);
+            indexed = true;
+        }
+    }
+    if (indexed)
+    {
+        LOG_DEBUG(logger_, "Top-" + std::to_string(n) + " on " + columnName + " using index");
+        return fetchRows(locations);
+    }
+#endif
+
+    // Order pages by the best value their zone admits. Pages without a zone
+    // cannot be bounded and are read first.
+    struct Candidate
+    {
+        uint32_t pageId;
+        bool bounded;
+        int64_t bound;
+    };
+    ZoneMap &zoneMap = pageManager_.getZoneMap();
+    std::vector<Candidate> pages;
+    DirectorySnapshot snapshot = pageManager_.snapshot();
+    for (uint32_t pageId : snapshot.pageIds)
+    {
+        std::vector<ColumnZone> zones = zoneMap.getZones(pageId);
+        if (zones.empty())
+        {
+            pages.push_back({pageId, false, 0});
+            continue;
+        }
+        const ColumnZone &zone = zones[columnIndex];
+        if (zone.has_values)
+        {
+            pages.push_back({pageId, true, ascending ? zone.min : zone.max});
+        }
+    }
+    std::stable_sort(pages.begin(), pages.end(), [ascending](const Candidate &a, const Candidate &b)
+                     {
+                         if (a.bounded != b.bounded)
+                         {
+                             return !a.bounded;
+                         }
+                         return ascending ? a.bound < b.bound : a.bound > b.bound;
+                     });
+
+    RowOrdering ordering({{columnIndex, ascending}});
+    TopNBuffer buffer(ordering, columns, n);
+    size_t pagesRead = 0;
+    for (const auto &page : pages)
+    {
+        if (page.bounded && buffer.full())
+        {
+            // Pages are sorted by bound, so once one cannot beat the worst row kept
+            // none of the remaining pages can either.
+            int64_t worst = orderingZoneKey(buffer.worstKeys()[0], type);
+            if (ascending ? page.bound > worst : page.bound < worst)
+            {
+                break;
+            }
+        }
+        for (auto &stored : pageManager_.readRows(page.pageId, snapshot))
+        {
+            buffer.push(std::move(stored.data.data));
+        }
+        pagesRead++;
+    }
+    LOG_DEBUG(logger_, "Top-" + std::to_string(n) + " on " + columnName + " read " + std::to_string(pagesRead) + " of " +
+                       std::to_string(pages.size()) + " pages");
+
+    std::vector<Row> rows;
+    for (const auto &bytes : buffer.finish())
+    {
+        rows.push_back(Row::deserialize(columns, bytes.data(), bytes.size()));
+    }
+    return rows;
+}
+
+bool Table::createBloomFilter(const std::string &columnName)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+    getColumnIndex(columnName);
+    return pageManager_.enableBloomFilter(columnName);
+}
+
+bool Table::createHashIndex(const std::string &columnName)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    const auto &columns = schema_.getSchema();
+    if (columns[columnIndex].type != DataType::TEXT)
+    {
+        LOG_WARN(logger_, "Hash indexes are only supported on TEXT columns: " + columnName);
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    if (findHashIndex(columnName) != nullptr)
+    {
+        LOG_WARN(logger_, "Hash index already exists on column: " + columnName);
+        return true;
+    }
+
+    auto hashIndex = buildHashIndex(columnIndex);
+    if (!hashIndex)
+    {
+        return false;
+    }
+    hashIndexes_.push_back(std::move(hashIndex));
+    return true;
+}
+
+std::unique_ptr<HashIndex> Table::buildHashIndex(size_t columnIndex)
+{
+    const auto &columns = schema_.getSchema();
+    std::vector<HashIndex::Entry> entries;
+    for (uint32_t pageId : pageManager_.getPageIds())
+    {
+        for (const auto &stored : pageManager_.readRows(pageId))
+        {
+            Row row = Row::deserialize(columns, stored.data.data.data(), stored.data.data.size());
+            entries.emplace_back(HashIndex::hashKey(row.getText(columnIndex)), stored.location);
+        }
+    }
+
+    auto hashIndex = std::make_unique<HashIndex>(tableDir_, columns[columnIndex].name, storage_, logger_);
+    hashIndex->removeFiles();
+    hashIndex->initialize();
+    if (!hashIndex->insertBatch(entries))
+    {
+        return nullptr;
+    }
+    // The rows indexed must be durable before the index says it holds them.
+    pageManager_.checkpoint();
+    hashIndex->markClean();
+    return hashIndex;
+}
+
+void Table::rebuildIndexes()
+{
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    for (auto &hashIndex : hashIndexes_)
+    {
+        LOG_WARN(logger_, "Rebuilding hash index on column: " + hashIndex->getColumnName());
+        auto rebuilt = buildHashIndex(getColumnIndex(hashIndex->getColumnName()));
+        if (!rebuilt)
+        {
+            throw std::runtime_error("Failed to rebuild hash index on column: " + hashIndex->getColumnName());
+        }
+        hashIndex = std::move(rebuilt);
+    }
+#ifndef DISABLE_BTREE
+    for (auto &index : indexes_)
+    {
+        LOG_WARN(logger_, "Rebuilding index on column: " + index->getColumnName());
+        auto rebuilt = buildIndex(getColumnIndex(index->getColumnName()));
+        if (!rebuilt)
+        {
+            throw std::runtime_error("Failed to rebuild index on column: " + index->getColumnName());
+        }
+        index = std::move(rebuilt);
+    }
+#endif
+}
+
+void Table::beginIndexChange()
+{
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    for (auto &hashIndex : hashIndexes_)
+    {
+        hashIndex->markDirty();
+    }
+#ifndef DISABLE_BTREE
+    for (auto &index : indexes_)
+    {
+        index->markDirty();
+    }
+#endif
+}
+
+HashIndex *Table::findHashIndex(const std::string &columnName)
+{
+    for (auto &hashIndex : hashIndexes_)
+    {
+        if (hashIndex->getColumnName() == columnName)
+        {
+            return hashIndex.get();
+        }
+    }
+    return nullptr;
+}
+
+void Table::updateIndexes(const std::vector<std::vector<char>> &serializedData, const std::vector<ReturnType> &inserted)
+{
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    bool hasIndexes = !hashIndexes_.empty();
+#ifndef DISABLE_BTREE
+    hasIndexes = hasIndexes || !indexes_.empty();
+#endif
+    if (!hasIndexes)
+    {
+        return;
+    }
+    if (serializedData.size() != inserted.size())
+    {
+        throw std::runtime_error("Index maintenance failed: inserted row count does not match input");
+    }
+
+    const auto &columns = schema_.getSchema();
+    std::vector<Row> rows;
+    rows.reserve(serializedData.size());
+    for (const auto &bytes : serializedData)
+    {
+        rows.push_back(Row::deserialize(columns, bytes.data(), bytes.size()));
+    }
+
+    for (auto &hashIndex : hashIndexes_)
+    {
+        size_t columnIndex = getColumnIndex(hashIndex->getColumnName());
+        std::vector<HashIndex::Entry> entries;
+        entries.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            entries.emplace_back(HashIndex::hashKey(rows[i].getText(columnIndex)), inserted[i].location);
+        }
+        hashIndex->insertBatch(entries);
+    }
+
+#ifndef DISABLE_BTREE
+    for (auto &index : indexes_)
+    {
+        size_t columnIndex = getColumnIndex(index->getColumnName());
+        std::vector<BPlusTree::Entry> entries;
+        entries.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            entries.emplace_back(toIndexKey(rows[i].getValue(columnIndex), columns[columnIndex].type), inserted[i].location);
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const BPlusTree::Entry &a, const BPlusTree::Entry &b)
+                         { return a.first < b.first; });
+        index->bulkLoad(entries);
+    }
+#endif
+}
+
+void Table::updateIndexes(const ReturnType &previous, const std::vector<char> *row)
+{
+    const auto &columns = schema_.getSchema();
+    Row before = Row::deserialize(columns, previous.data.data.data(), previous.data.data.size());
+    std::unique_ptr<Row> after;
+    if (row != nullptr)
+    {
+        after = std::make_unique<Row>(Row::deserialize(columns, row->data(), row->size()));
+    }
+    const Location &location = previous.location;
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+
+    // An updated row keeps its location, so only changed keys are touched.
+    for (auto &hashIndex : hashIndexes_)
+    {
+        size_t columnIndex = getColumnIndex(hashIndex->getColumnName());
+        if (after != nullptr && after->getValue(columnIndex) == before.getValue(columnIndex))
+        {
+            continue;
+        }
+        hashIndex->remove(before.getText(columnIndex), location);
+        if (after != nullptr)
+        {
+            hashIndex->insert(after->getText(columnIndex), location);
+        }
+    }
+
+#ifndef DISABLE_BTREE
+    for (auto &index : indexes_)
+    {
+        size_t columnIndex = getColumnIndex(index->getColumnName());
+        if (after != nullptr && after->getValue(columnIndex) == before.getValue(columnIndex))
+        {
+            continue;
+        }
+        DataType type = columns[columnIndex].type;
+        index->remove(toIndexKey(before.getValue(columnIndex), type), location);
+        if (after != nullptr)
+        {
+            index->insert(toIndexKey(after->getValue(columnIndex), type), location);
+        }
+    }
+#endif
+}
+
+#ifndef DISABLE_BTREE
+bool Table::createIndex(const std::string &columnName)
+{
+    if (!initialized_)
+    {
+        return false;
+    }
+
+    size_t columnIndex = getColumnIndex(columnName);
+    const auto &columns = schema_.getSchema();
+    if (columns[columnIndex].type != DataType::INT && columns[columnIndex].type != DataType::DATE)
+    {
+        LOG_WARN(logger_, "B+tree indexes are only supported on INT and DATE columns: " + columnName);
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(indexMutex_);
+    if (findIndex(columnName) != nullptr)
+    {
+        LOG_WARN(logger_, "Index already exists on column: " + columnName);
+        return true;
+    }
+
+    auto index = buildIndex(columnIndex);
+    if (!index)
+    {
+        return false;
+    }
+    indexes_.push_back(std::move(index));
+    return true;
+}
+
+std::unique_ptr<BPlusTree> Table::buildIndex(size_t columnIndex)
+{
+    // Collect (key, location) for every stored row, sort, and bulk load.
+    const auto &columns = schema_.getSchema();
+    std::vector<BPlusTree::Entry> entries;
+    for (uint32_t pageId : pageManager_.getPageIds())
+    {
+        for (const auto &stored : pageManager_.readRows(pageId))
+        {
+            Row row = Row::deserialize(columns, stored.data.data.data(), stored.data.data.size());
+            entries.emplace_back(toIndexKey(row.getValue(columnIndex), columns[columnIndex].type), stored.location);
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const BPlusTree::Entry &a, const BPlusTree::Entry &b)
+                     { return a.first < b.first; });
+
+    auto index = std::make_unique<BPlusTree>(tableDir_, columns[columnIndex].name, storage_, logger_);
+    index->removeFiles();
+    index->initialize();
+    if (!index->bulkLoad(entries))
+    {
+        return nullptr;
+    }
+    pageManager_.checkpoint();
+    index->markClean();
+    return index;
+}
+
+BPlusTree *Table::findIndex(const std::string &columnName)
+{
+    for (auto &index : indexes_)
+    {
+        if (index->getColumnName() == columnName)
+        {
+            return index.get();
+        }
+    }
+    return nullptr;
+}
+#endif
@@ -0,0 +1,23 @@
+#include "table_scan.h"
+
+bool TableScan::open()
+{
+    snapshot_ = pageManager_.snapshot();
+    nextPage_ = 0;
+    return true;
+}
+
+bool TableScan::next(RowBatch &batch)
+{
+    batch.rows.clear();
+    const PageIdView &pageIds = snapshot_.pageIds;
+    while (batch.rows.empty() && nextPage_ < pageIds.size())
+    {
+        for (auto &stored : pageManager_.readRows(pageIds[nextPage_], snapshot_))
+        {
+            batch.rows.push_back(std::move(stored.data.data));
+        }
+        nextPage_++;
+    }
+    return !batch.rows.empty();
+}
@@ -0,0 +1,277 @@
+#include "text_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "overflow_file.h"
+#include "row.h"
+
+namespace
+{
+    void need(const std::vector<char> &row, size_t offset, size_t bytes, size_t column)
+    {
+        if (offset + bytes > row.size())
+        {
+            throw std::runtime_error("Serialized row truncated at column " + std::to_string(column));
+        }
+    }
+
+    // Bytes of the value of a non-categorical column at offset, prefix included.
+    size_t fieldSize(const std::vector<char> &row, size_t offset, DataType type, size_t column)
+    {
+        if (type == DataType::INT || type == DataType::FLOAT)
+        {
+            return sizeof(int32_t);
+        }
+        need(row, offset, sizeof(uint16_t), column);
+        uint16_t prefix;
+        std::memcpy(&prefix, row.data() + offset, sizeof(uint16_t));
+        if (prefix == Row::OVERFLOW_TEXT)
+        {
+            return sizeof(uint16_t) + sizeof(OverflowRef);
+        }
+        if (prefix == Row::LONG_TEXT)
+        {
+            need(row, offset + sizeof(uint16_t), sizeof(uint32_t), column);
+            uint32_t length;
+            std::memcpy(&length, row.data() + offset + sizeof(uint16_t), sizeof(uint32_t));
+            return sizeof(uint16_t) + sizeof(uint32_t) + length;
+        }
+        return sizeof(uint16_t) + prefix;
+    }
+
+    bool isCategorical(const Column &column)
+    {
+        return column.categorical && column.type == DataType::TEXT;
+    }
+}
+
+void TextDictionary::appendCode(std::vector<char> &row, uint32_t code)
+{
+    do
+    {
+        uint8_t byte = code & 0x7f;
+        code >>= 7;
+        row.push_back(static_cast<char>(code != 0 ? byte | 0x80 : byte));
+    } while (code != 0);
+}
+
+uint32_t TextDictionary::readCode(const char *data, size_t size, size_t &offset)
+{
+    uint32_t code = 0;
+    for (size_t i = 0; i < MAX_CODE_BYTES; i++)
+    {
+        if (offset >= size)
+        {
+            break;
+        }
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        code |= static_cast<uint32_t>(byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0)
+        {
+            return code;
+        }
+    }
+    throw std::runtime_error("Malformed dictionary code in stored row");
+}
+
+void TextDictionary::initialize()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!storage_.fileExists(filename_))
+    {
+        storage_.createFile(filename_);
+    }
+    size_t fileSize = storage_.getSize(filename_);
+    std::vector<char> buffer(fileSize);
+    if (fileSize > 0 && !storage_.readFile(filename_, buffer.data(), fileSize))
+    {
+        throw std::runtime_error("Failed to read dictionary: " + filename_);
+    }
+
+    values_.clear();
+    codes_.clear();
+    size_t offset = 0;
+    while (offset + sizeof(uint16_t) <= fileSize)
+    {
+        uint16_t length;
+        std::memcpy(&length, buffer.data() + offset, sizeof(uint16_t));
+        if (offset + sizeof(uint16_t) + length > fileSize)
+        {
+            break;
+        }
+        std::string value(buffer.data() + offset + sizeof(uint16_t), length);
+        // Strings written by a change that never committed may repeat one.
+        codes_.emplace(value, static_cast<uint32_t>(values_.size()));
+        values_.push_back(std::move(value));
+        offset += sizeof(uint16_t) + length;
+    }
+    end_ = offset;
+    durableCodes_ = static_cast<uint32_t>(values_.size());
+}
+
+uint32_t TextDictionary::encode(const std::string &value)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = codes_.find(value);
+        if (it != codes_.end())
+        {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = codes_.find(value);
+    if (it != codes_.end())
+    {
+        return it->second;
+    }
+    if (value.size() >= Row::OVERFLOW_TEXT)
+    {
+        throw std::invalid_argument("Value of " + std::to_string(value.size()) + " bytes is too long for a categorical column");
+    }
+    if (values_.size() >= MAX_CODES)
+    {
+        throw std::runtime_error("Dictionary is full: " + filename_);
+    }
+    // Written before the code is handed out, so that syncing the file makes
+    // every code a row can hold durable.
+    std::vector<char> entry(sizeof(uint16_t) + value.size());
+    uint16_t length = static_cast<uint16_t>(value.size());
+    std::memcpy(entry.data(), &length, sizeof(uint16_t));
+    std::memcpy(entry.data() + sizeof(uint16_t), value.data(), value.size());
+    if (!storage_.writeFile(filename_, entry.data(), entry.size(), static_cast<std::streamoff>(end_)))
+    {
+        throw std::runtime_error("Failed to write dictionary: " + filename_);
+    }
+    end_ += entry.size();
+    uint32_t code = static_cast<uint32_t>(values_.size());
+    values_.push_back(value);
+    codes_.emplace(value, code);
+    return code;
+}
+
+bool TextDictionary::find(const std::string &value, uint32_t &code) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = codes_.find(value);
+    if (it == codes_.end())
+    {
+        return false;
+    }
+    code = it->second;
+    return true;
+}
+
+std::string TextDictionary::value(uint32_t code) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (code >= values_.size())
+    {
+        throw std::runtime_error("Unknown dictionary code " + std::to_string(code) + " in: " + filename_);
+    }
+    return values_[code];
+}
+
+size_t TextDictionary::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return values_.size();
+}
+
+bool TextDictionary::encodeRow(const std::vector<Column> &columns, std::vector<char> &row)
+{
+    std::vector<char> encoded;
+    encoded.reserve(row.size());
+    uint32_t maxCode = 0;
+    bool any = false;
+    size_t offset = 0;
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        size_t size = fieldSize(row, offset, columns[i].type, i);
+        need(row, offset, size, i);
+        if (!isCategorical(columns[i]))
+        {
+            encoded.insert(encoded.end(), row.begin() + offset, row.begin() + offset + size);
+            offset += size;
+            continue;
+        }
+        uint16_t prefix;
+        std::memcpy(&prefix, row.data() + offset, sizeof(uint16_t));
+        if (prefix == Row::LONG_TEXT || prefix == Row::OVERFLOW_TEXT)
+        {
+            throw std::invalid_argument("Value of column " + columns[i].name + " is too long for a categorical column");
+        }
+        uint32_t code = encode(std::string(row.data() + offset + sizeof(uint16_t), prefix));
+        appendCode(encoded, code);
+        maxCode = std::max(maxCode, code);
+        any = true;
+        offset += size;
+    }
+    row.swap(encoded);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return any && maxCode >= durableCodes_;
+}
+
+void TextDictionary::decodeRow(const std::vector<Column> &columns, std::vector<char> &row) const
+{
+    std::vector<char> decoded;
+    decoded.reserve(row.size());
+    size_t offset = 0;
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        if (!isCategorical(columns[i]))
+        {
+            size_t size = fieldSize(row, offset, columns[i].type, i);
+            need(row, offset, size, i);
+            decoded.insert(decoded.end(), row.begin() + offset, row.begin() + offset + size);
+            offset += size;
+            continue;
+        }
+        std::string text = value(readCode(row.data(), row.size(), offset));
+        uint16_t length = static_cast<uint16_t>(text.size());
+        const char *lenPtr = reinterpret_cast<const char *>(&length);
+        decoded.insert(decoded.end(), lenPtr, lenPtr + sizeof(uint16_t));
+        decoded.insert(decoded.end(), text.begin(), text.end());
+    }
+    row.swap(decoded);
+}
+
+uint32_t TextDictionary::codeAt(const std::vector<Column> &columns, const std::vector<char> &row, size_t columnIndex)
+{
+    if (columnIndex >= columns.size() || !isCategorical(columns[columnIndex]))
+    {
+        throw std::invalid_argument("Column " + std::to_string(columnIndex) + " is not categorical");
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < columnIndex; i++)
+    {
+        if (isCategorical(columns[i]))
+        {
+            readCode(row.data(), row.size(), offset);
+            continue;
+        }
+        offset += fieldSize(row, offset, columns[i].type, i);
+    }
+    return readCode(row.data(), row.size(), offset);
+}
+
+void TextDictionary::sync()
+{
+    uint32_t written;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        written = static_cast<uint32_t>(values_.size());
+        if (written == durableCodes_)
+        {
+            return;
+        }
+    }
+    storage_.syncData(filename_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    durableCodes_ = std::max(durableCodes_, written);
+}
@@ -0,0 +1,353 @@
+#include "wal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "hash.h"
+
+uint64_t WriteAheadLog::checksum(const std::vector<char> &payload, uint64_t lsn)
+{
+    return hashBytes(payload.data(), payload.size(), lsn);
+}
+
+bool WriteAheadLog::readFileHeader(int file, WalFileHeader &header)
+{
+    if (!storage_.fileExists(files_[file]) || storage_.getSize(files_[file]) < sizeof(WalFileHeader))
+    {
+        return false;
+    }
+    storage_.readFile(files_[file], reinterpret_cast<char *>(&header), sizeof(header));
+    return header.magic == MAGIC;
+}
+
+void WriteAheadLog::writeFileHeader(int file, uint64_t startLsn)
+{
+    WalFileHeader header{MAGIC, startLsn};
+    storage_.writeFile(files_[file], reinterpret_cast<char *>(&header), sizeof(header));
+    storage_.syncFile(files_[file]);
+}
+
+void WriteAheadLog::recover(const std::function<void(const WalRecord &)> &visit)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!storage_.fileExists(checkpointFile_))
+    {
+        LOG_DEBUG(logger_, "Creating write-ahead log: " + files_[0]);
+        writeFileHeader(0, 0);
+        WalCheckpoint checkpoint{MAGIC, 0};
+        storage_.writeFile(checkpointFile_, reinterpret_cast<char *>(&checkpoint), sizeof(checkpoint));
+        storage_.syncFile(checkpointFile_);
+        current_ = 0;
+        startLsn_ = nextLsn_ = durableLsn_ = syncedLsn_ = redoLsn_ = 0;
+        reserved_ = sizeof(WalFileHeader);
+        return;
+    }
+
+    WalCheckpoint checkpoint;
+    storage_.readFile(checkpointFile_, reinterpret_cast<char *>(&checkpoint), sizeof(checkpoint));
+    if (checkpoint.magic != MAGIC)
+    {
+        throw std::runtime_error("Not a write-ahead log checkpoint: " + checkpointFile_);
+    }
+    redoLsn_ = checkpoint.redo_lsn;
+
+    // The redo point is the start of one file. When a later checkpoint had
+    // already switched files, the other file continues where this one ends.
+    WalFileHeader headers[2];
+    bool valid[2] = {readFileHeader(0, headers[0]), readFileHeader(1, headers[1])};
+    int first = valid[0] && headers[0].start_lsn == redoLsn_ ? 0 : (valid[1] && headers[1].start_lsn == redoLsn_ ? 1 : -1);
+    if (first < 0)
+    {
+        throw std::runtime_error("No write-ahead log file starts at the redo point " + std::to_string(redoLsn_));
+    }
+
+    size_t replayed = 0;
+    current_ = first;
+    startLsn_ = redoLsn_;
+    uint64_t end = replayFile(first, visit, replayed);
+    int second = 1 - first;
+    if (valid[second] && headers[second].start_lsn == end && end != redoLsn_)
+    {
+        current_ = second;
+        startLsn_ = end;
+        end = replayFile(second, visit, replayed);
+    }
+    nextLsn_ = durableLsn_ = syncedLsn_ = end;
+    reserved_ = storage_.getSize(files_[current_]);
+    LOG_INFO(logger_, "Replayed " + std::to_string(replayed) + " write-ahead log records (" +
+                          std::to_string(end - redoLsn_) + " bytes) from lsn " + std::to_string(redoLsn_));
+}
+
+uint64_t WriteAheadLog::replayFile(int file, const std::function<void(const WalRecord &)> &visit, size_t &replayed)
+{
+    // Replay until the first record that is torn or left over from an earlier
+    // use of the file; both show up as an LSN or checksum mismatch.
+    const std::string &filename = files_[file];
+    size_t fileSize = storage_.getSize(filename);
+    uint64_t offset = sizeof(WalFileHeader);
+    uint64_t lsn = startLsn_;
+    while (offset + sizeof(WalRecordHeader) <= fileSize)
+    {
+        WalRecordHeader recordHeader;
+        storage_.readFile(filename, reinterpret_cast<char *>(&recordHeader), sizeof(recordHeader), static_cast<std::streamoff>(offset));
+        if (recordHeader.lsn != lsn || recordHeader.length == 0 ||
+            offset + sizeof(WalRecordHeader) + recordHeader.length > fileSize)
+        {
+            break;
+        }
+
+        WalRecord record{recordHeader.type, recordHeader.lsn, std::vector<char>(recordHeader.length)};
+        storage_.readFile(filename, record.payload.data(), record.payload.size(),
+                          static_cast<std::streamoff>(offset + sizeof(WalRecordHeader)));
+        if (checksum(record.payload, lsn) != recordHeader.checksum)
+        {
+            break;
+        }
+        visit(record);
+
+        uint64_t recordSize = sizeof(WalRecordHeader) + recordHeader.length;
+        offset += recordSize;
+        lsn += recordSize;
+        replayed++;
+    }
+    return lsn;
+}
+
+uint64_t WriteAheadLog::commit(WalRecordType type, const std::vector<char> &payload)
+{
+    uint64_t lsn = append(type, payload);
+    waitDurable(lsn);
+    return lsn;
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, const std::vector<char> &payload)
+{
+    if (payload.empty() || payload.size() > UINT32_MAX)
+    {
+        throw std::invalid_argument("Write-ahead log records must hold 1 byte to 4 GB");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed_)
+    {
+        throw std::runtime_error("Write-ahead log is unusable after a failed flush: " + files_[current_]);
+    }
+    uint64_t lsn = nextLsn_;
+    WalRecordHeader header{static_cast<uint32_t>(payload.size()), type, lsn, checksum(payload, lsn)};
+    const char *headerPtr = reinterpret_cast<const char *>(&header);
+    buffer_.insert(buffer_.end(), headerPtr, headerPtr + sizeof(header));
+    buffer_.insert(buffer_.end(), payload.begin(), payload.end());
+    nextLsn_ += sizeof(header) + payload.size();
+    return lsn;
+}
+
+void WriteAheadLog::waitDurable(uint64_t lsn)
+{
+    // Flushes end on record boundaries, so the record is durable once the
+    // durable end has moved past its start. Whoever finds no flush running
+    // writes everything buffered so far, including the records of threads
+    // waiting on the running flush.
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (durableLsn_ <= lsn)
+    {
+        if (failed_)
+        {
+            throw std::runtime_error("Write-ahead log flush failed: " + files_[current_]);
+        }
+        if (flushing_)
+        {
+            flushed_.wait(lock);
+            continue;
+        }
+        flushLocked(lock);
+    }
+}
+
+void WriteAheadLog::flushLocked(std::unique_lock<std::mutex> &lock)
+{
+    flushing_ = true;
+    std::vector<char> batch;
+    batch.swap(buffer_);
+    uint64_t batchStart = durableLsn_;
+    uint64_t batchEnd = nextLsn_;
+    DurabilityMode mode = policy_.mode;
+    size_t fileEnd = sizeof(WalFileHeader) + (batchEnd - startLsn_);
+    size_t reserve = 0;
+    if (fileEnd > reserved_)
+    {
+        reserve = reserved_ = (fileEnd / WAL_EXTENT + 1) * WAL_EXTENT;
+    }
+    lock.unlock();
+
+    bool success = true;
+    bool synced = mode == DurabilityMode::FSYNC || mode == DurabilityMode::FDATASYNC;
+    try
+    {
+        if (reserve > 0)
+        {
+            storage_.preallocate(files_[current_], reserve);
+        }
+        std::streamoff offset = static_cast<std::streamoff>(sizeof(WalFileHeader) + (batchStart - startLsn_));
+        storage_.writeFile(files_[current_], batch.data(), batch.size(), offset);
+        if (mode == DurabilityMode::FSYNC)
+        {
+            storage_.syncFile(files_[current_]);
+        }
+        else if (mode == DurabilityMode::FDATASYNC)
+        {
+            storage_.syncData(files_[current_]);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(logger_, "Failed to flush write-ahead log: " + files_[current_] + ", error: " + e.what());
+        success = false;
+    }
+
+    lock.lock();
+    flushing_ = false;
+    if (success)
+    {
+        durableLsn_ = batchEnd;
+        if (synced)
+        {
+            syncedLsn_ = batchEnd;
+        }
+    }
+    else
+    {
+        failed_ = true;
+    }
+    flushed_.notify_all();
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    stopSyncer();
+}
+
+void WriteAheadLog::setDurability(const DurabilityPolicy &policy)
+{
+    if (policy.mode == DurabilityMode::PERIODIC && policy.interval_ms == 0)
+    {
+        throw std::invalid_argument("Periodic durability needs an interval");
+    }
+    stopSyncer();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        policy_ = policy;
+        stopSyncer_ = false;
+    }
+    if (policy.mode == DurabilityMode::PERIODIC)
+    {
+        syncer_ = std::thread(&WriteAheadLog::syncLoop, this);
+    }
+}
+
+void WriteAheadLog::stopSyncer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopSyncer_ = true;
+    }
+    syncerWake_.notify_all();
+    if (syncer_.joinable())
+    {
+        syncer_.join();
+    }
+}
+
+void WriteAheadLog::syncLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::chrono::milliseconds interval(policy_.interval_ms);
+    while (!syncerWake_.wait_for(lock, interval, [this]
+                                 { return stopSyncer_; }))
+    {
+        // A running flush either syncs itself or is picked up next time.
+        if (flushing_ || failed_ || syncedLsn_ >= durableLsn_)
+        {
+            continue;
+        }
+        flushing_ = true;
+        uint64_t target = durableLsn_;
+        lock.unlock();
+
+        bool success = true;
+        try
+        {
+            storage_.syncData(files_[current_]);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(logger_, "Failed to sync write-ahead log: " + files_[current_] + ", error: " + e.what());
+            success = false;
+        }
+
+        lock.lock();
+        flushing_ = false;
+        if (success)
+        {
+            syncedLsn_ = std::max(syncedLsn_, target);
+        }
+        else
+        {
+            failed_ = true;
+        }
+        flushed_.notify_all();
+    }
+}
+
+uint64_t WriteAheadLog::switchFile()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.wait(lock, [this]
+                  { return !flushing_; });
+    if (!buffer_.empty())
+    {
+        throw std::runtime_error("Cannot switch write-ahead log files while commits are in flight");
+    }
+    if (redoLsn_ < startLsn_ || nextLsn_ == startLsn_)
+    {
+        return startLsn_;
+    }
+    // Recovery only continues into the next file when this one is intact up
+    // to its start.
+    if (syncedLsn_ < durableLsn_)
+    {
+        storage_.syncData(files_[current_]);
+        syncedLsn_ = durableLsn_;
+    }
+    // Stale records left in the other file have LSNs below the new start, so
+    // writing the header is enough to empty it.
+    int next = 1 - current_;
+    writeFileHeader(next, nextLsn_);
+    current_ = next;
+    startLsn_ = nextLsn_;
+    reserved_ = storage_.getSize(files_[current_]);
+    LOG_DEBUG(logger_, "Switched write-ahead log to " + files_[current_] + " at lsn " + std::to_string(startLsn_));
+    return startLsn_;
+}
+
+void WriteAheadLog::checkpointed(uint64_t redoLsn)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    WalCheckpoint checkpoint{MAGIC, redoLsn};
+    storage_.writeFile(checkpointFile_, reinterpret_cast<char *>(&checkpoint), sizeof(checkpoint));
+    storage_.syncFile(checkpointFile_);
+    redoLsn_ = redoLsn;
+}
+
+uint64_t WriteAheadLog::getEndLsn()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextLsn_;
+}
+
+uint64_t WriteAheadLog::getSize()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextLsn_ - redoLsn_;
+}
@@ -0,0 +1,249 @@
+#include "zone_map.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+    void widen(ColumnZone &zone, int64_t key)
+    {
+        if (!zone.has_values)
+        {
+            zone.min = key;
+            zone.max = key;
+            zone.has_values = 1;
+            return;
+        }
+        if (key < zone.min)
+        {
+            zone.min = key;
+        }
+        if (key > zone.max)
+        {
+            zone.max = key;
+        }
+    }
+}
+
+int64_t ZoneMap::toZoneKey(const Row::Value &value, DataType type)
+{
+    switch (type)
+    {
+    case DataType::INT:
+        return std::get<int32_t>(value);
+    case DataType::DATE:
+        return Row::dateToKey(std::get<std::string>(value));
+    case DataType::FLOAT:
+    {
+        // Flip the sign bit of positives and all bits of negatives so that the
+        // unsigned bit patterns sort like the floats they encode. -0.0 equals
+        // +0.0 and gets its key.
+        float f = std::get<float>(value);
+        if (f == 0.0f)
+        {
+            f = 0.0f;
+        }
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        return static_cast<int64_t>(bits);
+    }
+    case DataType::TEXT:
+    {
+        // First 7 bytes big-endian; the top byte stays 0 so the key is never negative.
+        const auto &text = std::get<std::string>(value);
+        uint64_t key = 0;
+        for (size_t i = 0; i < 7; i++)
+        {
+            key <<= 8;
+            if (i < text.size())
+            {
+                key |= static_cast<unsigned char>(text[i]);
+            }
+        }
+        return static_cast<int64_t>(key);
+    }
+    default:
+        throw std::runtime_error("Unsupported data type in zone map");
+    }
+}
+
+bool ZoneMap::initialize()
+{
+    try
+    {
+        if (!storage_.fileExists(filename_) || storage_.getSize(filename_) < sizeof(ZoneMapHeader))
+        {
+            LOG_DEBUG(logger_, "Zone map file does not exist yet: " + filename_);
+            return true;
+        }
+
+        size_t fileSize = storage_.getSize(filename_);
+        std::vector<char> buffer(fileSize);
+        storage_.readFile(filename_, buffer.data(), fileSize, 0);
+
+        ZoneMapHeader header;
+        std::memcpy(&header, buffer.data(), sizeof(ZoneMapHeader));
+        size_t recordSize = sizeof(uint32_t) + header.num_columns * sizeof(ColumnZone);
+        if (sizeof(ZoneMapHeader) + header.num_pages * recordSize > fileSize)
+        {
+            throw std::runtime_error("Zone map file is truncated: " + filename_);
+        }
+
+        const char *cursor = buffer.data() + sizeof(ZoneMapHeader);
+        std::unique_lock<std::shared_mutex> lock(latch_);
+        for (uint32_t i = 0; i < header.num_pages; i++)
+        {
+            uint32_t pageId;
+            std::memcpy(&pageId, cursor, sizeof(uint32_t));
+            cursor += sizeof(uint32_t);
+
+            std::vector<ColumnZone> pageZones(header.num_columns);
+            std::memcpy(pageZones.data(), cursor, header.num_columns * sizeof(ColumnZone));
+            cursor += header.num_columns * sizeof(ColumnZone);
+
+            if (zones_.size() <= pageId)
+            {
+                zones_.resize(pageId + 1);
+            }
+            zones_[pageId] = std::move(pageZones);
+        }
+        LOG_DEBUG(logger_, "Loaded zone map for " + std::to_string(header.num_pages) + " pages");
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to initialize zone map: " + std::string(e.what()));
+    }
+}
+
+void ZoneMap::setSchema(const std::vector<Column> &columns)
+{
+    columns_ = columns;
+}
+
+void ZoneMap::extend(uint32_t pageId, uint32_t rowId, const Row &row)
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    std::vector<ColumnZone> &pageZones = zonesOf(pageId);
+    for (size_t i = 0; i < columns_.size(); i++)
+    {
+        widen(pageZones[i], toZoneKey(row.getValue(i), columns_[i].type));
+    }
+    widen(pageZones[columns_.size()], rowId);
+}
+
+void ZoneMap::extendRowId(uint32_t pageId, uint32_t rowId)
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    widen(zonesOf(pageId)[columns_.size()], rowId);
+}
+
+std::vector<ColumnZone> &ZoneMap::zonesOf(uint32_t pageId)
+{
+    if (zones_.size() <= pageId)
+    {
+        zones_.resize(pageId + 1);
+    }
+    auto &pageZones = zones_[pageId];
+    if (pageZones.empty())
+    {
+        pageZones.assign(columns_.size() + 1, ColumnZone{0, 0, 0, 0});
+    }
+    else if (pageZones.size() == columns_.size())
+    {
+        // Written before zones covered row ids: any id may be on the page.
+        pageZones.push_back(ColumnZone{0, INT64_MAX, 0, 1});
+    }
+    return pageZones;
+}
+
+bool ZoneMap::mayContain(uint32_t pageId, size_t columnIndex, int64_t lowKey, int64_t highKey) const
+{
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (pageId >= zones_.size() || columnIndex >= zones_[pageId].size())
+    {
+        // No statistics for this page: it has to be read.
+        return true;
+    }
+    const ColumnZone &zone = zones_[pageId][columnIndex];
+    if (!zone.has_values)
+    {
+        return false;
+    }
+    return !(zone.min > highKey || zone.max < lowKey);
+}
+
+bool ZoneMap::mayContainRowId(uint32_t pageId, uint32_t rowId) const
+{
+    return mayContain(pageId, columns_.size(), rowId, rowId);
+}
+
+std::vector<ColumnZone> ZoneMap::getZones(uint32_t pageId) const
+{
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (pageId >= zones_.size())
+    {
+        return {};
+    }
+    return zones_[pageId];
+}
+
+void ZoneMap::persist()
+{
+    if (columns_.empty())
+    {
+        return;
+    }
+
+    ZoneMapHeader header{0, static_cast<uint16_t>(columns_.size() + 1), 0};
+    std::vector<char> buffer(sizeof(ZoneMapHeader));
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    for (uint32_t pageId = 0; pageId < zones_.size(); pageId++)
+    {
+        const auto &pageZones = zones_[pageId];
+        if (pageZones.size() != columns_.size() && pageZones.size() != columns_.size() + 1)
+        {
+            continue;
+        }
+        const char *idPtr = reinterpret_cast<const char *>(&pageId);
+        buffer.insert(buffer.end(), idPtr, idPtr + sizeof(uint32_t));
+        const char *zonePtr = reinterpret_cast<const char *>(pageZones.data());
+        buffer.insert(buffer.end(), zonePtr, zonePtr + pageZones.size() * sizeof(ColumnZone));
+        if (pageZones.size() == columns_.size())
+        {
+            ColumnZone anyRowId{0, INT64_MAX, 0, 1};
+            const char *anyPtr = reinterpret_cast<const char *>(&anyRowId);
+            buffer.insert(buffer.end(), anyPtr, anyPtr + sizeof(ColumnZone));
+        }
+        header.num_pages++;
+    }
+    lock.unlock();
+    std::memcpy(buffer.data(), &header, sizeof(ZoneMapHeader));
+
+    try
+    {
+        storage_.writeFile(filename_, buffer.data(), buffer.size());
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(logger_, "Failed to persist zone map to file: " + filename_ + ", error: " + e.what());
+    }
+}
+
+void ZoneMap::sync()
+{
+    if (storage_.fileExists(filename_))
+    {
+        storage_.syncFile(filename_);
+    }
+}
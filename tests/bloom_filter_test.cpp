@@ -0,0 +1,83 @@
+// Bloom filters: equality scans over unordered keys, where zone maps cannot
+// help, read only the pages that may hold the key. Filters cover rows
+// inserted after they were built and survive reopening the table.
+#include <string>
+
+#include "database.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ROWS = 20000;
+    constexpr size_t MORE_ROWS = 2000;
+    constexpr int32_t PROBES = 200;
+    constexpr size_t ABSENT = 50000; // Keys of rows from here on are never loaded.
+
+    // Keys in scrambled order, so every page spans nearly the whole key range.
+    int32_t keyOf(size_t i)
+    {
+        return static_cast<int32_t>((i * 7919) % 100003);
+    }
+
+    std::string writeRows(const std::string &filename, size_t first, size_t rows)
+    {
+        return writeTsv(filename, "k\tname", rows, [first](std::ostream &out, size_t i)
+                        { out << keyOf(first + i) << "\tuser" << keyOf(first + i); });
+    }
+
+    // Looks up PROBES keys of rows [first, first + PROBES) and as many absent
+    // keys inside the range of every zone, and returns the pages read per
+    // lookup.
+    double pagesPerLookup(CountingStorage &storage, Table &table, size_t first)
+    {
+        size_t before = storage.pageReads;
+        for (int32_t p = 0; p < PROBES; p++)
+        {
+            int32_t key = keyOf(first + static_cast<size_t>(p));
+            CHECK(table.lookup("k", key).size() == 1);
+            CHECK(table.lookup("name", "user" + std::to_string(key)).size() == 1);
+            int32_t absent = keyOf(ABSENT + static_cast<size_t>(p));
+            CHECK(table.lookup("k", absent).empty());
+            CHECK(table.lookup("name", "user" + std::to_string(absent)).empty());
+        }
+        return static_cast<double>(storage.pageReads - before) / (4 * PROBES);
+    }
+
+    void checkLookups(CountingStorage &storage, Table &table)
+    {
+        // Half a page per lookup, as half the keys are present, and about 1%
+        // of the other pages as false positives.
+        CHECK(pagesPerLookup(storage, table, 0) < 3.0);
+        CHECK(pagesPerLookup(storage, table, ROWS) < 3.0);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    CountingStorage storage(logger);
+    std::string dir = freshDirectory("bloom_filter");
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"k", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(writeRows(dir + "/rows.tsv", 0, ROWS)));
+        size_t pages = table.getPageManager().getPageIds().size();
+        CHECK(pages > 50);
+
+        // Without filters every lookup reads every page.
+        size_t before = storage.pageReads;
+        CHECK(table.lookup("k", keyOf(5)).size() == 1);
+        CHECK(storage.pageReads - before == pages);
+
+        CHECK(table.createBloomFilter("k"));
+        CHECK(table.createBloomFilter("name"));
+        CHECK(table.writeDataFromFile(writeRows(dir + "/more.tsv", ROWS, MORE_ROWS)));
+        checkLookups(storage, table);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    checkLookups(storage, db.getTable("rows"));
+    return 0;
+}
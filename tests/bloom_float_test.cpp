@@ -0,0 +1,62 @@
+// Equality scans on a FLOAT column with a bloom filter must find -0.0 rows
+// when asked for 0.0 and the other way round, as the two compare equal.
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "bloom_filter.h"
+#include "database.h"
+#include "file_storage.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ZERO_ROWS = 3000;
+    constexpr size_t MIXED_ROWS = 3000;
+
+    size_t countSignedZeros(const std::vector<Row> &rows, bool negative)
+    {
+        size_t count = 0;
+        for (const auto &row : rows)
+        {
+            float x = row.getFloat(1);
+            count += x == 0.0f && std::signbit(x) == negative ? 1 : 0;
+        }
+        return count;
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("bloom_float");
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    CHECK(PageBloomFilters::hashValue(-0.0f, DataType::FLOAT) == PageBloomFilters::hashValue(0.0f, DataType::FLOAT));
+    CHECK(PageBloomFilters::hashValue(-nan, DataType::FLOAT) == PageBloomFilters::hashValue(nan, DataType::FLOAT));
+    CHECK(PageBloomFilters::hashValue(std::nanf("7"), DataType::FLOAT) == PageBloomFilters::hashValue(nan, DataType::FLOAT));
+
+    // First pages hold -0.0 alone, so their zones hold no other value. Later
+    // ones mix -0.0 and +0.0 with -1 and 1, so only the bloom filter can
+    // tell them apart.
+    Table &table = db.createTable("floats", {{"id", DataType::INT}, {"x", DataType::FLOAT}});
+    CHECK(table.writeDataFromFile(writeTsv(dir + "/zeros.tsv", "id\tx", ZERO_ROWS, [](std::ostream &out, size_t i)
+                                           { out << i << "\t-0"; })));
+    const char *mixed[] = {"-0", "-1", "0", "1"};
+    CHECK(table.writeDataFromFile(writeTsv(dir + "/mixed.tsv", "id\tx", MIXED_ROWS, [&](std::ostream &out, size_t i)
+                                           { out << ZERO_ROWS + i << "\t" << mixed[i % 4]; })));
+    CHECK(table.createBloomFilter("x"));
+
+    for (float probe : {0.0f, -0.0f})
+    {
+        std::vector<Row> rows = table.lookup("x", probe);
+        CHECK(rows.size() == ZERO_ROWS + MIXED_ROWS / 2);
+        CHECK(countSignedZeros(rows, true) == ZERO_ROWS + MIXED_ROWS / 4);
+        CHECK(countSignedZeros(rows, false) == MIXED_ROWS / 4);
+    }
+    CHECK(table.lookup("x", nan).empty());
+    return 0;
+}
@@ -0,0 +1,137 @@
+// B+tree indexes: bulk loads, inserts that split nodes, duplicates and
+// removal on the tree itself, then index range queries over INT and DATE
+// columns of a table, before and after it is reopened.
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+#include "database.h"
+#include "file_storage.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr int32_t KEYS = 20000;
+    constexpr size_t TABLE_ROWS = 10000;
+
+    Location locationOf(int32_t key, uint16_t copy)
+    {
+        return Location{static_cast<uint32_t>(key) + 1, copy};
+    }
+
+    // Every key in [low, high] once per copy, in key order.
+    void checkRange(BPlusTree &tree, int32_t low, int32_t high, uint16_t copies)
+    {
+        std::vector<Location> found = tree.rangeScan(low, high);
+        CHECK(found.size() == static_cast<size_t>(high - low + 1) * copies);
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            CHECK(found[i].page_id == static_cast<uint32_t>(low + static_cast<int32_t>(i / copies)) + 1);
+        }
+    }
+
+    void checkTree(IStorage &storage, ILogger &logger, const std::string &dir)
+    {
+        {
+            BPlusTree tree(dir, "k", storage, logger);
+            CHECK(tree.initialize());
+            std::vector<BPlusTree::Entry> entries;
+            for (int32_t key = 0; key < KEYS; key += 2)
+            {
+                entries.emplace_back(key, locationOf(key, 0));
+            }
+            CHECK(tree.bulkLoad(entries));
+            checkRange(tree, 0, 0, 1);
+
+            // Odd keys in random order split the packed leaves.
+            std::vector<int32_t> odd;
+            for (int32_t key = 1; key < KEYS; key += 2)
+            {
+                odd.push_back(key);
+            }
+            std::shuffle(odd.begin(), odd.end(), std::mt19937(7));
+            for (int32_t key : odd)
+            {
+                CHECK(tree.insert(key, locationOf(key, 0)));
+            }
+            checkRange(tree, 0, KEYS - 1, 1);
+            checkRange(tree, 4321, 4400, 1);
+            CHECK(tree.rangeScan(KEYS, KEYS + 100).empty());
+            CHECK(tree.rangeScan(100, 200, 10).size() == 10);
+
+            // Duplicates of one key spanning many leaves.
+            for (uint16_t copy = 1; copy < 2000; copy++)
+            {
+                CHECK(tree.insert(777, Location{778, copy}));
+            }
+            CHECK(tree.rangeScan(777, 777).size() == 2000);
+            CHECK(tree.remove(777, Location{778, 1500}));
+            CHECK(!tree.remove(777, Location{778, 1500}));
+            CHECK(tree.rangeScan(777, 777).size() == 1999);
+            CHECK(tree.size() == KEYS + 1998);
+        }
+
+        BPlusTree reopened(dir, "k", storage, logger);
+        CHECK(reopened.initialize());
+        CHECK(reopened.size() == KEYS + 1998);
+        checkRange(reopened, 0, 776, 1);
+        checkRange(reopened, 778, KEYS - 1, 1);
+        CHECK(reopened.rangeScan(777, 777).size() == 1999);
+    }
+
+    std::string dateOf(size_t i)
+    {
+        char date[11];
+        std::snprintf(date, sizeof(date), "%02zu/%02zu/%04zu", i % 28 + 1, (i / 28) % 12 + 1, 2000 + i / 336);
+        return date;
+    }
+
+    void checkTable(Table &table)
+    {
+        std::vector<Row> rows = table.rangeQuery("id", 100, 4999);
+        CHECK(rows.size() == 4900);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            CHECK(rows[i].getInt(0) == static_cast<int32_t>(100 + i));
+        }
+        CHECK(table.lookup("id", 9999).size() == 1);
+        CHECK(table.lookup("id", static_cast<int32_t>(TABLE_ROWS)).empty());
+        // 336 days a year, from 2000 on.
+        CHECK(table.rangeQuery("day", std::string("01/01/2005"), std::string("28/12/2005")).size() == 336);
+        CHECK(table.lookup("day", dateOf(1234)).size() == 1);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("btree");
+    checkTree(storage, logger, dir);
+
+    std::string data = writeTsv(dir + "/rows.tsv", "id\tday\tname", TABLE_ROWS, [](std::ostream &out, size_t i)
+                                { out << TABLE_ROWS - 1 - i << "\t" << dateOf(TABLE_ROWS - 1 - i) << "\tn" << i; });
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"day", DataType::DATE}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(data));
+        CHECK(table.createIndex("id"));
+        CHECK(table.createIndex("day"));
+        CHECK(!table.createIndex("name"));
+        checkTable(table);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    Table &table = db.getTable("rows");
+    checkTable(table);
+    BPlusTree index(dir + "/db/rows", "id", storage, logger);
+    CHECK(index.initialize());
+    CHECK(index.isClean());
+    CHECK(index.size() == TABLE_ROWS);
+    return 0;
+}
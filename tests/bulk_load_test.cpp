@@ -0,0 +1,78 @@
+// Parallel bulk loads into an indexed table, one of them with a file that
+// fails to load: the indexes must hold exactly the published rows, before and
+// after the table is reopened. Every indexed column has an unindexed twin.
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+#include "database.h"
+#include "file_storage.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t FILES = 4;
+    constexpr size_t FILE_ROWS = 3000;
+    const std::string HEADER = "k\tk2\tname\tname2";
+
+    std::string writeFile(const std::string &dir, size_t file)
+    {
+        return writeTsv(dir + "/load" + std::to_string(file) + ".tsv", HEADER, FILE_ROWS, [file](std::ostream &out, size_t i)
+                        {
+                            size_t k = file * FILE_ROWS + i;
+                            out << k << "\t" << k << "\tv" << k % 30 << "\tv" << k % 30; });
+    }
+
+    void checkIndexes(Table &table, size_t expectedRows)
+    {
+        CHECK(table.rangeQuery("k2", INT_MIN, INT_MAX).size() == expectedRows);
+        CHECK(table.rangeQuery("k", INT_MIN, INT_MAX).size() == expectedRows);
+        CHECK(table.findRowIds("k", 4321).size() == table.findRowIds("k2", 4321).size());
+        for (const std::string value : {"v0", "v17"})
+        {
+            CHECK(table.lookup("name", value).size() == table.lookup("name2", value).size());
+        }
+    }
+}
+
+int main()
+{
+    std::string dir = freshDirectory("bulk_load");
+    std::vector<std::string> files;
+    for (size_t file = 0; file < FILES + 1; file++)
+    {
+        files.push_back(writeFile(dir, file));
+    }
+    {
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"k", DataType::INT}, {"k2", DataType::INT}, {"name", DataType::TEXT}, {"name2", DataType::TEXT}});
+        CHECK(table.createIndex("k"));
+        CHECK(table.createHashIndex("name"));
+
+        CHECK(table.writeDataFromFiles(std::vector<std::string>(files.begin(), files.begin() + FILES)));
+        checkIndexes(table, FILES * FILE_ROWS);
+
+        // The loader of the missing file fails; the other one publishes its rows.
+        bool threw = false;
+        try
+        {
+            table.writeDataFromFiles({files[FILES], dir + "/missing.tsv"});
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+        checkIndexes(table, (FILES + 1) * FILE_ROWS);
+    }
+
+    NullLogger logger;
+    FileStorage storage(logger);
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    checkIndexes(db.getTable("rows"), (FILES + 1) * FILE_ROWS);
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Database catalog: tables of every layout and page size are listed, with
+// their schemas, after reopening without opening any of them, and a table is
+// opened once, on first use, also when threads ask for it together. A torn
+// record or one failing its checksum at the end of the catalog is dropped,
+// and the next table created takes its place.
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "database.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t TABLES = 60;
+    constexpr size_t ROWS = 500;
+    constexpr size_t THREADS = 4;
+
+    std::string nameOf(size_t i)
+    {
+        char name[16];
+        std::snprintf(name, sizeof(name), "t%03zu", i);
+        return name;
+    }
+
+    std::vector<Column> columnsOf(size_t i)
+    {
+        std::vector<Column> columns = {{"id", DataType::INT}, {"label", DataType::TEXT, i % 2 == 0}};
+        for (size_t extra = 0; extra < i % 4; extra++)
+        {
+            columns.push_back({"c" + std::to_string(extra), extra % 2 == 0 ? DataType::FLOAT : DataType::DATE});
+        }
+        return columns;
+    }
+
+    PageLayout layoutOf(size_t i)
+    {
+        return i % 3 == 0 ? PageLayout::SLOTTED : i % 3 == 1 ? PageLayout::PAX : PageLayout::COMPRESSED;
+    }
+
+    size_t pageSizeOf(size_t i)
+    {
+        return MIN_PAGE_SIZE << (i % 5);
+    }
+
+    void createTables(Database &db, const std::string &dir)
+    {
+        for (size_t i = 0; i < TABLES; i++)
+        {
+            Table &table = db.createTable(nameOf(i), columnsOf(i), layoutOf(i), pageSizeOf(i));
+            if (i % 20 == 0)
+            {
+                CHECK(table.writeDataFromFile(writeTsv(dir + "/rows.tsv", "id\tlabel", ROWS, [](std::ostream &out, size_t row)
+                                                       { out << row << "\tl" << row % 7; })));
+            }
+        }
+    }
+
+    void checkCatalog(Database &db, size_t tables)
+    {
+        std::vector<std::string> names = db.listTables();
+        CHECK(names.size() == tables);
+        for (size_t i = 0; i < TABLES; i++)
+        {
+            CHECK(names[i] == nameOf(i));
+            CHECK(db.hasTable(nameOf(i)));
+            std::vector<Column> columns = db.getSchema(nameOf(i));
+            std::vector<Column> expected = columnsOf(i);
+            CHECK(columns.size() == expected.size());
+            for (size_t c = 0; c < columns.size(); c++)
+            {
+                CHECK(columns[c].name == expected[c].name);
+                CHECK(columns[c].type == expected[c].type);
+                CHECK(columns[c].categorical == expected[c].categorical);
+            }
+        }
+        CHECK(!db.hasTable("missing"));
+        CHECK(db.openTableCount() == 0);
+    }
+
+    template <typename Action>
+    bool refused(Action action)
+    {
+        try
+        {
+            action();
+        }
+        catch (const std::invalid_argument &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // Every thread gets the same table, opened once.
+    void checkOpen(Database &db)
+    {
+        std::vector<Table *> tables(THREADS, nullptr);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREADS; t++)
+        {
+            threads.emplace_back([&db, &tables, t]
+                                 { tables[t] = &db.getTable(nameOf(20)); });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        for (Table *table : tables)
+        {
+            CHECK(table == tables[0]);
+        }
+        CHECK(db.openTableCount() == 1);
+        CHECK(tables[0]->getPageManager().getPageSize() == pageSizeOf(20));
+        CHECK(tables[0]->lookup("label", std::string("l3")).size() == (ROWS + 3) / 7);
+        CHECK(db.openTableCount() == 1);
+        CHECK(refused([&db]
+                      { db.getTable("missing"); }));
+    }
+
+    void appendToCatalog(IStorage &storage, const std::string &dir, const std::vector<char> &bytes)
+    {
+        storage.appendFile(dir + "/db/catalog.dat", bytes.data(), bytes.size());
+    }
+
+    // Header of a record of length bytes with the given checksum.
+    std::vector<char> recordHeader(uint32_t length, uint32_t checksum)
+    {
+        std::vector<char> header(2 * sizeof(uint32_t));
+        std::memcpy(header.data(), &length, sizeof(length));
+        std::memcpy(header.data() + sizeof(length), &checksum, sizeof(checksum));
+        return header;
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("catalog");
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        createTables(db, dir);
+        CHECK(db.openTableCount() == TABLES);
+        CHECK(refused([&db]
+                      { db.createTable(nameOf(1), columnsOf(1)); }));
+        for (const std::string name : {"", "a/b", "..", "."})
+        {
+            CHECK(refused([&db, &name]
+                          { db.createTable(name, columnsOf(0)); }));
+        }
+        CHECK(db.listTables().size() == TABLES);
+    }
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        checkCatalog(db, TABLES);
+        checkOpen(db);
+    }
+
+    // A record cut short by a crash: its header and part of its payload.
+    std::vector<char> torn = recordHeader(100, 0x12345678);
+    torn.resize(torn.size() + 10, 'x');
+    appendToCatalog(storage, dir, torn);
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        checkCatalog(db, TABLES);
+        db.createTable("later", columnsOf(1));
+        CHECK(db.hasTable("later"));
+    }
+
+    // A whole record whose payload does not match its checksum.
+    std::vector<char> garbled = recordHeader(16, 0x12345678);
+    garbled.resize(garbled.size() + 16, 'y');
+    appendToCatalog(storage, dir, garbled);
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        CHECK(db.listTables().size() == TABLES + 1);
+        CHECK(db.hasTable("later"));
+        CHECK(db.getSchema("later").size() == columnsOf(1).size());
+        db.createTable("last", columnsOf(2));
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    CHECK(db.listTables().size() == TABLES + 2);
+    CHECK(db.getSchema("last").size() == columnsOf(2).size());
+    CHECK(db.openTableCount() == 0);
+    return 0;
+}
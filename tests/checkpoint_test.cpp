@@ -0,0 +1,122 @@
+// A checkpoint bounds what recovery replays: after a crash only the records
+// committed since the last checkpoint are in the log from its redo point,
+// and replaying them onto the checkpointed pages restores every row and
+// index entry. A clean shutdown leaves nothing to replay.
+#include <cstring>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "table_scan.h"
+#include "test_util.h"
+#include "wal.h"
+
+namespace
+{
+    constexpr size_t BATCH_ROWS = 500;
+    constexpr size_t BATCHES_BEFORE = 12; // Checkpointed.
+    constexpr size_t BATCHES_AFTER = 8;   // Only in the log when the process dies.
+    constexpr size_t ROWS = (BATCHES_BEFORE + BATCHES_AFTER) * BATCH_ROWS;
+    const std::string HEADER = "id\tname";
+
+    void load(Table &table, const std::string &dir, size_t firstBatch, size_t batches)
+    {
+        for (size_t b = firstBatch; b < firstBatch + batches; b++)
+        {
+            CHECK(table.writeDataFromFile(writeTsv(dir + "/batch" + std::to_string(b) + ".tsv", HEADER, BATCH_ROWS, [b](std::ostream &out, size_t i)
+                                                   { out << b * BATCH_ROWS + i << "\tname" << (b * BATCH_ROWS + i) % 50; })));
+        }
+    }
+
+    [[noreturn]] void loadAndCrash(const std::string &dir)
+    {
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.createIndex("id"));
+        load(table, dir, 0, BATCHES_BEFORE);
+        table.getPageManager().checkpoint();
+        load(table, dir, BATCHES_BEFORE, BATCHES_AFTER);
+        _exit(0);
+    }
+
+    // Rows inserted by the records a recovery would replay.
+    std::vector<std::pair<uint32_t, uint32_t>> loggedRows(IStorage &storage, ILogger &logger, const std::string &tableDir)
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> rows; // (first row id, count)
+        WriteAheadLog wal(tableDir, storage, logger);
+        wal.recover([&rows](const WalRecord &record)
+                    {
+                        CHECK(record.type == WalRecordType::INSERT);
+                        WalInsertHeader header;
+                        std::memcpy(&header, record.payload.data(), sizeof(header));
+                        rows.emplace_back(header.first_row_id, header.num_rows); });
+        return rows;
+    }
+
+    void checkRows(Table &table)
+    {
+        std::vector<Column> columns = table.getSchema();
+        TableScan scan(table.getPageManager(), columns);
+        CHECK(scan.open());
+        std::vector<bool> seen(ROWS, false);
+        RowBatch batch;
+        while (scan.next(batch))
+        {
+            for (const auto &data : batch.rows)
+            {
+                Row row = Row::deserialize(columns, data.data(), data.size());
+                size_t id = static_cast<size_t>(row.getInt(0));
+                CHECK(id < ROWS && !seen[id]);
+                CHECK(row.getText(1) == "name" + std::to_string(id % 50));
+                seen[id] = true;
+            }
+        }
+        for (bool found : seen)
+        {
+            CHECK(found);
+        }
+        CHECK(table.rangeQuery("id", 0, static_cast<int32_t>(ROWS)).size() == ROWS);
+        CHECK(table.lookup("id", static_cast<int32_t>(ROWS - 1)).size() == 1);
+    }
+}
+
+int main()
+{
+    std::string dir = freshDirectory("checkpoint");
+    pid_t child = fork();
+    CHECK(child >= 0);
+    if (child == 0)
+    {
+        loadAndCrash(dir);
+    }
+    int status;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    NullLogger logger;
+    FileStorage storage(logger);
+    size_t logged = 0;
+    for (const auto &rows : loggedRows(storage, logger, dir + "/db/rows"))
+    {
+        CHECK(rows.first >= BATCHES_BEFORE * BATCH_ROWS);
+        logged += rows.second;
+    }
+    CHECK(logged == BATCHES_AFTER * BATCH_ROWS);
+
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        checkRows(db.getTable("rows"));
+    }
+    CHECK(loggedRows(storage, logger, dir + "/db/rows").empty());
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    checkRows(db.getTable("rows"));
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Vacuum: deletes leave dead bytes on their pages until a vacuum pass
+// compacts the fragmented pages and merges sparse neighbours. Afterwards no
+// page holds dead bytes, every row and index entry is intact, and inserts
+// fill the reclaimed space instead of adding pages. The background vacuum
+// does the same for deletes made after the table is reopened.
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "database.h"
+#include "slotted_page.h"
+#include "table_scan.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr int32_t ROWS = 8000;
+    constexpr int32_t REFILL_BATCHES = 10;
+    constexpr int32_t REFILL_ROWS = 400;
+    const std::string HEADER = "id\tname";
+
+    // The first half keeps every tenth row, leaving sparse pages to merge;
+    // the second half loses every other row, leaving pages to compact.
+    bool deletedFirst(int32_t id)
+    {
+        return id < ROWS / 2 ? id % 10 != 0 : id % 2 == 1;
+    }
+
+    // Deleted after reopening: a third of the rows left in the second half.
+    bool deletedLater(int32_t id)
+    {
+        return id >= ROWS / 2 && !deletedFirst(id) && id % 3 == 0;
+    }
+
+    size_t liveRows()
+    {
+        size_t live = 0;
+        for (int32_t id = 0; id < ROWS; id++)
+        {
+            live += deletedFirst(id) || deletedLater(id) ? 0 : 1;
+        }
+        return live;
+    }
+
+    std::string nameOf(int32_t id)
+    {
+        return "name" + std::to_string(id) + std::string(40, 'x');
+    }
+
+    // Dead bytes of the page holding the most.
+    size_t maxDeadBytes(PageManager &pageManager, ILogger &logger)
+    {
+        SlottedPage format(logger);
+        format.setPageSize(pageManager.getPageSize());
+        size_t dead = 0;
+        std::vector<char> buffer;
+        for (uint32_t pageId : pageManager.getPageIds())
+        {
+            CHECK(pageManager.readPage(pageId, buffer));
+            dead = std::max(dead, format.deadSpace(buffer));
+        }
+        return dead;
+    }
+
+    // Below what makes vacuum compact a page.
+    bool compacted(PageManager &pageManager, ILogger &logger)
+    {
+        return maxDeadBytes(pageManager, logger) < pageManager.getPageSize() / PageManager::VACUUM_DEAD_SPACE_DIVISOR;
+    }
+
+    void deleteRows(Table &table, bool (*deleted)(int32_t))
+    {
+        for (int32_t id = 0; id < ROWS; id++)
+        {
+            if (deleted(id))
+            {
+                std::vector<uint32_t> rowIds = table.findRowIds("id", id);
+                CHECK(rowIds.size() == 1);
+                CHECK(table.deleteRow(rowIds[0]));
+            }
+        }
+    }
+
+    // Rows with ids below ROWS, through the index and through a scan, which
+    // must not count a merged row twice.
+    void checkRows(Table &table, size_t expected)
+    {
+        std::vector<Row> rows = table.rangeQuery("id", 0, ROWS - 1);
+        CHECK(rows.size() == expected);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            CHECK(!deletedFirst(rows[i].getInt(0)));
+            CHECK(rows[i].getText(1) == nameOf(rows[i].getInt(0)));
+            CHECK(i == 0 || rows[i - 1].getInt(0) < rows[i].getInt(0));
+        }
+        CHECK(table.lookup("id", 10).size() == 1);
+        CHECK(table.lookup("id", 11).empty());
+        CHECK(table.lookup("name", nameOf(ROWS - 2)).size() == 1);
+
+        std::vector<Column> columns = table.getSchema();
+        TableScan scan(table.getPageManager(), columns);
+        CHECK(scan.open());
+        size_t scanned = 0;
+        RowBatch batch;
+        while (scan.next(batch))
+        {
+            for (const auto &bytes : batch.rows)
+            {
+                scanned += Row::deserialize(columns, bytes.data(), bytes.size()).getInt(0) < ROWS ? 1 : 0;
+            }
+        }
+        scan.close();
+        CHECK(scanned == expected);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("compaction");
+    size_t survivors = 0;
+    for (int32_t id = 0; id < ROWS; id++)
+    {
+        survivors += deletedFirst(id) ? 0 : 1;
+    }
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(writeTsv(dir + "/rows.tsv", HEADER, ROWS, [](std::ostream &out, size_t i)
+                                               { out << i << "\t" << nameOf(static_cast<int32_t>(i)); })));
+        CHECK(table.createIndex("id"));
+        CHECK(table.createHashIndex("name"));
+        PageManager &pageManager = table.getPageManager();
+        size_t pages = pageManager.getPageIds().size();
+
+        deleteRows(table, deletedFirst);
+        CHECK(!compacted(pageManager, logger));
+        CHECK(pageManager.vacuum() > 0);
+        // Merged pages may fill up another pass's worth of sparse neighbours.
+        for (int pass = 0; pass < 10 && pageManager.vacuum() > 0; pass++)
+        {
+        }
+        CHECK(pageManager.vacuum() == 0);
+        CHECK(compacted(pageManager, logger));
+        checkRows(table, survivors);
+
+        // Most of the rows deleted above fit again in the space vacuum
+        // reclaimed. Each insert spreads over at most MAX_PLACEMENT_PAGES
+        // pages, so they come in batches.
+        for (int32_t batch = 0; batch < REFILL_BATCHES; batch++)
+        {
+            CHECK(table.writeDataFromFile(writeTsv(dir + "/refill.tsv", HEADER, REFILL_ROWS, [batch](std::ostream &out, size_t i)
+                                                   { out << ROWS + batch * REFILL_ROWS + static_cast<int32_t>(i) << "\t" << nameOf(ROWS); })));
+        }
+        CHECK(pageManager.getPageIds().size() == pages);
+        checkRows(table, survivors);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    Table &table = db.getTable("rows");
+    checkRows(table, survivors);
+    PageManager &pageManager = table.getPageManager();
+    CHECK(pageManager.vacuum() == 0);
+
+    deleteRows(table, deletedLater);
+    CHECK(!compacted(pageManager, logger));
+    table.startVacuum(5);
+    for (int wait = 0; wait < 1000 && !compacted(pageManager, logger); wait++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pageManager.stopVacuum();
+    CHECK(compacted(pageManager, logger));
+    CHECK(table.rangeQuery("id", 0, ROWS - 1).size() == liveRows());
+    CHECK(table.lookup("id", ROWS / 2 + 2).empty());
+    return 0;
+}
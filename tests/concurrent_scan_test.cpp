@@ -0,0 +1,165 @@
+// Directory snapshots, full scans resolving moved rows, and index lookups,
+// while inserts publish new pages and grow the indexes. Meant to be run under
+// ThreadSanitizer or AddressSanitizer as well.
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "database.h"
+#include "page_directory.h"
+#include "file_storage.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t INITIAL_ROWS = 2000;
+    constexpr size_t MOVED_ROWS = 50;
+    constexpr size_t INSERT_BATCHES = 40;
+    constexpr size_t BATCH_ROWS = 200;
+    const std::string HEADER = "id\tk\tname";
+
+    // Rows with k = 100, which no read below asks for.
+    std::vector<std::string> writeBatches(const std::string &dir)
+    {
+        std::vector<std::string> batches;
+        for (size_t b = 0; b < INSERT_BATCHES; b++)
+        {
+            batches.push_back(writeTsv(dir + "/batch" + std::to_string(b) + ".tsv", HEADER, BATCH_ROWS, [b](std::ostream &out, size_t i)
+                                       { out << INITIAL_ROWS + b * BATCH_ROWS + i << "\t100\tinserted"; }));
+        }
+        return batches;
+    }
+
+    // Repeats read until another thread inserted every batch. Returns the
+    // number of reads.
+    template <typename Read>
+    size_t readWhileInserting(Table &table, const std::vector<std::string> &batches, Read read)
+    {
+        std::atomic<bool> inserting{true};
+        std::thread inserter([&]
+                             {
+                                 for (const auto &batch : batches)
+                                 {
+                                     CHECK(table.writeDataFromFile(batch));
+                                 }
+                                 inserting = false; });
+        size_t reads = 0;
+        do
+        {
+            read();
+            reads++;
+        } while (inserting);
+        inserter.join();
+        return reads;
+    }
+
+    // Every snapshot is a prefix of the pages in the order they were added,
+    // and keeps its pages after the id buffer has grown past it.
+    void snapshotWhileAdding(IStorage &storage, ILogger &logger, const std::string &dir)
+    {
+        constexpr uint32_t PAGES = 20000;
+        freshDirectory(dir + "/directory");
+        PageDirectory directory(dir + "/directory", storage, logger);
+        CHECK(directory.initialize());
+        std::atomic<bool> adding{true};
+        std::thread adder([&]
+                          {
+                              for (uint32_t pageId = 0; pageId < PAGES; pageId++)
+                              {
+                                  PageDirectoryEntry entry{pageId * 3, 100};
+                                  directory.addPageDirectoryEntry(entry);
+                              }
+                              adding = false; });
+        std::vector<DirectorySnapshot> kept;
+        size_t lastSize = 0;
+        do
+        {
+            DirectorySnapshot snapshot = directory.snapshot();
+            CHECK(snapshot.pageIds.size() >= lastSize);
+            lastSize = snapshot.pageIds.size();
+            for (size_t i = 0; i < snapshot.pageIds.size(); i++)
+            {
+                CHECK(snapshot.pageIds[i] == i * 3);
+            }
+            if (kept.size() < 64)
+            {
+                kept.push_back(snapshot);
+            }
+        } while (adding);
+        adder.join();
+        for (const auto &snapshot : kept)
+        {
+            uint32_t expected = 0;
+            for (uint32_t pageId : snapshot.pageIds)
+            {
+                CHECK(pageId == expected);
+                expected += 3;
+            }
+        }
+        CHECK(directory.snapshot().pageIds.size() == PAGES);
+        std::cout << kept.size() << " snapshots kept during growth\n";
+    }
+
+    void scanMovedRows(Database &db, const std::string &dir)
+    {
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"k", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(writeTsv(dir + "/initial.tsv", HEADER, INITIAL_ROWS, [](std::ostream &out, size_t i)
+                                               { out << i << "\t" << i % 10 << "\tn" << i; })));
+        // Rows grown past the free space of their full page move to another
+        // one, so scans must look up their home slot (see PageManager::locateRow).
+        std::vector<Column> columns = table.getSchema();
+        const std::string longName(1500, 'x');
+        for (size_t i = 0; i < MOVED_ROWS; i++)
+        {
+            int32_t id = static_cast<int32_t>(i * (INITIAL_ROWS / MOVED_ROWS));
+            std::vector<uint32_t> rowIds = table.findRowIds("id", id);
+            CHECK(rowIds.size() == 1);
+            CHECK(table.updateRow(rowIds[0], Row(columns, {id, id % 10, longName})));
+        }
+
+        size_t scans = readWhileInserting(table, writeBatches(dir), [&]
+                                          {
+                                              std::vector<Row> rows = table.rangeQuery("k", 0, 9);
+                                              CHECK(rows.size() == INITIAL_ROWS);
+                                              size_t moved = 0;
+                                              for (const auto &row : rows)
+                                              {
+                                                  moved += row.getText(2) == longName ? 1 : 0;
+                                              }
+                                              CHECK(moved == MOVED_ROWS); });
+        CHECK(table.rangeQuery("k", 100, 100).size() == INSERT_BATCHES * BATCH_ROWS);
+        std::cout << scans << " scans during ingest\n";
+    }
+
+    // Inserts split B+tree nodes and hash buckets while lookups walk them.
+    void lookUpIndexes(Database &db, const std::string &dir)
+    {
+        Table &table = db.createTable("indexed", {{"id", DataType::INT}, {"k", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(writeTsv(dir + "/indexed.tsv", HEADER, INITIAL_ROWS, [](std::ostream &out, size_t i)
+                                               { out << i << "\t" << i % 10 << "\tg" << i % 10; })));
+        CHECK(table.createIndex("id"));
+        CHECK(table.createHashIndex("name"));
+
+        size_t lookups = readWhileInserting(table, writeBatches(dir), [&]
+                                            {
+                                                CHECK(table.lookup("name", std::string("g3")).size() == INITIAL_ROWS / 10);
+                                                CHECK(table.rangeQuery("id", 0, static_cast<int32_t>(INITIAL_ROWS) - 1).size() == INITIAL_ROWS);
+                                                CHECK(table.findRowIds("id", 7).size() == 1); });
+        CHECK(table.lookup("name", std::string("inserted")).size() == INSERT_BATCHES * BATCH_ROWS);
+        std::cout << lookups << " index lookups during ingest\n";
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("concurrent_scan");
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    snapshotWhileAdding(storage, logger, dir);
+    scanMovedRows(db, dir);
+    lookUpIndexes(db, dir);
+    return 0;
+}
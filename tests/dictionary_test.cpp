@@ -0,0 +1,140 @@
+// Categorical TEXT columns: rows hold codes into the table's dictionary, and
+// read back as the strings they were written with through scans, lookups,
+// openValue and groupCount. Codes follow the order of first appearance and
+// never change: not when the table is reopened and grows, nor when a crash
+// left a torn entry at the end of the dictionary file.
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "text_dictionary.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ROWS = 6000;
+    constexpr size_t CITIES = 300;
+    const std::vector<std::string> COUNTRIES = {"fr", "de", "it", "es", "pt"};
+    const std::string HEADER = "id\tcountry\tcity\tnote";
+
+    std::string cityOf(size_t i)
+    {
+        return "city" + std::to_string(i * 7 % CITIES);
+    }
+
+    std::vector<Column> columns(bool categorical)
+    {
+        return {{"id", DataType::INT}, {"country", DataType::TEXT, categorical}, {"city", DataType::TEXT, categorical}, {"note", DataType::TEXT}};
+    }
+
+    std::string writeRows(const std::string &filename, size_t first, size_t rows)
+    {
+        return writeTsv(filename, HEADER, rows, [first](std::ostream &out, size_t i)
+                        {
+                            size_t id = first + i;
+                            out << id << "\t" << COUNTRIES[id % COUNTRIES.size()] << "\t" << cityOf(id) << "\tnote" << id; });
+    }
+
+    void checkTable(Table &table, size_t rows)
+    {
+        std::vector<std::pair<Row::Value, uint64_t>> countries = table.groupCount("country");
+        CHECK(countries.size() == COUNTRIES.size());
+        for (size_t i = 0; i < countries.size(); i++)
+        {
+            CHECK(i == 0 || std::get<std::string>(countries[i - 1].first) < std::get<std::string>(countries[i].first));
+            CHECK(countries[i].second == rows / COUNTRIES.size());
+        }
+        CHECK(table.groupCount("city").size() == CITIES);
+
+        std::vector<Row> french = table.lookup("country", std::string("fr"));
+        CHECK(french.size() == rows / COUNTRIES.size());
+        for (const auto &row : french)
+        {
+            size_t id = static_cast<size_t>(row.getInt(0));
+            CHECK(id % COUNTRIES.size() == 0);
+            CHECK(row.getText(2) == cityOf(id));
+            CHECK(row.getText(3) == "note" + std::to_string(id));
+        }
+        CHECK(table.lookup("city", cityOf(1)).size() == rows / CITIES);
+        CHECK(table.lookup("country", std::string("xx")).empty());
+
+        std::vector<uint32_t> rowIds = table.findRowIds("note", std::string("note42"));
+        CHECK(rowIds.size() == 1);
+        ValueReader reader;
+        CHECK(table.openValue(rowIds[0], "city", reader));
+        std::string city(reader.size(), ' ');
+        CHECK(reader.read(&city[0], city.size()) == city.size());
+        CHECK(city == cityOf(42));
+    }
+
+    // Code of every string, in code order.
+    std::vector<std::string> codes(IStorage &storage, const std::string &tableDir)
+    {
+        TextDictionary dictionary(tableDir, storage);
+        dictionary.initialize();
+        std::vector<std::string> values;
+        for (uint32_t code = 0; code < dictionary.size(); code++)
+        {
+            values.push_back(dictionary.value(code));
+            uint32_t found;
+            CHECK(dictionary.find(values.back(), found) && found == code);
+        }
+        return values;
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("dictionary");
+    std::string tableDir = dir + "/db/places";
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("places", columns(true));
+        CHECK(table.writeDataFromFile(writeRows(dir + "/rows.tsv", 0, ROWS)));
+        checkTable(table, ROWS);
+
+        // The codes take fewer pages than the strings.
+        Table &plain = db.createTable("plain", columns(false));
+        CHECK(plain.writeDataFromFile(writeRows(dir + "/rows.tsv", 0, ROWS)));
+        CHECK(table.getPageManager().getPageIds().size() < plain.getPageManager().getPageIds().size());
+    }
+
+    // Row 0 brings the first country and city, row 1 the next ones.
+    std::vector<std::string> before = codes(storage, tableDir);
+    CHECK(before.size() == COUNTRIES.size() + CITIES);
+    CHECK(before[0] == COUNTRIES[0] && before[1] == cityOf(0) && before[2] == COUNTRIES[1] && before[3] == cityOf(1));
+
+    // A crash while appending a string leaves its length and part of its bytes.
+    uint16_t tornLength = 20;
+    storage.appendFile(tableDir + "/dictionary.dat", reinterpret_cast<char *>(&tornLength), sizeof(tornLength));
+    storage.appendFile(tableDir + "/dictionary.dat", "torn", 4);
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.getTable("places");
+        checkTable(table, ROWS);
+        CHECK(table.writeDataFromFile(writeRows(dir + "/more.tsv", ROWS, ROWS)));
+        checkTable(table, 2 * ROWS);
+
+        std::vector<uint32_t> rowIds = table.findRowIds("note", std::string("note7"));
+        CHECK(table.updateRow(rowIds[0], Row(table.getSchema(), {7, std::string("nz"), cityOf(7), std::string("note7")})));
+        CHECK(table.lookup("country", std::string("nz")).size() == 1);
+        CHECK(table.groupCount("country").size() == COUNTRIES.size() + 1);
+    }
+
+    // Old codes kept, the new country appended behind them.
+    std::vector<std::string> after = codes(storage, tableDir);
+    CHECK(after.size() == before.size() + 1);
+    CHECK(std::equal(before.begin(), before.end(), after.begin()));
+    CHECK(after.back() == "nz");
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    std::vector<Row> rows = db.getTable("places").lookup("country", std::string("nz"));
+    CHECK(rows.size() == 1 && rows[0].getInt(0) == 7);
+    return 0;
+}
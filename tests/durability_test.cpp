@@ -0,0 +1,131 @@
+// Durability modes: each syncs the log as it promises, and in each a process
+// that dies right after its commits loses none of them.
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t BATCHES = 20;
+    constexpr size_t BATCH_ROWS = 50;
+    const std::string HEADER = "id\tname";
+
+    // Counts syncs of the write-ahead log files, by kind.
+    class LogSyncStorage : public FileStorage
+    {
+    public:
+        explicit LogSyncStorage(ILogger &logger) : FileStorage(logger) {}
+
+        void syncFile(const std::string &filename) override
+        {
+            fsyncs += isLog(filename) ? 1 : 0;
+            FileStorage::syncFile(filename);
+        }
+        void syncData(const std::string &filename) override
+        {
+            fdatasyncs += isLog(filename) ? 1 : 0;
+            FileStorage::syncData(filename);
+        }
+
+        std::atomic<size_t> fsyncs{0};
+        std::atomic<size_t> fdatasyncs{0};
+
+    private:
+        static bool isLog(const std::string &filename) { return filename.find("/wal.") != std::string::npos; }
+    };
+
+    const DurabilityPolicy POLICIES[] = {{DurabilityMode::NONE, 0},
+                                         {DurabilityMode::FSYNC, 0},
+                                         {DurabilityMode::PERIODIC, 20},
+                                         {DurabilityMode::FDATASYNC, 0}};
+
+    void load(Table &table, const std::string &dir, const std::string &name)
+    {
+        for (size_t b = 0; b < BATCHES; b++)
+        {
+            CHECK(table.writeDataFromFile(writeTsv(dir + "/" + name + std::to_string(b) + ".tsv", HEADER, BATCH_ROWS, [b](std::ostream &out, size_t i)
+                                                   { out << b * BATCH_ROWS + i << "\tn" << i; })));
+        }
+    }
+
+    // Returns the fsyncs and fdatasyncs of the log during the load.
+    std::pair<size_t, size_t> syncsOfLoad(Database &db, LogSyncStorage &storage, const std::string &dir, size_t mode)
+    {
+        std::string name = "synced" + std::to_string(mode);
+        Table &table = db.createTable(name, {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        table.setDurability(POLICIES[mode]);
+        size_t fsyncs = storage.fsyncs;
+        size_t fdatasyncs = storage.fdatasyncs;
+        load(table, dir, name);
+        return {storage.fsyncs - fsyncs, storage.fdatasyncs - fdatasyncs};
+    }
+
+    void checkSyncs(const std::string &dir)
+    {
+        NullLogger logger;
+        LogSyncStorage storage(logger);
+        Database db(dir + "/synced", storage, logger);
+        CHECK(db.initialize());
+
+        auto none = syncsOfLoad(db, storage, dir, 0);
+        CHECK(none.first == 0 && none.second == 0);
+        auto fsync = syncsOfLoad(db, storage, dir, 1);
+        CHECK(fsync.first >= BATCHES && fsync.second == 0);
+        auto fdatasync = syncsOfLoad(db, storage, dir, 3);
+        CHECK(fdatasync.first == 0 && fdatasync.second >= BATCHES);
+
+        // Commits do not wait for periodic syncs, which follow within the interval.
+        auto periodic = syncsOfLoad(db, storage, dir, 2);
+        CHECK(periodic.first + periodic.second < BATCHES);
+        size_t synced = storage.fsyncs + storage.fdatasyncs;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5 * POLICIES[2].interval_ms));
+        CHECK(periodic.first + periodic.second + (storage.fsyncs + storage.fdatasyncs - synced) > 0);
+    }
+
+    [[noreturn]] void loadAndDie(const std::string &dir, size_t mode)
+    {
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        std::string name = "rows" + std::to_string(mode);
+        Table &table = db.createTable(name, {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        table.setDurability(POLICIES[mode]);
+        load(table, dir, name);
+        _exit(0);
+    }
+}
+
+int main()
+{
+    std::string dir = freshDirectory("durability");
+    checkSyncs(dir);
+
+    for (size_t mode = 0; mode < sizeof(POLICIES) / sizeof(POLICIES[0]); mode++)
+    {
+        pid_t child = fork();
+        CHECK(child >= 0);
+        if (child == 0)
+        {
+            loadAndDie(dir, mode);
+        }
+        int status;
+        CHECK(waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.getTable("rows" + std::to_string(mode));
+        CHECK(table.rangeQuery("id", 0, static_cast<int32_t>(BATCHES * BATCH_ROWS)).size() == BATCHES * BATCH_ROWS);
+        CHECK(table.lookup("name", std::string("n7")).size() == BATCHES);
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Placement and fill factor: batches a little larger than a page fill the
+// free space earlier batches left, so the table takes no more pages than one
+// load of all its rows. A fill factor leaves every page part empty, for bulk
+// loads too, and rows that grow later stay on their page instead of moving
+// to new ones.
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "slotted_page.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ROWS = 6000;
+    constexpr size_t BATCH_ROWS = 90; // About a page and a third.
+    constexpr size_t FILL_FACTOR = 70;
+    const std::string HEADER = "id\tname";
+
+    // Names of 10 to 50 bytes.
+    std::string nameOf(size_t i)
+    {
+        return std::string(10 + i * 7 % 41, static_cast<char>('a' + i % 26));
+    }
+
+    std::string writeRows(const std::string &filename, size_t first, size_t rows)
+    {
+        return writeTsv(filename, HEADER, rows, [first](std::ostream &out, size_t i)
+                        { out << first + i << "\t" << nameOf(first + i); });
+    }
+
+    // Many small commits and nothing to recover: the log need not be synced.
+    Table &createTable(Database &db, const std::string &name)
+    {
+        Table &table = db.createTable(name, {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        table.setDurability({DurabilityMode::NONE});
+        return table;
+    }
+
+    void loadBatches(Table &table, const std::string &dir)
+    {
+        for (size_t first = 0; first < ROWS; first += BATCH_ROWS)
+        {
+            CHECK(table.writeDataFromFile(writeRows(dir + "/batch.tsv", first, std::min(BATCH_ROWS, ROWS - first))));
+        }
+    }
+
+    size_t pagesOf(Table &table)
+    {
+        return table.getPageManager().getPageIds().size();
+    }
+
+    // Free bytes of the fullest page.
+    size_t minFreeSpace(Table &table, ILogger &logger)
+    {
+        PageManager &pageManager = table.getPageManager();
+        SlottedPage format(logger);
+        format.setPageSize(pageManager.getPageSize());
+        size_t least = pageManager.getPageSize();
+        std::vector<char> page;
+        for (uint32_t pageId : pageManager.getPageIds())
+        {
+            CHECK(pageManager.readPage(pageId, page));
+            least = std::min(least, format.freeSpace(page));
+        }
+        return least;
+    }
+
+    // Every third row 20 bytes longer.
+    void growRows(Table &table)
+    {
+        std::vector<Column> columns = table.getSchema();
+        for (size_t id = 0; id < ROWS; id += 3)
+        {
+            std::vector<uint32_t> rowIds = table.findRowIds("id", static_cast<int32_t>(id));
+            CHECK(rowIds.size() == 1);
+            CHECK(table.updateRow(rowIds[0], Row(columns, {static_cast<int32_t>(id), nameOf(id) + std::string(20, '+')})));
+        }
+        std::vector<Row> rows = table.rangeQuery("id", 0, static_cast<int32_t>(ROWS));
+        CHECK(rows.size() == ROWS);
+        for (const auto &row : rows)
+        {
+            size_t id = static_cast<size_t>(row.getInt(0));
+            CHECK(row.getText(1) == (id % 3 == 0 ? nameOf(id) + std::string(20, '+') : nameOf(id)));
+        }
+    }
+
+    bool refused(Table &table, size_t percent)
+    {
+        try
+        {
+            table.setFillFactor(percent);
+        }
+        catch (const std::invalid_argument &)
+        {
+            return true;
+        }
+        return false;
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("fill_factor");
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    std::string all = writeRows(dir + "/all.tsv", 0, ROWS);
+
+    Table &whole = createTable(db, "whole");
+    CHECK(whole.writeDataFromFile(all));
+    Table &batched = createTable(db, "batched");
+    loadBatches(batched, dir);
+    CHECK(pagesOf(batched) <= pagesOf(whole) + 1);
+    CHECK(batched.rangeQuery("id", 0, static_cast<int32_t>(ROWS)).size() == ROWS);
+
+    SlottedPage format(logger);
+    format.setPageSize(PAGE_SIZE);
+    size_t reserve = format.emptyPageSpace() * (100 - FILL_FACTOR) / 100;
+    Table &spare = createTable(db, "spare");
+    spare.setFillFactor(FILL_FACTOR);
+    loadBatches(spare, dir);
+    CHECK(minFreeSpace(spare, logger) >= reserve);
+    CHECK(pagesOf(spare) > pagesOf(batched) * 100 / FILL_FACTOR * 9 / 10);
+    Table &bulk = createTable(db, "bulk");
+    bulk.setFillFactor(FILL_FACTOR);
+    CHECK(bulk.writeDataFromFiles({all}));
+    CHECK(minFreeSpace(bulk, logger) >= reserve);
+
+    // Grown rows fill the reserved space; on full pages they move out.
+    size_t sparePages = pagesOf(spare);
+    CHECK(spare.createIndex("id"));
+    growRows(spare);
+    CHECK(pagesOf(spare) == sparePages);
+    size_t batchedPages = pagesOf(batched);
+    CHECK(batched.createIndex("id"));
+    growRows(batched);
+    CHECK(pagesOf(batched) > batchedPages);
+
+    CHECK(refused(spare, PageManager::MIN_FILL_FACTOR - 1));
+    CHECK(refused(spare, 101));
+    CHECK(!refused(spare, 100));
+    return 0;
+}
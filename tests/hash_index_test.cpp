@@ -0,0 +1,119 @@
+// Hash indexes: bucket splits, overflow chains, batch inserts and removal on
+// the index itself, then TEXT equality lookups on a table, before and after
+// it is reopened.
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "file_storage.h"
+#include "hash_index.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr uint32_t KEYS = 20000;
+    constexpr uint16_t HOT_COPIES = 3000; // Far more than a bucket page holds.
+    constexpr size_t TABLE_ROWS = 12000;
+
+    std::string keyOf(uint32_t i)
+    {
+        return "key" + std::to_string(i);
+    }
+
+    // Locations stored under key, hash collisions included.
+    size_t countAt(HashIndex &index, const std::string &key, uint32_t pageId)
+    {
+        std::vector<Location> found = index.lookup(key);
+        return static_cast<size_t>(std::count_if(found.begin(), found.end(), [pageId](const Location &location)
+                                                 { return location.page_id == pageId; }));
+    }
+
+    void checkIndex(HashIndex &index)
+    {
+        CHECK(index.size() == KEYS + HOT_COPIES - 1);
+        for (uint32_t i = 0; i < KEYS; i += 7)
+        {
+            CHECK(countAt(index, keyOf(i), i + 1) == 1);
+        }
+        CHECK(countAt(index, "hot", 0) == HOT_COPIES - 1);
+        CHECK(index.lookup("absent").empty());
+    }
+
+    void checkIndexFiles(IStorage &storage, ILogger &logger, const std::string &dir)
+    {
+        {
+            HashIndex index(dir, "name", storage, logger);
+            CHECK(index.initialize());
+            // Even keys one at a time, odd ones in one batch.
+            for (uint32_t i = 0; i < KEYS; i += 2)
+            {
+                CHECK(index.insert(keyOf(i), Location{i + 1, 0}));
+            }
+            std::vector<HashIndex::Entry> batch;
+            for (uint32_t i = 1; i < KEYS; i += 2)
+            {
+                batch.emplace_back(HashIndex::hashKey(keyOf(i)), Location{i + 1, 0});
+            }
+            CHECK(index.insertBatch(batch));
+            CHECK(index.numBuckets() > HashIndex::INITIAL_BUCKETS);
+
+            for (uint16_t copy = 0; copy < HOT_COPIES; copy++)
+            {
+                CHECK(index.insert("hot", Location{0, copy}));
+            }
+            CHECK(index.remove("hot", Location{0, 1234}));
+            CHECK(!index.remove("hot", Location{0, 1234}));
+            CHECK(!index.remove("absent", Location{0, 0}));
+            checkIndex(index);
+        }
+
+        HashIndex reopened(dir, "name", storage, logger);
+        CHECK(reopened.initialize());
+        checkIndex(reopened);
+    }
+
+    void checkTable(Table &table)
+    {
+        for (size_t group : {0, 17, 59})
+        {
+            std::vector<Row> rows = table.lookup("name", "g" + std::to_string(group));
+            CHECK(rows.size() == TABLE_ROWS / 60);
+            for (const auto &row : rows)
+            {
+                CHECK(row.getInt(0) % 60 == static_cast<int32_t>(group));
+            }
+        }
+        CHECK(table.lookup("name", std::string("g60")).empty());
+        CHECK(table.findRowIds("name", std::string("g5")).size() == TABLE_ROWS / 60);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("hash_index");
+    checkIndexFiles(storage, logger, dir);
+
+    std::string data = writeTsv(dir + "/rows.tsv", "id\tname", TABLE_ROWS, [](std::ostream &out, size_t i)
+                                { out << i << "\tg" << i % 60; });
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(data));
+        CHECK(table.createHashIndex("name"));
+        CHECK(!table.createHashIndex("id"));
+        checkTable(table);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    checkTable(db.getTable("rows"));
+    HashIndex index(dir + "/db/rows", "name", storage, logger);
+    CHECK(index.initialize());
+    CHECK(index.isClean());
+    CHECK(index.size() == TABLE_ROWS);
+    return 0;
+}
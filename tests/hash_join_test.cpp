@@ -0,0 +1,156 @@
+// Hash join on FLOAT keys, in memory and with Grace partitioning: -0.0 and
+// +0.0 compare equal and must join, NaN equals nothing and must not. Then
+// INT keys with a skewed build side, partitioned again as often as the
+// budget needs, with no partition file left behind.
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include "database.h"
+#include "file_storage.h"
+#include "hash_join.h"
+#include "table_scan.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t LEFT_ROWS = 2000;
+    constexpr size_t RIGHT_ROWS = 1000;
+    // Every tenth row of either side has a zero key, -0.0 on the left and
+    // +0.0 on the right; the others have their row number as key.
+    constexpr size_t EXPECTED_MATCHES = (LEFT_ROWS / 10) * (RIGHT_ROWS / 10) + RIGHT_ROWS - RIGHT_ROWS / 10;
+
+    Table &createSide(Database &db, const std::string &dir, const std::string &name, size_t rows, const std::string &zero)
+    {
+        Table &table = db.createTable(name, {{"id", DataType::INT}, {"x", DataType::FLOAT}});
+        CHECK(table.writeDataFromFile(writeTsv(dir + "/" + name + ".tsv", "id\tx", rows + 1, [&](std::ostream &out, size_t i)
+                                               {
+                                                   out << i << "\t";
+                                                   if (i == rows)
+                                                   {
+                                                       out << "nan";
+                                                   }
+                                                   else if (i % 10 == 0)
+                                                   {
+                                                       out << zero;
+                                                   }
+                                                   else
+                                                   {
+                                                       out << i;
+                                                   } })));
+        return table;
+    }
+
+    constexpr size_t CUSTOMERS = 20000;
+    constexpr size_t ORDERS = 40000;
+    constexpr size_t SKEWED = 100; // Extra customers sharing key 42.
+
+    // Records the deepest partitioning level of the spill files created.
+    class LevelStorage : public FileStorage
+    {
+    public:
+        explicit LevelStorage(ILogger &logger) : FileStorage(logger) {}
+
+        bool createFile(const std::string &filename) override
+        {
+            size_t at = filename.rfind("_l");
+            if (at != std::string::npos)
+            {
+                deepestLevel = std::max<uint32_t>(deepestLevel, static_cast<uint32_t>(std::stoul(filename.substr(at + 2))));
+            }
+            return FileStorage::createFile(filename);
+        }
+
+        uint32_t deepestLevel = 0;
+    };
+
+    size_t join(Table &left, Table &right, size_t memoryBudget, IStorage &storage, ILogger &logger, const std::string &spillDir,
+                bool &partitioned)
+    {
+        TableScan leftScan(left.getPageManager(), left.getSchema());
+        TableScan rightScan(right.getPageManager(), right.getSchema());
+        HashJoin join({leftScan, 1, {}}, {rightScan, 1, {}}, memoryBudget, storage, spillDir, logger);
+        CHECK(join.open());
+        size_t matches = 0;
+        RowBatch batch;
+        while (join.next(batch))
+        {
+            for (const auto &bytes : batch.rows)
+            {
+                Row row = Row::deserialize(join.getSchema(), bytes.data(), bytes.size());
+                CHECK(row.getFloat(1) == row.getFloat(3));
+                matches++;
+            }
+        }
+        partitioned = join.isPartitioned();
+        join.close();
+        return matches;
+    }
+
+    // Joins every order with its customer and returns the deepest level the
+    // build side was partitioned to.
+    uint32_t joinOrders(Table &orders, Table &customers, size_t memoryBudget, ILogger &logger, const std::string &spillDir)
+    {
+        LevelStorage storage(logger);
+        TableScan orderScan(orders.getPageManager(), orders.getSchema());
+        TableScan customerScan(customers.getPageManager(), customers.getSchema());
+        HashJoin join({orderScan, 1, {0, 1}}, {customerScan, 0, {0, 1}}, memoryBudget, storage, spillDir, logger);
+        CHECK(join.open());
+        size_t matches = 0;
+        RowBatch batch;
+        while (join.next(batch))
+        {
+            for (const auto &bytes : batch.rows)
+            {
+                Row row = Row::deserialize(join.getSchema(), bytes.data(), bytes.size());
+                CHECK(row.getInt(1) == row.getInt(2));
+                CHECK(row.getText(3) == "c" + std::to_string(row.getInt(2)));
+                matches++;
+            }
+        }
+        CHECK(matches == ORDERS + (ORDERS / CUSTOMERS) * SKEWED);
+        join.close();
+        CHECK(!std::filesystem::exists(spillDir) || std::filesystem::is_empty(spillDir));
+        return storage.deepestLevel;
+    }
+
+    void checkRepartitioning(Database &db, ILogger &logger, const std::string &dir)
+    {
+        Table &orders = db.createTable("orders", {{"id", DataType::INT}, {"customer", DataType::INT}});
+        CHECK(orders.writeDataFromFile(writeTsv(dir + "/orders.tsv", "id\tcustomer", ORDERS, [](std::ostream &out, size_t i)
+                                                { out << i << "\t" << i % CUSTOMERS; })));
+        Table &customers = db.createTable("customers", {{"id", DataType::INT}, {"name", DataType::TEXT}});
+        CHECK(customers.writeDataFromFile(writeTsv(dir + "/customers.tsv", "id\tname", CUSTOMERS + SKEWED, [](std::ostream &out, size_t i)
+                                                   {
+                                                       size_t id = i < CUSTOMERS ? i : 42;
+                                                       out << id << "\tc" << id; })));
+
+        std::string spillDir = dir + "/join_spill";
+        CHECK(joinOrders(orders, customers, 64 << 20, logger, spillDir) == 0);
+        // Eight partitions per level, split again until they fit.
+        uint32_t level = joinOrders(orders, customers, 32 << 10, logger, spillDir);
+        CHECK(level >= 1 && level < HashJoin::MAX_PARTITION_LEVEL);
+        // Two partitions per level: partitions still too big at the deepest
+        // level are joined as they are.
+        CHECK(joinOrders(orders, customers, 8 << 10, logger, spillDir) == HashJoin::MAX_PARTITION_LEVEL);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("hash_join");
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    Table &left = createSide(db, dir, "left", LEFT_ROWS, "-0");
+    Table &right = createSide(db, dir, "right", RIGHT_ROWS, "0");
+
+    bool partitioned = true;
+    CHECK(join(left, right, 64 << 20, storage, logger, dir + "/spill", partitioned) == EXPECTED_MATCHES);
+    CHECK(!partitioned);
+    CHECK(join(left, right, 16 << 10, storage, logger, dir + "/spill", partitioned) == EXPECTED_MATCHES);
+    CHECK(partitioned);
+    checkRepartitioning(db, logger, dir);
+    return 0;
+}
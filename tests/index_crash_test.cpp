@@ -0,0 +1,130 @@
+// Kills a process ingesting into an indexed table at a different fixed point
+// of its index maintenance every round, then checks that the B+tree and hash
+// index agree with a scan of the recovered rows. Every indexed column has an
+// unindexed twin holding the same values.
+#include <climits>
+#include <csignal>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "database.h"
+#include "file_storage.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr int ROUNDS = 8;
+    // The write to an index file each round crashes on: the dirty marks of
+    // the first commit, then points ever further into the ingest.
+    constexpr size_t CRASH_AT[ROUNDS] = {1, 2, 37, 260, 513, 1024, 1999, 3001};
+    constexpr size_t BATCH_ROWS = 100;
+    const std::string HEADER = "k\tk2\tname\tname2";
+
+    // Kills the process in place of its n-th write to an index file, so every
+    // run crashes at the same point of index maintenance.
+    class CrashingStorage : public FileStorage
+    {
+    public:
+        CrashingStorage(ILogger &logger, size_t crashAt) : FileStorage(logger), writesLeft_(crashAt) {}
+
+        bool writeFile(const std::string &filename, char *data, std::size_t size, std::streampos offset = 0) override
+        {
+            bool index = filename.find(".btree") != std::string::npos || filename.find(".hash") != std::string::npos;
+            if (index && --writesLeft_ == 0)
+            {
+                raise(SIGKILL);
+            }
+            return FileStorage::writeFile(filename, data, size, offset);
+        }
+
+    private:
+        size_t writesLeft_;
+    };
+
+    // Inserts batches, and updates a row of the previous batch after each,
+    // until the storage kills the process.
+    [[noreturn]] void ingest(const std::string &dir, int round)
+    {
+        NullLogger logger;
+        CrashingStorage storage(logger, CRASH_AT[round]);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.getTable("rows");
+        // A killed process loses no commit that reached the OS, and skipping
+        // the syncs makes index maintenance a larger part of every batch.
+        table.setDurability({DurabilityMode::NONE});
+        std::vector<Column> columns = table.getSchema();
+        for (int batch = 0;; batch++)
+        {
+            int first = (round * 100000 + batch) * static_cast<int>(BATCH_ROWS);
+            std::string file = writeTsv(dir + "/batch.tsv", HEADER, BATCH_ROWS, [first](std::ostream &out, size_t i)
+                                        {
+                                            int k = first + static_cast<int>(i);
+                                            out << k << "\t" << k << "\tv" << k % 50 << "\tv" << k % 50; });
+            CHECK(table.writeDataFromFile(file));
+            if (batch > 0)
+            {
+                int32_t previous = first - static_cast<int>(BATCH_ROWS) / 2;
+                std::vector<uint32_t> rowIds = table.findRowIds("k2", previous);
+                CHECK(rowIds.size() == 1);
+                CHECK(table.updateRow(rowIds[0], Row(columns, {-previous, -previous, std::string("updated"), std::string("updated")})));
+            }
+        }
+    }
+
+    // Returns the number of recovered rows.
+    size_t checkIndexes(const std::string &dir, int round)
+    {
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.getTable("rows");
+
+        size_t rows = table.rangeQuery("k2", INT_MIN, INT_MAX).size();
+        size_t indexed = table.rangeQuery("k", INT_MIN, INT_MAX).size();
+        std::cout << "round " << round << ": " << rows << " rows, " << indexed << " in the B+tree\n";
+        CHECK(indexed == rows);
+        CHECK(table.rangeQuery("k", INT_MIN, -1).size() == table.rangeQuery("k2", INT_MIN, -1).size());
+        for (const std::string value : {"v0", "v7", "v49", "updated"})
+        {
+            CHECK(table.lookup("name", value).size() == table.lookup("name2", value).size());
+            CHECK(table.findRowIds("name", value).size() == table.findRowIds("name2", value).size());
+        }
+        return rows;
+    }
+}
+
+int main()
+{
+    std::string dir = freshDirectory("index_crash");
+    {
+        NullLogger logger;
+        FileStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"k", DataType::INT}, {"k2", DataType::INT}, {"name", DataType::TEXT}, {"name2", DataType::TEXT}});
+        CHECK(table.createIndex("k"));
+        CHECK(table.createHashIndex("name"));
+    }
+
+    size_t rows = 0;
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        pid_t child = fork();
+        CHECK(child >= 0);
+        if (child == 0)
+        {
+            ingest(dir, round);
+        }
+        int status;
+        CHECK(waitpid(child, &status, 0) == child);
+        CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+        size_t recovered = checkIndexes(dir, round);
+        CHECK(recovered >= rows);
+        rows = recovered;
+    }
+    return 0;
+}
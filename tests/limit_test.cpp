@@ -0,0 +1,179 @@
+// LIMIT stops pulling input once it has its rows, top-N keeps the first of
+// equal rows and returns them best first, and Table::topN reads only the
+// pages that can still improve its result.
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "limit_operator.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t SOURCE_ROWS = 10000;
+    constexpr size_t BATCH_ROWS = 100;
+    constexpr size_t TABLE_ROWS = 20000;
+
+    std::vector<Column> columns()
+    {
+        return {{"id", DataType::INT}, {"k", DataType::INT}};
+    }
+
+    // Rows (i, k) in batches of BATCH_ROWS, counting the batches handed out.
+    class CountingSource : public Operator
+    {
+    public:
+        explicit CountingSource(std::vector<int32_t> keys) : columns_(columns()), keys_(std::move(keys)) {}
+
+        const std::vector<Column> &getSchema() override { return columns_; }
+        bool open() override
+        {
+            position_ = 0;
+            open_ = true;
+            return true;
+        }
+        bool next(RowBatch &batch) override
+        {
+            CHECK(open_);
+            batch.rows.clear();
+            for (; position_ < keys_.size() && batch.rows.size() < BATCH_ROWS; position_++)
+            {
+                batch.rows.push_back(Row(columns_, {static_cast<int32_t>(position_), keys_[position_]}).serialize());
+            }
+            batches += batch.rows.empty() ? 0 : 1;
+            return !batch.rows.empty();
+        }
+        void close() override { open_ = false; }
+
+        size_t batches = 0;
+        bool isOpen() const { return open_; }
+
+    private:
+        std::vector<Column> columns_;
+        std::vector<int32_t> keys_;
+        size_t position_ = 0;
+        bool open_ = false;
+    };
+
+    std::vector<Row> drain(Operator &op)
+    {
+        std::vector<Row> rows;
+        CHECK(op.open());
+        RowBatch batch;
+        while (op.next(batch))
+        {
+            for (const auto &data : batch.rows)
+            {
+                rows.push_back(Row::deserialize(op.getSchema(), data.data(), data.size()));
+            }
+        }
+        op.close();
+        return rows;
+    }
+
+    void checkLimit()
+    {
+        CountingSource source(std::vector<int32_t>(SOURCE_ROWS, 0));
+        LimitOperator limit(source, 250);
+        std::vector<Row> rows = drain(limit);
+        CHECK(rows.size() == 250);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            CHECK(rows[i].getInt(0) == static_cast<int32_t>(i));
+        }
+        CHECK(source.batches == 3);
+        CHECK(!source.isOpen());
+
+        CountingSource all(std::vector<int32_t>(SOURCE_ROWS, 0));
+        LimitOperator beyond(all, SOURCE_ROWS * 2);
+        CHECK(drain(beyond).size() == SOURCE_ROWS);
+    }
+
+    // Few distinct keys, so most rows tie; the first rows of every key win.
+    void checkTopN()
+    {
+        std::vector<int32_t> keys(SOURCE_ROWS);
+        std::mt19937 rng(3);
+        for (auto &key : keys)
+        {
+            key = static_cast<int32_t>(rng() % 50);
+        }
+        std::vector<size_t> order(SOURCE_ROWS);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        for (bool ascending : {true, false})
+        {
+            std::vector<size_t> expected = order;
+            std::stable_sort(expected.begin(), expected.end(), [&](size_t a, size_t b)
+                             { return ascending ? keys[a] < keys[b] : keys[a] > keys[b]; });
+            for (size_t n : {1, 77, 500})
+            {
+                CountingSource source(keys);
+                TopNOperator topN(source, {{1, ascending}}, n);
+                std::vector<Row> rows = drain(topN);
+                CHECK(rows.size() == n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    CHECK(rows[i].getInt(0) == static_cast<int32_t>(expected[i]));
+                }
+            }
+        }
+    }
+
+    // id ascends with the pages; k is scrambled.
+    void checkTableTopN(CountingStorage &storage, Table &table)
+    {
+        for (bool ascending : {true, false})
+        {
+            size_t before = storage.pageReads;
+            std::vector<Row> rows = table.topN("id", 10, ascending);
+            CHECK(storage.pageReads - before <= 2);
+            CHECK(rows.size() == 10);
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                CHECK(rows[i].getInt(0) == static_cast<int32_t>(ascending ? i : TABLE_ROWS - 1 - i));
+            }
+        }
+
+        // Every page holds large values of k, so pruning cannot skip them all.
+        std::vector<Row> rows = table.topN("k", 25, false);
+        CHECK(rows.size() == 25);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            CHECK(rows[i].getInt(1) == static_cast<int32_t>(TABLE_ROWS - 1 - i));
+        }
+        CHECK(table.topN("id", 0).empty());
+        CHECK(table.topN("id", TABLE_ROWS * 2).size() == TABLE_ROWS);
+    }
+}
+
+int main()
+{
+    checkLimit();
+    checkTopN();
+
+    NullLogger logger;
+    CountingStorage storage(logger);
+    std::string dir = freshDirectory("limit");
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    Table &table = db.createTable("rows", columns());
+    CHECK(table.writeDataFromFile(writeTsv(dir + "/rows.tsv", "id\tk", TABLE_ROWS, [](std::ostream &out, size_t i)
+                                           { out << i << "\t" << (i * 7919) % TABLE_ROWS; })));
+    checkTableTopN(storage, table);
+
+    // Through the index, ascending top-N reads the rows it returns alone.
+    CHECK(table.createIndex("k"));
+    size_t before = storage.pageReads;
+    std::vector<Row> rows = table.topN("k", 5);
+    CHECK(storage.pageReads - before <= 5);
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        CHECK(rows[i].getInt(1) == static_cast<int32_t>(i));
+    }
+    return 0;
+}
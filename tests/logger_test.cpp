@@ -0,0 +1,159 @@
+// Leveled logging: disabled messages are filtered before their text is
+// built, and the async logger writes every message it accepted, in order
+// per thread, accounting for the ones it had to drop.
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_logger.h"
+#include "global_logger.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t THREADS = 4;
+    constexpr size_t MESSAGES = 5000;
+
+    class RecordingLogger : public ILogger
+    {
+    public:
+        using ILogger::log;
+        void log(const std::string &message) override { messages.push_back(message); }
+
+        std::vector<std::string> messages;
+    };
+
+    void checkLevels()
+    {
+        RecordingLogger logger;
+        CHECK(logger.getLevel() == LogLevel::INFO);
+        size_t built = 0;
+        auto text = [&built](const std::string &message)
+        {
+            built++;
+            return message;
+        };
+        LOG_DEBUG(logger, text("debug"));
+        LOG_INFO(logger, text("info"));
+        logger.setLevel(LogLevel::WARN);
+        LOG_INFO(logger, text("info"));
+        LOG_WARN(logger, text("warn"));
+        LOG_ERROR(logger, text("error"));
+        logger.setLevel(LogLevel::OFF);
+        LOG_ERROR(logger, text("error"));
+        CHECK(built == 3);
+        CHECK((logger.messages == std::vector<std::string>{"info", "warn", "error"}));
+    }
+
+    std::vector<std::string> lines(const std::string &text)
+    {
+        std::vector<std::string> result;
+        std::istringstream in(text);
+        for (std::string line; std::getline(in, line);)
+        {
+            result.push_back(line);
+        }
+        return result;
+    }
+
+    void logFromThreads(AsyncLogger &logger)
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREADS; t++)
+        {
+            threads.emplace_back([&logger, t]
+                                 {
+                                     for (size_t i = 0; i < MESSAGES; i++)
+                                     {
+                                         LOG_WARN(logger, std::to_string(t) + " " + std::to_string(i));
+                                         LOG_DEBUG(logger, "hidden");
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Messages of every thread come out in the order it logged them. Returns
+    // the number of messages written.
+    size_t checkOrder(const std::vector<std::string> &written)
+    {
+        std::vector<long> last(THREADS, -1);
+        size_t messages = 0;
+        for (const auto &line : written)
+        {
+            CHECK(line.find("hidden") == std::string::npos);
+            if (line.rfind("[WARN] Log buffer full", 0) == 0)
+            {
+                continue;
+            }
+            CHECK(line.rfind("[WARN] ", 0) == 0);
+            std::istringstream fields(line.substr(7));
+            size_t thread;
+            long i;
+            fields >> thread >> i;
+            CHECK(thread < THREADS && i > last[thread]);
+            last[thread] = i;
+            messages++;
+        }
+        return messages;
+    }
+
+    void checkAsync()
+    {
+        std::ostringstream out;
+        {
+            AsyncLogger logger(out, THREADS * MESSAGES);
+            logFromThreads(logger);
+            logger.flush();
+            CHECK(logger.getDropped() == 0);
+        }
+        CHECK(checkOrder(lines(out.str())) == THREADS * MESSAGES);
+    }
+
+    // A ring too small to keep up drops messages instead of blocking, and
+    // reports how many.
+    void checkDrops()
+    {
+        std::ostringstream out;
+        uint64_t dropped;
+        {
+            AsyncLogger logger(out, 4);
+            logFromThreads(logger);
+            logger.flush();
+            dropped = logger.getDropped();
+        }
+        std::vector<std::string> written = lines(out.str());
+        CHECK(checkOrder(written) + dropped == THREADS * MESSAGES);
+        uint64_t reported = 0;
+        for (const auto &line : written)
+        {
+            if (line.rfind("[WARN] Log buffer full, dropped ", 0) == 0)
+            {
+                reported += std::stoull(line.substr(32));
+            }
+        }
+        CHECK(reported == dropped);
+    }
+
+    void checkGlobal()
+    {
+        RecordingLogger logger;
+        GlobalLogger::install(logger);
+        LOG_INFO(GlobalLogger::instance(), "installed");
+        GlobalLogger::reset();
+        CHECK(&GlobalLogger::instance() != &logger);
+        CHECK(logger.messages == std::vector<std::string>{"installed"});
+    }
+}
+
+int main()
+{
+    checkLevels();
+    checkAsync();
+    checkDrops();
+    checkGlobal();
+    return 0;
+}
@@ -0,0 +1,124 @@
+// TEXT values too long for a page, up to a megabyte, live in the overflow
+// file: rows holding them round-trip through scans, index lookups and
+// updates, openValue streams them in chunks, and all of it holds after the
+// table is reopened. The pages only keep the rows' references.
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "overflow_file.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr int32_t ROWS = 200;
+    constexpr int32_t HUGE_ROW = 7;
+    constexpr size_t HUGE_SIZE = (1u << 20) + 3;
+    constexpr size_t UPDATED_SIZE = 200000;
+    constexpr size_t CHUNK = 4096;
+
+    // Short values stay in the row, those over a quarter of a page move, and
+    // every tenth row is over 64K, past what a uint16_t length holds.
+    size_t sizeOf(int32_t id)
+    {
+        if (id == HUGE_ROW)
+        {
+            return HUGE_SIZE;
+        }
+        if (id % 10 == 0)
+        {
+            return 100000 + static_cast<size_t>(id);
+        }
+        return id % 3 == 0 ? 3000 : 10;
+    }
+
+    std::string valueOf(int32_t id, size_t size)
+    {
+        std::string value(size, ' ');
+        for (size_t i = 0; i < size; i++)
+        {
+            value[i] = static_cast<char>('a' + (i * 7 + static_cast<size_t>(id)) % 26);
+        }
+        return value;
+    }
+
+    std::string readAll(ValueReader &reader)
+    {
+        std::string value;
+        char chunk[CHUNK];
+        size_t read;
+        while ((read = reader.read(chunk, sizeof(chunk))) > 0)
+        {
+            CHECK(read <= sizeof(chunk));
+            value.append(chunk, read);
+        }
+        return value;
+    }
+
+    void checkTable(Table &table, bool updated)
+    {
+        std::vector<Row> rows = table.rangeQuery("id", 0, ROWS - 1);
+        CHECK(rows.size() == static_cast<size_t>(ROWS));
+        for (const auto &row : rows)
+        {
+            int32_t id = row.getInt(0);
+            size_t size = updated && id == 20 ? UPDATED_SIZE : sizeOf(id);
+            CHECK(row.getText(1) == valueOf(id, size));
+            CHECK(row.getText(2) == "tag" + std::to_string(id % 4));
+        }
+        CHECK(table.lookup("tag", std::string("tag3")).size() == static_cast<size_t>(ROWS / 4));
+
+        for (int32_t id : {HUGE_ROW, 10, 20, 3, 1})
+        {
+            std::vector<uint32_t> rowIds = table.findRowIds("id", id);
+            CHECK(rowIds.size() == 1);
+            ValueReader reader;
+            CHECK(table.openValue(rowIds[0], "doc", reader));
+            size_t size = updated && id == 20 ? UPDATED_SIZE : sizeOf(id);
+            CHECK(reader.size() == size);
+            CHECK(readAll(reader) == valueOf(id, size));
+        }
+        ValueReader missing;
+        CHECK(!table.openValue(UINT32_MAX, "doc", missing));
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("overflow");
+    size_t totalBytes = 0;
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("docs", {{"id", DataType::INT}, {"doc", DataType::TEXT}, {"tag", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(writeTsv(dir + "/docs.tsv", "id\tdoc\ttag", ROWS, [&](std::ostream &out, size_t i)
+                                               {
+                                                   int32_t id = static_cast<int32_t>(i);
+                                                   totalBytes += sizeOf(id);
+                                                   out << id << "\t" << valueOf(id, sizeOf(id)) << "\ttag" << id % 4; })));
+        CHECK(table.createIndex("id"));
+        CHECK(table.createHashIndex("tag"));
+        checkTable(table, false);
+
+        // Most of the bytes are in the overflow file, not on the pages.
+        CHECK(storage.getSize(dir + "/db/docs/overflow.dat") >= totalBytes - ROWS * 3000);
+        CHECK(table.getPageManager().getPageIds().size() < 10);
+
+        std::vector<uint32_t> rowIds = table.findRowIds("id", 20);
+        CHECK(table.updateRow(rowIds[0], Row(table.getSchema(), {20, valueOf(20, UPDATED_SIZE), std::string("tag0")})));
+        checkTable(table, true);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    Table &table = db.getTable("docs");
+    checkTable(table, true);
+    std::vector<uint32_t> rowIds = table.findRowIds("id", HUGE_ROW);
+    CHECK(table.deleteRow(rowIds[0]));
+    CHECK(table.lookup("id", HUGE_ROW).empty());
+    ValueReader reader;
+    CHECK(!table.openValue(rowIds[0], "doc", reader));
+    return 0;
+}
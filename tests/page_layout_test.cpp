@@ -0,0 +1,180 @@
+// Rows written to column-major page layouts, PAX and compressed, read back
+// exactly as written, through scans, index lookups and single-column reads,
+// after single inserts into partly filled pages as well as bulk loads, and
+// after reopening. Compressed pages encode the columns to fewer pages.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "compressed_page.h"
+#include "database.h"
+#include "pax_page.h"
+#include "table_scan.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ROWS = 6000;
+    constexpr size_t BATCHES = 3; // Single-insert loads; the rest is bulk loaded.
+    const std::string HEADER = "id\tname\tday\tamount";
+
+    std::vector<Column> columns()
+    {
+        return {{"id", DataType::INT}, {"name", DataType::TEXT}, {"day", DataType::DATE}, {"amount", DataType::FLOAT}};
+    }
+
+    // Names from empty to 60 bytes, and amounts of both signs.
+    std::string nameOf(size_t i)
+    {
+        return std::string(i % 61, static_cast<char>('a' + i % 26));
+    }
+
+    std::string dayOf(size_t i)
+    {
+        char day[11];
+        std::snprintf(day, sizeof(day), "%02zu/%02zu/%04zu", i % 28 + 1, (i / 28) % 12 + 1, 1990 + i / 336);
+        return day;
+    }
+
+    float amountOf(size_t i)
+    {
+        return (static_cast<float>(i) - ROWS / 2) * 0.25f;
+    }
+
+    std::string writeRows(const std::string &filename, size_t first, size_t rows)
+    {
+        return writeTsv(filename, HEADER, rows, [first](std::ostream &out, size_t i)
+                        {
+                            size_t id = first + i;
+                            out << id << "\t" << nameOf(id) << "\t" << dayOf(id) << "\t" << amountOf(id); });
+    }
+
+    void checkRow(const Row &row)
+    {
+        size_t id = static_cast<size_t>(row.getInt(0));
+        CHECK(id < ROWS);
+        CHECK(row.getText(1) == nameOf(id));
+        CHECK(row.getDate(2) == dayOf(id));
+        CHECK(row.getFloat(3) == amountOf(id));
+    }
+
+    void checkTable(Table &table)
+    {
+        std::vector<Column> schema = table.getSchema();
+        TableScan scan(table.getPageManager(), schema);
+        CHECK(scan.open());
+        std::vector<bool> seen(ROWS, false);
+        RowBatch batch;
+        while (scan.next(batch))
+        {
+            for (const auto &data : batch.rows)
+            {
+                Row row = Row::deserialize(schema, data.data(), data.size());
+                checkRow(row);
+                CHECK(!seen[row.getInt(0)]);
+                seen[row.getInt(0)] = true;
+            }
+        }
+        scan.close();
+        for (bool found : seen)
+        {
+            CHECK(found);
+        }
+
+        std::vector<Row> rows = table.rangeQuery("id", 1000, 1099);
+        CHECK(rows.size() == 100);
+        for (const auto &row : rows)
+        {
+            checkRow(row);
+        }
+        for (size_t id : {0, 200})
+        {
+            size_t sameName = 0;
+            for (size_t other = 0; other < ROWS; other++)
+            {
+                sameName += nameOf(other) == nameOf(id) ? 1 : 0;
+            }
+            CHECK(table.lookup("name", nameOf(id)).size() == sameName);
+        }
+        CHECK(table.rangeQuery("amount", -1.0f, 1.0f).size() == 9);
+        CHECK(table.lookup("day", dayOf(4000)).size() == 1);
+    }
+
+    void checkLayout(IStorage &storage, ILogger &logger, const std::string &dir, PageLayout layout, const std::string &name)
+    {
+        size_t batchRows = ROWS / 2 / BATCHES;
+        {
+            Database db(dir + "/db", storage, logger);
+            CHECK(db.initialize());
+            Table &table = db.createTable(name, columns(), layout);
+            for (size_t b = 0; b < BATCHES; b++)
+            {
+                CHECK(table.writeDataFromFile(writeRows(dir + "/" + name + std::to_string(b) + ".tsv", b * batchRows, batchRows)));
+            }
+            CHECK(table.writeDataFromFiles({writeRows(dir + "/" + name + "_bulk.tsv", ROWS / 2, ROWS / 2)}));
+            CHECK(table.createIndex("id"));
+            checkTable(table);
+        }
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        checkTable(db.getTable(name));
+    }
+
+    // Reads one column of a PAX or compressed page without decoding the others.
+    template <typename Format>
+    void checkColumns(IStorage &storage, ILogger &logger, const std::string &dir, const std::string &name)
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        PageManager &pageManager = db.getTable(name).getPageManager();
+        Format format(logger);
+        format.setSchema(columns());
+        std::vector<char> page;
+        for (uint32_t pageId : pageManager.getPageIds())
+        {
+            CHECK(pageManager.readPage(pageId, page));
+            std::vector<ReturnType> rows = format.readRows(page, pageId);
+            std::vector<Row::Value> names = format.readColumn(page, 1);
+            std::vector<Row::Value> amounts = format.readColumn(page, 3);
+            CHECK(names.size() == rows.size() && amounts.size() == rows.size());
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                Row row = Row::deserialize(columns(), rows[i].data.data.data(), rows[i].data.data.size());
+                CHECK(std::get<std::string>(names[i]) == row.getText(1));
+                CHECK(std::get<float>(amounts[i]) == row.getFloat(3));
+            }
+        }
+    }
+
+    // Ids and days are dense runs of numbers, which no page stores plain,
+    // and the table takes fewer pages than PAX.
+    void checkEncodings(IStorage &storage, ILogger &logger, const std::string &dir)
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        PageManager &pageManager = db.getTable("compressed").getPageManager();
+        CompressedPage format(logger);
+        format.setSchema(columns());
+        std::vector<char> page;
+        for (uint32_t pageId : pageManager.getPageIds())
+        {
+            CHECK(pageManager.readPage(pageId, page));
+            CHECK(format.columnEncoding(page, 0) != ColumnEncoding::PLAIN);
+            CHECK(format.columnEncoding(page, 2) != ColumnEncoding::PLAIN);
+        }
+        CHECK(pageManager.getPageIds().size() < db.getTable("pax").getPageManager().getPageIds().size());
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("page_layout");
+    checkLayout(storage, logger, dir, PageLayout::PAX, "pax");
+    checkColumns<PaxPage>(storage, logger, dir, "pax");
+    checkLayout(storage, logger, dir, PageLayout::COMPRESSED, "compressed");
+    checkColumns<CompressedPage>(storage, logger, dir, "compressed");
+    checkEncodings(storage, logger, dir);
+    return 0;
+}
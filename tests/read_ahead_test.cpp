@@ -0,0 +1,176 @@
+// Read-ahead: a sequential stream of page reads keeps the pages ahead of it
+// requested from storage in contiguous ranges, before they are read, and
+// interleaved streams are followed separately. Strided reads request
+// nothing. The window grows while read-ahead pages stay slow, up to its
+// limit, and a table scan prefetches its pages.
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "read_ahead.h"
+#include "table_scan.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr uint32_t PAGES = 2000;
+    constexpr uint32_t OTHER_STREAM = 100000;
+    constexpr std::chrono::nanoseconds FAST{1000};
+    constexpr std::chrono::nanoseconds SLOW{1000000};
+
+    struct Range
+    {
+        size_t offset;
+        size_t size;
+    };
+
+    // Records the prefetch requests for page.dat files.
+    class PrefetchStorage : public FileStorage
+    {
+    public:
+        explicit PrefetchStorage(ILogger &logger) : FileStorage(logger) {}
+
+        void prefetch(const std::string &filename, size_t offset, size_t size) override
+        {
+            if (filename.size() >= 9 && filename.compare(filename.size() - 9, 9, "/page.dat") == 0)
+            {
+                requests.push_back({offset, size});
+            }
+            FileStorage::prefetch(filename, offset, size);
+        }
+
+        std::vector<Range> requests;
+    };
+
+    // End of the requests of the stream starting at page first, which must
+    // follow one another without gaps or overlaps.
+    size_t requestedEnd(const std::vector<Range> &requests, uint32_t first)
+    {
+        size_t end = 0;
+        for (const auto &request : requests)
+        {
+            size_t page = request.offset / PAGE_SIZE;
+            if (page < first || page >= static_cast<size_t>(first) + OTHER_STREAM)
+            {
+                continue;
+            }
+            CHECK(end == 0 || request.offset == end);
+            end = request.offset + request.size;
+        }
+        return end;
+    }
+
+    void read(ReadAhead &readAhead, uint32_t pageId, std::chrono::nanoseconds latency)
+    {
+        readAhead.beforeRead(pageId);
+        readAhead.afterRead(pageId, latency);
+    }
+
+    void checkSequential(ILogger &logger, const std::string &dir)
+    {
+        PrefetchStorage storage(logger);
+        CHECK(storage.createFile(dir + "/page.dat"));
+        ReadAhead readAhead(storage, dir + "/page.dat");
+        read(readAhead, 0, FAST);
+        CHECK(storage.requests.empty());
+        for (uint32_t pageId = 1; pageId < PAGES; pageId++)
+        {
+            // Every page from the third on was requested before its read.
+            CHECK(pageId < 2 || requestedEnd(storage.requests, 0) > static_cast<size_t>(pageId) * PAGE_SIZE);
+            read(readAhead, pageId, FAST);
+        }
+        CHECK(storage.requests.front().offset == 2 * PAGE_SIZE);
+        // A request whenever half of the window was read.
+        CHECK(storage.requests.size() <= PAGES / (ReadAhead::MIN_WINDOW / 2) + 1);
+        for (const auto &request : storage.requests)
+        {
+            CHECK(request.size <= ReadAhead::MIN_WINDOW * PAGE_SIZE);
+        }
+    }
+
+    void checkInterleaved(ILogger &logger, const std::string &dir)
+    {
+        PrefetchStorage storage(logger);
+        ReadAhead readAhead(storage, dir + "/page.dat");
+        for (uint32_t pageId = 0; pageId < PAGES; pageId++)
+        {
+            read(readAhead, pageId, FAST);
+            read(readAhead, OTHER_STREAM + pageId, FAST);
+        }
+        CHECK(requestedEnd(storage.requests, 0) >= static_cast<size_t>(PAGES) * PAGE_SIZE);
+        CHECK(requestedEnd(storage.requests, OTHER_STREAM) >= static_cast<size_t>(OTHER_STREAM + PAGES) * PAGE_SIZE);
+
+        // Every third page: no page is the next one of a stream.
+        storage.requests.clear();
+        for (uint32_t pageId = 0; pageId < PAGES; pageId += 3)
+        {
+            read(readAhead, pageId, FAST);
+        }
+        CHECK(storage.requests.empty());
+    }
+
+    void checkWindow(ILogger &logger, const std::string &dir)
+    {
+        PrefetchStorage storage(logger);
+        ReadAhead readAhead(storage, dir + "/page.dat");
+        read(readAhead, 0, FAST);
+        for (uint32_t pageId = 1; pageId < PAGES * 4; pageId++)
+        {
+            read(readAhead, pageId, SLOW);
+        }
+        size_t largest = 0;
+        for (const auto &request : storage.requests)
+        {
+            CHECK(request.size <= ReadAhead::MAX_WINDOW_BYTES);
+            largest = std::max(largest, request.size);
+        }
+        CHECK(largest > ReadAhead::MAX_WINDOW_BYTES / 2);
+        CHECK(requestedEnd(storage.requests, 0) >= static_cast<size_t>(PAGES) * 4 * PAGE_SIZE);
+    }
+
+    void checkScan(ILogger &logger, const std::string &dir)
+    {
+        constexpr size_t ROWS = 50000;
+        {
+            FileStorage storage(logger);
+            Database db(dir + "/db", storage, logger);
+            CHECK(db.initialize());
+            Table &table = db.createTable("rows", {{"id", DataType::INT}, {"name", DataType::TEXT}});
+            CHECK(table.writeDataFromFile(writeTsv(dir + "/rows.tsv", "id\tname", ROWS, [](std::ostream &out, size_t i)
+                                                   { out << i << "\tname" << i; })));
+        }
+
+        PrefetchStorage storage(logger);
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.getTable("rows");
+        size_t pages = table.getPageManager().getPageIds().size();
+        storage.requests.clear();
+        TableScan scan(table.getPageManager(), table.getSchema());
+        CHECK(scan.open());
+        size_t rows = 0;
+        RowBatch batch;
+        while (scan.next(batch))
+        {
+            rows += batch.rows.size();
+        }
+        scan.close();
+        CHECK(rows == ROWS);
+        CHECK(!storage.requests.empty());
+        CHECK(storage.requests.size() < pages / 2);
+        CHECK(requestedEnd(storage.requests, 0) >= pages * PAGE_SIZE);
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    std::string dir = freshDirectory("read_ahead");
+    checkSequential(logger, dir);
+    checkInterleaved(logger, dir);
+    checkWindow(logger, dir);
+    checkScan(logger, dir);
+    return 0;
+}
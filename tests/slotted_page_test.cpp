@@ -0,0 +1,101 @@
+// Row maintenance on a single slotted page: deletes free slots for reuse,
+// updates grow rows in place or forward them, compaction reclaims dead bytes,
+// and slot ids outside the slot directory are refused without being read.
+#include <stdexcept>
+#include <string>
+
+#include "slotted_page.h"
+#include "test_util.h"
+
+namespace
+{
+    std::vector<char> bytes(size_t size, char fill)
+    {
+        return std::vector<char>(size, fill);
+    }
+
+    template <typename Action>
+    bool throwsRuntimeError(Action action)
+    {
+        try
+        {
+            action();
+        }
+        catch (const std::runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    SlottedPage format(logger);
+    format.setPageSize(PAGE_SIZE);
+    std::vector<char> page(PAGE_SIZE);
+    format.initPage(page);
+    PageDirectoryEntry entry{7, 0};
+
+    std::vector<ReturnType> placed = format.insert({{10, bytes(100, 'a')}, {11, bytes(100, 'b')}, {12, bytes(100, 'c')}}, page, entry);
+    CHECK(placed.size() == 3);
+    CHECK(placed[1].location.page_id == 7 && placed[1].location.slot_id == 1);
+    size_t freeAfterInsert = format.freeSpace(page);
+
+    // A deleted slot is reused by the next insert and its bytes turn dead.
+    format.erase(page, 1);
+    CHECK(format.readRows(page, 7).size() == 2);
+    CHECK(format.deadSpace(page) == 100);
+    uint16_t slotId = 0;
+    CHECK(!format.findRow(page, 11, slotId));
+    placed = format.insert({{13, bytes(50, 'd')}}, page, entry);
+    CHECK(placed[0].location.slot_id == 1);
+    CHECK(format.findRow(page, 13, slotId) && slotId == 1);
+    CHECK(format.compact(page) == 100);
+    CHECK(format.deadSpace(page) == 0);
+    CHECK(format.freeSpace(page) == freeAfterInsert + 50);
+
+    // Updates keep the slot id, in place or with the page's free space.
+    CHECK(format.update(page, 0, bytes(40, 'e')));
+    CHECK(format.read(page, 0).data == bytes(40, 'e'));
+    CHECK(format.update(page, 0, bytes(300, 'f')));
+    CHECK(format.read(page, 0).data == bytes(300, 'f'));
+    CHECK(!format.update(page, 0, bytes(PAGE_SIZE, 'g')));
+    CHECK(format.read(page, 0).data == bytes(300, 'f'));
+
+    // A forwarded home drops out of readRows but stays the row's home slot.
+    CHECK(format.forward(page, 2, {9, 4}));
+    Location forward{};
+    CHECK(format.slotState(page, 2, forward) == SlotState::FORWARDED);
+    CHECK(forward.page_id == 9 && forward.slot_id == 4);
+    CHECK(format.readRows(page, 7).size() == 2);
+    CHECK(format.findRow(page, 12, slotId) && slotId == 2);
+    CHECK(format.rowIds(page) == std::vector<uint32_t>({10, 13, 12}));
+    // A row moved in is never taken for its home.
+    format.setMoved(page, 1);
+    CHECK(format.slotState(page, 1, forward) == SlotState::MOVED);
+    CHECK(!format.findRow(page, 13, slotId));
+
+    // Slot ids past the slot directory, even past the page, are refused.
+    for (uint16_t outside : {uint16_t(3), uint16_t(60000)})
+    {
+        CHECK(throwsRuntimeError([&]
+                                 { format.erase(page, outside); }));
+        CHECK(throwsRuntimeError([&]
+                                 { format.update(page, outside, bytes(10, 'h')); }));
+        CHECK(throwsRuntimeError([&]
+                                 { format.forward(page, outside, {1, 1}); }));
+        CHECK(throwsRuntimeError([&]
+                                 { format.setMoved(page, outside); }));
+        CHECK(format.slotState(page, outside, forward) == SlotState::FREE);
+    }
+
+    // Deleting the last rows empties the page.
+    format.erase(page, 0);
+    format.erase(page, 1);
+    format.erase(page, 2);
+    CHECK(format.readRows(page, 7).empty());
+    CHECK(format.freeSpace(page) == format.emptyPageSpace());
+    return 0;
+}
@@ -0,0 +1,164 @@
+// External merge sort: input within the budget is sorted in memory, larger
+// input is spilled to runs and merged in as many passes as the budget needs.
+// The output is always a sorted permutation of the input, and no run file
+// outlives the operator. Spill files keep records of any length.
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sort_operator.h"
+#include "spill_file.h"
+#include "test_util.h"
+
+namespace
+{
+    constexpr size_t ROWS = 30000;
+
+    std::vector<Column> columns()
+    {
+        return {{"id", DataType::INT}, {"group", DataType::TEXT}, {"day", DataType::DATE}};
+    }
+
+    // Rows of a vector handed out in small batches, in a fixed random order.
+    class RowSource : public Operator
+    {
+    public:
+        explicit RowSource(size_t rows) : columns_(columns())
+        {
+            for (size_t i = 0; i < rows; i++)
+            {
+                char day[11];
+                std::snprintf(day, sizeof(day), "%02zu/%02zu/%04zu", i % 28 + 1, i % 12 + 1, 2000 + i % 20);
+                rows_.push_back(Row(columns_, {static_cast<int32_t>(i), "g" + std::to_string(i % 37), std::string(day)}).serialize());
+            }
+            std::shuffle(rows_.begin(), rows_.end(), std::mt19937(11));
+        }
+
+        const std::vector<Column> &getSchema() override { return columns_; }
+        bool open() override
+        {
+            position_ = 0;
+            return true;
+        }
+        bool next(RowBatch &batch) override
+        {
+            batch.rows.clear();
+            for (; position_ < rows_.size() && batch.rows.size() < 100; position_++)
+            {
+                batch.rows.push_back(rows_[position_]);
+            }
+            return !batch.rows.empty();
+        }
+
+    private:
+        std::vector<Column> columns_;
+        std::vector<std::vector<char>> rows_;
+        size_t position_ = 0;
+    };
+
+    std::vector<Row> drain(SortOperator &sort)
+    {
+        std::vector<Row> rows;
+        CHECK(sort.open());
+        RowBatch batch;
+        while (sort.next(batch))
+        {
+            for (const auto &data : batch.rows)
+            {
+                rows.push_back(Row::deserialize(columns(), data.data(), data.size()));
+            }
+        }
+        return rows;
+    }
+
+    // Sorts on id, descending, and checks every id comes out once.
+    void sortById(IStorage &storage, ILogger &logger, const std::string &spillDir, size_t budget, size_t minRuns, size_t maxRuns)
+    {
+        RowSource source(ROWS);
+        SortOperator sort(source, {{0, false}}, budget, storage, spillDir, logger);
+        std::vector<Row> rows = drain(sort);
+        CHECK(rows.size() == ROWS);
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            CHECK(rows[i].getInt(0) == static_cast<int32_t>(ROWS - 1 - i));
+        }
+        CHECK(sort.getNumRuns() >= minRuns && sort.getNumRuns() <= maxRuns);
+        sort.close();
+        CHECK(std::filesystem::is_empty(spillDir));
+    }
+
+    // Group ascending as text, then day descending as a date, then id.
+    void sortByTwoKeys(IStorage &storage, ILogger &logger, const std::string &spillDir)
+    {
+        RowSource source(ROWS);
+        SortOperator sort(source, {{1, true}, {2, false}, {0, true}}, 16 * 1024, storage, spillDir, logger);
+        std::vector<Row> rows = drain(sort);
+        CHECK(rows.size() == ROWS);
+        for (size_t i = 1; i < rows.size(); i++)
+        {
+            const Row &a = rows[i - 1];
+            const Row &b = rows[i];
+            CHECK(a.getText(1) <= b.getText(1));
+            if (a.getText(1) == b.getText(1))
+            {
+                int64_t dayA = Row::dateToKey(a.getDate(2));
+                int64_t dayB = Row::dateToKey(b.getDate(2));
+                CHECK(dayA >= dayB);
+                CHECK(dayA > dayB || a.getInt(0) < b.getInt(0));
+            }
+        }
+        sort.close();
+        CHECK(std::filesystem::is_empty(spillDir));
+    }
+
+    void checkSpillFile(IStorage &storage, const std::string &dir)
+    {
+        std::vector<std::vector<char>> records;
+        for (size_t size : std::vector<size_t>{0, 1, 100, PAGE_SIZE - 4, PAGE_SIZE, 3 * PAGE_SIZE + 5, 7})
+        {
+            std::vector<char> record(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                record[i] = static_cast<char>(i * 31 + size);
+            }
+            records.push_back(record);
+        }
+        SpillWriter writer(storage, dir + "/records.spill");
+        for (const auto &record : records)
+        {
+            writer.write(record);
+        }
+        writer.finish();
+        CHECK(writer.getNumRecords() == records.size());
+
+        SpillReader reader(storage, dir + "/records.spill");
+        std::vector<char> record;
+        for (const auto &expected : records)
+        {
+            CHECK(reader.next(record));
+            CHECK(record == expected);
+        }
+        CHECK(!reader.next(record));
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    FileStorage storage(logger);
+    std::string dir = freshDirectory("sort");
+    checkSpillFile(storage, dir);
+    std::string spillDir = freshDirectory(dir + "/spill");
+
+    // Within the budget: no run is written.
+    sortById(storage, logger, spillDir, 64 * 1024 * 1024, 0, 0);
+    // Up to 64 runs merged at once: a single merge.
+    sortById(storage, logger, spillDir, 256 * 1024, 2, 64);
+    // Four runs merged at once: over 64 runs take three intermediate passes.
+    sortById(storage, logger, spillDir, 16 * 1024, 65, SIZE_MAX);
+    sortByTwoKeys(storage, logger, spillDir);
+    return 0;
+}
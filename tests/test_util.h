@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "ILogger.h"
+#include "file_storage.h"
+
+// Checks stay on in release builds, unlike assert.
+#define CHECK(condition)                                                                 \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(condition))                                                                \
+        {                                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition "\n"; \
+            std::exit(1);                                                                \
+        }                                                                                \
+    } while (0)
+
+class NullLogger : public ILogger
+{
+public:
+    void log(const std::string &) override {}
+};
+
+// Counts the reads of table pages (the page.dat files), to check how many
+// pages a query had to read.
+class CountingStorage : public FileStorage
+{
+public:
+    explicit CountingStorage(ILogger &logger) : FileStorage(logger) {}
+
+    bool readFile(const std::string &filename, char *data, std::size_t size, std::streampos offset = 0) override
+    {
+        if (filename.size() >= 9 && filename.compare(filename.size() - 9, 9, "/page.dat") == 0)
+        {
+            pageReads++;
+        }
+        return FileStorage::readFile(filename, data, size, offset);
+    }
+
+    std::atomic<size_t> pageReads{0};
+};
+
+// A fresh, empty directory for the test's tables, under the working directory.
+inline std::string freshDirectory(const std::string &name)
+{
+    std::filesystem::remove_all(name);
+    std::filesystem::create_directories(name);
+    return name;
+}
+
+// Writes a tab separated file with the given header and rows, for
+// Table::writeDataFromFile.
+template <typename RowWriter>
+std::string writeTsv(const std::string &filename, const std::string &header, size_t rows, RowWriter writeRow)
+{
+    std::ofstream out(filename);
+    out << header << "\n";
+    for (size_t i = 0; i < rows; i++)
+    {
+        writeRow(out, i);
+        out << "\n";
+    }
+    return filename;
+}
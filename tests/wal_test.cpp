@@ -0,0 +1,134 @@
+// Write-ahead log: concurrent commits share syncs, recovery returns every
+// committed record in log order, stops at a torn record whose space later
+// commits reuse, and starts at the redo point of the last checkpoint.
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+#include "wal.h"
+
+namespace
+{
+    constexpr size_t THREADS = 4;
+    constexpr size_t COMMITS = 200;
+
+    class SyncCountingStorage : public FileStorage
+    {
+    public:
+        explicit SyncCountingStorage(ILogger &logger) : FileStorage(logger) {}
+
+        void syncFile(const std::string &filename) override
+        {
+            syncs++;
+            FileStorage::syncFile(filename);
+        }
+        void syncData(const std::string &filename) override
+        {
+            syncs++;
+            FileStorage::syncData(filename);
+        }
+
+        std::atomic<size_t> syncs{0};
+    };
+
+    std::vector<char> payloadOf(size_t thread, size_t i)
+    {
+        std::string text = std::to_string(thread) + ":" + std::to_string(i) + ":" + std::string(i % 300, 'w');
+        return std::vector<char>(text.begin(), text.end());
+    }
+
+    std::vector<WalRecord> recoverAll(IStorage &storage, ILogger &logger, const std::string &dir)
+    {
+        std::vector<WalRecord> records;
+        WriteAheadLog wal(dir, storage, logger);
+        wal.recover([&records](const WalRecord &record)
+                    { records.push_back(record); });
+        return records;
+    }
+
+    // Every commit of every thread, each thread's in commit order.
+    void checkRecords(const std::vector<WalRecord> &records, size_t commits)
+    {
+        CHECK(records.size() == THREADS * commits);
+        std::vector<size_t> next(THREADS, 0);
+        for (size_t r = 0; r < records.size(); r++)
+        {
+            CHECK(r == 0 || records[r].lsn > records[r - 1].lsn);
+            CHECK(records[r].type == WalRecordType::INSERT);
+            size_t thread = static_cast<size_t>(records[r].payload[0] - '0');
+            CHECK(thread < THREADS);
+            CHECK(records[r].payload == payloadOf(thread, next[thread]));
+            next[thread]++;
+        }
+    }
+
+    void commitFromThreads(WriteAheadLog &wal)
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < THREADS; t++)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                                     for (size_t i = 0; i < COMMITS; i++)
+                                     {
+                                         wal.commit(WalRecordType::INSERT, payloadOf(t, i));
+                                     } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+}
+
+int main()
+{
+    NullLogger logger;
+    SyncCountingStorage storage(logger);
+    std::string dir = freshDirectory("wal");
+
+    {
+        WriteAheadLog wal(dir, storage, logger);
+        size_t visited = 0;
+        wal.recover([&visited](const WalRecord &)
+                    { visited++; });
+        CHECK(visited == 0);
+        size_t syncsBefore = storage.syncs;
+        commitFromThreads(wal);
+        // Committers waiting on a running flush share the next one.
+        CHECK(storage.syncs - syncsBefore < THREADS * COMMITS * 3 / 4);
+    }
+    checkRecords(recoverAll(storage, logger, dir), COMMITS);
+
+    // Tear the last record: recovery stops before it, and the next commit
+    // takes its place.
+    std::vector<WalRecord> records = recoverAll(storage, logger, dir);
+    const WalRecord &last = records.back();
+    char torn = static_cast<char>(last.payload[0] ^ 0x55);
+    storage.writeFile(dir + "/wal.0.log", &torn, 1,
+                      static_cast<std::streamoff>(sizeof(WalFileHeader) + (last.lsn - records.front().lsn) + sizeof(WalRecordHeader)));
+    records = recoverAll(storage, logger, dir);
+    CHECK(records.size() == THREADS * COMMITS - 1);
+    {
+        WriteAheadLog wal(dir, storage, logger);
+        wal.recover([](const WalRecord &) {});
+        CHECK(wal.commit(WalRecordType::MODIFY, payloadOf(0, 7)) == last.lsn);
+    }
+    records = recoverAll(storage, logger, dir);
+    CHECK(records.size() == THREADS * COMMITS);
+    CHECK(records.back().type == WalRecordType::MODIFY && records.back().payload == payloadOf(0, 7));
+
+    // After a checkpoint only the records from its redo point are replayed.
+    {
+        WriteAheadLog wal(dir, storage, logger);
+        wal.recover([](const WalRecord &) {});
+        uint64_t redo = wal.switchFile();
+        CHECK(redo == wal.getEndLsn());
+        wal.checkpointed(redo);
+        CHECK(wal.commit(WalRecordType::INSERT, payloadOf(1, 1)) == redo);
+    }
+    records = recoverAll(storage, logger, dir);
+    CHECK(records.size() == 1 && records[0].payload == payloadOf(1, 1));
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Zone maps: range scans without an index skip the pages whose zones cannot
+// match, before and after the table is reopened, and never drop a matching
+// row of any column type.
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "database.h"
+#include "test_util.h"
+#include "zone_map.h"
+
+namespace
+{
+    constexpr int32_t ROWS = 20000;
+
+    // id ascends, so its zones are narrow; k is spread over every page.
+    std::string writeRows(const std::string &dir)
+    {
+        return writeTsv(dir + "/rows.tsv", "id\tk\tamount\tname", ROWS, [](std::ostream &out, size_t i)
+                        { out << i << "\t" << (i * 7919) % 1000 << "\t" << (static_cast<float>(i) - ROWS / 2) / 4 << "\tsharedprefix" << i; });
+    }
+
+    // Rows in the range, and the pages read to find them.
+    size_t pagesRead(CountingStorage &storage, Table &table, const std::string &column, const Row::Value &low,
+                     const Row::Value &high, size_t expectedRows)
+    {
+        size_t before = storage.pageReads;
+        CHECK(table.rangeQuery(column, low, high).size() == expectedRows);
+        return storage.pageReads - before;
+    }
+
+    void checkPruning(CountingStorage &storage, Table &table)
+    {
+        size_t pages = table.getPageManager().getPageIds().size();
+        CHECK(pages > 50);
+        CHECK(pagesRead(storage, table, "id", 5000, 5099, 100) <= 3);
+        CHECK(pagesRead(storage, table, "id", ROWS, ROWS + 100, 0) == 0);
+        CHECK(pagesRead(storage, table, "k", 10, 19, ROWS / 100) > pages / 2);
+        // Floats around zero, where the sign flips the bit order.
+        CHECK(pagesRead(storage, table, "amount", -1.0f, 0.0f, 5) <= 2);
+        CHECK(pagesRead(storage, table, "amount", -0.0f, 0.25f, 2) <= 2);
+        // Names share their first seven bytes, so zones cannot tell them apart.
+        CHECK(pagesRead(storage, table, "name", std::string("sharedprefix1000"), std::string("sharedprefix1000"), 1) == pages);
+    }
+
+    void checkKeyOrder()
+    {
+        const float floats[] = {-std::numeric_limits<float>::infinity(), -1e30f, -1.0f, -1e-30f, 0.0f, 1e-30f, 1.0f, 1e30f,
+                                std::numeric_limits<float>::infinity()};
+        for (size_t i = 1; i < sizeof(floats) / sizeof(floats[0]); i++)
+        {
+            CHECK(ZoneMap::toZoneKey(floats[i - 1], DataType::FLOAT) < ZoneMap::toZoneKey(floats[i], DataType::FLOAT));
+        }
+        CHECK(ZoneMap::toZoneKey(-0.0f, DataType::FLOAT) == ZoneMap::toZoneKey(0.0f, DataType::FLOAT));
+        CHECK(ZoneMap::toZoneKey(std::string("31/12/1999"), DataType::DATE) < ZoneMap::toZoneKey(std::string("01/01/2000"), DataType::DATE));
+        CHECK(ZoneMap::toZoneKey(std::string("abc"), DataType::TEXT) < ZoneMap::toZoneKey(std::string("abd"), DataType::TEXT));
+        CHECK(ZoneMap::toZoneKey(std::string(""), DataType::TEXT) >= 0);
+    }
+}
+
+int main()
+{
+    checkKeyOrder();
+    NullLogger logger;
+    CountingStorage storage(logger);
+    std::string dir = freshDirectory("zone_map");
+    std::string data = writeRows(dir);
+    {
+        Database db(dir + "/db", storage, logger);
+        CHECK(db.initialize());
+        Table &table = db.createTable("rows", {{"id", DataType::INT}, {"k", DataType::INT}, {"amount", DataType::FLOAT}, {"name", DataType::TEXT}});
+        CHECK(table.writeDataFromFile(data));
+        checkPruning(storage, table);
+    }
+
+    Database db(dir + "/db", storage, logger);
+    CHECK(db.initialize());
+    checkPruning(storage, db.getTable("rows"));
+    return 0;
+}